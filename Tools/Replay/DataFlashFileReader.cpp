@@ -1,5 +1,6 @@
 #include "DataFlashFileReader.h"
 #include <AP_Filesystem/AP_Filesystem.h>
+#include <AP_Logger/AP_Logger_Compress.h>
 
 #include <fcntl.h>
 #include <string.h>
@@ -19,6 +20,8 @@ AP_LoggerFileReader::AP_LoggerFileReader()
 AP_LoggerFileReader::~AP_LoggerFileReader()
 {
     ::printf("Replay counts: %" PRIu64 " bytes  %u entries\n", bytes_read, message_count);
+    delete[] frame_data;
+    delete[] block;
 }
 
 bool AP_LoggerFileReader::open_log(const char *logfile)
@@ -27,12 +30,40 @@ bool AP_LoggerFileReader::open_log(const char *logfile)
     if (fd == -1) {
         return false;
     }
+    compressed = AP_Logger_Compress::is_compressed(fd);
+    if (compressed && frame_data == nullptr) {
+        frame_data = new uint8_t[LOGGER_COMPRESS_BLOCK_MAX];
+        block = new uint8_t[LOGGER_COMPRESS_BLOCK_MAX];
+    }
+    block_len = block_ofs = 0;
     return true;
 }
 
 ssize_t AP_LoggerFileReader::read_input(void *buffer, const size_t count)
 {
-    uint64_t ret = AP::FS().read(fd, buffer, count);
+    if (!compressed) {
+        uint64_t ret = AP::FS().read(fd, buffer, count);
+        bytes_read += ret;
+        return ret;
+    }
+
+    // messages may span frames
+    uint8_t *b = (uint8_t *)buffer;
+    size_t ret = 0;
+    while (ret < count) {
+        if (block_ofs == block_len) {
+            const int32_t n = AP_Logger_Compress::read_frame(fd, frame_data, block);
+            if (n <= 0) {
+                break;
+            }
+            block_len = n;
+            block_ofs = 0;
+        }
+        const uint32_t n = MIN(count - ret, block_len - block_ofs);
+        memcpy(&b[ret], &block[block_ofs], n);
+        block_ofs += n;
+        ret += n;
+    }
     bytes_read += ret;
     return ret;
 }
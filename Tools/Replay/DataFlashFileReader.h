@@ -28,6 +28,13 @@ protected:
 private:
     ssize_t read_input(void *buf, size_t count);
 
+    // decoded block of a compressed log
+    bool compressed = false;
+    uint8_t *frame_data = nullptr;
+    uint8_t *block = nullptr;
+    uint32_t block_len = 0;
+    uint32_t block_ofs = 0;
+
     uint64_t bytes_read = 0;
     uint32_t message_count = 0;
     uint64_t start_micros;
@@ -6,8 +6,27 @@ check that replay produced identical results
 
 from __future__ import print_function
 
-def check_log(logfile, progress=print, ekf2_only=False, ekf3_only=False, verbose=False):
-    '''check replay log for matching output'''
+def within_tolerance(v1, v2, tolerance, abs_tolerance):
+    '''return true if two field values match within a relative and absolute tolerance'''
+    if v1 == v2:
+        return True
+    if tolerance <= 0 and abs_tolerance <= 0:
+        return False
+    try:
+        err = abs(float(v1) - float(v2))
+    except (TypeError, ValueError):
+        return False
+    if err != err:
+        # NaN in only one of the two
+        return False
+    return err <= max(abs_tolerance, tolerance * max(abs(float(v1)), abs(float(v2))))
+
+def check_log(logfile, progress=print, ekf2_only=False, ekf3_only=False, verbose=False,
+              tolerance=0, abs_tolerance=0):
+    '''check replay log for matching output. With a non-zero tolerance
+    fields are allowed to differ by tolerance relative to their magnitude
+    or abs_tolerance, and the largest difference seen in each field is
+    reported'''
     from pymavlink import mavutil
     progress("Processing log %s" % logfile)
     failure = 0
@@ -16,6 +35,8 @@ def check_log(logfile, progress=print, ekf2_only=False, ekf3_only=False, verbose
     base_count = 0
     counts = {}
     base_counts = {}
+    max_err = {}
+    tol_count = 0
 
     mlog = mavutil.mavlink_connection(logfile)
 
@@ -58,14 +79,27 @@ def check_log(logfile, progress=print, ekf2_only=False, ekf3_only=False, verbose
                 continue
             v1 = getattr(m,f)
             v2 = getattr(mb,f)
-            if v1 != v2:
-                mismatch = True
-                errors += 1
-                progress("Mismatch in field %s.%s: %s %s" % (mtype, f, str(v1), str(v2)))
+            if v1 == v2:
+                continue
+            if within_tolerance(v1, v2, tolerance, abs_tolerance):
+                tol_count += 1
+                key = "%s.%s" % (mtype, f)
+                err = abs(float(v1) - float(v2))
+                if err > max_err.get(key, (0,))[0]:
+                    max_err[key] = (err, v1, v2)
+                continue
+            mismatch = True
+            errors += 1
+            progress("Mismatch in field %s.%s: %s %s" % (mtype, f, str(v1), str(v2)))
         if mismatch:
             progress(mb)
             progress(m)
     progress("Processed %u/%u messages, %u errors" % (count, base_count, errors))
+    if tol_count > 0:
+        progress("%u fields differed within tolerance" % tol_count)
+        for key in sorted(max_err.keys()):
+            (err, v1, v2) = max_err[key]
+            progress("  %-12s max error %g (%s %s)" % (key, err, str(v1), str(v2)))
     if verbose:
         for mtype in counts.keys():
             progress("%s %u/%u %d" % (mtype, counts[mtype], base_counts[mtype], base_counts[mtype]-counts[mtype]))
@@ -82,13 +116,16 @@ if __name__ == '__main__':
     parser.add_argument("--ekf2-only", action='store_true', help="only check EKF2")
     parser.add_argument("--ekf3-only", action='store_true', help="only check EKF3")
     parser.add_argument("--verbose", action='store_true', help="verbose output")
+    parser.add_argument("--tolerance", type=float, default=0, help="allowed relative difference between fields")
+    parser.add_argument("--abs-tolerance", type=float, default=0, help="allowed absolute difference between fields")
     parser.add_argument("logs", metavar="LOG", nargs="+")
 
     args = parser.parse_args()
 
     failed = False
     for filename in args.logs:
-        if not check_log(filename, print, args.ekf2_only, args.ekf3_only, args.verbose):
+        if not check_log(filename, print, args.ekf2_only, args.ekf3_only, args.verbose,
+                         tolerance=args.tolerance, abs_tolerance=args.abs_tolerance):
             failed = True
 
     if failed:
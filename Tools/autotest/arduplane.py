@@ -1548,9 +1548,9 @@ class AutoTestPlane(AutoTest):
                 continue
             last_collision = now
 
-    def test_adsb_send_threatening_adsb_message(self, here):
+    def test_adsb_send_threatening_adsb_message(self, here, icao=37):
         self.progress("Sending ABSD_VEHICLE message")
-        self.mav.mav.adsb_vehicle_send(37, # ICAO address
+        self.mav.mav.adsb_vehicle_send(icao, # ICAO address
                                        int(here.lat * 1e7),
                                        int(here.lng * 1e7),
                                        mavutil.mavlink.ADSB_ALTITUDE_TYPE_PRESSURE_QNH,
@@ -1626,6 +1626,57 @@ class AutoTestPlane(AutoTest):
         if ex is not None:
             raise ex
 
+    def test_adsb_stress(self):
+        self.context_push()
+        ex = None
+        try:
+            self.set_parameter("ADSB_TYPE", 1)
+            self.set_parameter("ADSB_LIST_MAX", 500)
+            self.set_parameter("ADSB_LIST_RADIUS", 10000)
+            self.set_parameter("AVD_ENABLE", 1)
+            self.set_parameter("AVD_OBS_MAX", 100)
+            self.set_parameter("AVD_F_ACTION", mavutil.mavlink.MAV_COLLISION_ACTION_REPORT)
+            self.set_parameter("SIM_ADSB_COUNT", 500)
+            self.set_parameter("SIM_ADSB_RADIUS", 5000)
+            self.set_parameter("SR0_ADSB", 50)
+            self.reboot_sitl()
+            self.wait_ready_to_arm()
+
+            # simulated aircraft are sent from 10s after boot
+            self.progress("Collecting ADSB_VEHICLE messages")
+            seen = set()
+            tstart = self.get_sim_time()
+            while self.get_sim_time_cached() - tstart < 30:
+                m = self.mav.recv_match(type='ADSB_VEHICLE', blocking=True, timeout=1)
+                if m is not None:
+                    seen.add(m.ICAO_address)
+            self.progress("Saw %u distinct aircraft" % len(seen))
+            # the simulated ICAO addresses are random, so a few collide
+            if len(seen) < 400:
+                raise NotAchievedException("Saw only %u aircraft" % len(seen))
+
+            m = self.mav.recv_match(type='SYS_STATUS', blocking=True, timeout=5)
+            if m is None:
+                raise NotAchievedException("Did not get SYS_STATUS")
+            self.progress("Load with %u aircraft: %.1f%%" % (len(seen), m.load * 0.1))
+
+            # a threat must still be found amongst all the other traffic
+            here = self.mav.location()
+            self.test_adsb_send_threatening_adsb_message(here, icao=100037)
+            self.progress("Waiting for collision message")
+            m = self.mav.recv_match(type='COLLISION', condition='COLLISION.id==100037', blocking=True, timeout=4)
+            if m is None:
+                raise NotAchievedException("Did not get collision message")
+            if m.threat_level != 2:
+                raise NotAchievedException("Expected some threat at least")
+
+        except Exception as e:
+            ex = e
+        self.context_pop()
+        self.reboot_sitl()
+        if ex is not None:
+            raise ex
+
     def fly_do_guided_request(self, target_system=1, target_component=1):
         self.progress("Takeoff")
         self.takeoff(alt=50)
@@ -2135,6 +2186,10 @@ class AutoTestPlane(AutoTest):
              "Test ADSB",
              self.test_adsb),
 
+            ("ADSBStress",
+             "Test ADSB and avoidance with many aircraft",
+             self.test_adsb_stress),
+
             ("Button",
              "Test Buttons",
              self.test_button),
@@ -32,6 +32,7 @@
 
 #define VEHICLE_TIMEOUT_MS              5000   // if no updates in this time, drop it from the list
 #define ADSB_SQUAWK_OCTAL_DEFAULT       1200
+#define ADSB_ICAO_HASH_NONE             UINT16_MAX
 
 #ifndef ADSB_VEHICLE_LIST_SIZE_DEFAULT
     #define ADSB_VEHICLE_LIST_SIZE_DEFAULT  25
@@ -64,7 +65,7 @@ const AP_Param::GroupInfo AP_ADSB::var_info[] = {
     // @Param: LIST_MAX
     // @DisplayName: ADSB vehicle list size
     // @Description: ADSB list size of nearest vehicles. Longer lists take longer to refresh with lower SRx_ADSB values.
-    // @Range: 1 100
+    // @Range: 1 500
     // @User: Advanced
     // @RebootRequired: True
     AP_GROUPINFO("LIST_MAX",   2, AP_ADSB, in_state.list_size_param, ADSB_VEHICLE_LIST_SIZE_DEFAULT),
@@ -185,15 +186,37 @@ void AP_ADSB::init(void)
         // sanity check param
         in_state.list_size_param = constrain_int16(in_state.list_size_param, 1, INT16_MAX);
 
+        // at least twice as many hash slots as vehicles keeps the probe sequences short
+        uint32_t icao_hash_size = 16;
+        while (icao_hash_size < 2U * in_state.list_size_param) {
+            icao_hash_size <<= 1;
+        }
+
         in_state.vehicle_list = new adsb_vehicle_t[in_state.list_size_param];
+        in_state.vehicle_lat = new int32_t[in_state.list_size_param];
+        in_state.vehicle_lng = new int32_t[in_state.list_size_param];
+        in_state.icao_hash = new uint16_t[icao_hash_size];
 
-        if (in_state.vehicle_list == nullptr) {
+        if (in_state.vehicle_list == nullptr || in_state.vehicle_lat == nullptr ||
+            in_state.vehicle_lng == nullptr || in_state.icao_hash == nullptr) {
             // dynamic RAM allocation of in_state.vehicle_list[] failed
+            delete [] in_state.vehicle_list;
+            delete [] in_state.vehicle_lat;
+            delete [] in_state.vehicle_lng;
+            delete [] in_state.icao_hash;
+            in_state.vehicle_list = nullptr;
+            in_state.vehicle_lat = nullptr;
+            in_state.vehicle_lng = nullptr;
+            in_state.icao_hash = nullptr;
             _init_failed = true; // this keeps us from constantly trying to init forever in main update
             gcs().send_text(MAV_SEVERITY_INFO, "ADSB: Unable to initialize ADSB vehicle list");
             return;
         }
         in_state.list_size_allocated = in_state.list_size_param;
+        in_state.icao_hash_mask = icao_hash_size - 1;
+        for (uint32_t i = 0; i < icao_hash_size; i++) {
+            in_state.icao_hash[i] = ADSB_ICAO_HASH_NONE;
+        }
     }
 
     if (detected_num_instances == 0) {
@@ -369,22 +392,31 @@ void AP_ADSB::update(void)
  */
 void AP_ADSB::determine_furthest_aircraft(void)
 {
-    float max_distance = 0;
+    // compare squared distances in units of latitude, with longitude
+    // scaled at our own latitude rather than at each vehicle's. Only
+    // the distance to the furthest is found in metres
+    const float lng_scale = _my_loc.longitude_scale();
+    float max_distance_sq = 0;
     uint16_t max_distance_index = 0;
 
     for (uint16_t index = 0; index < in_state.vehicle_count; index++) {
         if (is_special_vehicle(in_state.vehicle_list[index].info.ICAO_address)) {
             continue;
         }
-        const float distance = _my_loc.get_distance(get_location(in_state.vehicle_list[index]));
-        if (max_distance < distance || index == 0) {
-            max_distance = distance;
+        const float dlat = (float)(in_state.vehicle_lat[index] - _my_loc.lat);
+        const float dlng = (float)(in_state.vehicle_lng[index] - _my_loc.lng) * lng_scale;
+        const float distance_sq = sq(dlat) + sq(dlng);
+        if (max_distance_sq < distance_sq || index == 0) {
+            max_distance_sq = distance_sq;
             max_distance_index = index;
         }
     } // for index
 
     in_state.furthest_vehicle_index = max_distance_index;
-    in_state.furthest_vehicle_distance = max_distance;
+    in_state.furthest_vehicle_distance = 0;
+    if (max_distance_sq > 0) {
+        in_state.furthest_vehicle_distance = _my_loc.get_distance(get_location(in_state.vehicle_list[max_distance_index]));
+    }
 }
 
 /*
@@ -417,8 +449,16 @@ void AP_ADSB::delete_vehicle(const uint16_t index)
         in_state.furthest_vehicle_distance = 0;
         in_state.furthest_vehicle_index = 0;
     }
+    icao_hash_remove(in_state.vehicle_list[index].info.ICAO_address);
     if (index != (in_state.vehicle_count-1)) {
+        // the last vehicle moves into the gap
+        uint16_t slot;
+        if (icao_hash_find(in_state.vehicle_list[in_state.vehicle_count-1].info.ICAO_address, slot)) {
+            in_state.icao_hash[slot] = index;
+        }
         in_state.vehicle_list[index] = in_state.vehicle_list[in_state.vehicle_count-1];
+        in_state.vehicle_lat[index] = in_state.vehicle_lat[in_state.vehicle_count-1];
+        in_state.vehicle_lng[index] = in_state.vehicle_lng[in_state.vehicle_count-1];
     }
     // TODO: is memset needed? When we decrement the index we essentially forget about it
     memset(&in_state.vehicle_list[in_state.vehicle_count-1], 0, sizeof(adsb_vehicle_t));
@@ -432,15 +472,78 @@ void AP_ADSB::delete_vehicle(const uint16_t index)
  */
 bool AP_ADSB::find_index(const adsb_vehicle_t &vehicle, uint16_t *index) const
 {
-    for (uint16_t i = 0; i < in_state.vehicle_count; i++) {
-        if (in_state.vehicle_list[i].info.ICAO_address == vehicle.info.ICAO_address) {
-            *index = i;
+    uint16_t slot;
+    if (!icao_hash_find(vehicle.info.ICAO_address, slot)) {
+        return false;
+    }
+    *index = in_state.icao_hash[slot];
+    return true;
+}
+
+/*
+ * first slot of the ICAO hash to look in for an ICAO address. The
+ * address is mixed so that runs of nearby addresses spread out
+ */
+uint16_t AP_ADSB::icao_hash_home(const uint32_t icao) const
+{
+    return ((icao * 0x9E3779B1U) >> 16) & in_state.icao_hash_mask;
+}
+
+/*
+ * find the ICAO hash slot holding the index of the vehicle with
+ * an ICAO address. Returns false if the vehicle is not in the list
+ */
+bool AP_ADSB::icao_hash_find(const uint32_t icao, uint16_t &slot) const
+{
+    if (in_state.icao_hash == nullptr) {
+        // not initialised, disabled or the allocation failed
+        return false;
+    }
+    for (uint16_t i = icao_hash_home(icao); in_state.icao_hash[i] != ADSB_ICAO_HASH_NONE; i = (i + 1) & in_state.icao_hash_mask) {
+        if (in_state.vehicle_list[in_state.icao_hash[i]].info.ICAO_address == icao) {
+            slot = i;
             return true;
         }
     }
     return false;
 }
 
+/*
+ * add a vehicle's index to the ICAO hash. There is always a free
+ * slot as the hash has more slots than the list has vehicles
+ */
+void AP_ADSB::icao_hash_insert(const uint32_t icao, const uint16_t index)
+{
+    uint16_t i = icao_hash_home(icao);
+    while (in_state.icao_hash[i] != ADSB_ICAO_HASH_NONE) {
+        i = (i + 1) & in_state.icao_hash_mask;
+    }
+    in_state.icao_hash[i] = index;
+}
+
+/*
+ * remove a vehicle from the ICAO hash. This must be done before the
+ * vehicle is overwritten in vehicle_list. The slots after it are
+ * shifted back so that no probe sequence is broken by the gap
+ */
+void AP_ADSB::icao_hash_remove(const uint32_t icao)
+{
+    uint16_t gap;
+    if (!icao_hash_find(icao, gap)) {
+        return;
+    }
+    const uint16_t mask = in_state.icao_hash_mask;
+    for (uint16_t i = (gap + 1) & mask; in_state.icao_hash[i] != ADSB_ICAO_HASH_NONE; i = (i + 1) & mask) {
+        const uint16_t home = icao_hash_home(in_state.vehicle_list[in_state.icao_hash[i]].info.ICAO_address);
+        // an entry can fill the gap if the gap lies between its home slot and where it is now
+        if (((i - home) & mask) >= ((i - gap) & mask)) {
+            in_state.icao_hash[gap] = in_state.icao_hash[i];
+            gap = i;
+        }
+    }
+    in_state.icao_hash[gap] = ADSB_ICAO_HASH_NONE;
+}
+
 /*
  * Update the vehicle list. If the vehicle is already in the
  * list then it will update it, otherwise it will be added.
@@ -535,7 +638,17 @@ void AP_ADSB::set_vehicle(const uint16_t index, const adsb_vehicle_t &vehicle)
         // out of range
         return;
     }
+    if (index >= in_state.vehicle_count) {
+        // new vehicle on the end of the list
+        icao_hash_insert(vehicle.info.ICAO_address, index);
+    } else if (in_state.vehicle_list[index].info.ICAO_address != vehicle.info.ICAO_address) {
+        // replacing a different vehicle
+        icao_hash_remove(in_state.vehicle_list[index].info.ICAO_address);
+        icao_hash_insert(vehicle.info.ICAO_address, index);
+    }
     in_state.vehicle_list[index] = vehicle;
+    in_state.vehicle_lat[index] = vehicle.info.lat;
+    in_state.vehicle_lng[index] = vehicle.info.lon;
 
     write_log(vehicle);
 }
@@ -43,6 +43,7 @@ public:
     friend class AP_ADSB_Backend;
     friend class AP_ADSB_uAvionix_MAVLink;
     friend class AP_ADSB_Sagetech;
+    friend class AP_ADSB_Test;
 
     // constructor
     AP_ADSB();
@@ -155,6 +156,12 @@ private:
     // return index of given vehicle if ICAO_ADDRESS matches. return -1 if no match
     bool find_index(const adsb_vehicle_t &vehicle, uint16_t *index) const;
 
+    // ICAO address hash, mapping the ICAO address of each vehicle in vehicle_list to its index
+    uint16_t icao_hash_home(const uint32_t icao) const;
+    bool icao_hash_find(const uint32_t icao, uint16_t &slot) const;
+    void icao_hash_insert(const uint32_t icao, const uint16_t index);
+    void icao_hash_remove(const uint32_t icao);
+
     // remove a vehicle from the list
     void delete_vehicle(const uint16_t index);
 
@@ -187,6 +194,16 @@ private:
         uint16_t    list_size_allocated;
         adsb_vehicle_t *vehicle_list;
         uint16_t    vehicle_count;
+
+        // position of each vehicle in vehicle_list, kept in their own arrays
+        // so that searches of the whole list only touch what they need
+        int32_t     *vehicle_lat;
+        int32_t     *vehicle_lng;
+
+        // open addressed hash of ICAO address to vehicle_list index, with
+        // ADSB_ICAO_HASH_NONE in unused slots. The size is a power of two
+        uint16_t    *icao_hash;
+        uint16_t    icao_hash_mask;
         AP_Int32    list_radius;
         AP_Int16    list_altitude;
 
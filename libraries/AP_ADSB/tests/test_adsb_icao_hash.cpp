@@ -0,0 +1,159 @@
+#include <AP_gtest.h>
+
+#include <stdlib.h>
+
+#include <AP_ADSB/AP_ADSB.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+static AP_ADSB adsb;
+
+/*
+  access to the vehicle list, and the ICAO hash which indexes it, of
+  the AP_ADSB above
+ */
+class AP_ADSB_Test
+{
+public:
+    // replace the vehicle list with an empty one, sized as init() does
+    static void init_list(uint16_t size) {
+        free_list();
+        uint16_t icao_hash_size = 16;
+        while (icao_hash_size < 2U * size) {
+            icao_hash_size <<= 1;
+        }
+        adsb.in_state.vehicle_list = new AP_ADSB::adsb_vehicle_t[size];
+        adsb.in_state.vehicle_lat = new int32_t[size];
+        adsb.in_state.vehicle_lng = new int32_t[size];
+        adsb.in_state.icao_hash = new uint16_t[icao_hash_size];
+        adsb.in_state.list_size_allocated = size;
+        adsb.in_state.vehicle_count = 0;
+        adsb.in_state.icao_hash_mask = icao_hash_size - 1;
+        memset(adsb.in_state.icao_hash, 0xFF, icao_hash_size * sizeof(uint16_t));
+    }
+
+    static void free_list() {
+        delete [] adsb.in_state.vehicle_list;
+        delete [] adsb.in_state.vehicle_lat;
+        delete [] adsb.in_state.vehicle_lng;
+        delete [] adsb.in_state.icao_hash;
+        adsb.in_state.vehicle_list = nullptr;
+        adsb.in_state.vehicle_lat = nullptr;
+        adsb.in_state.vehicle_lng = nullptr;
+        adsb.in_state.icao_hash = nullptr;
+        adsb.in_state.list_size_allocated = 0;
+        adsb.in_state.vehicle_count = 0;
+    }
+
+    static bool find_index(const AP_ADSB::adsb_vehicle_t &vehicle, uint16_t &index) {
+        return adsb.find_index(vehicle, &index);
+    }
+
+    // the index of the vehicle, found by searching the whole list
+    static int32_t find_index_linear(const AP_ADSB::adsb_vehicle_t &vehicle) {
+        for (uint16_t i = 0; i < adsb.in_state.vehicle_count; i++) {
+            if (adsb.in_state.vehicle_list[i].info.ICAO_address == vehicle.info.ICAO_address) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    static void add_vehicle(const AP_ADSB::adsb_vehicle_t &vehicle) {
+        adsb.set_vehicle(adsb.in_state.vehicle_count, vehicle);
+        adsb.in_state.vehicle_count++;
+    }
+
+    static void set_vehicle(uint16_t index, const AP_ADSB::adsb_vehicle_t &vehicle) {
+        adsb.set_vehicle(index, vehicle);
+    }
+
+    static void delete_vehicle(uint16_t index) {
+        adsb.delete_vehicle(index);
+    }
+
+    static uint16_t vehicle_count() {
+        return adsb.in_state.vehicle_count;
+    }
+
+    // check every vehicle is in the hash once and its position mirrored
+    static void check_list() {
+        uint16_t entries = 0;
+        for (uint16_t i = 0; i <= adsb.in_state.icao_hash_mask; i++) {
+            if (adsb.in_state.icao_hash[i] < adsb.in_state.list_size_allocated) {
+                entries++;
+            }
+        }
+        EXPECT_EQ(entries, adsb.in_state.vehicle_count);
+        for (uint16_t i = 0; i < adsb.in_state.vehicle_count; i++) {
+            uint16_t index;
+            EXPECT_TRUE(find_index(adsb.in_state.vehicle_list[i], index));
+            EXPECT_EQ(index, i);
+            EXPECT_EQ(adsb.in_state.vehicle_lat[i], adsb.in_state.vehicle_list[i].info.lat);
+            EXPECT_EQ(adsb.in_state.vehicle_lng[i], adsb.in_state.vehicle_list[i].info.lon);
+        }
+    }
+};
+
+/*
+  lookups before init(), as when ADSB is disabled or the allocation
+  failed, find nothing
+ */
+TEST(AP_ADSB, icao_uninitialised)
+{
+    AP_ADSB_Test::free_list();
+    AP_ADSB::adsb_vehicle_t vehicle {};
+    EXPECT_FALSE(adsb.get_vehicle_by_ICAO(0, vehicle));
+    EXPECT_FALSE(adsb.get_vehicle_by_ICAO(0xABCDEF, vehicle));
+}
+
+/*
+  random adds, updates, replacements and deletes, with the hash lookup
+  checked against a search of the whole list before each one. Half the
+  trials use ICAO addresses with their low bits clear, as a poor hash
+  would collide on those
+ */
+TEST(AP_ADSB, icao_hash)
+{
+    srand(1);
+    for (uint8_t trial = 0; trial < 20; trial++) {
+        const uint16_t size = 25 + trial * 25;
+        AP_ADSB_Test::init_list(size);
+
+        for (uint32_t op = 0; op < 200000; op++) {
+            AP_ADSB::adsb_vehicle_t vehicle {};
+            vehicle.info.ICAO_address = rand() % (3 * size);
+            if (trial % 2 == 0) {
+                vehicle.info.ICAO_address <<= 12;
+            }
+            vehicle.info.lat = rand();
+            vehicle.info.lon = rand();
+
+            uint16_t index;
+            const bool found = AP_ADSB_Test::find_index(vehicle, index);
+            const int32_t expected = AP_ADSB_Test::find_index_linear(vehicle);
+            ASSERT_EQ(found, expected >= 0) << "trial " << unsigned(trial) << " op " << op;
+            if (found) {
+                ASSERT_EQ(index, expected) << "trial " << unsigned(trial) << " op " << op;
+                if (rand() % 4 == 0) {
+                    AP_ADSB_Test::delete_vehicle(index);
+                } else {
+                    AP_ADSB_Test::set_vehicle(index, vehicle);
+                }
+            } else if (AP_ADSB_Test::vehicle_count() < size) {
+                AP_ADSB_Test::add_vehicle(vehicle);
+            } else {
+                // a full list replaces a vehicle
+                AP_ADSB_Test::set_vehicle(rand() % size, vehicle);
+            }
+
+            if (op % 1000 == 0) {
+                AP_ADSB_Test::check_list();
+            }
+        }
+        AP_ADSB_Test::check_list();
+    }
+    AP_ADSB_Test::free_list();
+}
+
+AP_GTEST_MAIN()
@@ -334,7 +334,7 @@ void AccelCalibrator::run_fit(uint8_t max_iterations, float& fitness)
     uint8_t num_iterations = 0;
 
     while(num_iterations < max_iterations) {
-        float JTJ[ACCEL_CAL_MAX_NUM_PARAMS*ACCEL_CAL_MAX_NUM_PARAMS] {};
+        MatrixN<float,ACCEL_CAL_MAX_NUM_PARAMS> JTJ;
         VectorP JTFI;
 
         for(uint16_t k = 0; k<_samples_collected; k++) {
@@ -348,21 +348,26 @@ void AccelCalibrator::run_fit(uint8_t max_iterations, float& fitness)
             for(uint8_t i = 0; i < get_num_params(); i++) {
                 // compute JTJ
                 for(uint8_t j = 0; j < get_num_params(); j++) {
-                    JTJ[i*get_num_params()+j] += jacob[i] * jacob[j];
+                    JTJ(i,j) += jacob[i] * jacob[j];
                 }
                 // compute JTFI
                 JTFI[i] += jacob[i] * calc_residual(sample, fit_param.s);
             }
         }
 
-        if (!inverse(JTJ, JTJ, get_num_params())) {
+        // an identity block keeps the parameters a smaller fit
+        // doesn't use out of the solve
+        for(uint8_t i = get_num_params(); i < ACCEL_CAL_MAX_NUM_PARAMS; i++) {
+            JTJ(i,i) = 1.0f;
+        }
+
+        VectorP step;
+        if (!JTJ.solve_symmetric(JTFI, step)) {
             return;
         }
 
         for(uint8_t row=0; row < get_num_params(); row++) {
-            for(uint8_t col=0; col < get_num_params(); col++) {
-                fit_param.a[row] -= JTFI[col] * JTJ[row*get_num_params()+col];
-            }
+            fit_param.a[row] -= step[row];
         }
 
         fitness = calc_mean_squared_residuals(fit_param.s);
@@ -18,6 +18,7 @@ UC_REGISTRY_BINDER(AirspeedCb, uavcan::equipment::air_data::RawAirData);
 
 AP_Airspeed_UAVCAN::DetectedModules AP_Airspeed_UAVCAN::_detected_modules[] = {0};
 HAL_Semaphore AP_Airspeed_UAVCAN::_sem_registry;
+AP_UAVCAN_DispatchTable<AP_Airspeed_UAVCAN> AP_Airspeed_UAVCAN::_dispatch;
 
 // constructor
 AP_Airspeed_UAVCAN::AP_Airspeed_UAVCAN(AP_Airspeed &_frontend, uint8_t _instance) :
@@ -58,6 +59,9 @@ AP_Airspeed_Backend* AP_Airspeed_UAVCAN::probe(AP_Airspeed &_frontend, uint8_t _
                                       _detected_modules[i].ap_uavcan->get_driver_index());
             } else {
                 _detected_modules[i].driver = backend;
+                _dispatch.set(_dispatch.make_key(_detected_modules[i].ap_uavcan->get_driver_index(),
+                                                 _detected_modules[i].node_id),
+                              backend);
                 AP::can().log_text(AP_CANManager::LOG_INFO, 
                                       LOG_TAG,
                                       "Registered UAVCAN Airspeed Node %d on Bus %d\n",
@@ -77,6 +81,12 @@ AP_Airspeed_UAVCAN* AP_Airspeed_UAVCAN::get_uavcan_backend(AP_UAVCAN* ap_uavcan,
         return nullptr;
     }
 
+    const uint32_t key = _dispatch.make_key(ap_uavcan->get_driver_index(), node_id);
+    AP_Airspeed_UAVCAN* driver;
+    if (_dispatch.find(key, driver)) {
+        return driver;
+    }
+
     for (uint8_t i = 0; i < AIRSPEED_MAX_SENSORS; i++) {
         if (_detected_modules[i].driver != nullptr &&
             _detected_modules[i].ap_uavcan == ap_uavcan &&
@@ -104,6 +114,8 @@ AP_Airspeed_UAVCAN* AP_Airspeed_UAVCAN::get_uavcan_backend(AP_UAVCAN* ap_uavcan,
         }
     }
 
+    // remember the source, probe() sets the backend once it is registered
+    _dispatch.set(key, nullptr);
     return nullptr;
 }
 
@@ -41,6 +41,9 @@ private:
         AP_Airspeed_UAVCAN *driver;
     } _detected_modules[AIRSPEED_MAX_SENSORS];
 
+    // backend lookup by message source
+    static AP_UAVCAN_DispatchTable<AP_Airspeed_UAVCAN> _dispatch;
+
     static HAL_Semaphore _sem_registry;
     bool _have_temperature;
 };
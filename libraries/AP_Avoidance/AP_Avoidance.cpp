@@ -143,16 +143,35 @@ void AP_Avoidance::init(void)
 {
     debug("ADSB initialisation: %d obstacles", _obstacles_max.get());
     if (_obstacles == nullptr) {
-        _obstacles = new AP_Avoidance::Obstacle[_obstacles_max];
+        const uint8_t n = _obstacles_max;
+        _obstacles = new AP_Avoidance::Obstacle[n];
+        // one float per obstacle in each of the arrays of ObstacleBatch
+        float *batch = new float[n * (sizeof(ObstacleBatch) / sizeof(float *))];
 
-        if (_obstacles == nullptr) {
+        if (_obstacles == nullptr || batch == nullptr) {
             // dynamic RAM allocation of _obstacles[] failed, disable gracefully
+            delete [] _obstacles;
+            delete [] batch;
+            _obstacles = nullptr;
             hal.console->printf("Unable to initialize Avoidance obstacle list\n");
             // disable ourselves to avoid repeated allocation attempts
             _enabled.set(0);
             return;
         }
-        _obstacles_allocated = _obstacles_max;
+        _obstacles_allocated = n;
+
+        _batch.pos_n = &batch[0];
+        _batch.pos_e = &batch[n];
+        _batch.pos_d = &batch[2*n];
+        _batch.vel_n = &batch[3*n];
+        _batch.vel_e = &batch[4*n];
+        _batch.vel_d = &batch[5*n];
+        _batch.horizon_fail = &batch[6*n];
+        _batch.horizon_warn = &batch[7*n];
+        _batch.closest_xy_fail = &batch[8*n];
+        _batch.closest_xy_warn = &batch[9*n];
+        _batch.closest_z_fail = &batch[10*n];
+        _batch.closest_z_warn = &batch[11*n];
     }
     _obstacle_count = 0;
     _last_state_change_ms = 0;
@@ -169,6 +188,8 @@ void AP_Avoidance::deinit(void)
     if (_obstacles != nullptr) {
         delete [] _obstacles;
         _obstacles = nullptr;
+        delete [] _batch.pos_n;
+        _batch = {};
         _obstacles_allocated = 0;
         handle_recovery(RecoveryAction::RTL);
     }
@@ -331,22 +352,65 @@ float closest_approach_z(const Location &my_loc,
     return ret/100.0f;
 }
 
-void AP_Avoidance::update_threat_level(const Location &my_loc,
-                                       const Vector3f &my_vel,
-                                       AP_Avoidance::Obstacle &obstacle)
+/*
+  the closest approach of the track (0,0) -> (vel * time_horizon) to pos,
+  calculated as closest_approach_xy does
+ */
+static inline float closest_approach_xy_one(const float pos_n, const float pos_e,
+                                            const float vel_n, const float vel_e,
+                                            const float time_horizon)
 {
+    const float w_n = vel_n * time_horizon;
+    const float w_e = vel_e * time_horizon;
+    const float l2 = sq(w_n) + sq(w_e);
+    // no division when the track is too short to have a direction, the closest
+    // point is then its end.  This keeps the loop free of branches
+    const float t = MIN(MAX((pos_n * w_n + pos_e * w_e) / MAX(l2, FLT_EPSILON), 0.0f), 1.0f);
+    const float t_or_end = (l2 < FLT_EPSILON) ? 1.0f : t;
+    return sqrtf(sq(w_n * t_or_end - pos_n) + sq(w_e * t_or_end - pos_e));
+}
 
-    Location &obstacle_loc = obstacle._location;
-    Vector3f &obstacle_vel = obstacle._velocity;
+// the closest vertical approach in metres, calculated as closest_approach_z does
+static inline float closest_approach_z_one(const float pos_d, const float vel_d, const float time_horizon)
+{
+    float ret;
+    if (pos_d >= 0 && vel_d >= 0) {
+        ret = pos_d;
+    } else if (pos_d <= 0 && vel_d <= 0) {
+        ret = fabsf(pos_d);
+    } else {
+        ret = fabsf(pos_d - vel_d * time_horizon);
+    }
+    return ret / 100.0f;
+}
 
+/*
+  calculate the closest approaches to many obstacles at once.  The
+  obstacles are in arrays of floats so the compiler can vectorise this
+ */
+void closest_approach_batch(const AP_Avoidance::ObstacleBatch &batch, const uint8_t count)
+{
+    for (uint8_t i=0; i<count; i++) {
+        batch.closest_xy_fail[i] = closest_approach_xy_one(batch.pos_n[i], batch.pos_e[i], batch.vel_n[i], batch.vel_e[i], batch.horizon_fail[i]);
+        batch.closest_xy_warn[i] = closest_approach_xy_one(batch.pos_n[i], batch.pos_e[i], batch.vel_n[i], batch.vel_e[i], batch.horizon_warn[i]);
+        batch.closest_z_fail[i] = closest_approach_z_one(batch.pos_d[i], batch.vel_d[i], batch.horizon_fail[i]);
+        batch.closest_z_warn[i] = closest_approach_z_one(batch.pos_d[i], batch.vel_d[i], batch.horizon_warn[i]);
+    }
+}
+
+// set the threat level of an obstacle from its closest approaches, which
+// closest_approach_batch has calculated at index in _batch
+void AP_Avoidance::update_threat_level(const uint8_t index,
+                                       AP_Avoidance::Obstacle &obstacle)
+{
     obstacle.threat_level = MAV_COLLISION_THREAT_LEVEL_NONE;
 
     const uint32_t obstacle_age = AP_HAL::millis() - obstacle.timestamp_ms;
-    float closest_xy = closest_approach_xy(my_loc, my_vel, obstacle_loc, obstacle_vel, _fail_time_horizon + obstacle_age/1000);
+    float closest_xy = _batch.closest_xy_fail[index];
     if (closest_xy < _fail_distance_xy) {
         obstacle.threat_level = MAV_COLLISION_THREAT_LEVEL_HIGH;
     } else {
-        closest_xy = closest_approach_xy(my_loc, my_vel, obstacle_loc, obstacle_vel, _warn_time_horizon + obstacle_age/1000);
+        closest_xy = _batch.closest_xy_warn[index];
         if (closest_xy < _warn_distance_xy) {
             obstacle.threat_level = MAV_COLLISION_THREAT_LEVEL_LOW;
         }
@@ -354,12 +418,12 @@ void AP_Avoidance::update_threat_level(const Location &my_loc,
 
     // check for vertical separation; our threat level is the minimum
     // of vertical and horizontal threat levels
-    float closest_z = closest_approach_z(my_loc, my_vel, obstacle_loc, obstacle_vel, _warn_time_horizon + obstacle_age/1000);
+    float closest_z = _batch.closest_z_warn[index];
     if (obstacle.threat_level != MAV_COLLISION_THREAT_LEVEL_NONE) {
         if (closest_z > _warn_distance_z) {
             obstacle.threat_level = MAV_COLLISION_THREAT_LEVEL_NONE;
         } else {
-            closest_z = closest_approach_z(my_loc, my_vel, obstacle_loc, obstacle_vel, _fail_time_horizon + obstacle_age/1000);
+            closest_z = _batch.closest_z_fail[index];
             if (closest_z > _fail_distance_z) {
                 obstacle.threat_level = MAV_COLLISION_THREAT_LEVEL_LOW;
             }
@@ -375,13 +439,13 @@ void AP_Avoidance::update_threat_level(const Location &my_loc,
     // level is none - but only *once the GCS has been informed*!
     obstacle.closest_approach_xy = closest_xy;
     obstacle.closest_approach_z = closest_z;
-    float current_distance = my_loc.get_distance(obstacle_loc);
+    const float current_distance = norm(_batch.pos_n[index], _batch.pos_e[index]);
     obstacle.distance_to_closest_approach = current_distance - closest_xy;
-    Vector2f net_velocity_ne = Vector2f(my_vel[0] - obstacle_vel[0], my_vel[1] - obstacle_vel[1]);
+    const float net_speed_ne = norm(_batch.vel_n[index], _batch.vel_e[index]);
     obstacle.time_to_closest_approach = 0.0f;
     if (!is_zero(obstacle.distance_to_closest_approach) &&
-        ! is_zero(net_velocity_ne.length())) {
-        obstacle.time_to_closest_approach = obstacle.distance_to_closest_approach / net_velocity_ne.length();
+        ! is_zero(net_speed_ne)) {
+        obstacle.time_to_closest_approach = obstacle.distance_to_closest_approach / net_speed_ne;
     }
 }
 
@@ -471,7 +535,25 @@ void AP_Avoidance::check_for_threats()
     }
 
     // we always check all obstacles to see if they are threats since it
-    // is most likely our own position and/or velocity have changed
+    // is most likely our own position and/or velocity have changed.
+    // Lay them out relative to us and find all their closest approaches together
+    const uint32_t now = AP_HAL::millis();
+    for (uint8_t i=0; i<_obstacle_count; i++) {
+        const AP_Avoidance::Obstacle &obstacle = _obstacles[i];
+        const uint32_t obstacle_age = now - obstacle.timestamp_ms;
+        const Vector2f delta_pos_ne = obstacle._location.get_distance_NE(my_loc);
+        _batch.pos_n[i] = delta_pos_ne.x;
+        _batch.pos_e[i] = delta_pos_ne.y;
+        _batch.pos_d[i] = obstacle._location.alt - my_loc.alt;
+        _batch.vel_n[i] = obstacle._velocity.x - my_vel.x;
+        _batch.vel_e[i] = obstacle._velocity.y - my_vel.y;
+        _batch.vel_d[i] = obstacle._velocity.z - my_vel.z;
+        // horizons are whole seconds, as they were when passed as a uint8_t
+        _batch.horizon_fail[i] = (uint8_t)(_fail_time_horizon + obstacle_age/1000);
+        _batch.horizon_warn[i] = (uint8_t)(_warn_time_horizon + obstacle_age/1000);
+    }
+    closest_approach_batch(_batch, _obstacle_count);
+
     // determine the current most-serious-threat
     _current_most_serious_threat = -1;
     for (uint8_t i=0; i<_obstacle_count; i++) {
@@ -480,7 +562,7 @@ void AP_Avoidance::check_for_threats()
         const uint32_t obstacle_age = AP_HAL::millis() - obstacle.timestamp_ms;
         debug("i=%d src_id=%d timestamp=%u age=%d", i, obstacle.src_id, obstacle.timestamp_ms, obstacle_age);
 
-        update_threat_level(my_loc, my_vel, obstacle);
+        update_threat_level(i, obstacle);
         debug("   threat-level=%d", obstacle.threat_level);
 
         // ignore any really old data:
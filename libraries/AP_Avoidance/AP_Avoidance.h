@@ -75,6 +75,25 @@ public:
         uint32_t last_gcs_report_time; // millis
     };
 
+    // obstacles relative to us, one array per field so that
+    // closest_approach_batch() can work through them together
+    struct ObstacleBatch {
+        float *pos_n;           // metres, our position north of the obstacle
+        float *pos_e;           // metres, our position east of the obstacle
+        float *pos_d;           // centimetres, the obstacle's altitude above ours
+        float *vel_n;           // m/s, the obstacle's velocity relative to ours
+        float *vel_e;
+        float *vel_d;
+        float *horizon_fail;    // seconds
+        float *horizon_warn;    // seconds
+
+        // results, in metres
+        float *closest_xy_fail; // closest horizontal approach within horizon_fail
+        float *closest_xy_warn; // closest horizontal approach within horizon_warn
+        float *closest_z_fail;  // closest vertical approach within horizon_fail
+        float *closest_z_warn;  // closest vertical approach within horizon_warn
+    };
+
 
     // add obstacle to the list of known obstacles
     void add_obstacle(uint32_t obstacle_timestamp_ms,
@@ -172,8 +191,7 @@ private:
     uint32_t src_id_for_adsb_vehicle(const AP_ADSB::adsb_vehicle_t &vehicle) const;
 
     void check_for_threats();
-    void update_threat_level(const Location &my_loc,
-                             const Vector3f &my_vel,
+    void update_threat_level(const uint8_t index,
                              AP_Avoidance::Obstacle &obstacle);
 
     // calls into the AP_ADSB library to retrieve vehicle data
@@ -185,6 +203,7 @@ private:
 
     // internal variables
     AP_Avoidance::Obstacle *_obstacles;
+    ObstacleBatch _batch;   // the arrays share one allocation, starting at pos_n
     uint8_t _obstacles_allocated;
     uint8_t _obstacle_count;
     int8_t _current_most_serious_threat;
@@ -227,6 +246,10 @@ float closest_approach_z(const Location &my_loc,
                          const Vector3f &obstacle_vel,
                          uint8_t time_horizon);
 
+// closest_approach_xy and closest_approach_z for the first count
+// obstacles in a batch, at both time horizons
+void closest_approach_batch(const AP_Avoidance::ObstacleBatch &batch, uint8_t count);
+
 
 namespace AP {
     AP_Avoidance *ap_avoidance();
@@ -0,0 +1,81 @@
+#include <AP_gtest.h>
+
+#include <stdlib.h>
+
+#include <AP_Avoidance/AP_Avoidance.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#define OBSTACLES 100
+
+// a random float between -range and range
+static float rand_float(float range)
+{
+    return (rand() / float(RAND_MAX) * 2 - 1) * range;
+}
+
+/*
+  closest_approach_batch() must give the same answers as
+  closest_approach_xy() and closest_approach_z(), given the obstacles
+  laid out relative to us as AP_Avoidance::check_for_threats() does
+ */
+TEST(AP_Avoidance, closest_approach_batch)
+{
+    float buf[12][OBSTACLES];
+    const AP_Avoidance::ObstacleBatch batch {
+        buf[0], buf[1], buf[2], buf[3], buf[4], buf[5], buf[6], buf[7],
+        buf[8], buf[9], buf[10], buf[11]
+    };
+    Location obstacle_loc[OBSTACLES];
+    Vector3f obstacle_vel[OBSTACLES];
+
+    srand(1);
+    for (uint16_t trial = 0; trial < 200; trial++) {
+        const Location my_loc(-353632620 + int32_t(rand_float(1e6)), 1491652370 + int32_t(rand_float(1e6)),
+                              50000 + int32_t(rand_float(20000)), Location::AltFrame::ABSOLUTE);
+        const Vector3f my_vel(rand_float(30), rand_float(30), rand_float(5));
+
+        for (uint8_t i = 0; i < OBSTACLES; i++) {
+            obstacle_loc[i] = my_loc;
+            obstacle_loc[i].offset(rand_float(5000), rand_float(5000));
+            obstacle_loc[i].alt += int32_t(rand_float(50000));
+            obstacle_vel[i] = Vector3f(rand_float(100), rand_float(100), rand_float(10));
+            if (i % 7 == 0) {
+                // no relative movement, so the track has no direction
+                obstacle_vel[i] = my_vel;
+            }
+            if (i % 11 == 0) {
+                // barely moving relative to us
+                obstacle_vel[i] = my_vel + Vector3f(1e-5, 0, 0);
+            }
+            if (i % 13 == 0) {
+                // level with us
+                obstacle_loc[i].alt = my_loc.alt;
+                obstacle_vel[i].z = my_vel.z;
+            }
+
+            const Vector2f delta_pos_ne = obstacle_loc[i].get_distance_NE(my_loc);
+            batch.pos_n[i] = delta_pos_ne.x;
+            batch.pos_e[i] = delta_pos_ne.y;
+            batch.pos_d[i] = obstacle_loc[i].alt - my_loc.alt;
+            batch.vel_n[i] = obstacle_vel[i].x - my_vel.x;
+            batch.vel_e[i] = obstacle_vel[i].y - my_vel.y;
+            batch.vel_d[i] = obstacle_vel[i].z - my_vel.z;
+            batch.horizon_fail[i] = (i % 17 == 0) ? 0 : 30 + rand() % 5;
+            batch.horizon_warn[i] = 30 + rand() % 30;
+        }
+
+        closest_approach_batch(batch, OBSTACLES);
+
+        for (uint8_t i = 0; i < OBSTACLES; i++) {
+            const uint8_t horizon_fail = batch.horizon_fail[i];
+            const uint8_t horizon_warn = batch.horizon_warn[i];
+            EXPECT_FLOAT_EQ(batch.closest_xy_fail[i], closest_approach_xy(my_loc, my_vel, obstacle_loc[i], obstacle_vel[i], horizon_fail));
+            EXPECT_FLOAT_EQ(batch.closest_xy_warn[i], closest_approach_xy(my_loc, my_vel, obstacle_loc[i], obstacle_vel[i], horizon_warn));
+            EXPECT_EQ(batch.closest_z_fail[i], closest_approach_z(my_loc, my_vel, obstacle_loc[i], obstacle_vel[i], horizon_fail));
+            EXPECT_EQ(batch.closest_z_warn[i], closest_approach_z(my_loc, my_vel, obstacle_loc[i], obstacle_vel[i], horizon_warn));
+        }
+    }
+}
+
+AP_GTEST_MAIN()
@@ -20,6 +20,7 @@ UC_REGISTRY_BINDER(TemperatureCb, uavcan::equipment::air_data::StaticTemperature
 
 AP_Baro_UAVCAN::DetectedModules AP_Baro_UAVCAN::_detected_modules[] = {0};
 HAL_Semaphore AP_Baro_UAVCAN::_sem_registry;
+AP_UAVCAN_DispatchTable<AP_Baro_UAVCAN> AP_Baro_UAVCAN::_dispatch;
 
 /*
   constructor - registers instance at top Baro driver
@@ -73,6 +74,9 @@ AP_Baro_Backend* AP_Baro_UAVCAN::probe(AP_Baro &baro)
                 backend->_pressure_count = 0;
                 backend->_ap_uavcan = _detected_modules[i].ap_uavcan;
                 backend->_node_id = _detected_modules[i].node_id;
+                _dispatch.set(_dispatch.make_key(_detected_modules[i].ap_uavcan->get_driver_index(),
+                                                 backend->_node_id),
+                              backend);
 
                 backend->_instance = backend->_frontend.register_sensor();
                 backend->set_bus_id(backend->_instance, AP_HAL::Device::make_bus_id(AP_HAL::Device::BUS_TYPE_UAVCAN,
@@ -96,6 +100,13 @@ AP_Baro_UAVCAN* AP_Baro_UAVCAN::get_uavcan_backend(AP_UAVCAN* ap_uavcan, uint8_t
     if (ap_uavcan == nullptr) {
         return nullptr;
     }
+
+    const uint32_t key = _dispatch.make_key(ap_uavcan->get_driver_index(), node_id);
+    AP_Baro_UAVCAN* driver;
+    if (_dispatch.find(key, driver)) {
+        return driver;
+    }
+
     for (uint8_t i = 0; i < BARO_MAX_DRIVERS; i++) {
         if (_detected_modules[i].driver != nullptr &&
             _detected_modules[i].ap_uavcan == ap_uavcan && 
@@ -123,6 +134,9 @@ AP_Baro_UAVCAN* AP_Baro_UAVCAN::get_uavcan_backend(AP_UAVCAN* ap_uavcan, uint8_t
                 }
             }
         }
+
+        // remember the source, probe() sets the backend once it is registered
+        _dispatch.set(key, nullptr);
     }
 
     return nullptr;
@@ -42,5 +42,8 @@ private:
         AP_Baro_UAVCAN* driver;
     } _detected_modules[BARO_MAX_DRIVERS];
 
+    // backend lookup by message source
+    static AP_UAVCAN_DispatchTable<AP_Baro_UAVCAN> _dispatch;
+
     static HAL_Semaphore _sem_registry;
 };
@@ -18,6 +18,9 @@ extern const AP_HAL::HAL& hal;
 
 UC_REGISTRY_BINDER(BattInfoCb, uavcan::equipment::power::BatteryInfo);
 
+AP_UAVCAN_DispatchTable<AP_BattMonitor_UAVCAN> AP_BattMonitor_UAVCAN::_dispatch;
+HAL_Semaphore AP_BattMonitor_UAVCAN::_sem_registry;
+
 /// Constructor
 AP_BattMonitor_UAVCAN::AP_BattMonitor_UAVCAN(AP_BattMonitor &mon, AP_BattMonitor::BattMonitor_State &mon_state, BattMonitor_UAVCAN_Type type, AP_BattMonitor_Params &params) :
     AP_BattMonitor_Backend(mon, mon_state, params),
@@ -50,6 +53,13 @@ AP_BattMonitor_UAVCAN* AP_BattMonitor_UAVCAN::get_uavcan_backend(AP_UAVCAN* ap_u
     if (ap_uavcan == nullptr) {
         return nullptr;
     }
+
+    const uint32_t key = _dispatch.make_key(ap_uavcan->get_driver_index(), node_id, battery_id);
+    AP_BattMonitor_UAVCAN* found;
+    if (_dispatch.find(key, found)) {
+        return found;
+    }
+
     for (uint8_t i = 0; i < AP::battery()._num_instances; i++) {
         if (AP::battery().drivers[i] == nullptr ||
             AP::battery().get_type(i) != AP_BattMonitor::Type::UAVCAN_BatteryInfo) {
@@ -57,6 +67,7 @@ AP_BattMonitor_UAVCAN* AP_BattMonitor_UAVCAN::get_uavcan_backend(AP_UAVCAN* ap_u
         }
         AP_BattMonitor_UAVCAN* driver = (AP_BattMonitor_UAVCAN*)AP::battery().drivers[i];
         if (driver->_ap_uavcan == ap_uavcan && driver->_node_id == node_id && match_battery_id(i, battery_id)) {
+            _dispatch.set(key, driver);
             return driver;
         }
     }
@@ -78,6 +89,7 @@ AP_BattMonitor_UAVCAN* AP_BattMonitor_UAVCAN::get_uavcan_backend(AP_UAVCAN* ap_u
                             "Registered BattMonitor Node %d on Bus %d\n",
                             node_id,
                             ap_uavcan->get_driver_index());
+            _dispatch.set(key, batmon);
             return batmon;
         }
     }
@@ -110,7 +122,11 @@ void AP_BattMonitor_UAVCAN::handle_battery_info(const BattInfoCb &cb)
 
 void AP_BattMonitor_UAVCAN::handle_battery_info_trampoline(AP_UAVCAN* ap_uavcan, uint8_t node_id, const BattInfoCb &cb)
 {
-    AP_BattMonitor_UAVCAN* driver = get_uavcan_backend(ap_uavcan, node_id, cb.msg->battery_id);
+    AP_BattMonitor_UAVCAN* driver;
+    {
+        WITH_SEMAPHORE(_sem_registry);
+        driver = get_uavcan_backend(ap_uavcan, node_id, cb.msg->battery_id);
+    }
     if (driver == nullptr) {
         return;
     }
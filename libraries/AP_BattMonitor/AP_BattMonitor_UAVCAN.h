@@ -47,4 +47,9 @@ private:
 
     AP_UAVCAN* _ap_uavcan;
     uint8_t _node_id;
+
+    // backend lookup by message source, only bound backends are
+    // added as the battery ID match depends on parameters
+    static AP_UAVCAN_DispatchTable<AP_BattMonitor_UAVCAN> _dispatch;
+    static HAL_Semaphore _sem_registry;
 };
@@ -33,6 +33,7 @@ UC_REGISTRY_BINDER(MagCb, uavcan::equipment::ahrs::MagneticFieldStrength);
 UC_REGISTRY_BINDER(Mag2Cb, uavcan::equipment::ahrs::MagneticFieldStrength2);
 
 AP_Compass_UAVCAN::DetectedModules AP_Compass_UAVCAN::_detected_modules[] = {0};
+AP_UAVCAN_DispatchTable<AP_Compass_UAVCAN> AP_Compass_UAVCAN::_dispatch;
 HAL_Semaphore AP_Compass_UAVCAN::_sem_registry;
 
 AP_Compass_UAVCAN::AP_Compass_UAVCAN(AP_UAVCAN* ap_uavcan, uint8_t node_id, uint8_t sensor_id, uint32_t devid)
@@ -81,6 +82,10 @@ AP_Compass_Backend* AP_Compass_UAVCAN::probe(uint8_t index)
                 return nullptr;
             }
             _detected_modules[index].driver = driver;
+            _dispatch.set(_dispatch.make_key(_detected_modules[index].ap_uavcan->get_driver_index(),
+                                             _detected_modules[index].node_id,
+                                             _detected_modules[index].sensor_id),
+                          driver);
             AP::can().log_text(AP_CANManager::LOG_INFO,
                                 LOG_TAG,
                                 "Found Mag Node %d on Bus %d Sensor ID %d\n",
@@ -111,6 +116,13 @@ AP_Compass_UAVCAN* AP_Compass_UAVCAN::get_uavcan_backend(AP_UAVCAN* ap_uavcan, u
     if (ap_uavcan == nullptr) {
         return nullptr;
     }
+
+    const uint32_t key = _dispatch.make_key(ap_uavcan->get_driver_index(), node_id, sensor_id);
+    AP_Compass_UAVCAN* driver;
+    if (_dispatch.find(key, driver)) {
+        return driver;
+    }
+
     for (uint8_t i=0; i<COMPASS_MAX_BACKEND; i++) {
         if (_detected_modules[i].driver &&
             _detected_modules[i].ap_uavcan == ap_uavcan &&
@@ -160,6 +172,9 @@ AP_Compass_UAVCAN* AP_Compass_UAVCAN::get_uavcan_backend(AP_UAVCAN* ap_uavcan, u
             }
         }
     }
+
+    // remember the source, probe() sets the backend once it is registered
+    _dispatch.set(key, nullptr);
     return nullptr;
 }
 
@@ -44,5 +44,8 @@ private:
         uint32_t devid;
     } _detected_modules[COMPASS_MAX_BACKEND];
 
+    // backend lookup by message source
+    static AP_UAVCAN_DispatchTable<AP_Compass_UAVCAN> _dispatch;
+
     static HAL_Semaphore _sem_registry;
 };
@@ -184,6 +184,50 @@ void CompassCalibrator::update()
         return;
     }
 
+    // run as many fit steps as fit in the time budget
+    const uint8_t attempt = _attempt;
+    const uint32_t fit_time_us = _fit_time_us;
+    const uint32_t start_us = AP_HAL::micros();
+    uint32_t dt_us;
+    do {
+        fit_step();
+        dt_us = AP_HAL::micros() - start_us;
+    } while (_fitting() && dt_us < COMPASS_CAL_FIT_BUDGET_US);
+
+    if (_attempt != attempt || !_running()) {
+        // this attempt has finished, successfully or not
+        GCS_SEND_TEXT(MAV_SEVERITY_INFO, "Mag(%u) fit %s in %.1f ms", _compass_idx,
+                      _status == Status::SUCCESS ? "done" : "failed",
+                      (double)((fit_time_us + dt_us) * 1.0e-3f));
+    } else {
+        _fit_time_us += dt_us;
+    }
+}
+
+#if COMPASS_CAL_THREAD_PER_COMPASS
+bool CompassCalibrator::start_thread()
+{
+    if (_thread_started) {
+        return true;
+    }
+    if (!hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&CompassCalibrator::thread_main, void), "compasscal", 2048, AP_HAL::Scheduler::PRIORITY_IO, 0)) {
+        return false;
+    }
+    _thread_started = true;
+    return true;
+}
+
+void CompassCalibrator::thread_main()
+{
+    while (true) {
+        update();
+        hal.scheduler->delay(1);
+    }
+}
+#endif
+
+void CompassCalibrator::fit_step()
+{
     if (_status == Status::RUNNING_STEP_ONE) {
         if (_fit_step >= 10) {
             if (is_equal(_fitness, _initial_fitness) || isnan(_fitness)) {  // if true, means that fitness is diverging instead of converging
@@ -233,6 +277,7 @@ void CompassCalibrator::pull_sample()
         update_completion_mask(mag_sample.get());
         _sample_buffer[_samples_collected] = mag_sample;
         _samples_collected++;
+        _fit_samples_loaded = false;
     }
 }
 
@@ -353,6 +398,8 @@ void CompassCalibrator::reset_state()
 {
     _samples_collected = 0;
     _samples_thinned = 0;
+    _fit_samples_loaded = false;
+    _fit_time_us = 0;
     _params.radius = 200;
     _params.offset.zero();
     _params.diag = Vector3f(1.0f,1.0f,1.0f);
@@ -373,10 +420,7 @@ bool CompassCalibrator::set_status(CompassCalibrator::Status status)
         case Status::NOT_STARTED:
             reset_state();
             _status = Status::NOT_STARTED;
-            if (_sample_buffer != nullptr) {
-                free(_sample_buffer);
-                _sample_buffer = nullptr;
-            }
+            free_sample_buffers();
             return true;
 
         case Status::WAITING_TO_START:
@@ -398,7 +442,10 @@ bool CompassCalibrator::set_status(CompassCalibrator::Status status)
             if (_sample_buffer == nullptr) {
                 _sample_buffer = (CompassSample*)calloc(COMPASS_CAL_NUM_SAMPLES, sizeof(CompassSample));
             }
-            if (_sample_buffer != nullptr) {
+            if (_fit_samples == nullptr) {
+                _fit_samples = (FitSamples*)calloc(1, sizeof(FitSamples));
+            }
+            if (_sample_buffer != nullptr && _fit_samples != nullptr) {
                 initialize_fit();
                 _status = Status::RUNNING_STEP_ONE;
                 return true;
@@ -419,10 +466,7 @@ bool CompassCalibrator::set_status(CompassCalibrator::Status status)
                 return false;
             }
 
-            if (_sample_buffer != nullptr) {
-                free(_sample_buffer);
-                _sample_buffer = nullptr;
-            }
+            free_sample_buffers();
 
             _status = Status::SUCCESS;
             return true;
@@ -446,10 +490,7 @@ bool CompassCalibrator::set_status(CompassCalibrator::Status status)
                 return true;
             }
 
-            if (_sample_buffer != nullptr) {
-                free(_sample_buffer);
-                _sample_buffer = nullptr;
-            }
+            free_sample_buffers();
 
             _status = status;
             return true;
@@ -459,6 +500,15 @@ bool CompassCalibrator::set_status(CompassCalibrator::Status status)
     };
 }
 
+void CompassCalibrator::free_sample_buffers()
+{
+    free(_sample_buffer);
+    _sample_buffer = nullptr;
+    free(_fit_samples);
+    _fit_samples = nullptr;
+    _fit_samples_loaded = false;
+}
+
 bool CompassCalibrator::fit_acceptable()
 {
     if (!isnan(_fitness) &&
@@ -501,6 +551,7 @@ void CompassCalibrator::thin_samples()
             _samples_thinned++;
         }
     }
+    _fit_samples_loaded = false;
 
     update_completion_mask();
 }
@@ -531,12 +582,13 @@ bool CompassCalibrator::accept_sample(const Vector3f& sample, uint16_t skip_inde
         return false;
     }
 
-    float min_distance = _params.radius * 2*sinf(theta/2);
+    // compare squared distances to avoid a sqrt per sample
+    const float min_distance_sq = sq(_params.radius * 2*sinf(theta/2));
 
     for (uint16_t i = 0; i<_samples_collected; i++) {
         if (i != skip_index) {
-            float distance = (sample - _sample_buffer[i].get()).length();
-            if (distance < min_distance) {
+            const float distance_sq = (sample - _sample_buffer[i].get()).length_squared();
+            if (distance_sq < min_distance_sq) {
                 return false;
             }
         }
@@ -566,6 +618,22 @@ float CompassCalibrator::calc_mean_squared_residuals(const param_t& params) cons
         return 1.0e30f;
     }
     float sum = 0.0f;
+    if (_fit_samples_loaded) {
+        const FitSamples &s = *_fit_samples;
+        const Vector3f &offset = params.offset;
+        const Vector3f &diag = params.diag;
+        const Vector3f &offdiag = params.offdiag;
+        for (uint16_t k=0; k < _samples_collected; k++) {
+            const float sx = s.x[k] + offset.x;
+            const float sy = s.y[k] + offset.y;
+            const float sz = s.z[k] + offset.z;
+            const float A = diag.x*sx    + offdiag.x*sy + offdiag.y*sz;
+            const float B = offdiag.x*sx + diag.y*sy    + offdiag.z*sz;
+            const float C = offdiag.y*sx + offdiag.z*sy + diag.z*sz;
+            sum += sq(params.radius - sqrtf(A*A + B*B + C*C));
+        }
+        return sum / _samples_collected;
+    }
     for (uint16_t i=0; i < _samples_collected; i++) {
         Vector3f sample = _sample_buffer[i].get();
         float resid = calc_residual(sample, params);
@@ -586,34 +654,94 @@ void CompassCalibrator::calc_initial_offset()
     _params.offset /= _samples_collected;
 }
 
-void CompassCalibrator::calc_sphere_jacob(const Vector3f& sample, const param_t& params, float* ret) const
+void CompassCalibrator::load_fit_samples()
+{
+    if (_fit_samples_loaded) {
+        return;
+    }
+    for (uint16_t k = 0; k < _samples_collected; k++) {
+        const Vector3f sample = _sample_buffer[k].get();
+        _fit_samples->x[k] = sample.x;
+        _fit_samples->y[k] = sample.y;
+        _fit_samples->z[k] = sample.z;
+    }
+    _fit_samples_loaded = true;
+}
+
+/*
+  build the normal equations for a Levenberg-Marquardt step in a
+  single pass over the samples. The residual of each sample is
+  radius - |softiron*(sample+offset)|, and the Jacobian row is its
+  derivative with respect to the fit parameters: radius and offsets
+  for the sphere fit, offsets, diagonals and off-diagonals for the
+  ellipsoid fit. Only the upper triangle of J^T*J is accumulated
+ */
+template <uint8_t N>
+void CompassCalibrator::calc_normal_equations(const param_t& params, MatrixN<float,N> &JTJ, VectorN<float,N> &JTFI) const
 {
+    static_assert(N == COMPASS_CAL_NUM_SPHERE_PARAMS || N == COMPASS_CAL_NUM_ELLIPSOID_PARAMS, "unknown fit");
+
+    const FitSamples &s = *_fit_samples;
     const Vector3f &offset = params.offset;
     const Vector3f &diag = params.diag;
     const Vector3f &offdiag = params.offdiag;
-    Matrix3f softiron(
-        diag.x    , offdiag.x , offdiag.y,
-        offdiag.x , diag.y    , offdiag.z,
-        offdiag.y , offdiag.z , diag.z
-    );
 
-    float A =  (diag.x    * (sample.x + offset.x)) + (offdiag.x * (sample.y + offset.y)) + (offdiag.y * (sample.z + offset.z));
-    float B =  (offdiag.x * (sample.x + offset.x)) + (diag.y    * (sample.y + offset.y)) + (offdiag.z * (sample.z + offset.z));
-    float C =  (offdiag.y * (sample.x + offset.x)) + (offdiag.z * (sample.y + offset.y)) + (diag.z    * (sample.z + offset.z));
-    float length = (softiron*(sample+offset)).length();
-
-    // 0: partial derivative (radius wrt fitness fn) fn operated on sample
-    ret[0] = 1.0f;
-    // 1-3: partial derivative (offsets wrt fitness fn) fn operated on sample
-    ret[1] = -1.0f * (((diag.x    * A) + (offdiag.x * B) + (offdiag.y * C))/length);
-    ret[2] = -1.0f * (((offdiag.x * A) + (diag.y    * B) + (offdiag.z * C))/length);
-    ret[3] = -1.0f * (((offdiag.y * A) + (offdiag.z * B) + (diag.z    * C))/length);
+    for (uint16_t k = 0; k < _samples_collected; k++) {
+        const float sx = s.x[k] + offset.x;
+        const float sy = s.y[k] + offset.y;
+        const float sz = s.z[k] + offset.z;
+        const float A = diag.x*sx    + offdiag.x*sy + offdiag.y*sz;
+        const float B = offdiag.x*sx + diag.y*sy    + offdiag.z*sz;
+        const float C = offdiag.y*sx + offdiag.z*sy + diag.z*sz;
+        const float length = sqrtf(A*A + B*B + C*C);
+        const float inv_length = 1.0f / length;
+        const float resid = params.radius - length;
+
+        // partial derivatives wrt the offsets
+        const float d_ofs_x = -((diag.x*A    + offdiag.x*B + offdiag.y*C) * inv_length);
+        const float d_ofs_y = -((offdiag.x*A + diag.y*B    + offdiag.z*C) * inv_length);
+        const float d_ofs_z = -((offdiag.y*A + offdiag.z*B + diag.z*C) * inv_length);
+
+        float jacob[N];
+        if (N == COMPASS_CAL_NUM_SPHERE_PARAMS) {
+            jacob[0] = 1.0f;
+            jacob[1] = d_ofs_x;
+            jacob[2] = d_ofs_y;
+            jacob[3] = d_ofs_z;
+        } else {
+            jacob[0] = d_ofs_x;
+            jacob[1] = d_ofs_y;
+            jacob[2] = d_ofs_z;
+            // diagonals
+            jacob[3] = -(sx * A) * inv_length;
+            jacob[4] = -(sy * B) * inv_length;
+            jacob[5] = -(sz * C) * inv_length;
+            // off-diagonals
+            jacob[6] = -((sy * A) + (sx * B)) * inv_length;
+            jacob[7] = -((sz * A) + (sx * C)) * inv_length;
+            jacob[8] = -((sz * B) + (sy * C)) * inv_length;
+        }
+
+        for (uint8_t i = 0; i < N; i++) {
+            for (uint8_t j = i; j < N; j++) {
+                JTJ(i,j) += jacob[i] * jacob[j];
+            }
+            JTFI[i] += jacob[i] * resid;
+        }
+    }
+
+    // fill in the lower triangle
+    for (uint8_t i = 1; i < N; i++) {
+        for (uint8_t j = 0; j < i; j++) {
+            JTJ(i,j) = JTJ(j,i);
+        }
+    }
 }
 
 // run sphere fit to calculate diagonals and offdiagonals
 void CompassCalibrator::run_sphere_fit()
 {
-    if (_sample_buffer == nullptr) {
+    if (_sample_buffer == nullptr || _fit_samples == nullptr) {
         return;
     }
 
@@ -625,50 +753,36 @@ void CompassCalibrator::run_sphere_fit()
     param_t fit1_params, fit2_params;
     fit1_params = fit2_params = _params;
 
-    float JTJ[COMPASS_CAL_NUM_SPHERE_PARAMS*COMPASS_CAL_NUM_SPHERE_PARAMS] = { };
-    float JTJ2[COMPASS_CAL_NUM_SPHERE_PARAMS*COMPASS_CAL_NUM_SPHERE_PARAMS] = { };
-    float JTFI[COMPASS_CAL_NUM_SPHERE_PARAMS] = { };
+    MatrixN<float,COMPASS_CAL_NUM_SPHERE_PARAMS> JTJ;
+    VectorN<float,COMPASS_CAL_NUM_SPHERE_PARAMS> JTFI;
 
     // Gauss Newton Part common for all kind of extensions including LM
-    for (uint16_t k = 0; k<_samples_collected; k++) {
-        Vector3f sample = _sample_buffer[k].get();
-
-        float sphere_jacob[COMPASS_CAL_NUM_SPHERE_PARAMS];
-
-        calc_sphere_jacob(sample, fit1_params, sphere_jacob);
-
-        for (uint8_t i = 0;i < COMPASS_CAL_NUM_SPHERE_PARAMS; i++) {
-            // compute JTJ
-            for (uint8_t j = 0; j < COMPASS_CAL_NUM_SPHERE_PARAMS; j++) {
-                JTJ[i*COMPASS_CAL_NUM_SPHERE_PARAMS+j] += sphere_jacob[i] * sphere_jacob[j];
-                JTJ2[i*COMPASS_CAL_NUM_SPHERE_PARAMS+j] += sphere_jacob[i] * sphere_jacob[j];   //a backup JTJ for LM
-            }
-            // compute JTFI
-            JTFI[i] += sphere_jacob[i] * calc_residual(sample, fit1_params);
-        }
-    }
+    load_fit_samples();
+    calc_normal_equations<COMPASS_CAL_NUM_SPHERE_PARAMS>(fit1_params, JTJ, JTFI);
+    MatrixN<float,COMPASS_CAL_NUM_SPHERE_PARAMS> JTJ2 = JTJ;   //a backup JTJ for LM
 
     //------------------------Levenberg-Marquardt-part-starts-here---------------------------------//
     // refer: http://en.wikipedia.org/wiki/Levenberg%E2%80%93Marquardt_algorithm#Choice_of_damping_parameter
     for (uint8_t i = 0; i < COMPASS_CAL_NUM_SPHERE_PARAMS; i++) {
-        JTJ[i*COMPASS_CAL_NUM_SPHERE_PARAMS+i] += _sphere_lambda;
-        JTJ2[i*COMPASS_CAL_NUM_SPHERE_PARAMS+i] += _sphere_lambda/lma_damping;
+        JTJ(i,i) += _sphere_lambda;
+        JTJ2(i,i) += _sphere_lambda/lma_damping;
     }
 
-    if (!inverse(JTJ, JTJ, 4)) {
+    // solve the damped normal equations for the parameter steps,
+    // rather than forming the inverses
+    VectorN<float,COMPASS_CAL_NUM_SPHERE_PARAMS> step1, step2;
+    if (!JTJ.solve_symmetric(JTFI, step1)) {
         return;
     }
 
-    if (!inverse(JTJ2, JTJ2, 4)) {
+    if (!JTJ2.solve_symmetric(JTFI, step2)) {
         return;
     }
 
     // extract radius, offset, diagonals and offdiagonal parameters
     for (uint8_t row=0; row < COMPASS_CAL_NUM_SPHERE_PARAMS; row++) {
-        for (uint8_t col=0; col < COMPASS_CAL_NUM_SPHERE_PARAMS; col++) {
-            fit1_params.get_sphere_params()[row] -= JTFI[col] * JTJ[row*COMPASS_CAL_NUM_SPHERE_PARAMS+col];
-            fit2_params.get_sphere_params()[row] -= JTFI[col] * JTJ2[row*COMPASS_CAL_NUM_SPHERE_PARAMS+col];
-        }
+        fit1_params.get_sphere_params()[row] -= step1[row];
+        fit2_params.get_sphere_params()[row] -= step2[row];
     }
 
     // calculate fitness of two possible sets of parameters
@@ -697,39 +811,9 @@ void CompassCalibrator::run_sphere_fit()
     }
 }
 
-void CompassCalibrator::calc_ellipsoid_jacob(const Vector3f& sample, const param_t& params, float* ret) const
-{
-    const Vector3f &offset = params.offset;
-    const Vector3f &diag = params.diag;
-    const Vector3f &offdiag = params.offdiag;
-    Matrix3f softiron(
-        diag.x    , offdiag.x , offdiag.y,
-        offdiag.x , diag.y    , offdiag.z,
-        offdiag.y , offdiag.z , diag.z
-    );
-
-    float A =  (diag.x    * (sample.x + offset.x)) + (offdiag.x * (sample.y + offset.y)) + (offdiag.y * (sample.z + offset.z));
-    float B =  (offdiag.x * (sample.x + offset.x)) + (diag.y    * (sample.y + offset.y)) + (offdiag.z * (sample.z + offset.z));
-    float C =  (offdiag.y * (sample.x + offset.x)) + (offdiag.z * (sample.y + offset.y)) + (diag.z    * (sample.z + offset.z));
-    float length = (softiron*(sample+offset)).length();
-
-    // 0-2: partial derivative (offset wrt fitness fn) fn operated on sample
-    ret[0] = -1.0f * (((diag.x    * A) + (offdiag.x * B) + (offdiag.y * C))/length);
-    ret[1] = -1.0f * (((offdiag.x * A) + (diag.y    * B) + (offdiag.z * C))/length);
-    ret[2] = -1.0f * (((offdiag.y * A) + (offdiag.z * B) + (diag.z    * C))/length);
-    // 3-5: partial derivative (diag offset wrt fitness fn) fn operated on sample
-    ret[3] = -1.0f * ((sample.x + offset.x) * A)/length;
-    ret[4] = -1.0f * ((sample.y + offset.y) * B)/length;
-    ret[5] = -1.0f * ((sample.z + offset.z) * C)/length;
-    // 6-8: partial derivative (off-diag offset wrt fitness fn) fn operated on sample
-    ret[6] = -1.0f * (((sample.y + offset.y) * A) + ((sample.x + offset.x) * B))/length;
-    ret[7] = -1.0f * (((sample.z + offset.z) * A) + ((sample.x + offset.x) * C))/length;
-    ret[8] = -1.0f * (((sample.z + offset.z) * B) + ((sample.y + offset.y) * C))/length;
-}
-
 void CompassCalibrator::run_ellipsoid_fit()
 {
-    if (_sample_buffer == nullptr) {
+    if (_sample_buffer == nullptr || _fit_samples == nullptr) {
         return;
     }
 
@@ -741,50 +825,34 @@ void CompassCalibrator::run_ellipsoid_fit()
     param_t fit1_params, fit2_params;
     fit1_params = fit2_params = _params;
 
-    float JTJ[COMPASS_CAL_NUM_ELLIPSOID_PARAMS*COMPASS_CAL_NUM_ELLIPSOID_PARAMS] = { };
-    float JTJ2[COMPASS_CAL_NUM_ELLIPSOID_PARAMS*COMPASS_CAL_NUM_ELLIPSOID_PARAMS] = { };
-    float JTFI[COMPASS_CAL_NUM_ELLIPSOID_PARAMS] = { };
+    MatrixN<float,COMPASS_CAL_NUM_ELLIPSOID_PARAMS> JTJ;
+    VectorN<float,COMPASS_CAL_NUM_ELLIPSOID_PARAMS> JTFI;
 
     // Gauss Newton Part common for all kind of extensions including LM
-    for (uint16_t k = 0; k<_samples_collected; k++) {
-        Vector3f sample = _sample_buffer[k].get();
-
-        float ellipsoid_jacob[COMPASS_CAL_NUM_ELLIPSOID_PARAMS];
-
-        calc_ellipsoid_jacob(sample, fit1_params, ellipsoid_jacob);
-
-        for (uint8_t i = 0;i < COMPASS_CAL_NUM_ELLIPSOID_PARAMS; i++) {
-            // compute JTJ
-            for (uint8_t j = 0; j < COMPASS_CAL_NUM_ELLIPSOID_PARAMS; j++) {
-                JTJ [i*COMPASS_CAL_NUM_ELLIPSOID_PARAMS+j] += ellipsoid_jacob[i] * ellipsoid_jacob[j];
-                JTJ2[i*COMPASS_CAL_NUM_ELLIPSOID_PARAMS+j] += ellipsoid_jacob[i] * ellipsoid_jacob[j];
-            }
-            // compute JTFI
-            JTFI[i] += ellipsoid_jacob[i] * calc_residual(sample, fit1_params);
-        }
-    }
+    load_fit_samples();
+    calc_normal_equations<COMPASS_CAL_NUM_ELLIPSOID_PARAMS>(fit1_params, JTJ, JTFI);
+    MatrixN<float,COMPASS_CAL_NUM_ELLIPSOID_PARAMS> JTJ2 = JTJ;
 
     //------------------------Levenberg-Marquardt-part-starts-here---------------------------------//
     //refer: http://en.wikipedia.org/wiki/Levenberg%E2%80%93Marquardt_algorithm#Choice_of_damping_parameter
     for (uint8_t i = 0; i < COMPASS_CAL_NUM_ELLIPSOID_PARAMS; i++) {
-        JTJ[i*COMPASS_CAL_NUM_ELLIPSOID_PARAMS+i] += _ellipsoid_lambda;
-        JTJ2[i*COMPASS_CAL_NUM_ELLIPSOID_PARAMS+i] += _ellipsoid_lambda/lma_damping;
+        JTJ(i,i) += _ellipsoid_lambda;
+        JTJ2(i,i) += _ellipsoid_lambda/lma_damping;
     }
 
-    if (!inverse(JTJ, JTJ, 9)) {
+    VectorN<float,COMPASS_CAL_NUM_ELLIPSOID_PARAMS> step1, step2;
+    if (!JTJ.solve_symmetric(JTFI, step1)) {
         return;
     }
 
-    if (!inverse(JTJ2, JTJ2, 9)) {
+    if (!JTJ2.solve_symmetric(JTFI, step2)) {
         return;
     }
 
     // extract radius, offset, diagonals and offdiagonal parameters
     for (uint8_t row=0; row < COMPASS_CAL_NUM_ELLIPSOID_PARAMS; row++) {
-        for (uint8_t col=0; col < COMPASS_CAL_NUM_ELLIPSOID_PARAMS; col++) {
-            fit1_params.get_ellipsoid_params()[row] -= JTFI[col] * JTJ[row*COMPASS_CAL_NUM_ELLIPSOID_PARAMS+col];
-            fit2_params.get_ellipsoid_params()[row] -= JTFI[col] * JTJ2[row*COMPASS_CAL_NUM_ELLIPSOID_PARAMS+col];
-        }
+        fit1_params.get_ellipsoid_params()[row] -= step1[row];
+        fit2_params.get_ellipsoid_params()[row] -= step2[row];
     }
 
     // calculate fitness of two possible sets of parameters
@@ -845,7 +913,7 @@ void CompassCalibrator::AttitudeSample::set_from_ahrs(void)
     yaw = constrain_int16(127 * (yaw_rad / M_PI), -127, 127);
 }
 
-Matrix3f CompassCalibrator::AttitudeSample::get_rotmat(void)
+Matrix3f CompassCalibrator::AttitudeSample::get_rotmat(void) const
 {
     float roll_rad, pitch_rad, yaw_rad;
     roll_rad = roll * (M_PI / 127);
@@ -867,7 +935,7 @@ Matrix3f CompassCalibrator::AttitudeSample::get_rotmat(void)
   Note that this earth field uses an arbitrary north reference, so it
   may not match the true earth field.
  */
-Vector3f CompassCalibrator::calculate_earth_field(CompassSample &sample, enum Rotation r)
+Vector3f CompassCalibrator::calculate_earth_field(const CompassSample &sample, const Matrix3f &rot, enum Rotation r)
 {
     Vector3f v = sample.get();
 
@@ -886,8 +954,6 @@ Vector3f CompassCalibrator::calculate_earth_field(CompassSample &sample, enum Ro
     v += rot_offsets;
 
     // rotate the sample from body frame back to earth frame
-    Matrix3f rot = sample.att.get_rotmat();
-
     Vector3f efield = rot * v;
 
     // earth field is the mag sample in earth frame
@@ -910,22 +976,30 @@ bool CompassCalibrator::calculate_orientation(void)
     EXPECT_DELAY_MS(1000);
 
     float variance[ROTATION_MAX_AUTO_ROTATION+1] {};
+    Vector3f avg_efield[ROTATION_MAX_AUTO_ROTATION+1] {};
 
     _orientation_solution = _orientation;
-    
-    for (enum Rotation r = ROTATION_NONE; r <= ROTATION_MAX_AUTO_ROTATION; r = (enum Rotation)(r+1)) {
-        // calculate the average implied earth field across all samples
-        Vector3f total_ef {};
-        for (uint32_t i=0; i<_samples_collected; i++) {
-            Vector3f efield = calculate_earth_field(_sample_buffer[i], r);
-            total_ef += efield;
+
+    // the attitude of each sample is the same for every rotation, so
+    // loop over samples on the outside to only expand it twice
+
+    // calculate the average implied earth field across all samples
+    for (uint32_t i=0; i<_samples_collected; i++) {
+        const Matrix3f rot = _sample_buffer[i].att.get_rotmat();
+        for (enum Rotation r = ROTATION_NONE; r <= ROTATION_MAX_AUTO_ROTATION; r = (enum Rotation)(r+1)) {
+            avg_efield[r] += calculate_earth_field(_sample_buffer[i], rot, r);
         }
-        Vector3f avg_efield = total_ef / _samples_collected;
+    }
+    for (enum Rotation r = ROTATION_NONE; r <= ROTATION_MAX_AUTO_ROTATION; r = (enum Rotation)(r+1)) {
+        avg_efield[r] /= _samples_collected;
+    }
 
-        // now calculate the square error for this rotation against the average earth field
-        for (uint32_t i=0; i<_samples_collected; i++) {
-            Vector3f efield = calculate_earth_field(_sample_buffer[i], r);
-            float err = (efield - avg_efield).length_squared();
+    // now calculate the square error for each rotation against the average earth field
+    for (uint32_t i=0; i<_samples_collected; i++) {
+        const Matrix3f rot = _sample_buffer[i].att.get_rotmat();
+        for (enum Rotation r = ROTATION_NONE; r <= ROTATION_MAX_AUTO_ROTATION; r = (enum Rotation)(r+1)) {
+            Vector3f efield = calculate_earth_field(_sample_buffer[i], rot, r);
+            float err = (efield - avg_efield[r]).length_squared();
             // divide by number of samples collected to get the variance
             variance[r] += err / _samples_collected;
         }
@@ -1010,6 +1084,7 @@ bool CompassCalibrator::calculate_orientation(void)
         s.rotate(besti);
         _sample_buffer[i].set(s);
     }
+    _fit_samples_loaded = false;
 
     _orientation = besti;
     _orientation_solution = besti;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <AP_Math/AP_Math.h>
+#include <AP_Math/matrixN.h>
 
 #define COMPASS_CAL_NUM_SPHERE_PARAMS       4
 #define COMPASS_CAL_NUM_ELLIPSOID_PARAMS    9
@@ -9,6 +10,18 @@
 #define COMPASS_MAX_SCALE_FACTOR 1.5
 #define COMPASS_MIN_SCALE_FACTOR (1.0/COMPASS_MAX_SCALE_FACTOR)
 
+// time a single update() may spend on fit steps. A fit step is cheap
+// enough that a whole fit phase usually completes in one call
+#ifndef COMPASS_CAL_FIT_BUDGET_US
+#define COMPASS_CAL_FIT_BUDGET_US 2000
+#endif
+
+// give each calibrator its own thread so that fits for several
+// compasses run in parallel
+#ifndef COMPASS_CAL_THREAD_PER_COMPASS
+#define COMPASS_CAL_THREAD_PER_COMPASS (CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX)
+#endif
+
 class CompassCalibrator {
 public:
     CompassCalibrator();
@@ -33,6 +46,11 @@ public:
     // update the state machine and calculate offsets, diagonals and offdiagonals
     void update();
 
+#if COMPASS_CAL_THREAD_PER_COMPASS
+    // start a thread which calls update() for this calibrator
+    bool start_thread();
+#endif
+
     // compass calibration states
     enum class Status {
         NOT_STARTED = 0,
@@ -114,7 +132,7 @@ private:
     // compact class for approximate attitude, to save memory
     class AttitudeSample {
     public:
-        Matrix3f get_rotmat();
+        Matrix3f get_rotmat() const;
         void set_from_ahrs();
     private:
         int8_t roll;
@@ -134,6 +152,14 @@ private:
         int16_t z;
     };
 
+    // copy of the sample buffer laid out for the fit, loaded once the
+    // buffer is full as the samples don't change while fitting
+    struct FitSamples {
+        float x[COMPASS_CAL_NUM_SAMPLES];
+        float y[COMPASS_CAL_NUM_SAMPLES];
+        float z[COMPASS_CAL_NUM_SAMPLES];
+    };
+
     // set status including any required initialisation
     bool set_status(Status status);
 
@@ -150,6 +176,15 @@ private:
     // clear sample buffer and reset offsets and scaling to their defaults
     void reset_state();
 
+    // free the sample buffer and fit samples
+    void free_sample_buffers();
+
+    // fill _fit_samples from the sample buffer if needed
+    void load_fit_samples();
+
+    // run one step of the sphere or ellipsoid fit, or finish the fit
+    void fit_step();
+
     // initialize fitness before starting a fit
     void initialize_fit();
 
@@ -169,12 +204,15 @@ private:
     // calculate initial offsets by simply taking the average values of the samples
     void calc_initial_offset();
 
+    // accumulate J^T*J and J^T*residual over all fit samples for the
+    // sphere (4 parameter) or ellipsoid (9 parameter) model
+    template <uint8_t N>
+    void calc_normal_equations(const param_t& params, MatrixN<float,N> &JTJ, VectorN<float,N> &JTFI) const;
+
     // run sphere fit to calculate diagonals and offdiagonals
-    void calc_sphere_jacob(const Vector3f& sample, const param_t& params, float* ret) const;
     void run_sphere_fit();
 
     // run ellipsoid fit to calculate diagonals and offdiagonals
-    void calc_ellipsoid_jacob(const Vector3f& sample, const param_t& params, float* ret) const;
     void run_ellipsoid_fit();
 
     // update the completion mask based on a single sample
@@ -184,7 +222,7 @@ private:
     void update_completion_mask();
 
     // calculate compass orientation
-    Vector3f calculate_earth_field(CompassSample &sample, enum Rotation r);
+    Vector3f calculate_earth_field(const CompassSample &sample, const Matrix3f &rot, enum Rotation r);
     bool calculate_orientation();
 
     // fix radius to compensate for sensor scaling errors
@@ -198,6 +236,11 @@ private:
     // running method for use in thread
     bool _running() const;
 
+#if COMPASS_CAL_THREAD_PER_COMPASS
+    void thread_main();
+    bool _thread_started;
+#endif
+
     uint8_t _compass_idx;                   // index of the compass providing data
     Status _status;                         // current state of calibrator
 
@@ -214,6 +257,8 @@ private:
     CompassSample *_sample_buffer;          // buffer of sensor values
     uint16_t _samples_collected;            // number of samples in buffer
     uint16_t _samples_thinned;              // number of samples removed by the thin_samples() call (called before step 2 begins)
+    FitSamples *_fit_samples;               // samples as used by the fit
+    bool _fit_samples_loaded;               // true if _fit_samples matches the sample buffer
 
     // fit state
     class param_t _params;                  // latest calibration outputs
@@ -222,6 +267,7 @@ private:
     float _initial_fitness;                 // fitness before latest "fit" was attempted (used to determine if fit was an improvement)
     float _sphere_lambda;                   // sphere fit's lambda
     float _ellipsoid_lambda;                // ellipsoid fit's lambda
+    uint32_t _fit_time_us;                  // time spent fitting in this attempt
 
     // variables for orientation checking
     enum Rotation _orientation;             // latest detected orientation
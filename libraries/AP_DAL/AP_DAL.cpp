@@ -300,13 +300,14 @@ bool AP_DAL::ekf_low_time_remaining(EKFType etype, uint8_t core)
       scheduling of fusion between lanes
      */
     const auto &imu = AP::ins();
+    // EKF3 lanes may be updated in parallel, each changing only its own bit
     if ((AP_HAL::micros() - imu.get_last_update_usec())*1.0e-6 > imu.get_loop_delta_t()*0.33) {
-        _RFRF.core_slow |= mask;
+        __atomic_fetch_or(&_RFRF.core_slow, mask, __ATOMIC_RELAXED);
     } else {
-        _RFRF.core_slow &= ~mask;
+        __atomic_fetch_and(&_RFRF.core_slow, uint8_t(~mask), __ATOMIC_RELAXED);
     }
 #endif
-    return (_RFRF.core_slow & mask) != 0;
+    return (__atomic_load_n(&_RFRF.core_slow, __ATOMIC_RELAXED) & mask) != 0;
 }
 
 // log optical flow data
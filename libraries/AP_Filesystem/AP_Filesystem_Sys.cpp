@@ -23,6 +23,8 @@
 #include <AP_CANManager/AP_CANManager.h>
 #include <AP_Scheduler/AP_Scheduler.h>
 #include <AP_Common/ExpandingString.h>
+#include <AP_Scripting/AP_Scripting.h>
+#include <GCS_MAVLink/GCS.h>
 
 extern const AP_HAL::HAL& hal;
 
@@ -34,6 +36,12 @@ static const SysFileList sysfs_file_list[] = {
     {"threads.txt"},
     {"tasks.txt"},
     {"dma.txt"},
+    {"storage.txt"},
+    {"ftp.txt"},
+    {"routing.txt"},
+#ifdef ENABLE_SCRIPTING
+    {"scripts.txt"},
+#endif
 #if HAL_MAX_CAN_PROTOCOL_DRIVERS
     {"can_log.txt"},
     {"can0_stats.txt"},
@@ -91,6 +99,23 @@ int AP_Filesystem_Sys::open(const char *fname, int flags)
     if (strcmp(fname, "dma.txt") == 0) {
         hal.util->dma_info(*r.str);
     }
+    if (strcmp(fname, "storage.txt") == 0) {
+        hal.storage->get_stats(*r.str);
+    }
+    if (strcmp(fname, "ftp.txt") == 0) {
+        GCS_MAVLINK::ftp_stats(*r.str);
+    }
+    if (strcmp(fname, "routing.txt") == 0) {
+        GCS_MAVLINK::routing_stats(*r.str);
+    }
+#ifdef ENABLE_SCRIPTING
+    if (strcmp(fname, "scripts.txt") == 0) {
+        AP_Scripting *scripting = AP::scripting();
+        if (scripting != nullptr) {
+            scripting->profile_info(*r.str);
+        }
+    }
+#endif
 #if HAL_MAX_CAN_PROTOCOL_DRIVERS
     int8_t can_stats_num = -1;
     if (strcmp(fname, "can_log.txt") == 0) {
@@ -258,6 +258,36 @@ bool AP_FlashStorage::write(uint16_t offset, uint16_t length)
     return true;
 }
 
+/*
+  see if the next write would have to erase a sector. That is only
+  when both sectors are full: while the other sector is available
+  running out of space only needs a switch. Compacting then does the
+  same erase the write would do, but earlier, so no erases are added
+ */
+bool AP_FlashStorage::compaction_wanted(void) const
+{
+    if (reserved_space == 0 || write_error || in_switch_full_sector) {
+        return false;
+    }
+    // the same test as write() uses
+    const uint32_t space_available = flash_sector_size - write_offset;
+    const uint32_t space_required = sizeof(struct block_header) + max_write + reserved_space;
+    return space_available < space_required;
+}
+
+/*
+  write all data to the current sector and erase the other one, so
+  that the next sector switch is cheap
+ */
+bool AP_FlashStorage::compact(void)
+{
+    if (!flash_erase_ok()) {
+        return false;
+    }
+    debug("compacting at write_offset=%u\n", unsigned(write_offset));
+    return switch_full_sector();
+}
+
 /*
   load all data from a flash sector into mem_buffer
  */
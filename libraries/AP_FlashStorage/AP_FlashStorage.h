@@ -120,6 +120,15 @@ public:
     // write some data to storage from mem_buffer
     bool write(uint16_t offset, uint16_t length) WARN_IF_UNUSED;
 
+    // true when the next write would need the erase of a full sector
+    // switch: the sector in use has no room for another block and the
+    // other sector is full
+    bool compaction_wanted(void) const;
+
+    // do the switch_full_sector() a write would need ahead of time,
+    // when the caller knows it is idle and allowed to erase
+    bool compact(void) WARN_IF_UNUSED;
+
     // fixed storage size
     static const uint16_t storage_size = HAL_STORAGE_SIZE;
     
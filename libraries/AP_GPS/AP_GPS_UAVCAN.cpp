@@ -38,6 +38,7 @@ UC_REGISTRY_BINDER(AuxCb, uavcan::equipment::gnss::Auxiliary);
 
 AP_GPS_UAVCAN::DetectedModules AP_GPS_UAVCAN::_detected_modules[] = {0};
 HAL_Semaphore AP_GPS_UAVCAN::_sem_registry;
+AP_UAVCAN_DispatchTable<AP_GPS_UAVCAN> AP_GPS_UAVCAN::_dispatch;
 
 // Member Methods
 AP_GPS_UAVCAN::AP_GPS_UAVCAN(AP_GPS &_gps, AP_GPS::GPS_State &_state) :
@@ -49,6 +50,9 @@ AP_GPS_UAVCAN::~AP_GPS_UAVCAN()
     WITH_SEMAPHORE(_sem_registry);
 
     _detected_modules[_detected_module].driver = nullptr;
+    _dispatch.set(_dispatch.make_key(_detected_modules[_detected_module].ap_uavcan->get_driver_index(),
+                                     _detected_modules[_detected_module].node_id),
+                  nullptr);
 }
 
 void AP_GPS_UAVCAN::subscribe_msgs(AP_UAVCAN* ap_uavcan)
@@ -101,6 +105,9 @@ AP_GPS_Backend* AP_GPS_UAVCAN::probe(AP_GPS &_gps, AP_GPS::GPS_State &_state)
             } else {
                 _detected_modules[i].driver = backend;
                 backend->_detected_module = i;
+                _dispatch.set(_dispatch.make_key(_detected_modules[i].ap_uavcan->get_driver_index(),
+                                                 _detected_modules[i].node_id),
+                              backend);
                 AP::can().log_text(AP_CANManager::LOG_INFO,
                                  LOG_TAG,
                                  "Registered UAVCAN GPS Node %d on Bus %d\n",
@@ -119,6 +126,12 @@ AP_GPS_UAVCAN* AP_GPS_UAVCAN::get_uavcan_backend(AP_UAVCAN* ap_uavcan, uint8_t n
         return nullptr;
     }
 
+    const uint32_t key = _dispatch.make_key(ap_uavcan->get_driver_index(), node_id);
+    AP_GPS_UAVCAN* driver;
+    if (_dispatch.find(key, driver)) {
+        return driver;
+    }
+
     for (uint8_t i = 0; i < GPS_MAX_RECEIVERS; i++) {
         if (_detected_modules[i].driver != nullptr &&
             _detected_modules[i].ap_uavcan == ap_uavcan && 
@@ -145,6 +158,9 @@ AP_GPS_UAVCAN* AP_GPS_UAVCAN::get_uavcan_backend(AP_UAVCAN* ap_uavcan, uint8_t n
             }
         }
     }
+
+    // remember the source, probe() sets the backend once it is registered
+    _dispatch.set(key, nullptr);
     return nullptr;
 }
 
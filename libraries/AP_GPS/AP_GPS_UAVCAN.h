@@ -73,5 +73,8 @@ private:
         AP_GPS_UAVCAN* driver;
     } _detected_modules[GPS_MAX_RECEIVERS];
 
+    // backend lookup by message source
+    static AP_UAVCAN_DispatchTable<AP_GPS_UAVCAN> _dispatch;
+
     static HAL_Semaphore _sem_registry;
 };
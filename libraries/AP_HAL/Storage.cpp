@@ -1,6 +1,7 @@
 #include "AP_HAL.h"
 #include "Storage.h"
 #include <AP_Math/AP_Math.h>
+#include <AP_Common/ExpandingString.h>
 
 /*
   default erase method
@@ -15,3 +16,60 @@ bool AP_HAL::Storage::erase(void)
     }
     return true;
 }
+
+void AP_HAL::Storage::begin_transaction(void)
+{
+    if (__atomic_fetch_add(&transaction_depth, 1, __ATOMIC_RELAXED) == 0) {
+        transaction_start_ms = AP_HAL::millis();
+    }
+}
+
+void AP_HAL::Storage::end_transaction(void)
+{
+    uint8_t depth = __atomic_load_n(&transaction_depth, __ATOMIC_RELAXED);
+    while (depth > 0 &&
+           !__atomic_compare_exchange_n(&transaction_depth, &depth, uint8_t(depth-1), false,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        // depth has been reloaded, try again
+    }
+}
+
+bool AP_HAL::Storage::flush_held(void) const
+{
+    return __atomic_load_n(&transaction_depth, __ATOMIC_RELAXED) > 0 &&
+        AP_HAL::millis() - transaction_start_ms < HAL_STORAGE_TRANSACTION_TIMEOUT_MS;
+}
+
+void AP_HAL::Storage::note_flush(uint32_t nbytes, uint32_t dt_us)
+{
+    stats.bytes_written += nbytes;
+    stats.flushes++;
+    stats.flush_us_total += dt_us;
+    stats.flush_us_max = MAX(stats.flush_us_max, dt_us);
+}
+
+/*
+  write amplification is the ratio of bytes written to the backing
+  store to bytes changed by callers
+ */
+void AP_HAL::Storage::get_stats(ExpandingString &str)
+{
+    const float amplification = stats.bytes_requested > 0 ? float(stats.bytes_written) / stats.bytes_requested : 0;
+    const uint32_t flush_us_avg = stats.flushes > 0 ? stats.flush_us_total / stats.flushes : 0;
+    str.printf("bytes_requested: %u\n"
+               "bytes_written:   %u\n"
+               "amplification:   %.2f\n"
+               "flushes:         %u\n"
+               "flush_us_avg:    %u\n"
+               "flush_us_max:    %u\n"
+               "erases:          %u\n"
+               "compactions:     %u\n",
+               unsigned(stats.bytes_requested),
+               unsigned(stats.bytes_written),
+               (double)amplification,
+               unsigned(stats.flushes),
+               unsigned(flush_us_avg),
+               unsigned(stats.flush_us_max),
+               unsigned(stats.erases),
+               unsigned(stats.compactions));
+}
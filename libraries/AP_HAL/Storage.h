@@ -3,6 +3,13 @@
 #include <stdint.h>
 #include "AP_HAL_Namespace.h"
 
+class ExpandingString;
+
+// longest time an open transaction may hold back flushing
+#ifndef HAL_STORAGE_TRANSACTION_TIMEOUT_MS
+#define HAL_STORAGE_TRANSACTION_TIMEOUT_MS 2000
+#endif
+
 class AP_HAL::Storage {
 public:
     virtual void init() = 0;
@@ -11,4 +18,42 @@ public:
     virtual void write_block(uint16_t dst, const void* src, size_t n) = 0;
     virtual void _timer_tick(void) {};
     virtual bool healthy(void) { return true; }
+
+    /*
+      a transaction groups related writes, such as a burst of
+      parameter saves, so that the backend flushes them together
+      instead of line by line as they arrive. Transactions may nest.
+     */
+    void begin_transaction(void);
+    void end_transaction(void);
+
+    // write amplification and flush latency
+    virtual void get_stats(ExpandingString &str);
+
+protected:
+    // true while flushing should wait for an open transaction
+    bool flush_held(void) const;
+
+    // bytes changed by write_block()
+    void note_write(uint32_t nbytes) { stats.bytes_requested += nbytes; }
+
+    // one flush of nbytes to the backing store, taking dt_us
+    void note_flush(uint32_t nbytes, uint32_t dt_us);
+
+    struct {
+        uint32_t bytes_requested;
+        uint32_t bytes_written;
+        uint32_t flushes;
+        uint32_t flush_us_max;
+        uint64_t flush_us_total;
+        uint32_t erases;
+        uint32_t compactions;
+    } stats {};
+
+private:
+    // transactions may be opened from any thread, so the depth is
+    // only changed atomically. The timeout stops a transaction that is
+    // never ended from holding back flushes forever
+    uint8_t transaction_depth = 0;
+    volatile uint32_t transaction_start_ms = 0;
 };
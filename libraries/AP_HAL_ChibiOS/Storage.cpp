@@ -241,6 +241,7 @@ void Storage::write_block(uint16_t loc, const void *src, size_t n)
         WITH_SEMAPHORE(sem);
         memcpy(&_buffer[loc], src, n);
         _mark_dirty(loc, n);
+        note_write(n);
     }
 }
 
@@ -251,11 +252,24 @@ void Storage::_timer_tick(void)
     }
     if (_dirty_mask.empty()) {
         _last_empty_ms = AP_HAL::millis();
+#ifdef STORAGE_FLASH_PAGE
+        // compact while idle, so that a burst of writes doesn't find
+        // the sector full and wait for an erase
+        if (_initialisedType == StorageBackend::Flash &&
+            _flash.compaction_wanted() && _flash_erase_ok()) {
+            if (_flash.compact()) {
+                stats.compactions++;
+            }
+        }
+#endif
+        return;
+    }
+    if (flush_held()) {
         return;
     }
 
-    // write out the first dirty line. We don't write more
-    // than one to keep the latency of this call to a minimum
+    // write out the first run of dirty lines. We limit the run to
+    // CH_STORAGE_MAX_WRITE to keep the latency of this call down
     uint16_t i;
     for (i=0; i<CH_STORAGE_NUM_LINES; i++) {
         if (_dirty_mask.get(i)) {
@@ -266,19 +280,28 @@ void Storage::_timer_tick(void)
         // this shouldn't be possible
         return;
     }
+    uint16_t n = 1;
+    while (i+n < CH_STORAGE_NUM_LINES &&
+           n < CH_STORAGE_MAX_WRITE/CH_STORAGE_LINE_SIZE &&
+           _dirty_mask.get(i+n)) {
+        n++;
+    }
+    const uint16_t nbytes = n*CH_STORAGE_LINE_SIZE;
 
     {
-        // take a copy of the line we are writing with a semaphore held
+        // take a copy of the lines we are writing with a semaphore held
         WITH_SEMAPHORE(sem);
-        memcpy(tmpline, &_buffer[CH_STORAGE_LINE_SIZE*i], CH_STORAGE_LINE_SIZE);
+        memcpy(tmpline, &_buffer[CH_STORAGE_LINE_SIZE*i], nbytes);
     }
 
     bool write_ok = false;
+    const uint32_t start_us = AP_HAL::micros();
 
 #if HAL_WITH_RAMTRON
     if (_initialisedType == StorageBackend::FRAM) {
-        if (fram.write(CH_STORAGE_LINE_SIZE*i, tmpline, CH_STORAGE_LINE_SIZE)) {
+        if (fram.write(CH_STORAGE_LINE_SIZE*i, tmpline, nbytes)) {
             write_ok = true;
+            stats.bytes_written += nbytes;
         }
     }
 #endif
@@ -289,35 +312,41 @@ void Storage::_timer_tick(void)
         if (AP::FS().lseek(log_fd, offset, SEEK_SET) != offset) {
             return;
         }
-        if (AP::FS().write(log_fd, &_buffer[offset], CH_STORAGE_LINE_SIZE) != CH_STORAGE_LINE_SIZE) {
+        if (AP::FS().write(log_fd, tmpline, nbytes) != int32_t(nbytes)) {
             return;
         }
         if (AP::FS().fsync(log_fd) != 0) {
             return;
         }
         write_ok = true;
+        stats.bytes_written += nbytes;
     }
 #endif
 
 #ifdef STORAGE_FLASH_PAGE
     if (_initialisedType == StorageBackend::Flash) {
-        // save to storage backend
-        if (_flash_write(i)) {
+        // save to storage backend. Bytes written are counted in
+        // _flash_write_data() as they include the block headers
+        if (_flash_write(i, n)) {
             write_ok = true;
         }
     }
 #endif
 
     if (write_ok) {
+        note_flush(0, AP_HAL::micros() - start_us);
         WITH_SEMAPHORE(sem);
-        // while holding the semaphore we check if the copy of the
+        // while holding the semaphore we check if the copy of each
         // line is different from the original line. If it is
         // different then someone has re-dirtied the line while we
         // were writing it, in which case we should not mark it
         // clean. If it matches then we know we can mark the line as
         // clean
-        if (memcmp(tmpline, &_buffer[CH_STORAGE_LINE_SIZE*i], CH_STORAGE_LINE_SIZE) == 0) {
-            _dirty_mask.clear(i);
+        for (uint16_t j=0; j<n; j++) {
+            const uint16_t ofs = CH_STORAGE_LINE_SIZE*(i+j);
+            if (memcmp(&tmpline[CH_STORAGE_LINE_SIZE*j], &_buffer[ofs], CH_STORAGE_LINE_SIZE) == 0) {
+                _dirty_mask.clear(i+j);
+            }
         }
     }
 }
@@ -341,12 +370,12 @@ void Storage::_flash_load(void)
 }
 
 /*
-  write one storage line. This also updates _dirty_mask.
+  write a run of storage lines
 */
-bool Storage::_flash_write(uint16_t line)
+bool Storage::_flash_write(uint16_t line, uint16_t nlines)
 {
 #ifdef STORAGE_FLASH_PAGE
-    return _flash.write(line*CH_STORAGE_LINE_SIZE, CH_STORAGE_LINE_SIZE);
+    return _flash.write(line*CH_STORAGE_LINE_SIZE, nlines*CH_STORAGE_LINE_SIZE);
 #else
     return false;
 #endif
@@ -361,6 +390,7 @@ bool Storage::_flash_write_data(uint8_t sector, uint32_t offset, const uint8_t *
     size_t base_address = hal.flash->getpageaddr(_flash_page+sector);
     for (uint8_t i=0; i<STORAGE_FLASH_RETRIES; i++) {
         if (hal.flash->write(base_address+offset, data, length)) {
+            stats.bytes_written += length;
             return true;
         }
         hal.scheduler->delay(1);
@@ -416,6 +446,7 @@ bool Storage::_flash_erase_sector(uint8_t sector)
         sched->_expect_delay_ms(1000);
         if (hal.flash->erasepage(_flash_page+sector)) {
             sched->_expect_delay_ms(0);
+            stats.erases++;
             return true;
         }
         sched->_expect_delay_ms(0);
@@ -36,6 +36,8 @@
 #include <sys/ioctl.h>
 #include <net/if.h>
 #include <linux/can/raw.h>
+#include <linux/net_tstamp.h>
+#include <time.h>
 #include <cstring>
 #include "Scheduler.h"
 #include <AP_CANManager/AP_CANManager.h>
@@ -121,8 +123,13 @@ int CANIface::_openSocket(const std::string& iface_name)
     // Configure
     {
         const int on = 1;
-        // Timestamping
-        if (setsockopt(s, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on)) < 0) {
+        // Timestamping, using the hardware timestamp where the driver
+        // provides one and the kernel software timestamp otherwise
+        const int ts_flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+                             SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        _timestamping = setsockopt(s, SOL_SOCKET, SO_TIMESTAMPING, &ts_flags, sizeof(ts_flags)) == 0;
+        _hw_ts_offset_valid = false;
+        if (!_timestamping && setsockopt(s, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on)) < 0) {
             return -1;
         }
         // Socket loopback
@@ -163,7 +170,15 @@ int16_t CANIface::send(const AP_HAL::CANFrame& frame, const uint64_t tx_deadline
     tx_item.setup = true;
     tx_item.index = _tx_frame_counter;
     tx_item.deadline = tx_deadline;
-    _tx_queue.emplace(tx_item);
+    if (_tx_queue.full()) {
+        // try to make room before giving up on the frame
+        _pollRead();
+        _pollWrite();
+    }
+    if (!_tx_queue.push(tx_item)) {
+        stats.tx_queue_full++;
+        return 0;
+    }
     _tx_frame_counter++;
     stats.tx_requests++;
     _pollRead();     // Read poll is necessary because it can release the pending TX flag
@@ -256,47 +271,237 @@ uint32_t CANIface::getErrorCount() const
     return ec;
 }
 
+bool CANIface::TxQueue::push(const CanTxItem &item)
+{
+    if (full()) {
+        return false;
+    }
+    // sift up from the new leaf
+    uint16_t i = _count++;
+    while (i > 0) {
+        const uint16_t parent = (i - 1) / 2;
+        if (!(_heap[parent] < item)) {
+            break;
+        }
+        _heap[i] = _heap[parent];
+        i = parent;
+    }
+    _heap[i] = item;
+    return true;
+}
+
+void CANIface::TxQueue::pop()
+{
+    if (_count == 0) {
+        return;
+    }
+    // sift the last item down from the root
+    const CanTxItem last = _heap[--_count];
+    uint16_t i = 0;
+    while (true) {
+        uint16_t child = 2 * i + 1;
+        if (child >= _count) {
+            break;
+        }
+        if (child + 1 < _count && _heap[child] < _heap[child + 1]) {
+            child++;
+        }
+        if (!(last < _heap[child])) {
+            break;
+        }
+        _heap[i] = _heap[child];
+        i = child;
+    }
+    _heap[i] = last;
+}
+
 void CANIface::_pollWrite()
 {
     while (_hasReadyTx()) {
-        const CanTxItem tx = _tx_queue.top();
-        uint64_t curr_time = AP_HAL::native_micros64();
-        if (tx.deadline >= curr_time) {
-            // hal.console->printf("%x TDEAD: %lu CURRT: %lu DEL: %lu\n",tx.frame.id,  tx.deadline, curr_time, tx.deadline-curr_time);
-            const int res = _write(tx.frame);
-            if (res == 1) {                   // Transmitted successfully
+        // take as many frames as the socket may hold in one batch
+        CanTxItem batch[CAN_IO_BATCH_SIZE];
+        can_frame frames[CAN_IO_BATCH_SIZE];
+        unsigned count = 0;
+        const unsigned free_slots = _max_frames_in_socket_tx_queue - _frames_in_socket_tx_queue;
+        const uint64_t curr_time = AP_HAL::native_micros64();
+        while (!_tx_queue.empty() && count < free_slots && count < CAN_IO_BATCH_SIZE) {
+            const CanTxItem &tx = _tx_queue.top();
+            if (tx.deadline >= curr_time) {
+                batch[count] = tx;
+                frames[count] = makeSocketCanFrame(tx.frame);
+                count++;
+            } else {
+                stats.tx_timedout++;
+            }
+            _tx_queue.pop();
+        }
+        if (count == 0) {
+            break;
+        }
+
+        const int res = _write(frames, count);
+        unsigned done = 0;
+        if (res > 0) {                        // Transmitted successfully
+            stats.tx_batches++;
+            for (; done < unsigned(res); done++) {
                 _incrementNumFramesInSocketTxQueue();
-                if (tx.loopback) {
-                    _pending_loopback_ids.insert(tx.frame.id);
+                if (batch[done].loopback) {
+                    _pending_loopback_ids.insert(batch[done].frame.id);
                 }
                 stats.tx_success++;
-            } else if (res == 0) {            // Not transmitted, nor is it an error
-                stats.tx_full++;
-                break;                        // Leaving the loop, the frame remains enqueued for the next retry
-            } else {                          // Transmission error
-                stats.tx_write_fail++;
             }
-        } else {
-            // hal.console->printf("TDEAD: %lu CURRT: %lu DEL: %lu\n", tx.deadline, curr_time, curr_time-tx.deadline);
-            stats.tx_timedout++;
+        } else if (res < 0) {                 // Transmission error, the failed frame is dropped
+            stats.tx_write_fail++;
+            done = 1;
+        } else {                              // Not transmitted, nor is it an error
+            stats.tx_full++;
+        }
+
+        // frames not taken by the socket go back in the queue for the next retry
+        for (unsigned i = done; i < count; i++) {
+            (void)_tx_queue.push(batch[i]);
         }
+        if (res == 0) {
+            break;
+        }
+    }
+}
+
+/*
+  convert a CLOCK_REALTIME socket timestamp to the monotonic clock,
+  returning 0 if it is not plausible
+ */
+static uint64_t realtimeToMonotonic(const timespec &ts, uint64_t now_us, uint64_t now_realtime_us)
+{
+    if (ts.tv_sec == 0 && ts.tv_nsec == 0) {
+        return 0;
+    }
+    const uint64_t ts_us = uint64_t(ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+    if (ts_us > now_realtime_us) {
+        return 0;
+    }
+    const uint64_t age_us = now_realtime_us - ts_us;
+    if (age_us > 1000000ULL || age_us > now_us) {
+        return 0;
+    }
+    return now_us - age_us;
+}
+
+/*
+  map a raw hardware timestamp, which is in the clock of the CAN
+  controller, to the monotonic clock. The offset between the two clocks
+  is tracked from the software timestamp of the same frames. The
+  smallest offset seen is from the frame with the least receive
+  latency, so the offset follows any lower sample at once and creeps up
+  towards higher ones to follow drift between the clocks. Returns 0 if
+  there is no hardware timestamp
+ */
+uint64_t CANIface::_hwTimestampToMonotonic(const timespec &hw, uint64_t sw_us)
+{
+    if (hw.tv_sec == 0 && hw.tv_nsec == 0) {
+        return 0;
+    }
+    const int64_t hw_us = int64_t(hw.tv_sec) * 1000000LL + hw.tv_nsec / 1000;
+    const int64_t offset_us = int64_t(sw_us) - hw_us;
+    if (!_hw_ts_offset_valid || offset_us < _hw_ts_offset_us ||
+        offset_us - _hw_ts_offset_us > 1000000LL) {
+        // first frame, a lower latency frame, or the controller clock
+        // has been reset
+        _hw_ts_offset_us = offset_us;
+        _hw_ts_offset_valid = true;
+    } else {
+        _hw_ts_offset_us += (offset_us - _hw_ts_offset_us) / 256;
+    }
+    // never later than the software timestamp
+    return uint64_t(hw_us + _hw_ts_offset_us);
+}
 
-        // Removing the frame from the queue even if transmission failed
-        (void)_tx_queue.pop();
+uint64_t CANIface::_getRxTimestamp(msghdr& msg, uint64_t now_us, uint64_t now_realtime_us)
+{
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            // ts[0] is the software timestamp, in CLOCK_REALTIME, and
+            // ts[2] the raw hardware one, in the controller's clock
+            timespec ts[3];
+            memcpy(ts, CMSG_DATA(cmsg), sizeof(ts));
+            const uint64_t ret = realtimeToMonotonic(ts[0], now_us, now_realtime_us);
+            if (ret != 0) {
+                const uint64_t hw_ret = _hwTimestampToMonotonic(ts[2], ret);
+                if (hw_ret != 0) {
+                    stats.rx_hw_timestamps++;
+                    return hw_ret;
+                }
+                return ret;
+            }
+        } else if (cmsg->cmsg_type == SCM_TIMESTAMP) {
+            timeval tv;
+            memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+            const timespec ts { tv.tv_sec, tv.tv_usec * 1000 };
+            const uint64_t ret = realtimeToMonotonic(ts, now_us, now_realtime_us);
+            if (ret != 0) {
+                return ret;
+            }
+        }
     }
+    // Monotonic timestamp is not required to be precise (unlike UTC)
+    return now_us;
 }
 
 bool CANIface::_pollRead()
 {
+    if (_fd < 0) {
+        return false;
+    }
+    can_frame frames[CAN_IO_BATCH_SIZE];
+    iovec iovs[CAN_IO_BATCH_SIZE];
+    union {
+        uint8_t data[CMSG_SPACE(3 * sizeof(::timespec))];
+        struct cmsghdr align;
+    } control[CAN_IO_BATCH_SIZE];
+    mmsghdr msgs[CAN_IO_BATCH_SIZE];
+
+    bool received = false;
     uint8_t iterations_count = 0;
     while (iterations_count < CAN_MAX_POLL_ITERATIONS_COUNT)
     {
         iterations_count++;
-        CanRxItem rx;
-        rx.timestamp_us = AP_HAL::native_micros64();  // Monotonic timestamp is not required to be precise (unlike UTC)
-        bool loopback = false;
-        const int res = _read(rx.frame, rx.timestamp_us, loopback);
-        if (res == 1) {
+        memset(msgs, 0, sizeof(msgs));
+        for (uint8_t i = 0; i < CAN_IO_BATCH_SIZE; i++) {
+            iovs[i].iov_base = &frames[i];
+            iovs[i].iov_len  = sizeof(frames[i]);
+            msgs[i].msg_hdr.msg_iov    = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = control[i].data;
+            msgs[i].msg_hdr.msg_controllen = sizeof(control[i].data);
+        }
+
+        const int res = recvmmsg(_fd, msgs, CAN_IO_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+        if (res <= 0) {
+            if (res < 0 && errno != EWOULDBLOCK) {
+                stats.rx_errors++;
+            }
+            break;
+        }
+        stats.rx_batches++;
+
+        // one clock read per batch, the socket timestamps are relative to it
+        const uint64_t now_us = AP_HAL::native_micros64();
+        timespec now_realtime;
+        clock_gettime(CLOCK_REALTIME, &now_realtime);
+        const uint64_t now_realtime_us = uint64_t(now_realtime.tv_sec) * 1000000ULL + now_realtime.tv_nsec / 1000;
+
+        for (int i = 0; i < res; i++) {
+            msghdr &msg = msgs[i].msg_hdr;
+            const bool loopback = (msg.msg_flags & static_cast<int>(MSG_CONFIRM)) != 0;
+            if (!loopback && !_checkHWFilters(frames[i])) {
+                continue;
+            }
+            CanRxItem rx;
+            rx.frame = makeUavcanFrame(frames[i]);
+            rx.timestamp_us = _getRxTimestamp(msg, now_us, now_realtime_us);
             bool accept = true;
             if (loopback) {           // We receive loopback for all CAN frames
                 _confirmSentFrame();
@@ -307,80 +512,46 @@ bool CANIface::_pollRead()
             if (accept) {
                 _rx_queue.push(rx);
                 stats.rx_received++;
-                return true;
+                received = true;
             }
-        } else if (res == 0) {
-            break;
-        } else {
-            stats.rx_errors++;
+        }
+        if (res < CAN_IO_BATCH_SIZE) {
+            // socket is drained
             break;
         }
     }
-    return false;
+    return received;
 }
 
-int CANIface::_write(const AP_HAL::CANFrame& frame) const
+int CANIface::_write(const can_frame* frames, unsigned count) const
 {
     if (_fd < 0) {
         return -1;
     }
+    if (count > CAN_IO_BATCH_SIZE) {
+        count = CAN_IO_BATCH_SIZE;
+    }
     errno = 0;
 
-    const can_frame sockcan_frame = makeSocketCanFrame(frame);
+    iovec iovs[CAN_IO_BATCH_SIZE];
+    mmsghdr msgs[CAN_IO_BATCH_SIZE] {};
+    for (unsigned i = 0; i < count; i++) {
+        iovs[i].iov_base = const_cast<can_frame*>(&frames[i]);
+        iovs[i].iov_len  = sizeof(frames[i]);
+        msgs[i].msg_hdr.msg_iov    = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
 
-    const int res = write(_fd, &sockcan_frame, sizeof(sockcan_frame));
+    // returns the number of frames the socket took. A failure after
+    // the first frame is reported by the next call
+    const int res = sendmmsg(_fd, msgs, count, MSG_DONTWAIT);
     if (res <= 0) {
         if (errno == ENOBUFS || errno == EAGAIN) {  // Writing is not possible atm, not an error
             return 0;
         }
-        return res;
-    }
-    if (res != sizeof(sockcan_frame)) {
         return -1;
     }
-    return 1;
-}
-
-
-int CANIface::_read(AP_HAL::CANFrame& frame, uint64_t& timestamp_us, bool& loopback) const
-{
-    if (_fd < 0) {
-        return -1;
-    }
-    auto iov = iovec();
-    auto sockcan_frame = can_frame();
-    iov.iov_base = &sockcan_frame;
-    iov.iov_len  = sizeof(sockcan_frame);
-    union {
-        uint8_t data[CMSG_SPACE(sizeof(::timeval))];
-        struct cmsghdr align;
-    } control;
-
-    auto msg = msghdr();
-    msg.msg_iov    = &iov;
-    msg.msg_iovlen = 1;
-    msg.msg_control = control.data;
-    msg.msg_controllen = sizeof(control.data);
-
-    const int res = recvmsg(_fd, &msg, MSG_DONTWAIT);
-    if (res <= 0) {
-        return (res < 0 && errno == EWOULDBLOCK) ? 0 : res;
-    }
-    /*
-     * Flags
-     */
-    loopback = (msg.msg_flags & static_cast<int>(MSG_CONFIRM)) != 0;
-
-    if (!loopback && !_checkHWFilters(sockcan_frame)) {
-        return 0;
-    }
-
-    frame = makeUavcanFrame(sockcan_frame);
-    /*
-     * Timestamp
-     */
-    timestamp_us = AP_HAL::native_micros64();
-    return 1;
+    return res;
 }
 
 // Might block forever, only to be used for testing
@@ -449,8 +620,12 @@ void CANIface::_updateDownStatusFromPollResult(const pollfd& pfd)
 
 bool CANIface::init(const uint32_t bitrate, const OperatingMode mode)
 {
-    char iface_name[16];
-    sprintf(iface_name, "can%u", _self_index);
+    char iface_name[IFNAMSIZ];
+    if (_iface_name != nullptr) {
+        snprintf(iface_name, sizeof(iface_name), "%s", _iface_name);
+    } else {
+        snprintf(iface_name, sizeof(iface_name), "can%u", _self_index);
+    }
 
     if (_initialized) {
         return _initialized;
@@ -473,7 +648,7 @@ bool CANIface::select(bool &read_select, bool &write_select,
                         const AP_HAL::CANFrame* const pending_tx, uint64_t blocking_deadline)
 {
     // Detecting whether we need to block at all
-    bool need_block = !write_select;    // Write queue is infinite
+    bool need_block = !(write_select && !_tx_queue.full());
 
     if (read_select && _hasReadyRx()) {
         need_block = false;
@@ -497,8 +672,8 @@ bool CANIface::select(bool &read_select, bool &write_select,
     }
 
     // Writing the output masks
-    if (!_down) {
-        write_select = true;     // Always ready to write if not down
+    if (!_down && !_tx_queue.full()) {
+        write_select = true;     // Ready to write while there is room in the queue
     } else {
         write_select = false;
     }
@@ -581,8 +756,12 @@ void CANIface::get_stats(ExpandingString &str)
                "tx_confirmed:   %u\n"
                "tx_success:     %u\n"
                "tx_timedout:    %u\n"
+               "tx_queue_full:  %u\n"
+               "tx_batches:     %u\n"
                "rx_received:    %u\n"
                "rx_errors:      %u\n"
+               "rx_batches:     %u\n"
+               "rx_hw_timestamps: %u\n"
                "num_downs:      %u\n"
                "num_rx_poll_req:  %u\n"
                "num_tx_poll_req:  %u\n"
@@ -595,8 +774,12 @@ void CANIface::get_stats(ExpandingString &str)
                stats.tx_confirmed,
                stats.tx_success,
                stats.tx_timedout,
+               stats.tx_queue_full,
+               stats.tx_batches,
                stats.rx_received,
                stats.rx_errors,
+               stats.rx_batches,
+               stats.rx_hw_timestamps,
                stats.num_downs,
                stats.num_rx_poll_req,
                stats.num_tx_poll_req,
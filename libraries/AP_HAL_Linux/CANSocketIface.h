@@ -40,6 +40,7 @@
 #include <map>
 #include <unordered_set>
 #include <poll.h>
+#include <sys/socket.h>
 
 namespace Linux {
 
@@ -54,12 +55,32 @@ enum class SocketCanError
 #define CAN_MAX_INIT_TRIES_COUNT 100
 #define CAN_FILTER_NUMBER 8
 
+// frames moved per recvmmsg()/sendmmsg() call
+#ifndef CAN_IO_BATCH_SIZE
+#define CAN_IO_BATCH_SIZE 16
+#endif
+
+// frames waiting to be handed to the socket
+#ifndef CAN_TX_QUEUE_LEN
+#define CAN_TX_QUEUE_LEN 256
+#endif
+
+// frames handed to the socket but not yet seen on the bus. Keeping
+// this small stops low priority frames queued in the kernel from
+// delaying higher priority frames queued here
+#ifndef CAN_MAX_FRAMES_IN_SOCKET_TX_QUEUE
+#define CAN_MAX_FRAMES_IN_SOCKET_TX_QUEUE 2
+#endif
+
 class CANIface: public AP_HAL::CANIface {
 public:
-    CANIface(int index)
+    // iface_name defaults to can<index>, another name can be given
+    // to run on a virtual interface such as vcan0
+    CANIface(int index, const char *iface_name = nullptr)
       : _self_index(index)
+      , _iface_name(iface_name)
+      , _max_frames_in_socket_tx_queue(CAN_MAX_FRAMES_IN_SOCKET_TX_QUEUE)
       , _frames_in_socket_tx_queue(0)
-      , _max_frames_in_socket_tx_queue(2)
     { }
 
     ~CANIface() { }
@@ -126,13 +147,32 @@ public:
     };
 
 private:
+    /*
+      fixed capacity binary heap of frames waiting to be sent. The
+      top is the frame with the highest priority CAN ID, frames with
+      equal IDs come out in the order they were pushed
+     */
+    class TxQueue {
+    public:
+        bool push(const CanTxItem &item);
+        const CanTxItem &top() const { return _heap[0]; }
+        void pop();
+        bool empty() const { return _count == 0; }
+        bool full() const { return _count == CAN_TX_QUEUE_LEN; }
+    private:
+        CanTxItem _heap[CAN_TX_QUEUE_LEN];
+        uint16_t _count = 0;
+    };
+
     void _pollWrite();
 
     bool _pollRead();
 
-    int _write(const AP_HAL::CANFrame& frame) const;
+    int _write(const can_frame* frames, unsigned count) const;
+
+    uint64_t _getRxTimestamp(msghdr& msg, uint64_t now_us, uint64_t now_realtime_us);
 
-    int _read(AP_HAL::CANFrame& frame, uint64_t& ts_usec, bool& loopback) const;
+    uint64_t _hwTimestampToMonotonic(const timespec &hw, uint64_t sw_us);
 
     void _incrementNumFramesInSocketTxQueue();
 
@@ -160,16 +200,21 @@ private:
     int _fd;
 
     const uint8_t _self_index;
+    const char *_iface_name;
 
     const unsigned _max_frames_in_socket_tx_queue;
     unsigned _frames_in_socket_tx_queue;
+    bool _timestamping;  // SO_TIMESTAMPING is enabled, else SO_TIMESTAMP
+    // monotonic time minus controller time, for hardware timestamps
+    int64_t _hw_ts_offset_us;
+    bool _hw_ts_offset_valid;
     uint32_t _tx_frame_counter;
     AP_HAL::EventHandle *_evt_handle;
     static CANSocketEventSource evt_can_socket[HAL_NUM_CAN_IFACES];
 
     pollfd _pollfd;
     std::map<SocketCanError, uint64_t> _errors;
-    std::priority_queue<CanTxItem> _tx_queue;
+    TxQueue _tx_queue;
     std::queue<CanRxItem> _rx_queue;
     std::unordered_multiset<uint32_t> _pending_loopback_ids;
     std::vector<can_filter> _hw_filters_container;
@@ -181,6 +226,7 @@ private:
         uint32_t tx_write_fail;
         uint32_t tx_success;
         uint32_t tx_timedout;
+        uint32_t tx_queue_full;
         uint32_t rx_received;
         uint32_t rx_errors;
         uint32_t num_downs;
@@ -189,6 +235,9 @@ private:
         uint32_t num_poll_waits;
         uint32_t num_poll_tx_events;
         uint32_t num_poll_rx_events;
+        uint32_t tx_batches;
+        uint32_t rx_batches;
+        uint32_t rx_hw_timestamps;
     } stats;
 };
 
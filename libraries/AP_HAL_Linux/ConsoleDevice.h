@@ -14,6 +14,7 @@ public:
     virtual ssize_t read(uint8_t *buf, uint16_t n) override;
     virtual void set_blocking(bool blocking) override;
     virtual void set_speed(uint32_t speed) override;
+    virtual int get_fd() const override { return _closed ? -1 : _rd_fd; }
 
 private:
     int _rd_fd = -1;
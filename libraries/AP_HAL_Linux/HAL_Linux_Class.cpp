@@ -41,6 +41,8 @@
 #include "SPIUARTDriver.h"
 #include "Scheduler.h"
 #include "Storage.h"
+#include "Storage_Journal.h"
+#include "ThreadConfig.h"
 #include "UARTDriver.h"
 #include "Util.h"
 #include "Util_RPI.h"
@@ -101,7 +103,11 @@ static AnalogIn_Navio2 analogIn;
 static Empty::AnalogIn analogIn;
 #endif
 
+#if HAL_LINUX_STORAGE_JOURNAL
+static Storage_Journal storageDriver;
+#else
 static Storage storageDriver;
+#endif
 
 /*
   use the BBB gpio driver on ERLE, PXF, BBBMINI, BLUE and PocketPilot
@@ -279,6 +285,15 @@ void _usage(void)
     printf("\tcustom storage path:\n");
     printf("\t                   --storage-directory /var/APM/storage\n");
     printf("\t                   -s /var/APM/storage\n");
+    printf("\tthread CPU affinity (repeatable, first match wins):\n");
+    printf("\t                   --thread-affinity main=2\n");
+    printf("\t                   -c 'SPI*=2-3'\n");
+    printf("\tthread realtime priority (repeatable):\n");
+    printf("\t                   --thread-priority ap-timer=16\n");
+    printf("\t                   -P main=13\n");
+    printf("\treserve CPUs for main loop and realtime threads:\n");
+    printf("\t                   --isolate-cpus 2-3\n");
+    printf("\t                   -i 2-3\n");
 #if AP_MODULE_SUPPORTED
     printf("\tmodule support:\n");
     printf("\t                   --module-directory %s\n", AP_MODULE_DEFAULT_DIRECTORY);
@@ -309,11 +324,14 @@ void HAL_Linux::run(int argc, char* const argv[], Callbacks* callbacks) const
         {"terrain-directory",   true,  0, 't'},
         {"storage-directory",   true,  0, 's'},
         {"module-directory",    true,  0, 'M'},
+        {"thread-affinity",     true,  0, 'c'},
+        {"thread-priority",     true,  0, 'P'},
+        {"isolate-cpus",        true,  0, 'i'},
         {"help",                false,  0, 'h'},
         {0, false, 0, 0}
     };
 
-    GetOptLong gopt(argc, argv, "A:B:C:D:E:F:G:H:l:t:s:he:SM:",
+    GetOptLong gopt(argc, argv, "A:B:C:D:E:F:G:H:l:t:s:he:SM:c:P:i:",
                     options);
 
     /*
@@ -357,6 +375,21 @@ void HAL_Linux::run(int argc, char* const argv[], Callbacks* callbacks) const
         case 's':
             utilInstance.set_custom_storage_directory(gopt.optarg);
             break;
+        case 'c':
+            if (!ThreadConfig::get_singleton()->add_affinity(gopt.optarg)) {
+                exit(1);
+            }
+            break;
+        case 'P':
+            if (!ThreadConfig::get_singleton()->add_priority(gopt.optarg)) {
+                exit(1);
+            }
+            break;
+        case 'i':
+            if (!ThreadConfig::get_singleton()->set_isolated_cpus(gopt.optarg)) {
+                exit(1);
+            }
+            break;
 #if AP_MODULE_SUPPORTED
         case 'M':
             module_path = gopt.optarg;
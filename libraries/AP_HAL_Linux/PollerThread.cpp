@@ -21,6 +21,7 @@
 #include <sys/epoll.h>
 #include <sys/timerfd.h>
 
+#include <AP_HAL/AP_HAL.h>
 #include <AP_Math/AP_Math.h>
 
 namespace Linux {
@@ -37,6 +38,16 @@ void TimerPollable::on_can_read()
         return;
     }
 
+    // the last expiry reported was due (nevents - 1) periods after the
+    // one we were waiting for
+    const uint64_t now = AP_HAL::micros64();
+    const uint64_t due = _next_expiry_usec + (nevents - 1) * _period_usec;
+    Thread *thread = Thread::current();
+    if (thread != nullptr && nevents > 0) {
+        thread->record_wakeup_latency(now > due ? now - due : 0);
+    }
+    _next_expiry_usec += nevents * _period_usec;
+
     if (_wrapper) {
         _wrapper->start_cb();
     }
@@ -83,6 +94,9 @@ bool TimerPollable::adjust_timer(uint32_t timeout_usec)
         return false;
     }
 
+    _period_usec = timeout_usec;
+    _next_expiry_usec = AP_HAL::micros64() + timeout_usec;
+
     return true;
 }
 
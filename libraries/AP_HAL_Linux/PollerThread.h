@@ -57,6 +57,10 @@ protected:
     PeriodicCb _cb;
     WrapperCb *_wrapper;
     bool _removeme = false;
+
+    // for wakeup latency statistics
+    uint32_t _period_usec = 0;
+    uint64_t _next_expiry_usec = 0;
 };
 
 
@@ -70,6 +74,14 @@ public:
                              uint32_t timeout_usec);
     bool adjust_timer(TimerPollable *p, uint32_t timeout_usec);
 
+    /*
+     * Add file descriptor based Pollables to the same event loop as the
+     * timers. The caller keeps ownership of @p.
+     */
+    bool register_pollable(Pollable *p, uint32_t events) { return _poller.register_pollable(p, events); }
+    bool modify_pollable(Pollable *p, uint32_t events) { return _poller.modify_pollable(p, events); }
+    void unregister_pollable(const Pollable *p) { _poller.unregister_pollable(p); }
+
     void mainloop();
 
     bool stop() override;
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <errno.h>
+#include <malloc.h>
 #include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -9,6 +10,7 @@
 #include <sys/time.h>
 #include <unistd.h>
 
+#include <AP_Common/ExpandingString.h>
 #include <AP_HAL/AP_HAL.h>
 #include <AP_Math/AP_Math.h>
 #include <AP_Vehicle/AP_Vehicle_Type.h>
@@ -16,6 +18,7 @@
 #include "RCInput.h"
 #include "SPIUARTDriver.h"
 #include "Storage.h"
+#include "ThreadConfig.h"
 #include "UARTDriver.h"
 #include "Util.h"
 
@@ -31,6 +34,9 @@ extern const AP_HAL::HAL& hal;
 #define APM_LINUX_IO_PRIORITY           10
 #define APM_LINUX_SCRIPTING_PRIORITY     1
 
+// amount of main thread stack touched at startup so it is locked in memory
+#define APM_LINUX_MAIN_STACK_PREFAULT   (256 * 1024)
+
 #define APM_LINUX_TIMER_RATE            1000
 #define APM_LINUX_UART_RATE             100
 #if CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_NAVIO ||    \
@@ -57,6 +63,18 @@ extern const AP_HAL::HAL& hal;
 Scheduler::Scheduler()
 { }
 
+/*
+  touch the top of the main thread stack so that, together with
+  mlockall(), its pages are resident before the main loop starts.
+  Worker thread stacks are written in full by Thread::_poison_stack()
+ */
+static void __attribute__((noinline)) prefault_stack()
+{
+    volatile uint8_t stack[APM_LINUX_MAIN_STACK_PREFAULT];
+    for (size_t i = 0; i < sizeof(stack); i += 4096) {
+        stack[i] = 0;
+    }
+}
 
 void Scheduler::init_realtime()
 {
@@ -74,6 +92,12 @@ void Scheduler::init_realtime()
 
     mlockall(MCL_CURRENT|MCL_FUTURE);
 
+    // keep freed heap memory in the process instead of returning it to
+    // the kernel, so later allocations don't page fault
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    prefault_stack();
+
     struct sched_param param = { .sched_priority = APM_LINUX_MAIN_PRIORITY };
     if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == -1) {
         AP_HAL::panic("Scheduler: failed to set scheduling parameters: %s",
@@ -81,6 +105,16 @@ void Scheduler::init_realtime()
     }
 }
 
+/*
+  report the main thread and all Linux::Thread based threads
+ */
+void Scheduler::thread_info(ExpandingString &str)
+{
+    str.printf("ThreadsV2\n");
+    Thread::print_thread_info(str, "main", _main_ctx, 0, 0, 0);
+    Thread::thread_info(str);
+}
+
 void Scheduler::init()
 {
     int ret;
@@ -92,7 +126,6 @@ void Scheduler::init()
         uint32_t rate;
     } sched_table[] = {
         SCHED_THREAD(timer, TIMER),
-        SCHED_THREAD(uart, UART),
         SCHED_THREAD(rcin, RCIN),
         SCHED_THREAD(io, IO),
     };
@@ -101,8 +134,11 @@ void Scheduler::init()
 
     init_realtime();
 
-    /* set barrier to N + 1 threads: worker threads + main */
-    unsigned n_threads = ARRAY_SIZE(sched_table) + 1;
+    // affinity applies even when not running with realtime scheduling
+    ThreadConfig::get_singleton()->configure_current("main", SCHED_FIFO, APM_LINUX_MAIN_PRIORITY);
+
+    /* set barrier to N + 2 threads: worker threads + uart + main */
+    unsigned n_threads = ARRAY_SIZE(sched_table) + 2;
     ret = pthread_barrier_init(&_initialized_barrier, nullptr, n_threads);
     if (ret) {
         AP_HAL::panic("Scheduler: Failed to initialise barrier object: %s",
@@ -117,6 +153,13 @@ void Scheduler::init()
         t->thread->start(t->name, t->policy, t->prio);
     }
 
+    if (!_uart_thread.add_timer(FUNCTOR_BIND_MEMBER(&Scheduler::_uart_task, void),
+                                nullptr, hz_to_usec(APM_LINUX_UART_RATE))) {
+        AP_HAL::panic("Scheduler: failed to create uart event loop");
+    }
+    _uart_thread.set_stack_size(1024 * 1024);
+    _uart_thread.start("ap-uart", SCHED_FIFO, APM_LINUX_UART_PRIORITY);
+
 #if defined(DEBUG_STACK) && DEBUG_STACK
     register_timer_process(FUNCTOR_BIND_MEMBER(&Scheduler::_debug_stack, void));
 #endif
@@ -256,6 +299,7 @@ void Scheduler::_run_uarts()
 {
     // process any pending serial bytes
     for (uint8_t i=0;i<hal.num_serial; i++) {
+        UARTDriver::from(hal.serial(i))->_poll_update(_uart_thread);
         hal.serial(i)->_timer_tick();
     }
 }
@@ -335,6 +379,13 @@ bool Scheduler::SchedulerThread::_run()
     return PeriodicThread::_run();
 }
 
+bool Scheduler::SchedulerPollerThread::_run()
+{
+    _sched._wait_all_threads();
+
+    return PollerThread::_run();
+}
+
 void Scheduler::teardown()
 {
     _timer_thread.stop();
@@ -4,9 +4,12 @@
 
 #include "AP_HAL_Linux.h"
 
+#include "PollerThread.h"
 #include "Semaphores.h"
 #include "Thread.h"
 
+class ExpandingString;
+
 #define LINUX_SCHEDULER_MAX_TIMER_PROCS 10
 #define LINUX_SCHEDULER_MAX_TIMESLICED_PROCS 10
 #define LINUX_SCHEDULER_MAX_IO_PROCS 10
@@ -49,6 +52,9 @@ public:
 
     void teardown();
 
+    /* policy, priority, affinity and wakeup latency of all threads */
+    void thread_info(ExpandingString &str);
+
     /*
       create a new thread
      */
@@ -68,6 +74,23 @@ private:
         Scheduler &_sched;
     };
 
+    /*
+     * event loop thread: serial devices with a file descriptor are read as
+     * soon as input arrives, everything else runs from a periodic timer
+     * on the same poller
+     */
+    class SchedulerPollerThread : public PollerThread {
+    public:
+        SchedulerPollerThread(Scheduler &sched)
+            : _sched(sched)
+        { }
+
+    protected:
+        bool _run() override;
+
+        Scheduler &_sched;
+    };
+
     void     init_realtime();
 
     void _wait_all_threads();
@@ -89,7 +112,7 @@ private:
     SchedulerThread _timer_thread{FUNCTOR_BIND_MEMBER(&Scheduler::_timer_task, void), *this};
     SchedulerThread _io_thread{FUNCTOR_BIND_MEMBER(&Scheduler::_io_task, void), *this};
     SchedulerThread _rcin_thread{FUNCTOR_BIND_MEMBER(&Scheduler::_rcin_task, void), *this};
-    SchedulerThread _uart_thread{FUNCTOR_BIND_MEMBER(&Scheduler::_uart_task, void), *this};
+    SchedulerPollerThread _uart_thread{*this};
 
     void _timer_task();
     void _io_task();
@@ -2,6 +2,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <sys/uio.h>
 
 #include "AP_HAL_Linux.h"
 
@@ -23,4 +24,66 @@ public:
 
     /* Depends on lower level to implement, most devices are fine with defaults */
     virtual void set_parity(int v) { }
+
+    /*
+     * File descriptor the UART event loop should wait on for input, or -1
+     * if the device can't be polled and must be serviced periodically. It
+     * may change while the device is open.
+     */
+    virtual int get_fd() const { return -1; }
+
+    /*
+     * Scatter/gather versions of read() and write(), so a whole ring buffer
+     * can be moved in one system call. Return the number of bytes
+     * transferred or -1 on error. readv() returns 0 at end of file and
+     * writev() returns 0 if the device would block.
+     */
+    virtual ssize_t readv(const struct iovec *iov, int iovcnt)
+    {
+        ssize_t total = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            ssize_t ret = read((uint8_t *)iov[i].iov_base, iov[i].iov_len);
+            if (ret <= 0) {
+                return total > 0 ? total : ret;
+            }
+            total += ret;
+            if ((size_t)ret < iov[i].iov_len) {
+                break;
+            }
+        }
+        return total;
+    }
+
+    virtual ssize_t writev(const struct iovec *iov, int iovcnt)
+    {
+        ssize_t total = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            ssize_t ret = write((const uint8_t *)iov[i].iov_base, iov[i].iov_len);
+            if (ret <= 0) {
+                return total > 0 ? total : ret;
+            }
+            total += ret;
+            if ((size_t)ret < iov[i].iov_len) {
+                break;
+            }
+        }
+        return total;
+    }
+
+    /*
+     * Send each iovec as a separate packet, for datagram based devices.
+     * Returns the number of packets sent, 0 if the device would block or
+     * -1 on error.
+     */
+    virtual int send_packets(const struct iovec *iov, int iovcnt)
+    {
+        int sent = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            if (write((const uint8_t *)iov[i].iov_base, iov[i].iov_len) != (ssize_t)iov[i].iov_len) {
+                break;
+            }
+            sent++;
+        }
+        return sent;
+    }
 };
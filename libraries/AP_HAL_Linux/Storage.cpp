@@ -212,6 +212,7 @@ void Storage::write_block(uint16_t loc, const void *src, size_t n)
         init();
         memcpy(&_buffer[loc], src, n);
         _mark_dirty(loc, n);
+        note_write(n);
     }
 }
 
@@ -220,6 +221,9 @@ void Storage::_timer_tick(void)
     if (!_initialised || _dirty_mask == 0 || _fd == -1) {
         return;
     }
+    if (flush_held()) {
+        return;
+    }
 
     // write out the first dirty set of lines. We don't write more
     // than one to keep the latency of this call to a minimum
@@ -250,6 +254,7 @@ void Storage::_timer_tick(void)
       by the main task except during blocking calls. This means we
       don't need a semaphore around the _dirty_mask updates.
      */
+    const uint32_t start_us = AP_HAL::micros();
     if (lseek(_fd, i<<LINUX_STORAGE_LINE_SHIFT, SEEK_SET) == (i<<LINUX_STORAGE_LINE_SHIFT)) {
         _dirty_mask &= ~write_mask;
         if (write(_fd, &_buffer[i<<LINUX_STORAGE_LINE_SHIFT], n<<LINUX_STORAGE_LINE_SHIFT) != n<<LINUX_STORAGE_LINE_SHIFT) {
@@ -257,6 +262,7 @@ void Storage::_timer_tick(void)
             _dirty_mask |= write_mask;
             close(_fd);
             _fd = -1;
+            return;
         }
         if (_dirty_mask == 0) {
             if (fsync(_fd) != 0) {
@@ -264,5 +270,6 @@ void Storage::_timer_tick(void)
                 _fd = -1;
             }
         }
+        note_flush(n<<LINUX_STORAGE_LINE_SHIFT, AP_HAL::micros() - start_us);
     }
 }
@@ -0,0 +1,330 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+  Journal file layout:
+
+  The journal is a sequence of records, each a JournalRecord header
+  followed by length bytes of data to be copied to offset in the
+  image. The crc covers the header (with a zero crc) and the data.
+
+  Each flush from the timer thread is one append of a batch of
+  records, the last of which has JOURNAL_FLAG_COMMIT set. At boot the
+  batches are replayed in order up to the last complete batch, so a
+  torn append from a power loss is dropped as a whole and the image is
+  always one that existed between two flushes. As flushes are held
+  for an open transaction this also keeps a transaction together.
+
+  A checkpoint writes the image to a temporary file which is renamed
+  over the flat file before the journal is emptied. Replaying a
+  journal over a checkpoint which already holds its changes is
+  harmless, so there is no window where a power loss loses data.
+ */
+#include "Storage_Journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <AP_Common/ExpandingString.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_Math/crc.h>
+#include <AP_Vehicle/AP_Vehicle_Type.h>
+
+using namespace Linux;
+
+// these match the file name used by Linux::Storage
+#define STORAGE_FILE SKETCHNAME ".stg"
+#define STORAGE_TMP_FILE SKETCHNAME ".stg.tmp"
+#define JOURNAL_FILE SKETCHNAME ".jnl"
+
+#define JOURNAL_MAGIC 0x4A53
+#define JOURNAL_FLAG_COMMIT 0x01
+
+extern const AP_HAL::HAL& hal;
+
+void Storage_Journal::init()
+{
+    if (_initialised) {
+        return;
+    }
+
+    // load the last checkpoint. The timer thread is kept out until
+    // the journal has been replayed
+    Storage::init();
+    _initialised = false;
+    if (_fd != -1) {
+        close(_fd);
+        _fd = -1;
+    }
+
+    const char *dpath = hal.util->get_custom_storage_directory();
+    if (!dpath) {
+        dpath = HAL_BOARD_STORAGE_DIRECTORY;
+    }
+
+    _dfd = open(dpath, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if (_dfd == -1) {
+        AP_HAL::panic("Failed to open storage directory %s (%m)", dpath);
+    }
+
+    int jfd = openat(_dfd, JOURNAL_FILE, O_RDWR|O_CREAT|O_APPEND|O_CLOEXEC, 0666);
+    if (jfd == -1) {
+        AP_HAL::panic("Failed to open storage journal %s/%s (%m)", dpath, JOURNAL_FILE);
+    }
+    _jfd = jfd;
+
+    _replay();
+
+    // start with an empty journal so the next boot doesn't replay it again
+    if (_journal_size > 0 && !_checkpoint()) {
+        fprintf(stderr, "Failed to checkpoint storage (%m)\n");
+    }
+
+    _initialised = true;
+}
+
+/*
+  read and check the record at ofs in the journal. data must have
+  room for LINUX_STORAGE_SIZE bytes
+ */
+bool Storage_Journal::_read_record(int fd, uint32_t ofs, JournalRecord &rec, uint8_t *data) const
+{
+    if (pread(fd, &rec, sizeof(rec), ofs) != sizeof(rec)) {
+        return false;
+    }
+    if (rec.magic != JOURNAL_MAGIC ||
+        rec.length == 0 ||
+        uint32_t(rec.offset) + rec.length > LINUX_STORAGE_SIZE) {
+        return false;
+    }
+    if (pread(fd, data, rec.length, ofs + sizeof(rec)) != rec.length) {
+        return false;
+    }
+    JournalRecord hdr = rec;
+    hdr.crc = 0;
+    uint32_t crc = crc_crc32(0, (const uint8_t *)&hdr, sizeof(hdr));
+    crc = crc_crc32(crc, data, rec.length);
+    return crc == rec.crc;
+}
+
+/*
+  apply the complete batches in the journal to the image and drop
+  anything after them
+ */
+void Storage_Journal::_replay(void)
+{
+    JournalRecord rec;
+
+    // find the end of the last complete batch
+    uint32_t committed = 0;
+    uint32_t ofs = 0;
+    while (_read_record(_jfd, ofs, rec, _wbuf)) {
+        ofs += sizeof(rec) + rec.length;
+        if (rec.flags & JOURNAL_FLAG_COMMIT) {
+            committed = ofs;
+        }
+    }
+
+    ofs = 0;
+    while (ofs < committed && _read_record(_jfd, ofs, rec, _wbuf)) {
+        memcpy(&_buffer[rec.offset], _wbuf, rec.length);
+        ofs += sizeof(rec) + rec.length;
+    }
+
+    struct stat st;
+    if (fstat(_jfd, &st) == 0 && uint32_t(st.st_size) != committed) {
+        fprintf(stderr, "Storage journal: dropped %u bytes of incomplete writes\n",
+                unsigned(st.st_size - committed));
+        if (ftruncate(_jfd, committed) != 0) {
+            AP_HAL::panic("Failed to truncate storage journal (%m)");
+        }
+    }
+    _journal_size = committed;
+}
+
+/*
+  write the image to the flat file and empty the journal. This is only
+  called with no changes waiting to be journalled, so the image
+  matches the end of the journal
+ */
+bool Storage_Journal::_checkpoint(void)
+{
+    {
+        WITH_SEMAPHORE(_sem);
+        if (_nranges != 0) {
+            return false;
+        }
+        memcpy(_wbuf, _buffer, sizeof(_buffer));
+    }
+
+    int fd = openat(_dfd, STORAGE_TMP_FILE, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0666);
+    if (fd == -1) {
+        return false;
+    }
+    if (write(fd, _wbuf, sizeof(_buffer)) != sizeof(_buffer) ||
+        fsync(fd) != 0) {
+        close(fd);
+        unlinkat(_dfd, STORAGE_TMP_FILE, 0);
+        return false;
+    }
+    close(fd);
+
+    if (renameat(_dfd, STORAGE_TMP_FILE, _dfd, STORAGE_FILE) != 0 ||
+        fsync(_dfd) != 0) {
+        return false;
+    }
+
+    // the checkpoint is durable, the journal can go
+    if (ftruncate(_jfd, 0) != 0) {
+        return false;
+    }
+    _journal_size = 0;
+    stats.bytes_written += sizeof(_buffer);
+    stats.compactions++;
+    return true;
+}
+
+/*
+  add a range of changed bytes, merging it with any range it overlaps
+  or is close enough to that one record is smaller than two
+ */
+void Storage_Journal::_add_range(uint16_t start, uint16_t end)
+{
+    const uint16_t gap = sizeof(JournalRecord);
+    uint8_t i = 0;
+    while (i < _nranges) {
+        if (start <= _ranges[i].end + gap && _ranges[i].start <= end + gap) {
+            start = MIN(start, _ranges[i].start);
+            end = MAX(end, _ranges[i].end);
+            _ranges[i] = _ranges[--_nranges];
+            // the merged range may now reach ranges already checked
+            i = 0;
+            continue;
+        }
+        i++;
+    }
+    if (_nranges == LINUX_STORAGE_JOURNAL_RANGES) {
+        // merge with the nearest range
+        uint8_t nearest = 0;
+        uint32_t nearest_gap = UINT32_MAX;
+        for (i=0; i<_nranges; i++) {
+            const uint32_t g = _ranges[i].start > end ? _ranges[i].start - end : start - _ranges[i].end;
+            if (g < nearest_gap) {
+                nearest_gap = g;
+                nearest = i;
+            }
+        }
+        start = MIN(start, _ranges[nearest].start);
+        end = MAX(end, _ranges[nearest].end);
+        _ranges[nearest] = _ranges[--_nranges];
+        // the merged range can swallow others
+        _add_range(start, end);
+        return;
+    }
+    _ranges[_nranges++] = { start, end };
+}
+
+void Storage_Journal::write_block(uint16_t loc, const void *src, size_t n)
+{
+    if (loc >= sizeof(_buffer)-(n-1)) {
+        return;
+    }
+    init();
+
+    WITH_SEMAPHORE(_sem);
+
+    // only journal the bytes that change
+    const uint8_t *b = (const uint8_t *)src;
+    size_t first = 0;
+    while (first < n && b[first] == _buffer[loc+first]) {
+        first++;
+    }
+    if (first == n) {
+        return;
+    }
+    size_t last = n - 1;
+    while (b[last] == _buffer[loc+last]) {
+        last--;
+    }
+    memcpy(&_buffer[loc+first], &b[first], last+1-first);
+    _add_range(loc+first, loc+last+1);
+    note_write(last+1-first);
+}
+
+void Storage_Journal::_timer_tick(void)
+{
+    if (!_initialised || _jfd == -1) {
+        return;
+    }
+    if (_nranges == 0) {
+        // checkpoint while idle
+        if (_journal_size >= LINUX_STORAGE_JOURNAL_CHECKPOINT && !flush_held()) {
+            _checkpoint();
+        }
+        return;
+    }
+    if (flush_held()) {
+        return;
+    }
+
+    // build one batch of records from the changed ranges
+    Range ranges[LINUX_STORAGE_JOURNAL_RANGES];
+    uint8_t nranges;
+    uint32_t len = 0;
+    {
+        WITH_SEMAPHORE(_sem);
+        nranges = _nranges;
+        for (uint8_t i=0; i<nranges; i++) {
+            ranges[i] = _ranges[i];
+            JournalRecord rec {};
+            rec.magic = JOURNAL_MAGIC;
+            rec.flags = (i == nranges-1) ? JOURNAL_FLAG_COMMIT : 0;
+            rec.offset = ranges[i].start;
+            rec.length = ranges[i].end - ranges[i].start;
+            memcpy(&_wbuf[len + sizeof(rec)], &_buffer[rec.offset], rec.length);
+            uint32_t crc = crc_crc32(0, (const uint8_t *)&rec, sizeof(rec));
+            rec.crc = crc_crc32(crc, &_wbuf[len + sizeof(rec)], rec.length);
+            memcpy(&_wbuf[len], &rec, sizeof(rec));
+            len += sizeof(rec) + rec.length;
+        }
+        _nranges = 0;
+    }
+
+    const uint32_t start_us = AP_HAL::micros();
+    if (write(_jfd, _wbuf, len) != ssize_t(len) || fdatasync(_jfd) != 0) {
+        // drop any partial batch so later batches can be replayed,
+        // and try again next time
+        if (ftruncate(_jfd, _journal_size) != 0) {
+            close(_jfd);
+            _jfd = -1;
+        }
+        WITH_SEMAPHORE(_sem);
+        for (uint8_t i=0; i<nranges; i++) {
+            _add_range(ranges[i].start, ranges[i].end);
+        }
+        return;
+    }
+    _journal_size += len;
+    note_flush(len, AP_HAL::micros() - start_us);
+}
+
+void Storage_Journal::get_stats(ExpandingString &str)
+{
+    Storage::get_stats(str);
+    str.printf("journal_bytes:   %u\n", unsigned(_journal_size));
+}
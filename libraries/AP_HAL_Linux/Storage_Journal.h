@@ -0,0 +1,77 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <AP_Common/AP_Common.h>
+#include <AP_HAL/AP_HAL.h>
+
+#include "Storage.h"
+
+// journal size at which the image is checkpointed and the journal emptied
+#ifndef LINUX_STORAGE_JOURNAL_CHECKPOINT
+#define LINUX_STORAGE_JOURNAL_CHECKPOINT (4*LINUX_STORAGE_SIZE)
+#endif
+
+// number of separate changed ranges waiting to be journalled
+#define LINUX_STORAGE_JOURNAL_RANGES 16
+
+namespace Linux {
+
+/*
+  log structured storage. The RAM image is checkpointed to the same
+  flat file used by Linux::Storage, and changes since the checkpoint
+  are appended to a journal as (offset, data, crc) records
+ */
+class Storage_Journal : public Storage
+{
+public:
+    void init() override;
+    void write_block(uint16_t dst, const void* src, size_t n) override;
+    void _timer_tick(void) override;
+    void get_stats(ExpandingString &str) override;
+
+private:
+    struct PACKED JournalRecord {
+        uint16_t magic;
+        uint8_t flags;
+        uint8_t reserved;
+        uint16_t offset;
+        uint16_t length;
+        uint32_t crc;
+    };
+
+    struct Range {
+        uint16_t start;
+        uint16_t end;
+    };
+
+    void _add_range(uint16_t start, uint16_t end);
+    bool _read_record(int fd, uint32_t ofs, JournalRecord &rec, uint8_t *data) const;
+    void _replay(void);
+    bool _checkpoint(void);
+
+    HAL_Semaphore _sem;
+    int _dfd = -1;
+    int _jfd = -1;
+    uint32_t _journal_size = 0;
+
+    Range _ranges[LINUX_STORAGE_JOURNAL_RANGES];
+    uint8_t _nranges = 0;
+
+    // one flush can cover the whole image
+    uint8_t _wbuf[LINUX_STORAGE_SIZE + LINUX_STORAGE_JOURNAL_RANGES*sizeof(JournalRecord)];
+};
+
+}
@@ -3,6 +3,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <AP_HAL/AP_HAL.h>
@@ -57,6 +58,30 @@ ssize_t TCPServerDevice::read(uint8_t *buf, uint16_t n)
     return ret;
 }
 
+ssize_t TCPServerDevice::readv(const struct iovec *iov, int iovcnt)
+{
+    if (sock == nullptr) {
+        // the listener became readable, accept the new connection
+        return read((uint8_t *)iov[0].iov_base, iov[0].iov_len);
+    }
+    // at EOF return 0 and keep the socket: the UART stops polling it
+    // and falls back to read(), which closes it. Closing it here would
+    // free the fd number while it is still registered for polling
+    return ::readv(sock->get_fd(), iov, iovcnt);
+}
+
+ssize_t TCPServerDevice::writev(const struct iovec *iov, int iovcnt)
+{
+    if (sock == nullptr) {
+        return -1;
+    }
+    ssize_t ret = ::writev(sock->get_fd(), iov, iovcnt);
+    if (ret < 0 && errno == EAGAIN) {
+        return 0;
+    }
+    return ret;
+}
+
 bool TCPServerDevice::open()
 {
     listener.reuseaddress();
@@ -14,6 +14,9 @@ public:
     virtual void set_speed(uint32_t speed) override;
     virtual ssize_t write(const uint8_t *buf, uint16_t n) override;
     virtual ssize_t read(uint8_t *buf, uint16_t n) override;
+    virtual int get_fd() const override { return sock != nullptr ? sock->get_fd() : listener.get_fd(); }
+    virtual ssize_t readv(const struct iovec *iov, int iovcnt) override;
+    virtual ssize_t writev(const struct iovec *iov, int iovcnt) override;
 
 private:
     SocketAPM listener{false};
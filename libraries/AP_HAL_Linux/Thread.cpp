@@ -23,10 +23,12 @@
 #include <unistd.h>
 #include <utility>
 
+#include <AP_Common/ExpandingString.h>
 #include <AP_HAL/AP_HAL.h>
 #include <AP_Math/AP_Math.h>
 
 #include "Scheduler.h"
+#include "ThreadConfig.h"
 
 #define STACK_POISON 0xBEBACAFE
 
@@ -34,10 +36,26 @@ extern const AP_HAL::HAL &hal;
 
 namespace Linux {
 
+Thread *Thread::_threads;
+pthread_mutex_t Thread::_threads_mtx = PTHREAD_MUTEX_INITIALIZER;
+thread_local Thread *Thread::_current;
+
+Thread::~Thread()
+{
+    pthread_mutex_lock(&_threads_mtx);
+    for (Thread **t = &_threads; *t != nullptr; t = &(*t)->_next) {
+        if (*t == this) {
+            *t = _next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&_threads_mtx);
+}
 
 void *Thread::_run_trampoline(void *arg)
 {
     Thread *thread = static_cast<Thread *>(arg);
+    _current = thread;
     thread->_poison_stack();
     thread->_run();
 
@@ -171,6 +189,14 @@ bool Thread::start(const char *name, int policy, int prio)
 
     pthread_attr_init(&attr);
 
+    // apply any command line overrides for this thread
+    cpu_set_t cpus;
+    if (ThreadConfig::get_singleton()->configure(name, policy, param.sched_priority, cpus) &&
+        (r = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus)) != 0) {
+        AP_HAL::panic("Failed to set affinity for thread '%s': %s",
+                      name, strerror(r));
+    }
+
     /*
       we need to run as root to get realtime scheduling. Allow it to
       run as non-root for debugging purposes, plus to allow the Replay
@@ -191,6 +217,19 @@ bool Thread::start(const char *name, int policy, int prio)
         }
     }
 
+    if (name) {
+        strncpy(_name, name, sizeof(_name) - 1);
+    }
+
+    // link before the thread runs, as an auto-free thread may delete itself
+    pthread_mutex_lock(&_threads_mtx);
+    if (!_linked) {
+        _next = _threads;
+        _threads = this;
+        _linked = true;
+    }
+    pthread_mutex_unlock(&_threads_mtx);
+
     r = pthread_create(&_ctx, &attr, &Thread::_run_trampoline, this);
     if (r != 0) {
         AP_HAL::panic("Failed to create thread '%s': %s",
@@ -207,6 +246,78 @@ bool Thread::start(const char *name, int policy, int prio)
     return true;
 }
 
+void Thread::record_wakeup_latency(uint32_t usec)
+{
+    if (_wakeup_pub.reset.exchange(false, std::memory_order_acquire)) {
+        _wakeup = {};
+    }
+    _wakeup.count++;
+    _wakeup.total_usec += usec;
+    if (usec > _wakeup.max_usec) {
+        _wakeup.max_usec = usec;
+    }
+
+    const uint32_t seq = _wakeup_pub.seq.load(std::memory_order_relaxed);
+    _wakeup_pub.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _wakeup_pub.count.store(_wakeup.count, std::memory_order_relaxed);
+    _wakeup_pub.avg_usec.store(uint32_t(_wakeup.total_usec / _wakeup.count), std::memory_order_relaxed);
+    _wakeup_pub.max_usec.store(_wakeup.max_usec, std::memory_order_relaxed);
+    _wakeup_pub.seq.store(seq + 2, std::memory_order_release);
+}
+
+/*
+  read the wakeup statistics published by record_wakeup_latency()
+ */
+void Thread::read_wakeup_stats(uint32_t &count, uint32_t &avg_usec, uint32_t &max_usec) const
+{
+    uint32_t seq;
+    do {
+        seq = _wakeup_pub.seq.load(std::memory_order_acquire);
+        count = _wakeup_pub.count.load(std::memory_order_relaxed);
+        avg_usec = _wakeup_pub.avg_usec.load(std::memory_order_relaxed);
+        max_usec = _wakeup_pub.max_usec.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1U) != 0 || seq != _wakeup_pub.seq.load(std::memory_order_relaxed));
+}
+
+void Thread::print_thread_info(ExpandingString &str, const char *name, pthread_t ctx,
+                               uint32_t wakeups, uint32_t avg_us, uint32_t max_us)
+{
+    int policy = SCHED_OTHER;
+    struct sched_param param {};
+    pthread_getschedparam(ctx, &policy, &param);
+
+    char cpulist[32] = "?";
+    cpu_set_t cpus;
+    if (pthread_getaffinity_np(ctx, sizeof(cpus), &cpus) == 0) {
+        ThreadConfig::format_cpulist(cpus, cpulist, sizeof(cpulist));
+    }
+
+    str.printf("%-15.15s POL=%s PRI=%2d CPUS=%-8s WAKE=%5u AVG=%4u MAX=%5u\n",
+               name,
+               policy == SCHED_FIFO ? "FIFO" : policy == SCHED_RR ? "RR" : "OTHER",
+               param.sched_priority, cpulist,
+               unsigned(wakeups), unsigned(avg_us), unsigned(max_us));
+}
+
+void Thread::thread_info(ExpandingString &str)
+{
+    pthread_mutex_lock(&_threads_mtx);
+    for (Thread *t = _threads; t != nullptr; t = t->_next) {
+        if (!t->_started) {
+            continue;
+        }
+        uint32_t count, avg_usec, max_usec;
+        t->read_wakeup_stats(count, avg_usec, max_usec);
+        print_thread_info(str, t->_name[0] ? t->_name : "?", t->_ctx,
+                          count, avg_usec, max_usec);
+        // the thread clears its statistics on its next wakeup
+        t->_wakeup_pub.reset.store(true, std::memory_order_release);
+    }
+    pthread_mutex_unlock(&_threads_mtx);
+}
+
 bool Thread::is_current_thread()
 {
     return pthread_equal(pthread_self(), _ctx);
@@ -266,6 +377,8 @@ bool PeriodicThread::_run()
             next_run_usec = AP_HAL::micros64();
         } else {
             Scheduler::from(hal.scheduler)->microsleep(dt);
+            const uint64_t now = AP_HAL::micros64();
+            record_wakeup_latency(now > next_run_usec ? now - next_run_usec : 0);
         }
         next_run_usec += _period_usec;
 
@@ -16,12 +16,15 @@
  */
 #pragma once
 
+#include <atomic>
 #include <pthread.h>
 #include <inttypes.h>
 #include <stdlib.h>
 
 #include <AP_HAL/utility/functor.h>
 
+class ExpandingString;
+
 namespace Linux {
 
 /*
@@ -33,7 +36,7 @@ public:
 
     Thread(task_t t) : _task(t) { }
 
-    virtual ~Thread() { }
+    virtual ~Thread();
 
     bool start(const char *name, int policy, int prio);
 
@@ -51,6 +54,24 @@ public:
 
     bool join();
 
+    /*
+     * Record how late the thread woke up relative to when it was due. Must
+     * only be called from the thread itself.
+     */
+    void record_wakeup_latency(uint32_t usec);
+
+    /* The Thread the caller runs on, nullptr if not started through Thread */
+    static Thread *current() { return _current; }
+
+    /*
+     * Report policy, priority, CPU affinity and wakeup latency of all
+     * running threads, resetting the latency statistics
+     */
+    static void thread_info(ExpandingString &str);
+
+    static void print_thread_info(ExpandingString &str, const char *name, pthread_t ctx,
+                                  uint32_t wakeups, uint32_t avg_us, uint32_t max_us);
+
 protected:
     static void *_run_trampoline(void *arg);
 
@@ -63,6 +84,8 @@ protected:
 
     void _poison_stack();
 
+    void read_wakeup_stats(uint32_t &count, uint32_t &avg_usec, uint32_t &max_usec) const;
+
     task_t _task;
     bool _started = false;
     bool _should_exit = false;
@@ -75,6 +98,34 @@ protected:
     } _stack_debug;
 
     size_t _stack_size = 0;
+
+    char _name[16] {};
+
+    // wakeup latency, only touched by the thread itself
+    struct {
+        uint32_t count;
+        uint32_t max_usec;
+        uint64_t total_usec;
+    } _wakeup {};
+
+    // copy of _wakeup for thread_info(), published under a sequence lock
+    // which is odd while the thread is writing it. thread_info() asks
+    // for the statistics to be cleared rather than clearing them itself
+    struct {
+        std::atomic<uint32_t> seq;
+        std::atomic<uint32_t> count;
+        std::atomic<uint32_t> avg_usec;
+        std::atomic<uint32_t> max_usec;
+        std::atomic<bool> reset;
+    } _wakeup_pub {};
+
+    // list of started threads, for thread_info()
+    Thread *_next = nullptr;
+    bool _linked = false;
+    static Thread *_threads;
+    static pthread_mutex_t _threads_mtx;
+
+    static thread_local Thread *_current;
 };
 
 class PeriodicThread : public Thread {
@@ -0,0 +1,261 @@
+/*
+ * This file is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ThreadConfig.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Scheduler.h"
+
+namespace Linux {
+
+ThreadConfig ThreadConfig::_singleton;
+
+ThreadConfig *ThreadConfig::get_singleton()
+{
+    return &_singleton;
+}
+
+/*
+  parse a cpulist in the kernel's format, e.g. "0-1,3"
+ */
+bool ThreadConfig::parse_cpulist(const char *str, cpu_set_t &cpus)
+{
+    CPU_ZERO(&cpus);
+
+    const char *p = str;
+    while (*p) {
+        char *end;
+        const long first = strtol(p, &end, 10);
+        if (end == p || first < 0 || first >= CPU_SETSIZE) {
+            return false;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            p++;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first || last >= CPU_SETSIZE) {
+                return false;
+            }
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            CPU_SET(cpu, &cpus);
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p != 0) {
+            return false;
+        }
+    }
+
+    return CPU_COUNT(&cpus) > 0;
+}
+
+void ThreadConfig::format_cpulist(const cpu_set_t &cpus, char *buf, size_t len)
+{
+    size_t ofs = 0;
+    buf[0] = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && ofs < len; cpu++) {
+        if (!CPU_ISSET(cpu, &cpus)) {
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &cpus)) {
+            last++;
+        }
+        int n;
+        if (last == cpu) {
+            n = snprintf(&buf[ofs], len - ofs, "%s%d", ofs ? "," : "", cpu);
+        } else {
+            n = snprintf(&buf[ofs], len - ofs, "%s%d-%d", ofs ? "," : "", cpu, last);
+        }
+        if (n < 0) {
+            break;
+        }
+        ofs += n;
+        cpu = last;
+    }
+}
+
+bool ThreadConfig::_split(const char *spec, char *name, size_t name_len, const char *&value) const
+{
+    const char *eq = strchr(spec, '=');
+    if (eq == nullptr || eq == spec || (size_t)(eq - spec) >= name_len) {
+        fprintf(stderr, "Invalid thread setting '%s', expected name=value\n", spec);
+        return false;
+    }
+    memcpy(name, spec, eq - spec);
+    name[eq - spec] = 0;
+    value = eq + 1;
+    return true;
+}
+
+ThreadConfig::entry *ThreadConfig::_find(const char *name, bool create)
+{
+    for (uint8_t i = 0; i < _num_entries; i++) {
+        if (strcmp(_entries[i].name, name) == 0) {
+            return &_entries[i];
+        }
+    }
+    if (!create || _num_entries >= MAX_ENTRIES) {
+        return nullptr;
+    }
+    entry &e = _entries[_num_entries++];
+    e = entry();
+    strncpy(e.name, name, sizeof(e.name) - 1);
+    e.name[sizeof(e.name) - 1] = 0;
+    return &e;
+}
+
+const ThreadConfig::entry *ThreadConfig::_match(const char *name) const
+{
+    if (name == nullptr) {
+        return nullptr;
+    }
+    for (uint8_t i = 0; i < _num_entries; i++) {
+        const entry &e = _entries[i];
+        const size_t len = strlen(e.name);
+        if (len > 0 && e.name[len - 1] == '*') {
+            if (strncmp(e.name, name, len - 1) == 0) {
+                return &e;
+            }
+        } else if (strcmp(e.name, name) == 0) {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+bool ThreadConfig::add_affinity(const char *spec)
+{
+    char name[sizeof(entry::name)];
+    const char *value;
+    if (!_split(spec, name, sizeof(name), value)) {
+        return false;
+    }
+    cpu_set_t cpus;
+    if (!parse_cpulist(value, cpus)) {
+        fprintf(stderr, "Invalid cpulist '%s' for thread %s\n", value, name);
+        return false;
+    }
+    entry *e = _find(name, true);
+    if (e == nullptr) {
+        fprintf(stderr, "Too many thread settings\n");
+        return false;
+    }
+    e->cpus = cpus;
+    e->has_cpus = true;
+    return true;
+}
+
+bool ThreadConfig::add_priority(const char *spec)
+{
+    char name[sizeof(entry::name)];
+    const char *value;
+    if (!_split(spec, name, sizeof(name), value)) {
+        return false;
+    }
+    char *end;
+    const long prio = strtol(value, &end, 10);
+    if (end == value || *end != 0 ||
+        prio < sched_get_priority_min(SCHED_FIFO) ||
+        prio > sched_get_priority_max(SCHED_FIFO)) {
+        fprintf(stderr, "Invalid priority '%s' for thread %s\n", value, name);
+        return false;
+    }
+    entry *e = _find(name, true);
+    if (e == nullptr) {
+        fprintf(stderr, "Too many thread settings\n");
+        return false;
+    }
+    e->prio = prio;
+    return true;
+}
+
+bool ThreadConfig::set_isolated_cpus(const char *cpulist)
+{
+    if (!parse_cpulist(cpulist, _isolated_cpus)) {
+        fprintf(stderr, "Invalid cpulist '%s'\n", cpulist);
+        return false;
+    }
+    _isolate = true;
+    return true;
+}
+
+bool ThreadConfig::configure(const char *name, int policy, int &prio, cpu_set_t &cpus) const
+{
+    const entry *e = _match(name);
+    if (e != nullptr && e->prio >= 0) {
+        prio = e->prio;
+    }
+    if (e != nullptr && e->has_cpus) {
+        cpus = e->cpus;
+        return true;
+    }
+    if (!_isolate) {
+        // don't let threads inherit the main thread's pinning
+        if (_have_default_cpus) {
+            cpus = _default_cpus;
+            return true;
+        }
+        return false;
+    }
+
+    if (policy == SCHED_FIFO && prio >= AP_LINUX_SENSORS_SCHED_PRIO) {
+        cpus = _isolated_cpus;
+        return true;
+    }
+
+    // everything else runs on the remaining online CPUs
+    CPU_ZERO(&cpus);
+    const long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (long cpu = 0; cpu < n_cpus && cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &_isolated_cpus)) {
+            CPU_SET(cpu, &cpus);
+        }
+    }
+    return CPU_COUNT(&cpus) > 0;
+}
+
+void ThreadConfig::configure_current(const char *name, int policy, int prio)
+{
+    cpu_set_t cpus;
+    const int orig_prio = prio;
+    if (!_have_default_cpus &&
+        pthread_getaffinity_np(pthread_self(), sizeof(_default_cpus), &_default_cpus) == 0) {
+        _have_default_cpus = true;
+    }
+    if (configure(name, policy, prio, cpus)) {
+        const int r = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (r != 0) {
+            fprintf(stderr, "Failed to set affinity for thread '%s': %s\n", name, strerror(r));
+        }
+    }
+    if (prio != orig_prio && geteuid() == 0) {
+        struct sched_param param = { .sched_priority = prio };
+        const int r = pthread_setschedparam(pthread_self(), policy, &param);
+        if (r != 0) {
+            fprintf(stderr, "Failed to set priority for thread '%s': %s\n", name, strerror(r));
+        }
+    }
+}
+
+}
@@ -0,0 +1,90 @@
+/*
+ * This file is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Linux {
+
+/*
+ * Per-thread CPU affinity and real-time priority overrides, set from the
+ * command line before the scheduler starts any thread. Threads are matched
+ * by name ("main" for the main loop), a trailing '*' matches any suffix and
+ * the first matching entry wins.
+ */
+class ThreadConfig {
+public:
+    static ThreadConfig *get_singleton();
+
+    /* "name=cpulist", e.g. "ap-timer=3" or "SPI*=2-3" */
+    bool add_affinity(const char *spec);
+
+    /* "name=prio", e.g. "main=14" */
+    bool add_priority(const char *spec);
+
+    /*
+     * Reserve @cpulist for the main loop and the high priority real-time
+     * threads. Everything else is kept off these CPUs. Best combined with
+     * the isolcpus= kernel parameter so Linux itself stays off them too.
+     */
+    bool set_isolated_cpus(const char *cpulist);
+
+    /*
+     * Apply the overrides for a thread about to be created. @prio may be
+     * changed; @cpus is filled in and true returned if the thread should be
+     * pinned.
+     */
+    bool configure(const char *name, int policy, int &prio, cpu_set_t &cpus) const;
+
+    /*
+     * Apply the overrides to the calling thread. The affinity it had before
+     * is used for threads without an override created afterwards.
+     */
+    void configure_current(const char *name, int policy, int prio);
+
+    static bool parse_cpulist(const char *str, cpu_set_t &cpus);
+
+    /* format @cpus as a cpulist into @buf */
+    static void format_cpulist(const cpu_set_t &cpus, char *buf, size_t len);
+
+private:
+    static const uint8_t MAX_ENTRIES = 16;
+
+    struct entry {
+        char name[16] {};
+        bool has_cpus = false;
+        cpu_set_t cpus {};
+        int prio = -1;
+    };
+
+    entry *_find(const char *name, bool create);
+    const entry *_match(const char *name) const;
+    bool _split(const char *spec, char *name, size_t name_len, const char *&value) const;
+
+    entry _entries[MAX_ENTRIES];
+    uint8_t _num_entries = 0;
+
+    bool _isolate = false;
+    cpu_set_t _isolated_cpus;
+
+    bool _have_default_cpus = false;
+    cpu_set_t _default_cpus;
+
+    static ThreadConfig _singleton;
+};
+
+}
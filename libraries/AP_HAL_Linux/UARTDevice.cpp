@@ -4,6 +4,7 @@
 #include <fcntl.h>
 #include <poll.h>
 #include <stdio.h>
+#include <sys/uio.h>
 #include <termios.h>
 #include <unistd.h>
 
@@ -67,6 +68,24 @@ ssize_t UARTDevice::write(const uint8_t *buf, uint16_t n)
     return ret;
 }
 
+ssize_t UARTDevice::readv(const struct iovec *iov, int iovcnt)
+{
+    return ::readv(_fd, iov, iovcnt);
+}
+
+/*
+  the fd is non-blocking, so unlike write() there is no need to poll
+  before writing
+ */
+ssize_t UARTDevice::writev(const struct iovec *iov, int iovcnt)
+{
+    ssize_t ret = ::writev(_fd, iov, iovcnt);
+    if (ret < 0 && errno == EAGAIN) {
+        return 0;
+    }
+    return ret;
+}
+
 void UARTDevice::set_blocking(bool blocking)
 {
     int flags = fcntl(_fd, F_GETFL, 0);
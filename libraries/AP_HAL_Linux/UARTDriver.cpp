@@ -10,14 +10,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <termios.h>
 #include <unistd.h>
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
 
 #include "ConsoleDevice.h"
 #include "TCPServerDevice.h"
@@ -27,6 +30,13 @@
 #include <GCS_MAVLink/GCS.h>
 #include <AP_HAL/utility/packetise.h>
 
+// maximum number of MAVLink packets sent per sendmmsg() call
+#define UART_MAX_BATCH_PACKETS 16
+// bytes staged for one batch, enough for the largest MAVLink2 packets
+#define UART_MAX_BATCH_BYTES (UART_MAX_BATCH_PACKETS * 280)
+// how long to fall back to periodic reads after a hang-up or error
+#define UART_POLL_RETRY_MS 100
+
 extern const AP_HAL::HAL& hal;
 
 using namespace Linux;
@@ -84,6 +94,7 @@ void UARTDriver::begin(uint32_t b, uint16_t rxS, uint16_t txS)
         }
     }
     _initialised = false;
+    _device_generation++;
 
     while (_in_timer) hal.scheduler->delay(1);
 
@@ -221,6 +232,7 @@ void UARTDriver::end()
     }
 
     _device->close();
+    _device_generation++;
     _deallocate_buffers();
 }
 
@@ -387,6 +399,10 @@ int UARTDriver::_read_fd(uint8_t *buf, uint16_t n)
  */
 bool UARTDriver::_write_pending_bytes(void)
 {
+    if (_pollable.get_fd() != -1) {
+        return _write_pending_bytes_batched();
+    }
+
     // write any pending bytes
     uint32_t available_bytes = _writebuf.available();
     uint16_t n = available_bytes;
@@ -428,9 +444,164 @@ bool UARTDriver::_write_pending_bytes(void)
 }
 
 /*
-  push any pending bytes to/from the serial port. This is called at
-  1kHz in the timer thread. Doing it this way reduces the system call
-  overhead in the main task enormously.
+  push all pending bytes out with as few system calls as possible: one
+  writev() covering both halves of the ring buffer, or for packetised
+  (UDP) links one sendmmsg() carrying up to UART_MAX_BATCH_PACKETS
+  MAVLink packets, each as its own datagram
+  return true if progress is made
+ */
+bool UARTDriver::_write_pending_bytes_batched(void)
+{
+    const uint32_t available_bytes = _writebuf.available();
+    if (available_bytes == 0) {
+        return false;
+    }
+
+    if (_packetise) {
+        uint8_t tmpbuf[UART_MAX_BATCH_BYTES];
+        struct iovec iov[UART_MAX_BATCH_PACKETS];
+        uint32_t ofs = 0;
+        uint8_t n_pkts = 0;
+        while (n_pkts < UART_MAX_BATCH_PACKETS && ofs < available_bytes) {
+            const uint16_t n = mavlink_packetise(_writebuf, MIN(available_bytes - ofs, (uint32_t)UINT16_MAX), ofs);
+            if (n == 0 || ofs + n > sizeof(tmpbuf)) {
+                break;
+            }
+            iov[n_pkts].iov_base = &tmpbuf[ofs];
+            iov[n_pkts].iov_len = n;
+            ofs += n;
+            n_pkts++;
+        }
+        if (n_pkts == 0) {
+            return false;
+        }
+        _writebuf.peekbytes(tmpbuf, ofs);
+        const int sent = _device->send_packets(iov, n_pkts);
+        for (int i = 0; i < sent; i++) {
+            _writebuf.advance(iov[i].iov_len);
+        }
+    } else {
+        ByteBuffer::IoVec vec[2];
+        struct iovec iov[2];
+        const auto n_vec = _writebuf.peekiovec(vec, available_bytes);
+        for (int i = 0; i < n_vec; i++) {
+            iov[i].iov_base = vec[i].data;
+            iov[i].iov_len = vec[i].len;
+        }
+        const ssize_t ret = _device->writev(iov, n_vec);
+        if (ret > 0) {
+            _writebuf.advance(ret);
+        }
+    }
+
+    return _writebuf.available() != available_bytes;
+}
+
+void UARTDriver::_update_receive_timestamp()
+{
+    _receive_timestamp[_receive_timestamp_idx^1] = AP_HAL::micros64();
+    _receive_timestamp_idx ^= 1;
+}
+
+/*
+  called from the UART event loop when the device has input: read
+  straight into the ring buffer with a single readv()
+ */
+void UARTDriver::_poll_read()
+{
+    if (!_initialised) {
+        return;
+    }
+
+    _in_timer = true;
+
+    ByteBuffer::IoVec vec[2];
+    struct iovec iov[2];
+    const auto n_vec = _readbuf.reserve(vec, _readbuf.space());
+    if (n_vec == 0) {
+        // buffer is full, stop waiting for input until it is drained
+        if (_poll_events != 0 && _poller_thread->modify_pollable(&_pollable, 0)) {
+            _poll_events = 0;
+        }
+        _in_timer = false;
+        return;
+    }
+    for (int i = 0; i < n_vec; i++) {
+        iov[i].iov_base = vec[i].data;
+        iov[i].iov_len = vec[i].len;
+    }
+
+    const ssize_t ret = _device->readv(iov, n_vec);
+    if (ret > 0) {
+        _readbuf.commit((unsigned)ret);
+        _update_receive_timestamp();
+    } else {
+        _readbuf.commit(0);
+        if (ret == 0) {
+            // end of file would be reported as readable forever
+            _poll_suspend();
+        }
+    }
+
+    _in_timer = false;
+}
+
+/*
+  stop waiting on the device for a while, falling back to periodic
+  reads from _timer_tick()
+ */
+void UARTDriver::_poll_suspend()
+{
+    if (_pollable.get_fd() == -1) {
+        return;
+    }
+    _poller_thread->unregister_pollable(&_pollable);
+    _pollable.set_fd(-1);
+    _poll_resume_ms = AP_HAL::millis() + UART_POLL_RETRY_MS;
+}
+
+void UARTDriver::_poll_update(PollerThread &thread)
+{
+    _poller_thread = &thread;
+
+    int fd = -1;
+    if (_initialised && _connected && (int32_t)(AP_HAL::millis() - _poll_resume_ms) >= 0) {
+        fd = _device->get_fd();
+    }
+
+    if (fd == _pollable.get_fd() && _poll_generation == _device_generation) {
+        // resume waiting for input once there is room for it
+        const uint32_t events = _readbuf.space() > 0 ? EPOLLIN : 0;
+        if (fd != -1 && events != _poll_events &&
+            thread.modify_pollable(&_pollable, events)) {
+            _poll_events = events;
+        }
+        return;
+    }
+
+    if (_pollable.get_fd() != -1) {
+        thread.unregister_pollable(&_pollable);
+    }
+    _pollable.set_fd(fd);
+    _poll_generation = _device_generation;
+    if (fd == -1) {
+        return;
+    }
+
+    _poll_events = _readbuf.space() > 0 ? EPOLLIN : 0;
+    if (!thread.register_pollable(&_pollable, _poll_events)) {
+        // not pollable (e.g. stdin redirected from a file), keep
+        // servicing it from _timer_tick()
+        _pollable.set_fd(-1);
+        _poll_resume_ms = AP_HAL::millis() + UART_POLL_RETRY_MS;
+    }
+}
+
+/*
+  push any pending bytes to/from the serial port. This is called
+  periodically from the UART event loop. Doing it this way reduces the
+  system call overhead in the main task enormously. Devices registered
+  with the event loop are read from _poll_read() instead.
  */
 void UARTDriver::_timer_tick(void)
 {
@@ -443,6 +614,11 @@ void UARTDriver::_timer_tick(void)
         num_send--;
     }
 
+    if (_pollable.get_fd() != -1) {
+        _in_timer = false;
+        return;
+    }
+
     // try to fill the read buffer
     int ret;
     ByteBuffer::IoVec vec[2];
@@ -455,10 +631,8 @@ void UARTDriver::_timer_tick(void)
         }
         _readbuf.commit((unsigned)ret);
 
-        // update receive timestamp
-        _receive_timestamp[_receive_timestamp_idx^1] = AP_HAL::micros64();
-        _receive_timestamp_idx ^= 1;
-        
+        _update_receive_timestamp();
+
         /* stop reading as we read less than we asked for */
         if ((unsigned)ret < vec[i].len) {
             break;
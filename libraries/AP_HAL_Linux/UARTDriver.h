@@ -4,6 +4,7 @@
 #include <AP_HAL/utility/RingBuffer.h>
 
 #include "AP_HAL_Linux.h"
+#include "PollerThread.h"
 #include "SerialDevice.h"
 #include "Semaphores.h"
 
@@ -42,6 +43,12 @@ public:
     bool _write_pending_bytes(void);
     virtual void _timer_tick(void) override;
 
+    /*
+      keep the device registered with the UART event loop. Called
+      periodically from the thread running @thread
+     */
+    void _poll_update(PollerThread &thread);
+
     virtual enum flow_control get_flow_control(void) override
     {
         return _device->get_flow_control();
@@ -89,6 +96,41 @@ private:
     // timestamp for receiving data on the UART, avoiding a lock
     uint64_t _receive_timestamp[2];
     uint8_t _receive_timestamp_idx;
+    void _update_receive_timestamp();
+
+    /*
+      devices with a file descriptor are read from the UART event loop
+      as soon as input arrives, and written with one writev() or
+      sendmmsg() per flush. The file descriptor is owned by the
+      SerialDevice.
+     */
+    class DevicePollable : public Pollable {
+    public:
+        DevicePollable(UARTDriver &uart) : _uart(uart) { }
+        ~DevicePollable() { _fd = -1; }
+
+        void set_fd(int fd) { _fd = fd; }
+
+        void on_can_read() override { _uart._poll_read(); }
+        void on_error() override { _uart._poll_suspend(); }
+        void on_hang_up() override { _uart._poll_suspend(); }
+
+    private:
+        UARTDriver &_uart;
+    };
+
+    DevicePollable _pollable{*this};
+    PollerThread *_poller_thread;
+    uint32_t _poll_events;
+    uint32_t _poll_resume_ms;
+    // bumped whenever the device is opened or closed, as a new fd may
+    // reuse the number of the old one
+    uint8_t _device_generation;
+    uint8_t _poll_generation;
+
+    void _poll_read();
+    void _poll_suspend();
+    bool _write_pending_bytes_batched(void);
 
 protected:
     const char *device_path;
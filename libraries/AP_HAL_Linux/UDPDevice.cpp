@@ -1,8 +1,11 @@
 #include "UDPDevice.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
 
 #include <AP_HAL/AP_HAL.h>
 
@@ -33,6 +36,30 @@ ssize_t UDPDevice::write(const uint8_t *buf, uint16_t n)
     return socket.sendto(buf, n, _ip, _port);
 }
 
+/*
+  send a batch of datagrams with a single system call once the socket
+  is connected
+ */
+int UDPDevice::send_packets(const struct iovec *iov, int iovcnt)
+{
+    if (!_connected) {
+        return SerialDevice::send_packets(iov, iovcnt);
+    }
+
+    struct mmsghdr msgs[iovcnt];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < iovcnt; i++) {
+        msgs[i].msg_hdr.msg_iov = const_cast<struct iovec *>(&iov[i]);
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int ret = sendmmsg(socket.get_fd(), msgs, iovcnt, MSG_DONTWAIT);
+    if (ret < 0 && errno == EAGAIN) {
+        return 0;
+    }
+    return ret;
+}
+
 ssize_t UDPDevice::read(uint8_t *buf, uint16_t n)
 {
     ssize_t ret = socket.recv(buf, n, 0);
@@ -10,6 +10,7 @@
 #include <AP_HAL/AP_HAL.h>
 
 #include "Heat_Pwm.h"
+#include "Scheduler.h"
 #include "ToneAlarm_Disco.h"
 #include "Util.h"
 
@@ -93,6 +94,11 @@ uint32_t Util::available_memory(void)
     return 256*1024;
 }
 
+void Util::thread_info(ExpandingString &str)
+{
+    Scheduler::from(hal.scheduler)->thread_info(str);
+}
+
 #ifndef HAL_LINUX_DEFAULT_SYSTEM_ID
 #define HAL_LINUX_DEFAULT_SYSTEM_ID "linux-unknown"
 #endif
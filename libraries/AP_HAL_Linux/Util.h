@@ -57,6 +57,9 @@ public:
 
     uint32_t available_memory(void) override;
 
+    // request information on running threads
+    void thread_info(ExpandingString &str) override;
+
     bool get_system_id(char buf[40]) override;
     bool get_system_id_unformatted(uint8_t buf[], uint8_t &len) override;
 
@@ -0,0 +1,68 @@
+#include <AP_gbenchmark.h>
+#include <AP_HAL/AP_HAL.h>
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX && HAL_NUM_CAN_IFACES
+
+#include <AP_HAL_Linux/CANSocketIface.h>
+#include <AP_CANManager/AP_CANManager.h>
+
+/*
+  SocketCAN throughput over a virtual CAN bus, so no hardware is
+  needed. Create the bus before running with:
+    ip link add dev vcan0 type vcan
+    ip link set up vcan0
+ */
+#define BENCHMARK_CAN_IFACE "vcan0"
+
+// the interface logs through the CAN manager
+static AP_CANManager can_manager;
+
+static void BM_CANSendReceive(benchmark::State& state)
+{
+    Linux::CANIface tx_iface(0, BENCHMARK_CAN_IFACE);
+    Linux::CANIface rx_iface(0, BENCHMARK_CAN_IFACE);
+
+    if (!tx_iface.init(1000000, AP_HAL::CANIface::NormalMode) ||
+        !rx_iface.init(1000000, AP_HAL::CANIface::NormalMode)) {
+        fprintf(stderr, "error: couldn't open %s\n", BENCHMARK_CAN_IFACE);
+        return;
+    }
+
+    const uint8_t data[8] {};
+    const unsigned burst = state.range_x();
+    uint64_t frames = 0;
+
+    while (state.KeepRunning()) {
+        for (unsigned i = 0; i < burst; i++) {
+            const AP_HAL::CANFrame frame((0x100 + i) | AP_HAL::CANFrame::FlagEFF, data, sizeof(data));
+            if (tx_iface.send(frame, AP_HAL::native_micros64() + 100000, 0) != 1) {
+                fprintf(stderr, "error: tx queue full\n");
+                return;
+            }
+        }
+        tx_iface.flush_tx();
+
+        unsigned received = 0;
+        const uint64_t deadline = AP_HAL::native_micros64() + 1000000;
+        while (received < burst) {
+            AP_HAL::CANFrame frame;
+            uint64_t timestamp_us;
+            AP_HAL::CANIface::CanIOFlags flags;
+            if (rx_iface.receive(frame, timestamp_us, flags) == 1) {
+                received++;
+            } else if (AP_HAL::native_micros64() > deadline) {
+                fprintf(stderr, "error: lost %u frames\n", burst - received);
+                return;
+            }
+        }
+        frames += burst;
+    }
+
+    state.SetItemsProcessed(frames);
+}
+
+BENCHMARK(BM_CANSendReceive)->Arg(1)->Arg(16)->Arg(64)->Arg(128);
+
+#endif
+
+BENCHMARK_MAIN()
@@ -0,0 +1,282 @@
+#include <AP_gtest.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL_Linux/Storage_Journal.h>
+#include <AP_HAL_Linux/Util.h>
+
+using namespace Linux;
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  each test gets an empty storage directory. A "boot" is a new
+  Storage_Journal on the same directory, going out of scope without
+  any further writes as it would on a power loss
+ */
+class LinuxStorageJournal : public ::testing::Test {
+protected:
+    void SetUp() override {
+        strcpy(dir, "/tmp/ap_storage_XXXXXX");
+        ASSERT_NE(mkdtemp(dir), nullptr);
+        Util::from(hal.util)->set_custom_storage_directory(dir);
+    }
+
+    void TearDown() override {
+        DIR *d = opendir(dir);
+        if (d != nullptr) {
+            struct dirent *de;
+            while ((de = readdir(d)) != nullptr) {
+                if (de->d_name[0] != '.') {
+                    unlinkat(dirfd(d), de->d_name, 0);
+                }
+            }
+            closedir(d);
+        }
+        rmdir(dir);
+        Util::from(hal.util)->set_custom_storage_directory(nullptr);
+    }
+
+
+    // path of the file in the storage directory with the given suffix
+    bool file_path(const char *suffix, char *path) {
+        bool found = false;
+        DIR *d = opendir(dir);
+        if (d == nullptr) {
+            return false;
+        }
+        struct dirent *de;
+        while ((de = readdir(d)) != nullptr) {
+            const size_t len = strlen(de->d_name);
+            if (len > strlen(suffix) && strcmp(&de->d_name[len-strlen(suffix)], suffix) == 0) {
+                snprintf(path, PATH_MAX, "%s/%s", dir, de->d_name);
+                found = true;
+                break;
+            }
+        }
+        closedir(d);
+        return found;
+    }
+
+    off_t file_size(const char *suffix) {
+        char path[PATH_MAX];
+        struct stat st;
+        if (!file_path(suffix, path) || stat(path, &st) != 0) {
+            return -1;
+        }
+        return st.st_size;
+    }
+
+    void truncate_journal(off_t len) {
+        char path[PATH_MAX];
+        ASSERT_TRUE(file_path(".jnl", path));
+        ASSERT_EQ(truncate(path, len), 0);
+    }
+
+    void corrupt_journal(off_t ofs) {
+        char path[PATH_MAX];
+        ASSERT_TRUE(file_path(".jnl", path));
+        int fd = open(path, O_RDWR);
+        ASSERT_NE(fd, -1);
+        uint8_t b;
+        ASSERT_EQ(pread(fd, &b, 1, ofs), 1);
+        b ^= 0x5A;
+        ASSERT_EQ(pwrite(fd, &b, 1, ofs), 1);
+        close(fd);
+    }
+
+    // write the image of s as the checkpoint, as a checkpoint does
+    // before the journal is truncated
+    void write_checkpoint(Storage_Journal &s) {
+        uint8_t image[LINUX_STORAGE_SIZE];
+        s.read_block(image, 0, sizeof(image));
+        char path[PATH_MAX];
+        ASSERT_TRUE(file_path(".stg", path));
+        int fd = open(path, O_WRONLY);
+        ASSERT_NE(fd, -1);
+        ASSERT_EQ(write(fd, image, sizeof(image)), ssize_t(sizeof(image)));
+        close(fd);
+    }
+
+    char dir[32];
+};
+
+TEST_F(LinuxStorageJournal, replay)
+{
+    const uint32_t v1 = 0x12345678;
+    const uint32_t v2 = 0xCAFEF00D;
+    const uint8_t block[100] = { 1, 2, 3, 4, 5 };
+    uint32_t v;
+    uint8_t b[100];
+
+    {
+        Storage_Journal s;
+        s.init();
+        s.write_block(10, &v1, sizeof(v1));
+        s.write_block(LINUX_STORAGE_SIZE-sizeof(v2), &v2, sizeof(v2));
+        s._timer_tick();
+        s.write_block(4000, block, sizeof(block));
+        s._timer_tick();
+        EXPECT_GT(file_size(".jnl"), 0);
+    }
+
+    // the checkpoint has none of the changes, they come from the journal
+    {
+        Storage_Journal s;
+        s.init();
+        s.read_block(&v, 10, sizeof(v));
+        EXPECT_EQ(v, v1);
+        s.read_block(&v, LINUX_STORAGE_SIZE-sizeof(v2), sizeof(v));
+        EXPECT_EQ(v, v2);
+        s.read_block(b, 4000, sizeof(b));
+        EXPECT_EQ(memcmp(b, block, sizeof(b)), 0);
+
+        // the replayed journal has been checkpointed and emptied
+        EXPECT_EQ(file_size(".jnl"), 0);
+    }
+
+    {
+        Storage_Journal s;
+        s.init();
+        s.read_block(&v, 10, sizeof(v));
+        EXPECT_EQ(v, v1);
+    }
+}
+
+TEST_F(LinuxStorageJournal, unflushed_writes_lost)
+{
+    const uint32_t v1 = 0x11111111;
+    const uint32_t v2 = 0x22222222;
+    uint32_t v;
+
+    {
+        Storage_Journal s;
+        s.init();
+        s.write_block(100, &v1, sizeof(v1));
+        s._timer_tick();
+        s.write_block(100, &v2, sizeof(v2));
+    }
+
+    {
+        Storage_Journal s;
+        s.init();
+        s.read_block(&v, 100, sizeof(v));
+        EXPECT_EQ(v, v1);
+    }
+}
+
+TEST_F(LinuxStorageJournal, torn_tail)
+{
+    const uint32_t v1 = 0x11111111;
+    const uint32_t v2 = 0x22222222;
+    const uint32_t v3 = 0x33333333;
+    uint32_t v;
+    off_t len;
+
+    {
+        Storage_Journal s;
+        s.init();
+        s.write_block(100, &v1, sizeof(v1));
+        s._timer_tick();
+        // one batch of two records far enough apart not to be merged
+        s.write_block(100, &v2, sizeof(v2));
+        s.write_block(8000, &v3, sizeof(v3));
+        s._timer_tick();
+        len = file_size(".jnl");
+    }
+
+    // cut the commit record short, the whole second batch is dropped
+    truncate_journal(len - 2);
+    {
+        Storage_Journal s;
+        s.init();
+        s.read_block(&v, 100, sizeof(v));
+        EXPECT_EQ(v, v1);
+        s.read_block(&v, 8000, sizeof(v));
+        EXPECT_EQ(v, 0U);
+
+        // journalling carries on after the dropped batch
+        s.write_block(8000, &v3, sizeof(v3));
+        s._timer_tick();
+    }
+
+    {
+        Storage_Journal s;
+        s.init();
+        s.read_block(&v, 100, sizeof(v));
+        EXPECT_EQ(v, v1);
+        s.read_block(&v, 8000, sizeof(v));
+        EXPECT_EQ(v, v3);
+    }
+}
+
+TEST_F(LinuxStorageJournal, crc_bad_tail)
+{
+    const uint32_t v1 = 0x11111111;
+    const uint32_t v2 = 0x22222222;
+    uint32_t v;
+    off_t len;
+
+    {
+        Storage_Journal s;
+        s.init();
+        s.write_block(100, &v1, sizeof(v1));
+        s._timer_tick();
+        s.write_block(200, &v2, sizeof(v2));
+        s._timer_tick();
+        len = file_size(".jnl");
+    }
+
+    // damage the data of the last record, leaving its length intact
+    corrupt_journal(len - 1);
+    {
+        Storage_Journal s;
+        s.init();
+        s.read_block(&v, 100, sizeof(v));
+        EXPECT_EQ(v, v1);
+        s.read_block(&v, 200, sizeof(v));
+        EXPECT_EQ(v, 0U);
+    }
+}
+
+TEST_F(LinuxStorageJournal, crash_between_checkpoint_and_truncate)
+{
+    const uint32_t v1 = 0x11111111;
+    const uint32_t v2 = 0x22222222;
+    uint32_t v;
+    off_t len;
+
+    {
+        Storage_Journal s;
+        s.init();
+        s.write_block(100, &v1, sizeof(v1));
+        s._timer_tick();
+        s.write_block(100, &v2, sizeof(v2));
+        s.write_block(300, &v1, sizeof(v1));
+        s._timer_tick();
+        len = file_size(".jnl");
+
+        // the checkpoint reached the flat file but the journal was not
+        // truncated, so the next boot replays changes it already holds
+        write_checkpoint(s);
+    }
+    EXPECT_EQ(file_size(".jnl"), len);
+
+    {
+        Storage_Journal s;
+        s.init();
+        s.read_block(&v, 100, sizeof(v));
+        EXPECT_EQ(v, v2);
+        s.read_block(&v, 300, sizeof(v));
+        EXPECT_EQ(v, v1);
+        EXPECT_EQ(file_size(".jnl"), 0);
+    }
+}
+
+AP_GTEST_MAIN()
@@ -16,7 +16,9 @@
  */
 #include <AP_gtest.h>
 
+#include <fcntl.h>
 #include <pthread.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 
 #include <AP_HAL/AP_HAL.h>
@@ -91,6 +93,49 @@ TEST(LinuxThread, poller_thread)
     EXPECT_TRUE(thr.join());
 }
 
+class TestPipePollable : public Pollable {
+public:
+    TestPipePollable(int fd) : Pollable(fd) { }
+
+    int n_read = 0;
+
+    void on_can_read() override {
+        uint8_t b;
+        while (read(_fd, &b, 1) == 1) {
+            n_read++;
+        }
+    }
+};
+
+TEST(LinuxThread, poller_thread_pollable)
+{
+    int fds[2];
+    ASSERT_EQ(pipe2(fds, O_NONBLOCK), 0);
+
+    PollerThread thr;
+    TestPipePollable p(fds[0]);
+    EXPECT_TRUE(thr.register_pollable(&p, EPOLLIN));
+    EXPECT_TRUE(thr.start(nullptr, 0, 0));
+
+    const uint8_t buf[3] {};
+    EXPECT_EQ(write(fds[1], buf, sizeof(buf)), 3);
+    for (uint8_t i = 0; i < 100 && p.n_read < 3; i++) {
+        usleep(1000);
+    }
+    EXPECT_EQ(p.n_read, 3);
+
+    // no more events once input is disabled
+    EXPECT_TRUE(thr.modify_pollable(&p, 0));
+    EXPECT_EQ(write(fds[1], buf, 1), 1);
+    usleep(10000);
+    EXPECT_EQ(p.n_read, 3);
+
+    EXPECT_TRUE(thr.stop());
+    EXPECT_TRUE(thr.join());
+    thr.unregister_pollable(&p);
+    close(fds[1]);
+}
+
 class TestPeriodicThread1 : public PeriodicThread {
 public:
     TestPeriodicThread1() : PeriodicThread{FUNCTOR_BIND_MEMBER(&TestPeriodicThread1::_task, void)} { }
@@ -0,0 +1,81 @@
+#include <AP_gtest.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL_Linux/Scheduler.h>
+#include <AP_HAL_Linux/ThreadConfig.h>
+
+using namespace Linux;
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+TEST(LinuxThreadConfig, parse_cpulist)
+{
+    cpu_set_t cpus;
+    char buf[32];
+
+    EXPECT_TRUE(ThreadConfig::parse_cpulist("0-1,3", cpus));
+    EXPECT_EQ(CPU_COUNT(&cpus), 3);
+    EXPECT_TRUE(CPU_ISSET(0, &cpus));
+    EXPECT_TRUE(CPU_ISSET(1, &cpus));
+    EXPECT_FALSE(CPU_ISSET(2, &cpus));
+    EXPECT_TRUE(CPU_ISSET(3, &cpus));
+
+    ThreadConfig::format_cpulist(cpus, buf, sizeof(buf));
+    EXPECT_STREQ(buf, "0-1,3");
+
+    EXPECT_FALSE(ThreadConfig::parse_cpulist("", cpus));
+    EXPECT_FALSE(ThreadConfig::parse_cpulist("2-1", cpus));
+    EXPECT_FALSE(ThreadConfig::parse_cpulist("1;2", cpus));
+    EXPECT_FALSE(ThreadConfig::parse_cpulist("x", cpus));
+}
+
+TEST(LinuxThreadConfig, match)
+{
+    ThreadConfig config;
+    cpu_set_t cpus;
+    int prio;
+
+    EXPECT_TRUE(config.add_affinity("ap-timer=3"));
+    EXPECT_TRUE(config.add_affinity("SPI*=2-3"));
+    EXPECT_TRUE(config.add_priority("SPI*=14"));
+    EXPECT_FALSE(config.add_affinity("noequals"));
+    EXPECT_FALSE(config.add_priority("main=1000"));
+
+    prio = 15;
+    EXPECT_TRUE(config.configure("ap-timer", SCHED_FIFO, prio, cpus));
+    EXPECT_EQ(prio, 15);
+    EXPECT_EQ(CPU_COUNT(&cpus), 1);
+    EXPECT_TRUE(CPU_ISSET(3, &cpus));
+
+    prio = 12;
+    EXPECT_TRUE(config.configure("SPI1", SCHED_FIFO, prio, cpus));
+    EXPECT_EQ(prio, 14);
+    EXPECT_EQ(CPU_COUNT(&cpus), 2);
+
+    prio = 10;
+    EXPECT_FALSE(config.configure("ap-io", SCHED_FIFO, prio, cpus));
+    EXPECT_EQ(prio, 10);
+}
+
+TEST(LinuxThreadConfig, isolate)
+{
+    ThreadConfig config;
+    cpu_set_t cpus;
+    int prio;
+
+    EXPECT_TRUE(config.set_isolated_cpus("0"));
+
+    // realtime threads go to the isolated CPUs
+    prio = AP_LINUX_SENSORS_SCHED_PRIO;
+    EXPECT_TRUE(config.configure("SPI1", SCHED_FIFO, prio, cpus));
+    EXPECT_EQ(CPU_COUNT(&cpus), 1);
+    EXPECT_TRUE(CPU_ISSET(0, &cpus));
+
+    // everything else is kept off them
+    prio = 1;
+    if (config.configure("scripting", SCHED_FIFO, prio, cpus)) {
+        EXPECT_FALSE(CPU_ISSET(0, &cpus));
+    }
+}
+
+AP_GTEST_MAIN()
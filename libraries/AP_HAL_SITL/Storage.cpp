@@ -131,6 +131,7 @@ void Storage::write_block(uint16_t loc, const void *src, size_t n)
         _storage_open();
         memcpy(&_buffer[loc], src, n);
         _mark_dirty(loc, n);
+        note_write(n);
     }
 }
 
@@ -141,11 +142,23 @@ void Storage::_timer_tick(void)
     }
     if (_dirty_mask.empty()) {
         _last_empty_ms = AP_HAL::millis();
+#if STORAGE_USE_FLASH
+        // compact while idle, so that a burst of writes doesn't find
+        // the sector full and wait for an erase
+        if (_flash.compaction_wanted() && _flash_erase_ok()) {
+            if (_flash.compact()) {
+                stats.compactions++;
+            }
+        }
+#endif
+        return;
+    }
+    if (flush_held()) {
         return;
     }
 
-    // write out the first dirty line. We don't write more
-    // than one to keep the latency of this call to a minimum
+    // write out the first run of dirty lines. We limit the run to
+    // STORAGE_MAX_WRITE to keep the latency of this call down
     uint16_t i;
     for (i=0; i<STORAGE_NUM_LINES; i++) {
         if (_dirty_mask.get(i)) {
@@ -156,24 +169,34 @@ void Storage::_timer_tick(void)
         // this shouldn't be possible
         return;
     }
+    uint16_t n = 1;
+    while (i+n < STORAGE_NUM_LINES &&
+           n < STORAGE_MAX_WRITE/STORAGE_LINE_SIZE &&
+           _dirty_mask.get(i+n)) {
+        n++;
+    }
+    const uint32_t start_us = AP_HAL::micros();
 
 #if STORAGE_USE_POSIX
     if (using_filesystem && log_fd != -1) {
         const off_t offset = STORAGE_LINE_SIZE*i;
-        if (lseek(log_fd, offset, SEEK_SET) != offset) {
+        const ssize_t nbytes = STORAGE_LINE_SIZE*n;
+        if (pwrite(log_fd, &_buffer[offset], nbytes, offset) != nbytes) {
             return;
         }
-        if (write(log_fd, &_buffer[offset], STORAGE_LINE_SIZE) != STORAGE_LINE_SIZE) {
-            return;
+        for (uint16_t j=0; j<n; j++) {
+            _dirty_mask.clear(i+j);
         }
-        _dirty_mask.clear(i);
+        note_flush(nbytes, AP_HAL::micros() - start_us);
         return;
     } 
 #endif
     
 #if STORAGE_USE_FLASH
     // save to storage backend
-    _flash_write(i);
+    if (_flash_write(i, n)) {
+        note_flush(0, AP_HAL::micros() - start_us);
+    }
 #endif
 }
 
@@ -192,16 +215,20 @@ void Storage::_flash_load(void)
 }
 
 /*
-  write one storage line. This also updates _dirty_mask. 
+  write a run of storage lines. This also updates _dirty_mask.
 */
-void Storage::_flash_write(uint16_t line)
+bool Storage::_flash_write(uint16_t line, uint16_t nlines)
 {
 #if STORAGE_USE_FLASH
-    if (_flash.write(line*STORAGE_LINE_SIZE, STORAGE_LINE_SIZE)) {
-        // mark the line clean
-        _dirty_mask.clear(line);
+    if (_flash.write(line*STORAGE_LINE_SIZE, nlines*STORAGE_LINE_SIZE)) {
+        // mark the lines clean
+        for (uint16_t j=0; j<nlines; j++) {
+            _dirty_mask.clear(line+j);
+        }
+        return true;
     }
 #endif
+    return false;
 }
 
 
@@ -299,6 +326,10 @@ bool Storage::_flash_write_data(uint8_t sector, uint32_t offset, const uint8_t *
 {
     size_t base_address = sitl_flash_getpageaddr(sector);
     bool ret = sitl_flash_write(base_address+offset, data, length);
+    if (ret) {
+        // includes the block headers, for write amplification
+        stats.bytes_written += length;
+    }
     if (!ret && _flash_erase_ok()) {
         // we are getting flash write errors while disarmed. Try
         // re-writing all of flash
@@ -327,6 +358,7 @@ bool Storage::_flash_read_data(uint8_t sector, uint32_t offset, uint8_t *data, u
  */
 bool Storage::_flash_erase_sector(uint8_t sector)
 {
+    stats.erases++;
     return sitl_flash_erasepage(sector);
 }
 
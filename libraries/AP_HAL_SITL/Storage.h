@@ -18,6 +18,9 @@
 #define STORAGE_LINE_SIZE (1<<STORAGE_LINE_SHIFT)
 #define STORAGE_NUM_LINES (HAL_STORAGE_SIZE/STORAGE_LINE_SIZE)
 
+// largest run of dirty lines written by one _timer_tick() call
+#define STORAGE_MAX_WRITE 512
+
 class HALSITL::Storage : public AP_HAL::Storage {
 public:
     void init() override {}
@@ -57,7 +60,7 @@ private:
 #endif
     
     void _flash_load(void);
-    void _flash_write(uint16_t line);
+    bool _flash_write(uint16_t line, uint16_t nlines);
 
 #if STORAGE_USE_POSIX
     bool using_filesystem;
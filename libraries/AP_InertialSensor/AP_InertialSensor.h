@@ -52,6 +52,7 @@ class AP_AHRS;
   because of mutual dependencies
  */
 class AP_Logger;
+struct log_ISBS;
 
 /* AP_InertialSensor is an abstraction for gyro and accel measurements
  * which are correctly aligned to the body axes and scaled to SI units.
@@ -381,6 +382,9 @@ public:
         AP_Int16 samples_per_msg;
         AP_Int8 push_interval_ms;
 
+        // number of 32 sample blocks buffered per sensor when streaming
+        AP_Int8 stream_queue_len;
+
         // end Parameters
 
     private:
@@ -388,6 +392,8 @@ public:
         enum batch_opt_t {
             BATCH_OPT_SENSOR_RATE = (1<<0),
             BATCH_OPT_POST_FILTER = (1<<1),
+            BATCH_OPT_STREAM_GYRO = (1<<2),
+            BATCH_OPT_STREAM_ACCEL = (1<<3),
         };
 
         void rotate_to_next_sensor();
@@ -395,6 +401,37 @@ public:
 
         bool should_log(uint8_t instance, IMU_SENSOR_TYPE type);
         void push_data_to_log();
+        float sample_rate_hz(uint8_t instance, IMU_SENSOR_TYPE type) const;
+
+        /*
+          continuous streaming of every sample from a sensor. The
+          sensor thread fills a block of 32 samples, encodes it into
+          an ISBS packet and queues it. The main thread drains the
+          queues into the logger as fast as the logger will accept
+          them. Samples which do not fit in the queue are counted as
+          dropped, those of a partly filled block thrown away when
+          logging stops as discarded
+         */
+        struct stream_t {
+            ObjectBuffer<struct log_ISBS> *queue;
+            Vector3f samples[32];
+            uint64_t first_sample_us;
+            uint8_t count;
+            uint16_t seqnum;
+            // updated by the sensor thread:
+            uint32_t samples_dropped;
+            uint32_t samples_discarded;
+            // updated by the main thread:
+            uint32_t samples_logged;
+        };
+        stream_t *streams[INS_MAX_INSTANCES][2];
+        uint32_t last_stream_stats_ms;
+
+        void init_streams();
+        void stream_sample(stream_t &stream, uint8_t instance, IMU_SENSOR_TYPE type, uint64_t sample_us, const Vector3f &sample);
+        bool encode_stream_block(const stream_t &stream, uint8_t instance, IMU_SENSOR_TYPE type, struct log_ISBS &pkt) const;
+        void push_streams_to_log();
+        void write_stream_stats();
 
         uint64_t measurement_started_us;
 
@@ -402,6 +439,7 @@ public:
         bool isbh_sent : 1;
         bool _doing_sensor_rate_logging : 1;
         bool _doing_post_filter_logging : 1;
+        bool streaming : 1; // latched at init, streams replace batches
         uint8_t instance : 3; // instance we are sending data for
         AP_InertialSensor::IMU_SENSOR_TYPE type : 1;
         uint16_t isb_seqnum;
@@ -10,6 +10,8 @@
 
 #define SENSOR_RATE_DEBUG 0
 
+static_assert(INS_SAMPLE_BLOCK_MAX <= 32, "fsync_mask must have a bit per block sample");
+
 const extern AP_HAL::HAL& hal;
 
 AP_InertialSensor_Backend::AP_InertialSensor_Backend(AP_InertialSensor &imu) :
@@ -54,14 +56,14 @@ void AP_InertialSensor_Backend::_set_gyro_oversampling(uint8_t instance, uint8_t
   sensor may vary slightly from the system clock. This slowly adjusts
   the rate to the observed rate
 */
-void AP_InertialSensor_Backend::_update_sensor_rate(uint16_t &count, uint32_t &start_us, float &rate_hz) const
+void AP_InertialSensor_Backend::_update_sensor_rate(uint16_t &count, uint32_t &start_us, float &rate_hz, uint8_t nsamples) const
 {
     uint32_t now = AP_HAL::micros();
     if (start_us == 0) {
         count = 0;
         start_us = now;
     } else {
-        count++;
+        count += nsamples;
         if (now - start_us > 1000000UL) {
             float observed_rate_hz = count * 1.0e6f / (now - start_us);
 #if 0
@@ -127,6 +129,23 @@ void AP_InertialSensor_Backend::_rotate_and_correct_gyro(uint8_t instance, Vecto
     }
 }
 
+/*
+  rotate and correct a block of samples in place. The sensor rotation,
+  calibration and board rotation have been combined by the caller into
+  a single matrix and offset
+ */
+void AP_InertialSensor_Backend::rotate_and_correct_block(sample_block &block, const Matrix3f &rot, const Vector3f &offset) const
+{
+    for (uint8_t i = 0; i < block.n; i++) {
+        const float x = block.x[i];
+        const float y = block.y[i];
+        const float z = block.z[i];
+        block.x[i] = rot.a.x*x + rot.a.y*y + rot.a.z*z - offset.x;
+        block.y[i] = rot.b.x*x + rot.b.y*y + rot.b.z*z - offset.y;
+        block.z[i] = rot.c.x*x + rot.c.y*y + rot.c.z*z - offset.z;
+    }
+}
+
 /*
   rotate gyro vector and add the gyro offset
  */
@@ -269,6 +288,161 @@ void AP_InertialSensor_Backend::_notify_new_gyro_raw_sample(uint8_t instance,
     }
 }
 
+/*
+  process a block of gyro samples from a FIFO. This is equivalent to
+  calling _rotate_and_correct_gyro() and _notify_new_gyro_raw_sample()
+  for each sample, but the rotation and calibration are combined into
+  one transform and the semaphore is only taken once
+ */
+void AP_InertialSensor_Backend::_notify_new_gyro_raw_block(uint8_t instance, sample_block &block)
+{
+    if (block.n == 0 || ((1U<<instance) & _imu.imu_kill_mask)) {
+        return;
+    }
+
+    _update_sensor_rate(_imu._sample_gyro_count[instance], _imu._sample_gyro_start_us[instance],
+                        _imu._gyro_raw_sample_rates[instance], block.n);
+
+    // don't accept below 40Hz
+    if (_imu._gyro_raw_sample_rates[instance] < 40) {
+        return;
+    }
+
+    // FIFO samples are evenly spaced at the observed sensor rate
+    const float dt = 1.0f / _imu._gyro_raw_sample_rates[instance];
+    const uint64_t last_sample_us = _imu._gyro_last_sample_us[instance];
+    const uint64_t now = AP_HAL::micros64();
+    _imu._gyro_last_sample_us[instance] = now;
+
+    // combine the sensor rotation, offsets and board rotation
+    Matrix3f rot;
+    rot.from_rotation(_imu._gyro_orientation[instance]);
+    Matrix3f board_rot;
+    if (_imu._board_orientation == ROTATION_CUSTOM && _imu._custom_rotation) {
+        board_rot = *_imu._custom_rotation;
+    } else {
+        board_rot.from_rotation(_imu._board_orientation);
+    }
+    rotate_and_correct_block(block, board_rot * rot, board_rot * _imu._gyro_offset[instance].get());
+
+#if AP_MODULE_SUPPORTED
+    // call gyro_sample hook if any
+    for (uint8_t i = 0; i < block.n; i++) {
+        AP_Module::call_hook_gyro_sample(instance, dt, block.get(i));
+    }
+#endif
+
+    // push gyros if optical flow present
+    if (hal.opticalflow) {
+        for (uint8_t i = 0; i < block.n; i++) {
+            hal.opticalflow->push_gyro(block.x[i], block.y[i], dt);
+        }
+    }
+
+    const bool post_filter_logging = _imu.batchsampler.doing_post_filter_logging();
+
+    {
+        WITH_SEMAPHORE(_sem);
+
+        Vector3f delta_angle_acc = _imu._delta_angle_acc[instance];
+        float delta_angle_acc_dt = _imu._delta_angle_acc_dt[instance];
+        Vector3f last_delta_angle = _imu._last_delta_angle[instance];
+        Vector3f last_raw_gyro = _imu._last_raw_gyro[instance];
+        float sample_dt = dt;
+
+        if (AP_HAL::micros64() - last_sample_us > 100000U) {
+            // zero accumulator if sensor was unhealthy for 0.1s
+            delta_angle_acc.zero();
+            delta_angle_acc_dt = 0;
+            sample_dt = 0;
+        }
+
+        for (uint8_t i = 0; i < block.n; i++) {
+            const Vector3f gyro = block.get(i);
+
+            // compute delta angle and coning correction, see
+            // _notify_new_gyro_raw_sample()
+            const Vector3f delta_angle = (gyro + last_raw_gyro) * 0.5f * sample_dt;
+            Vector3f delta_coning = (delta_angle_acc + last_delta_angle * (1.0f / 6.0f));
+            delta_coning = delta_coning % delta_angle;
+            delta_coning *= 0.5f;
+
+            delta_angle_acc += delta_angle + delta_coning;
+            delta_angle_acc_dt += sample_dt;
+
+            last_delta_angle = delta_angle;
+            last_raw_gyro = gyro;
+            sample_dt = dt;
+        }
+
+        _imu._delta_angle_acc[instance] = delta_angle_acc;
+        _imu._delta_angle_acc_dt[instance] = delta_angle_acc_dt;
+        _imu._last_delta_angle[instance] = last_delta_angle;
+        _imu._last_raw_gyro[instance] = last_raw_gyro;
+
+#if HAL_WITH_DSP
+        // capture gyro window for FFT analysis
+        if (_imu._gyro_window_size > 0) {
+            const float mult = _imu._gyro_raw_sampling_multiplier[instance];
+            const float *axis[XYZ_AXIS_COUNT] { block.x, block.y, block.z };
+            for (uint8_t a = 0; a < XYZ_AXIS_COUNT; a++) {
+                FloatBuffer &window = _imu._gyro_window[instance][a];
+                const uint8_t n = MIN(uint32_t(block.n), window.space());
+                float scaled[INS_SAMPLE_BLOCK_MAX];
+                for (uint8_t i = 0; i < n; i++) {
+                    scaled[i] = axis[a][i] * mult;
+                }
+                window.push(scaled, n);
+            }
+        }
+#endif
+
+        const bool notch_enabled = _gyro_notch_enabled();
+        const bool harmonic_notch_enabled = gyro_harmonic_notch_enabled();
+
+        for (uint8_t i = 0; i < block.n; i++) {
+            Vector3f gyro_filtered = block.get(i);
+
+            // apply the notch filter
+            if (notch_enabled) {
+                gyro_filtered = _imu._gyro_notch_filter[instance].apply(gyro_filtered);
+            }
+
+            // apply the harmonic notch filter
+            if (harmonic_notch_enabled) {
+                gyro_filtered = _imu._gyro_harmonic_notch_filter[instance].apply(gyro_filtered);
+            }
+
+            // apply the low pass filter last to attentuate any notch induced noise
+            gyro_filtered = _imu._gyro_filter[instance].apply(gyro_filtered);
+
+            // if the filtering failed in any way then reset the filters and keep the old value
+            if (gyro_filtered.is_nan() || gyro_filtered.is_inf()) {
+                _imu._gyro_filter[instance].reset();
+                _imu._gyro_notch_filter[instance].reset();
+                _imu._gyro_harmonic_notch_filter[instance].reset();
+            } else {
+                _imu._gyro_filtered[instance] = gyro_filtered;
+            }
+
+            if (post_filter_logging) {
+                const Vector3f &logged = _imu._gyro_filtered[instance];
+                block.x[i] = logged.x;
+                block.y[i] = logged.y;
+                block.z[i] = logged.z;
+            }
+        }
+
+        _imu._new_gyro_data[instance] = true;
+    }
+
+    // the last sample in the block was taken now, the others are spaced back from it
+    const uint32_t dt_us = uint32_t(dt * 1.0e6f);
+    for (uint8_t i = 0; i < block.n; i++) {
+        log_gyro_raw(instance, now - uint64_t(block.n - 1 - i) * dt_us, block.get(i));
+    }
+}
+
 void AP_InertialSensor_Backend::log_gyro_raw(uint8_t instance, const uint64_t sample_us, const Vector3f &gyro)
 {
     AP_Logger *logger = AP_Logger::get_singleton();
@@ -408,6 +582,116 @@ void AP_InertialSensor_Backend::_notify_new_accel_raw_sample(uint8_t instance,
     }
 }
 
+/*
+  process a block of accel samples from a FIFO. This is equivalent to
+  calling _rotate_and_correct_accel() and _notify_new_accel_raw_sample()
+  for each sample, but the rotation and calibration are combined into
+  one transform and the semaphore is only taken once
+ */
+void AP_InertialSensor_Backend::_notify_new_accel_raw_block(uint8_t instance, sample_block &block)
+{
+    if (block.n == 0 || ((1U<<instance) & _imu.imu_kill_mask)) {
+        return;
+    }
+
+    _update_sensor_rate(_imu._sample_accel_count[instance], _imu._sample_accel_start_us[instance],
+                        _imu._accel_raw_sample_rates[instance], block.n);
+
+    // don't accept below 40Hz
+    if (_imu._accel_raw_sample_rates[instance] < 40) {
+        return;
+    }
+
+    // FIFO samples are evenly spaced at the observed sensor rate
+    const float dt = 1.0f / _imu._accel_raw_sample_rates[instance];
+    const uint64_t last_sample_us = _imu._accel_last_sample_us[instance];
+    const uint64_t now = AP_HAL::micros64();
+    _imu._accel_last_sample_us[instance] = now;
+
+    /*
+      combine the sensor rotation, scaling, offsets and board
+      rotation. Accel calibration is done in the sensor frame after
+      the sensor rotation, see _rotate_and_correct_accel()
+     */
+    Matrix3f rot;
+    rot.from_rotation(_imu._accel_orientation[instance]);
+    const Vector3f &accel_scale = _imu._accel_scale[instance].get();
+    rot.a *= accel_scale.x;
+    rot.b *= accel_scale.y;
+    rot.c *= accel_scale.z;
+    const Vector3f &accel_offset = _imu._accel_offset[instance].get();
+    const Vector3f scaled_offset(accel_offset.x * accel_scale.x,
+                                 accel_offset.y * accel_scale.y,
+                                 accel_offset.z * accel_scale.z);
+    Matrix3f board_rot;
+    if (_imu._board_orientation == ROTATION_CUSTOM && _imu._custom_rotation) {
+        board_rot = *_imu._custom_rotation;
+    } else {
+        board_rot.from_rotation(_imu._board_orientation);
+    }
+    rotate_and_correct_block(block, board_rot * rot, board_rot * scaled_offset);
+
+    for (uint8_t i = 0; i < block.n; i++) {
+        const Vector3f accel = block.get(i);
+#if AP_MODULE_SUPPORTED
+        // call accel_sample hook if any
+        AP_Module::call_hook_accel_sample(instance, dt, accel, (block.fsync_mask & (1U<<i)) != 0);
+#endif
+        _imu.calc_vibration_and_clipping(instance, accel, dt);
+    }
+
+    const bool post_filter_logging = _imu.batchsampler.doing_post_filter_logging();
+
+    {
+        WITH_SEMAPHORE(_sem);
+
+        Vector3f delta_velocity_acc = _imu._delta_velocity_acc[instance];
+        float delta_velocity_acc_dt = _imu._delta_velocity_acc_dt[instance];
+        float sample_dt = dt;
+
+        if (AP_HAL::micros64() - last_sample_us > 100000U) {
+            // zero accumulator if sensor was unhealthy for 0.1s
+            delta_velocity_acc.zero();
+            delta_velocity_acc_dt = 0;
+            sample_dt = 0;
+        }
+
+        for (uint8_t i = 0; i < block.n; i++) {
+            const Vector3f accel = block.get(i);
+
+            // delta velocity
+            delta_velocity_acc += accel * sample_dt;
+            delta_velocity_acc_dt += sample_dt;
+            sample_dt = dt;
+
+            _imu._accel_filtered[instance] = _imu._accel_filter[instance].apply(accel);
+            if (_imu._accel_filtered[instance].is_nan() || _imu._accel_filtered[instance].is_inf()) {
+                _imu._accel_filter[instance].reset();
+            }
+
+            _imu.set_accel_peak_hold(instance, _imu._accel_filtered[instance]);
+
+            if (post_filter_logging) {
+                const Vector3f &logged = _imu._accel_filtered[instance];
+                block.x[i] = logged.x;
+                block.y[i] = logged.y;
+                block.z[i] = logged.z;
+            }
+        }
+
+        _imu._delta_velocity_acc[instance] = delta_velocity_acc;
+        _imu._delta_velocity_acc_dt[instance] = delta_velocity_acc_dt;
+
+        _imu._new_accel_data[instance] = true;
+    }
+
+    // the last sample in the block was taken now, the others are spaced back from it
+    const uint32_t dt_us = uint32_t(dt * 1.0e6f);
+    for (uint8_t i = 0; i < block.n; i++) {
+        log_accel_raw(instance, now - uint64_t(block.n - 1 - i) * dt_us, block.get(i));
+    }
+}
+
 void AP_InertialSensor_Backend::_notify_new_accel_sensor_rate_sample(uint8_t instance, const Vector3f &accel)
 {
     if (!_imu.batchsampler.doing_sensor_rate_logging()) {
@@ -29,6 +29,11 @@
 
 #include "AP_InertialSensor.h"
 
+// maximum number of samples passed to the frontend in one block
+#ifndef INS_SAMPLE_BLOCK_MAX
+#define INS_SAMPLE_BLOCK_MAX 8
+#endif
+
 class AuxiliaryBus;
 class AP_Logger;
 
@@ -144,6 +149,50 @@ protected:
     // sensors, and should be set to zero for FIFO based sensors
     void _notify_new_gyro_raw_sample(uint8_t instance, const Vector3f &accel, uint64_t sample_us=0);
 
+    /*
+      a burst of samples read from a sensor FIFO. The samples are
+      scaled to SI units but are still in the sensor frame. They are
+      held as separate x, y and z arrays so that each processing
+      stage can run over contiguous data
+     */
+    struct sample_block {
+        uint8_t n;
+        uint32_t fsync_mask;    // accel only, bit i set if sample i had FSYNC set
+        float x[INS_SAMPLE_BLOCK_MAX];
+        float y[INS_SAMPLE_BLOCK_MAX];
+        float z[INS_SAMPLE_BLOCK_MAX];
+
+        void reset(void) {
+            n = 0;
+            fsync_mask = 0;
+        }
+        bool full(void) const {
+            return n >= INS_SAMPLE_BLOCK_MAX;
+        }
+        void push(const Vector3f &v, bool fsync_set=false) {
+            if (fsync_set) {
+                fsync_mask |= (1U<<n);
+            }
+            x[n] = v.x;
+            y[n] = v.y;
+            z[n] = v.z;
+            n++;
+        }
+        Vector3f get(uint8_t i) const {
+            return Vector3f(x[i], y[i], z[i]);
+        }
+    };
+
+    // this can be called instead of _rotate_and_correct_gyro() and
+    // _notify_new_gyro_raw_sample() for a burst of samples from a
+    // FIFO based sensor. The whole block is rotated, corrected and
+    // filtered with the backend semaphore taken once. On return the
+    // block holds the samples as they were logged
+    void _notify_new_gyro_raw_block(uint8_t instance, sample_block &block);
+
+    // as _notify_new_gyro_raw_block() but for accels
+    void _notify_new_accel_raw_block(uint8_t instance, sample_block &block);
+
     // rotate accel vector, scale, offset and publish
     void _publish_accel(uint8_t instance, const Vector3f &accel);
 
@@ -188,7 +237,7 @@ protected:
     }
 
     // update the sensor rate for FIFO sensors
-    void _update_sensor_rate(uint16_t &count, uint32_t &start_us, float &rate_hz) const;
+    void _update_sensor_rate(uint16_t &count, uint32_t &start_us, float &rate_hz, uint8_t nsamples=1) const;
 
     // return true if the sensors are still converging and sampling rates could change significantly
     bool sensors_converging() const { return AP_HAL::millis() < 30000; }
@@ -336,4 +385,7 @@ private:
     void log_accel_raw(uint8_t instance, const uint64_t sample_us, const Vector3f &accel);
     void log_gyro_raw(uint8_t instance, const uint64_t sample_us, const Vector3f &gryo);
 
+    // rotate and correct a block of samples in place
+    void rotate_and_correct_block(sample_block &block, const Matrix3f &rot, const Vector3f &offset) const;
+
 };
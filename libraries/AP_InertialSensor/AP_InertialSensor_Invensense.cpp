@@ -57,6 +57,9 @@ extern const AP_HAL::HAL& hal;
 #define MPU_SAMPLE_SIZE 14
 #define MPU_FIFO_BUFFER_LEN 8
 
+// each FIFO read is passed to the frontend as a single block
+static_assert(MPU_FIFO_BUFFER_LEN <= INS_SAMPLE_BLOCK_MAX, "FIFO read must fit in a sample block");
+
 #define int16_val(v, idx) ((int16_t)(((uint16_t)v[2*idx] << 8) | v[2*idx+1]))
 #define uint16_val(v, idx)(((uint16_t)v[2*idx] << 8) | v[2*idx+1])
 
@@ -428,6 +431,11 @@ void AP_InertialSensor_Invensense::_poll_data()
 
 bool AP_InertialSensor_Invensense::_accumulate(uint8_t *samples, uint8_t n_samples)
 {
+    sample_block accel_block;
+    sample_block gyro_block;
+    accel_block.reset();
+    gyro_block.reset();
+
     for (uint8_t i = 0; i < n_samples; i++) {
         const uint8_t *data = samples + MPU_SAMPLE_SIZE * i;
         Vector3f accel, gyro;
@@ -447,6 +455,9 @@ bool AP_InertialSensor_Invensense::_accumulate(uint8_t *samples, uint8_t n_sampl
             if (!hal.scheduler->in_expected_delay()) {
                 debug("temp reset IMU[%u] %d %d", _accel_instance, _raw_temp, t2);
             }
+            // samples before the corrupt one are still good
+            _notify_new_accel_raw_block(_accel_instance, accel_block);
+            _notify_new_gyro_raw_block(_gyro_instance, gyro_block);
             _fifo_reset(true);
             return false;
         }
@@ -457,14 +468,15 @@ bool AP_InertialSensor_Invensense::_accumulate(uint8_t *samples, uint8_t n_sampl
                         -int16_val(data, 6));
         gyro *= _gyro_scale;
 
-        _rotate_and_correct_accel(_accel_instance, accel);
-        _rotate_and_correct_gyro(_gyro_instance, gyro);
-
-        _notify_new_accel_raw_sample(_accel_instance, accel, 0, fsync_set);
-        _notify_new_gyro_raw_sample(_gyro_instance, gyro);
+        accel_block.push(accel, fsync_set);
+        gyro_block.push(gyro);
 
         _temp_filtered = _temp_filter.apply(temp);
     }
+
+    _notify_new_accel_raw_block(_accel_instance, accel_block);
+    _notify_new_gyro_raw_block(_gyro_instance, gyro_block);
+
     return true;
 }
 
@@ -482,6 +494,10 @@ bool AP_InertialSensor_Invensense::_accumulate_sensor_rate_sampling(uint8_t *sam
     const int32_t unscaled_clip_limit = _clip_limit / _accel_scale;
     bool clipped = false;
     bool ret = true;
+    sample_block accel_block;
+    sample_block gyro_block;
+    accel_block.reset();
+    gyro_block.reset();
     
     for (uint8_t i = 0; i < n_samples; i++) {
         const uint8_t *data = samples + MPU_SAMPLE_SIZE * i;
@@ -492,6 +508,11 @@ bool AP_InertialSensor_Invensense::_accumulate_sensor_rate_sampling(uint8_t *sam
             if (!hal.scheduler->in_expected_delay()) {
                 debug("temp reset IMU[%u] %d %d", _accel_instance, _raw_temp, t2);
             }
+            // samples before the corrupt one are still good
+            _notify_new_accel_raw_block(_accel_instance, accel_block);
+            _notify_new_gyro_raw_block(_gyro_instance, gyro_block);
+            accel_block.reset();
+            gyro_block.reset();
             _fifo_reset(true);
             ret = false;
             break;
@@ -517,8 +538,7 @@ bool AP_InertialSensor_Invensense::_accumulate_sensor_rate_sampling(uint8_t *sam
 
             if (_accum.accel_count % _accel_fifo_downsample_rate == 0) {
                 _accum.accel *= _fifo_accel_scale;
-                _rotate_and_correct_accel(_accel_instance, _accum.accel);
-                _notify_new_accel_raw_sample(_accel_instance, _accum.accel, 0, false);
+                accel_block.push(_accum.accel);
                 _accum.accel.zero();
                 _accum.accel_count = 0;
                 // we assume that the gyro rate is always >= and a multiple of the accel rate
@@ -539,12 +559,14 @@ bool AP_InertialSensor_Invensense::_accumulate_sensor_rate_sampling(uint8_t *sam
 
         if (_accum.gyro_count % _gyro_fifo_downsample_rate == 0) {
             _accum.gyro *= _fifo_gyro_scale;
-            _rotate_and_correct_gyro(_gyro_instance, _accum.gyro);
-            _notify_new_gyro_raw_sample(_gyro_instance, _accum.gyro);
+            gyro_block.push(_accum.gyro);
             _accum.gyro.zero();
         }
     }
 
+    _notify_new_accel_raw_block(_accel_instance, accel_block);
+    _notify_new_gyro_raw_block(_gyro_instance, gyro_block);
+
     if (clipped) {
         increment_clip_count(_accel_instance);
     }
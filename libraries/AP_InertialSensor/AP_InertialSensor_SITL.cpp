@@ -2,6 +2,7 @@
 #include "AP_InertialSensor_SITL.h"
 #include <SITL/SITL.h>
 #include <stdio.h>
+#include <time.h>
 
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
 
@@ -156,12 +157,12 @@ void AP_InertialSensor_SITL::generate_accel()
 }
 
 /*
-  generate a gyro sample
+  generate a gyro sample at sample_hz, averaged over nsamples sensor
+  rate samples
  */
-void AP_InertialSensor_SITL::generate_gyro()
+Vector3f AP_InertialSensor_SITL::generate_gyro(uint8_t nsamples, uint16_t sample_hz)
 {
     Vector3f gyro_accum;
-    uint8_t nsamples = enable_fast_sampling(gyro_instance) ? 8 : 1;
 
     for (uint8_t j = 0; j < nsamples; j++) {
         float p = radians(sitl->state.rollRate) + gyro_drift();
@@ -200,14 +201,14 @@ void AP_InertialSensor_SITL::generate_gyro()
             p += sinf(gyro_time * 2 * M_PI * vibe_freq.x) * calculate_noise(gyro_noise, noise_variation);
             q += sinf(gyro_time * 2 * M_PI * vibe_freq.y) * calculate_noise(gyro_noise, noise_variation);
             r += sinf(gyro_time * 2 * M_PI * vibe_freq.z) * calculate_noise(gyro_noise, noise_variation);
-            gyro_time += 1.0f / (gyro_sample_hz * nsamples);
+            gyro_time += 1.0f / (sample_hz * nsamples);
         }
 
         // VIB_MOT_MAX is a rpm-scaled vibration applied to each axis
         if (!is_zero(sitl->vibe_motor) && motors_on) {
             for (uint8_t i = 0; i < sitl->state.num_motors; i++) {
                 float motor_freq = calculate_noise(sitl->state.rpm[sitl->state.vtol_motor_start+i] / 60.0f, freq_variation);
-                float phase_incr = motor_freq * 2 * M_PI / (gyro_sample_hz * nsamples);
+                float phase_incr = motor_freq * 2 * M_PI / (sample_hz * nsamples);
                 float &phase = gyro_motor_phase[i];
                 phase += phase_incr;
                 if (phase_incr > M_PI) {
@@ -234,8 +235,79 @@ void AP_InertialSensor_SITL::generate_gyro()
         _notify_new_gyro_sensor_rate_sample(gyro_instance, gyro);
     }
     gyro_accum /= nsamples;
-    _rotate_and_correct_gyro(gyro_instance, gyro_accum);
-    _notify_new_gyro_raw_sample(gyro_instance, gyro_accum, AP_HAL::micros64());
+    return gyro_accum;
+}
+
+/*
+  emulate a FIFO based gyro running at the INS_GYRO_RATE fast sampling
+  rate. All samples that are due are generated and passed to the
+  frontend in blocks, as the FIFO drivers do
+ */
+void AP_InertialSensor_SITL::generate_gyro_fifo(uint64_t now)
+{
+    const uint32_t interval_us = 1000000UL / gyro_fifo_hz;
+    // keep the sensor rate samples at 8kHz
+    const uint8_t nsamples = MAX(8 / get_fast_sampling_rate(), 1);
+
+    if (next_gyro_sample == 0 || now - next_gyro_sample > 100000U) {
+        // first sample or we have been paused, don't try to catch up
+        next_gyro_sample = now;
+    }
+
+    sample_block block;
+    block.reset();
+    while (now >= next_gyro_sample) {
+        block.push(generate_gyro(nsamples, gyro_fifo_hz));
+        next_gyro_sample += interval_us;
+        if (block.full() || now < next_gyro_sample) {
+            notify_gyro_block(block);
+            block.reset();
+        }
+    }
+}
+
+/*
+  pass a block of gyro samples to the frontend. With
+  INS_SITL_BLOCK_BENCHMARK enabled the per-sample and block paths are
+  alternated every 10 seconds and the CPU time per sample of each is
+  printed
+ */
+void AP_InertialSensor_SITL::notify_gyro_block(sample_block &block)
+{
+#if INS_SITL_BLOCK_BENCHMARK
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    const uint64_t start_ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    if (bench.use_block) {
+        _notify_new_gyro_raw_block(gyro_instance, block);
+    } else {
+        for (uint8_t i = 0; i < block.n; i++) {
+            Vector3f gyro = block.get(i);
+            _rotate_and_correct_gyro(gyro_instance, gyro);
+            _notify_new_gyro_raw_sample(gyro_instance, gyro);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    bench.total_ns += (ts.tv_sec * 1000000000ULL + ts.tv_nsec) - start_ns;
+    bench.nsamples += block.n;
+
+    const uint32_t now_ms = AP_HAL::millis();
+    if (now_ms - bench.start_ms >= 10000) {
+        if (bench.nsamples > 0) {
+            ::printf("IMU%u %s: %u Hz %.3f us/sample\n",
+                     unsigned(gyro_instance),
+                     bench.use_block ? "block" : "sample",
+                     unsigned(bench.nsamples * 1000ULL / (now_ms - bench.start_ms)),
+                     bench.total_ns * 1.0e-3 / bench.nsamples);
+        }
+        bench.use_block = !bench.use_block;
+        bench.start_ms = now_ms;
+        bench.total_ns = 0;
+        bench.nsamples = 0;
+    }
+#else
+    _notify_new_gyro_raw_block(gyro_instance, block);
+#endif
 }
 
 void AP_InertialSensor_SITL::timer_update(void)
@@ -262,7 +334,13 @@ void AP_InertialSensor_SITL::timer_update(void)
     }
     if (now >= next_gyro_sample) {
         if (((1U << gyro_instance) & sitl->gyro_fail_mask) == 0) {
-            generate_gyro();
+            if (gyro_fifo_hz != 0) {
+                generate_gyro_fifo(now);
+                return;
+            }
+            Vector3f gyro = generate_gyro(enable_fast_sampling(gyro_instance) ? 8 : 1, gyro_sample_hz);
+            _rotate_and_correct_gyro(gyro_instance, gyro);
+            _notify_new_gyro_raw_sample(gyro_instance, gyro, AP_HAL::micros64());
             if (next_gyro_sample == 0) {
                 next_gyro_sample = now + 1000000UL / gyro_sample_hz;
             } else {
@@ -305,6 +383,12 @@ void AP_InertialSensor_SITL::start()
     accel_instance = _imu.register_accel(accel_sample_hz,
                                         AP_HAL::Device::make_bus_id(AP_HAL::Device::BUS_TYPE_SITL, bus_id, 2, DEVTYPE_SITL));
     bus_id++;
+
+    if (enable_fast_sampling(gyro_instance) && get_fast_sampling_rate() > 1) {
+        // behave like a FIFO sensor at the requested gyro rate
+        gyro_fifo_hz = gyro_sample_hz * get_fast_sampling_rate();
+        _set_gyro_raw_sample_rate(gyro_instance, gyro_fifo_hz);
+    }
     hal.scheduler->register_timer_process(FUNCTOR_BIND_MEMBER(&AP_InertialSensor_SITL::timer_update, void));
 }
 
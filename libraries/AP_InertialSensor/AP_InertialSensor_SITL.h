@@ -6,6 +6,11 @@
 #include "AP_InertialSensor.h"
 #include "AP_InertialSensor_Backend.h"
 
+// compare the cost of the per-sample and block gyro paths when emulating a FIFO
+#ifndef INS_SITL_BLOCK_BENCHMARK
+#define INS_SITL_BLOCK_BENCHMARK 0
+#endif
+
 // simulated sensor rates in Hz. This matches a pixhawk1
 const uint16_t INS_SITL_SENSOR_A[] = { 1000, 1000 };
 const uint16_t INS_SITL_SENSOR_B[] = { 760, 800 };
@@ -27,13 +32,18 @@ private:
     void timer_update();
     float gyro_drift(void);
     void generate_accel();
-    void generate_gyro();
+    Vector3f generate_gyro(uint8_t nsamples, uint16_t sample_hz);
+    void generate_gyro_fifo(uint64_t now);
+    void notify_gyro_block(sample_block &block);
 
     SITL::SITL *sitl;
 
     const uint16_t gyro_sample_hz;
     const uint16_t accel_sample_hz;
 
+    // gyro rate when emulating a FIFO sensor with fast sampling, zero otherwise
+    uint16_t gyro_fifo_hz;
+
     uint8_t gyro_instance;
     uint8_t accel_instance;
     uint64_t next_gyro_sample;
@@ -44,5 +54,14 @@ private:
     float accel_motor_phase[12];
 
     static uint8_t bus_id;
+
+#if INS_SITL_BLOCK_BENCHMARK
+    struct {
+        bool use_block;
+        uint32_t start_ms;
+        uint64_t total_ns;
+        uint32_t nsamples;
+    } bench;
+#endif
 };
 #endif // CONFIG_HAL_BOARD
@@ -23,8 +23,8 @@ const AP_Param::GroupInfo AP_InertialSensor::BatchSampler::var_info[] = {
 
     // @Param: BAT_OPT
     // @DisplayName: Batch Logging Options Mask
-    // @Description: Options for the BatchSampler. Post-filter and sensor-rate logging cannot be used at the same time.
-    // @Bitmask: 0:Sensor-Rate Logging (sample at full sensor rate seen by AP), 1: Sample post-filtering
+    // @Description: Options for the BatchSampler. Post-filter and sensor-rate logging cannot be used at the same time. The streaming options replace batches with a continuous log of every sample from the IMUs in @PREFIX@BAT_MASK, packed into ISBS messages, with ISST messages reporting the number of samples logged and dropped. Streaming takes effect on the next reboot.
+    // @Bitmask: 0:Sensor-Rate Logging (sample at full sensor rate seen by AP), 1: Sample post-filtering, 2: Stream gyros, 3: Stream accels
     // @User: Advanced
     AP_GROUPINFO("BAT_OPT",  3, AP_InertialSensor::BatchSampler, _batch_options_mask, 0),
 
@@ -41,6 +41,15 @@ const AP_Param::GroupInfo AP_InertialSensor::BatchSampler::var_info[] = {
     // @Increment: 1
     AP_GROUPINFO("BAT_LGCT", 5, AP_InertialSensor::BatchSampler, samples_per_msg,   32),
 
+    // @Param: BAT_SQ
+    // @DisplayName: stream queue length
+    // @Description: Number of 32 sample blocks buffered for each sensor when streaming. A longer queue rides out longer logger stalls before samples are dropped, at a cost of 231 bytes of memory per block per sensor.
+    // @Range: 4 64
+    // @Increment: 1
+    // @User: Advanced
+    // @RebootRequired: True
+    AP_GROUPINFO("BAT_SQ", 6, AP_InertialSensor::BatchSampler, stream_queue_len,   16),
+
     AP_GROUPEND
 };
 
@@ -55,6 +64,11 @@ void AP_InertialSensor::BatchSampler::init()
         return;
     }
 
+    if (_batch_options_mask & (BATCH_OPT_STREAM_GYRO|BATCH_OPT_STREAM_ACCEL)) {
+        init_streams();
+        return;
+    }
+
     _required_count -= _required_count % 32; // round down to nearest multiple of 32
 
     const uint32_t total_allocation = 3*_required_count*sizeof(uint16_t);
@@ -84,6 +98,11 @@ void AP_InertialSensor::BatchSampler::periodic()
     if (_sensor_mask == 0) {
         return;
     }
+    if (streaming) {
+        push_streams_to_log();
+        write_stream_stats();
+        return;
+    }
     push_data_to_log();
 }
 
@@ -100,6 +119,23 @@ void AP_InertialSensor::BatchSampler::update_doing_sensor_rate_logging()
         _doing_sensor_rate_logging = false;
         return;
     }
+    if (streaming) {
+        // the choice of sample source is global, so only stream at
+        // sensor rate if every streamed sensor provides it
+        _doing_sensor_rate_logging = true;
+        for (uint8_t i=0; i<INS_MAX_INSTANCES; i++) {
+            const uint8_t bit = (1<<i);
+            if (streams[i][IMU_SENSOR_TYPE_GYRO] != nullptr &&
+                !(_imu._gyro_sensor_rate_sampling_enabled & bit)) {
+                _doing_sensor_rate_logging = false;
+            }
+            if (streams[i][IMU_SENSOR_TYPE_ACCEL] != nullptr &&
+                !(_imu._accel_sensor_rate_sampling_enabled & bit)) {
+                _doing_sensor_rate_logging = false;
+            }
+        }
+        return;
+    }
     const uint8_t bit = (1<<instance);
     switch (type) {
     case IMU_SENSOR_TYPE_GYRO:
@@ -194,28 +230,13 @@ void AP_InertialSensor::BatchSampler::push_data_to_log()
 
     // possibly send isb header:
     if (!isbh_sent && data_read_offset == 0) {
-        float sample_rate = 0; // avoid warning about uninitialised values
-        switch(type) {
-        case IMU_SENSOR_TYPE_GYRO:
-            sample_rate = _imu._gyro_raw_sample_rates[instance];
-            if (_doing_sensor_rate_logging) {
-                sample_rate *= _imu._gyro_over_sampling[instance];
-            }
-            break;
-        case IMU_SENSOR_TYPE_ACCEL:
-            sample_rate = _imu._accel_raw_sample_rates[instance];
-            if (_doing_sensor_rate_logging) {
-                sample_rate *= _imu._accel_over_sampling[instance];
-            }
-            break;
-        }
         if (!logger->Write_ISBH(isb_seqnum,
                                        type,
                                        instance,
                                        multiplier,
                                        _required_count,
                                        measurement_started_us,
-                                       sample_rate)) {
+                                       sample_rate_hz(instance, type))) {
             // buffer full?
             return;
         }
@@ -243,6 +264,26 @@ void AP_InertialSensor::BatchSampler::push_data_to_log()
     }
 }
 
+float AP_InertialSensor::BatchSampler::sample_rate_hz(uint8_t _instance, IMU_SENSOR_TYPE _type) const
+{
+    float sample_rate = 0; // avoid warning about uninitialised values
+    switch(_type) {
+    case IMU_SENSOR_TYPE_GYRO:
+        sample_rate = _imu._gyro_raw_sample_rates[_instance];
+        if (_doing_sensor_rate_logging) {
+            sample_rate *= _imu._gyro_over_sampling[_instance];
+        }
+        break;
+    case IMU_SENSOR_TYPE_ACCEL:
+        sample_rate = _imu._accel_raw_sample_rates[_instance];
+        if (_doing_sensor_rate_logging) {
+            sample_rate *= _imu._accel_over_sampling[_instance];
+        }
+        break;
+    }
+    return sample_rate;
+}
+
 bool AP_InertialSensor::BatchSampler::should_log(uint8_t _instance, IMU_SENSOR_TYPE _type)
 {
     if (_sensor_mask == 0) {
@@ -273,6 +314,12 @@ bool AP_InertialSensor::BatchSampler::should_log(uint8_t _instance, IMU_SENSOR_T
 
 void AP_InertialSensor::BatchSampler::sample(uint8_t _instance, AP_InertialSensor::IMU_SENSOR_TYPE _type, uint64_t sample_us, const Vector3f &_sample)
 {
+    if (streaming) {
+        if (_instance < INS_MAX_INSTANCES && streams[_instance][_type] != nullptr) {
+            stream_sample(*streams[_instance][_type], _instance, _type, sample_us, _sample);
+        }
+        return;
+    }
     if (!should_log(_instance, _type)) {
         return;
     }
@@ -286,3 +333,218 @@ void AP_InertialSensor::BatchSampler::sample(uint8_t _instance, AP_InertialSenso
 
     data_write_offset++; // may unblock the reading process
 }
+
+void AP_InertialSensor::BatchSampler::init_streams()
+{
+    const uint8_t qlen = constrain_int16(stream_queue_len, 4, 64);
+    const uint8_t _count = MIN(MIN(_imu._accel_count, _imu._gyro_count), INS_MAX_INSTANCES);
+    uint32_t total_allocation = 0;
+
+    for (uint8_t i=0; i<_count; i++) {
+        if (!(_sensor_mask & (1U<<i))) {
+            continue;
+        }
+        for (uint8_t t=0; t<2; t++) {
+            const IMU_SENSOR_TYPE _type = (IMU_SENSOR_TYPE)t;
+            const uint8_t option = (_type == IMU_SENSOR_TYPE_GYRO) ? BATCH_OPT_STREAM_GYRO : BATCH_OPT_STREAM_ACCEL;
+            if (!(_batch_options_mask & option)) {
+                continue;
+            }
+            const uint32_t allocation = sizeof(stream_t) + (qlen+1) * sizeof(log_ISBS);
+            stream_t *stream = new stream_t;
+            if (stream != nullptr) {
+                stream->queue = new ObjectBuffer<log_ISBS>(qlen);
+                if (stream->queue == nullptr || stream->queue->get_size() == 0) {
+                    delete stream->queue;
+                    delete stream;
+                    stream = nullptr;
+                }
+            }
+            if (stream == nullptr) {
+                gcs().send_text(MAV_SEVERITY_WARNING, "Failed to allocate %u bytes for IMU%u stream", (unsigned)allocation, unsigned(i+1));
+                continue;
+            }
+            streams[i][t] = stream;
+            total_allocation += allocation;
+        }
+    }
+
+    gcs().send_text(MAV_SEVERITY_DEBUG, "INS: alloc %u bytes for ISBS (free=%u)", (unsigned int)total_allocation, (unsigned int)hal.util->available_memory());
+
+    streaming = true;
+    update_doing_sensor_rate_logging();
+    initialised = true;
+}
+
+/*
+  quantise one axis of a stream block with the finest scale that keeps
+  both the samples and the differences between them inside an int16,
+  then replace every element but the first with the difference from
+  the previous one. The step is the largest sample or difference in
+  the block divided by 32766, so quiet blocks get a fine step and
+  loud ones a coarse one. Decoding is not exact, each decoded value
+  is within half a step of the logged sample
+ */
+static bool encode_stream_axis(const Vector3f *samples, uint8_t n, uint8_t axis, float &scale, int16_t *out)
+{
+    float vmax = 0;
+    for (uint8_t i=0; i<n; i++) {
+        const float v = samples[i][axis];
+        vmax = MAX(vmax, fabsf(v));
+        if (i > 0) {
+            vmax = MAX(vmax, fabsf(v - samples[i-1][axis]));
+        }
+    }
+    if (!isfinite(vmax)) {
+        return false;
+    }
+    // leave one count of headroom so rounding can't push a
+    // difference past INT16_MAX
+    const float range = INT16_MAX - 1;
+    if (vmax < 1.0e-30f) {
+        // an all zero block
+        scale = 0;
+        memset(out, 0, n*sizeof(int16_t));
+        return true;
+    }
+    scale = vmax / range;
+    const float inv_scale = range / vmax;
+    int32_t prev = 0;
+    for (uint8_t i=0; i<n; i++) {
+        const int32_t q = lrintf(samples[i][axis] * inv_scale);
+        out[i] = int16_t(q - prev);
+        prev = q;
+    }
+    return true;
+}
+
+bool AP_InertialSensor::BatchSampler::encode_stream_block(const stream_t &stream, uint8_t _instance, IMU_SENSOR_TYPE _type, struct log_ISBS &pkt) const
+{
+    static_assert(ARRAY_SIZE(stream.samples) == ARRAY_SIZE(pkt.x), "stream block must fill an ISBS message");
+    pkt = {
+        LOG_PACKET_HEADER_INIT(LOG_ISBS_MSG),
+        time_us        : 0,
+        instance       : _instance,
+        sensor_type    : (uint8_t)_type,
+        seqno          : stream.seqnum,
+        sample_us      : stream.first_sample_us,
+        sample_rate_hz : sample_rate_hz(_instance, _type),
+    };
+
+    // pkt is packed, so encode into aligned buffers and copy in
+    const uint8_t n = ARRAY_SIZE(stream.samples);
+    float scale[3];
+    int16_t data[3][ARRAY_SIZE(stream.samples)];
+    for (uint8_t axis=0; axis<3; axis++) {
+        if (!encode_stream_axis(stream.samples, n, axis, scale[axis], data[axis])) {
+            return false;
+        }
+    }
+    pkt.scale_x = scale[0];
+    pkt.scale_y = scale[1];
+    pkt.scale_z = scale[2];
+    memcpy(pkt.x, data[0], sizeof(pkt.x));
+    memcpy(pkt.y, data[1], sizeof(pkt.y));
+    memcpy(pkt.z, data[2], sizeof(pkt.z));
+    return true;
+}
+
+/*
+  called from the sensor thread for every sample of a streamed sensor
+ */
+void AP_InertialSensor::BatchSampler::stream_sample(stream_t &stream, uint8_t _instance, IMU_SENSOR_TYPE _type, uint64_t sample_us, const Vector3f &_sample)
+{
+    AP_Logger *logger = AP_Logger::get_singleton();
+    if (logger == nullptr || !logger->should_log(MASK_LOG_ANY)) {
+        // start a fresh block once we are logging again
+        stream.samples_discarded += stream.count;
+        stream.count = 0;
+        return;
+    }
+    if (stream.count == 0) {
+        stream.first_sample_us = sample_us ? sample_us : AP_HAL::micros64();
+    }
+    stream.samples[stream.count++] = _sample;
+    if (stream.count < ARRAY_SIZE(stream.samples)) {
+        return;
+    }
+    stream.count = 0;
+
+    struct log_ISBS pkt;
+    if (!encode_stream_block(stream, _instance, _type, pkt) ||
+        !stream.queue->push(pkt)) {
+        // the sequence number still advances so the gap shows in the log
+        stream.samples_dropped += ARRAY_SIZE(stream.samples);
+    }
+    stream.seqnum++;
+}
+
+/*
+  move queued stream blocks into the logger, one block from each
+  stream in turn so a fast sensor can't starve a slow one, until the
+  queues are empty or the logger pushes back
+ */
+void AP_InertialSensor::BatchSampler::push_streams_to_log()
+{
+    AP_Logger *logger = AP_Logger::get_singleton();
+    if (logger == nullptr) {
+        return;
+    }
+    bool pushed;
+    do {
+        pushed = false;
+        for (uint8_t i=0; i<INS_MAX_INSTANCES; i++) {
+            for (uint8_t t=0; t<2; t++) {
+                stream_t *stream = streams[i][t];
+                if (stream == nullptr) {
+                    continue;
+                }
+                struct log_ISBS pkt;
+                if (stream->queue->peek(&pkt, 1) != 1) {
+                    continue;
+                }
+                if (!logger->Write_ISBS(pkt)) {
+                    // leave it queued for the next call
+                    return;
+                }
+                stream->queue->pop();
+                stream->samples_logged += ARRAY_SIZE(stream->samples);
+                pushed = true;
+            }
+        }
+    } while (pushed);
+}
+
+void AP_InertialSensor::BatchSampler::write_stream_stats()
+{
+    const uint32_t now_ms = AP_HAL::millis();
+    if (now_ms - last_stream_stats_ms < 1000) {
+        return;
+    }
+    AP_Logger *logger = AP_Logger::get_singleton();
+    if (logger == nullptr || !logger->should_log(MASK_LOG_ANY)) {
+        return;
+    }
+    last_stream_stats_ms = now_ms;
+
+    for (uint8_t i=0; i<INS_MAX_INSTANCES; i++) {
+        for (uint8_t t=0; t<2; t++) {
+            const stream_t *stream = streams[i][t];
+            if (stream == nullptr) {
+                continue;
+            }
+            const struct log_ISST pkt{
+                LOG_PACKET_HEADER_INIT(LOG_ISST_MSG),
+                time_us           : AP_HAL::micros64(),
+                instance          : i,
+                sensor_type       : t,
+                seqno             : stream->seqnum,
+                samples_logged    : stream->samples_logged,
+                samples_dropped   : stream->samples_dropped,
+                samples_discarded : stream->samples_discarded,
+                queued            : (uint8_t)stream->queue->available(),
+            };
+            logger->WriteBlock(&pkt, sizeof(pkt));
+        }
+    }
+}
@@ -10,6 +10,7 @@
 #include <AP_InternalError/AP_InternalError.h>
 #include <GCS_MAVLink/GCS.h>
 #include <AP_BoardConfig/AP_BoardConfig.h>
+#include <AP_Scheduler/AP_Scheduler.h>
 
 AP_Logger *AP_Logger::_singleton;
 
@@ -110,6 +111,36 @@ const AP_Param::GroupInfo AP_Logger::var_info[] = {
     // @User: Standard
     AP_GROUPINFO("_FILE_MB_FREE",  7, AP_Logger, _params.min_MB_free, 500),
 
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    // @Param: _FILE_COMP
+    // @DisplayName: Compress log files
+    // @Description: When enabled the File backend compresses logs before writing them, which reduces the load on the microSD card with high logging rates. Compressed logs are decompressed when downloaded with the log download protocol and can be read by Replay, but files fetched by MAVLink FTP are in the compressed format
+    // @Values: 0:Disabled,1:Enabled
+    // @RebootRequired: True
+    // @User: Advanced
+    AP_GROUPINFO("_FILE_COMP",  8, AP_Logger, _params.file_compress, 0),
+#endif
+
+#if HAL_LOGGER_RATE_LIMIT_ENABLED
+    // @Param: _RATEMAX
+    // @DisplayName: Maximum logging rate per message type
+    // @Description: This sets the maximum rate at which each type of message is logged. All the messages of a type written in the same main loop are kept, so this does not drop instances of multi-instance messages. Critical messages, messages needed by Replay and parameters are not limited. A value of zero means no limit. The number of messages not logged is recorded in DSFT messages
+    // @Units: Hz
+    // @Range: 0 1000
+    // @Increment: 0.1
+    // @User: Advanced
+    AP_GROUPINFO("_RATEMAX",  9, AP_Logger, _params.rate_max, 0),
+
+    // @Param: _DARM_RATEMAX
+    // @DisplayName: Maximum logging rate per message type when disarmed
+    // @Description: This sets the maximum rate at which each type of message is logged while disarmed, as for LOG_RATEMAX. A value of zero means the LOG_RATEMAX limit applies when disarmed
+    // @Units: Hz
+    // @Range: 0 1000
+    // @Increment: 0.1
+    // @User: Advanced
+    AP_GROUPINFO("_DARM_RATEMAX",  10, AP_Logger, _params.disarmed_rate_max, 0),
+#endif
+
     AP_GROUPEND
 };
 
@@ -233,6 +264,38 @@ void AP_Logger::Init(const struct LogStructure *structures, uint8_t num_types)
         backends[i]->Init();
     }
 
+#if HAL_LOGGER_RATE_LIMIT_ENABLED && !APM_BUILD_TYPE(APM_BUILD_Replay)
+    _rate_limiter = new AP_Logger_RateLimiter(_params.rate_max, _params.disarmed_rate_max);
+    if (_rate_limiter != nullptr) {
+        // messages needed to make sense of a log, or by Replay. The
+        // IMU batch and stream messages are sequence numbered and a
+        // gap loses the whole batch
+        static const uint8_t exempt[] {
+            LOG_FORMAT_MSG,
+            LOG_FORMAT_UNITS_MSG,
+            LOG_UNIT_MSG,
+            LOG_MULT_MSG,
+            LOG_PARAMETER_MSG,
+            LOG_MESSAGE_MSG,
+            LOG_MODE_MSG,
+            LOG_EVENT_MSG,
+            LOG_ERROR_MSG,
+            LOG_ARM_DISARM_MSG,
+            LOG_DF_FILE_STATS,
+            LOG_RATE_STATS_MSG,
+            LOG_ISBH_MSG,
+            LOG_ISBD_MSG,
+            LOG_ISBS_MSG,
+            LOG_ISST_MSG,
+        };
+        for (const uint8_t msg_type : exempt) {
+            _rate_limiter->set_exempt(msg_type);
+        }
+        // the limits are picked up from periodic_tasks(), once the
+        // scheduler has its loop rate
+    }
+#endif
+
     Prep();
 
     start_io_thread();
@@ -687,6 +750,9 @@ void AP_Logger::WriteBlock(const void *pBuffer, uint16_t size) {
 #if APM_BUILD_TYPE(APM_BUILD_Replay)
     save_format_Replay(pBuffer);
 #endif
+    if (!rate_limit_ok(((const uint8_t *)pBuffer)[2])) {
+        return;
+    }
     FOR_EACH_BACKEND(WriteBlock(pBuffer, size));
 }
 
@@ -714,9 +780,58 @@ void AP_Logger::WriteCriticalBlock(const void *pBuffer, uint16_t size) {
 }
 
 void AP_Logger::WritePrioritisedBlock(const void *pBuffer, uint16_t size, bool is_critical) {
+    if (!is_critical && !rate_limit_ok(((const uint8_t *)pBuffer)[2])) {
+        return;
+    }
     FOR_EACH_BACKEND(WritePrioritisedBlock(pBuffer, size, is_critical));
 }
 
+/*
+  check the rate limit for a message type
+ */
+bool AP_Logger::rate_limit_ok(uint8_t msg_type)
+{
+#if HAL_LOGGER_RATE_LIMIT_ENABLED
+    if (_rate_limiter != nullptr) {
+        return _rate_limiter->should_log(msg_type, vehicle_is_armed());
+    }
+#endif
+    return true;
+}
+
+void AP_Logger::note_dropped(uint8_t msg_type)
+{
+#if HAL_LOGGER_RATE_LIMIT_ENABLED
+    if (_rate_limiter != nullptr) {
+        _rate_limiter->note_dropped(msg_type);
+    }
+#endif
+}
+
+#if HAL_LOGGER_RATE_LIMIT_ENABLED
+/*
+  log the counts of messages not logged for each message type
+ */
+void AP_Logger::Write_Rate_Stats()
+{
+    const uint64_t now_us = AP_HAL::micros64();
+    for (uint16_t i=0; i<256; i++) {
+        uint16_t decimated, dropped;
+        if (!_rate_limiter->take_counts(i, decimated, dropped)) {
+            continue;
+        }
+        const struct log_Rate_Stats pkt {
+            LOG_PACKET_HEADER_INIT(LOG_RATE_STATS_MSG),
+            time_us   : now_us,
+            id        : uint8_t(i),
+            decimated : decimated,
+            dropped   : dropped,
+        };
+        WriteBlock(&pkt, sizeof(pkt));
+    }
+}
+#endif
+
 // change me to "DoTimeConsumingPreparations"?
 void AP_Logger::EraseAll() {
     FOR_EACH_BACKEND(EraseAll());
@@ -802,6 +917,14 @@ void AP_Logger::handle_mavlink_msg(GCS_MAVLINK &link, const mavlink_message_t &m
 void AP_Logger::periodic_tasks() {
     handle_log_send();
     FOR_EACH_BACKEND(periodic_tasks());
+#if HAL_LOGGER_RATE_LIMIT_ENABLED
+    const uint32_t now = AP_HAL::millis();
+    if (_rate_limiter != nullptr && now - _last_rate_stats_ms >= 1000) {
+        _last_rate_stats_ms = now;
+        _rate_limiter->update(AP::scheduler().get_loop_rate_hz());
+        Write_Rate_Stats();
+    }
+#endif
 }
 
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX
@@ -925,6 +1048,10 @@ void AP_Logger::WriteV(const char *name, const char *labels, const char *units,
         return;
     }
 
+    if (!is_critical && !rate_limit_ok(f->msg_type)) {
+        return;
+    }
+
     for (uint8_t i=0; i<_next_backend; i++) {
         if (!(f->sent_mask & (1U<<i))) {
             if (!backends[i]->Write_Emit_FMT(f->msg_type)) {
@@ -1353,6 +1480,31 @@ bool AP_Logger::Write_ISBD(const uint16_t isb_seqno,
     return backends[0]->WriteBlock(&pkt, sizeof(pkt));
 }
 
+/*
+  write a block of streamed IMU samples. Unlike other messages these
+  are not written if that would leave less than
+  HAL_LOGGER_ISBS_RESERVED_SPACE bytes in the first backend's buffer,
+  so a stream which outruns the storage backs up in the caller's queue
+  rather than crowding out the rest of the log
+ */
+bool AP_Logger::Write_ISBS(struct log_ISBS &pkt)
+{
+    if (_next_backend == 0) {
+        return false;
+    }
+    if (backends[0]->bufferspace_available() < sizeof(pkt) + HAL_LOGGER_ISBS_RESERVED_SPACE) {
+        return false;
+    }
+    pkt.time_us = AP_HAL::micros64();
+
+    // only the first backend need succeed for us to be successful
+    for (uint8_t i=1; i<_next_backend; i++) {
+        backends[i]->WriteBlock(&pkt, sizeof(pkt));
+    }
+
+    return backends[0]->WriteBlock(&pkt, sizeof(pkt));
+}
+
 // Wrote an event packet
 void AP_Logger::Write_Event(LogEvent id)
 {
@@ -23,6 +23,18 @@
 #include <stdint.h>
 
 #include "LoggerMessageWriter.h"
+#include "AP_Logger_RateLimiter.h"
+
+// support for compressing file backend logs
+#ifndef HAL_LOGGER_FILE_COMPRESS_ENABLED
+#define HAL_LOGGER_FILE_COMPRESS_ENABLED (HAL_MEM_CLASS >= HAL_MEM_CLASS_300)
+#endif
+
+// bytes of the first backend's buffer that streamed IMU samples
+// (ISBS) leave free for the rest of the log
+#ifndef HAL_LOGGER_ISBS_RESERVED_SPACE
+#define HAL_LOGGER_ISBS_RESERVED_SPACE 2048
+#endif
 
 class AP_Logger_Backend;
 class AP_AHRS;
@@ -243,6 +255,7 @@ public:
                         const int16_t x[32],
                         const int16_t y[32],
                         const int16_t z[32]);
+    bool Write_ISBS(struct log_ISBS &pkt);
     void Write_Vibration();
     void Write_RCIN(void);
     void Write_RCOUT(void);
@@ -353,6 +366,13 @@ public:
         AP_Int8 mav_bufsize; // in kilobytes
         AP_Int16 file_timeout; // in seconds
         AP_Int16 min_MB_free;
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+        AP_Int8 file_compress;
+#endif
+#if HAL_LOGGER_RATE_LIMIT_ENABLED
+        AP_Float rate_max;
+        AP_Float disarmed_rate_max;
+#endif
     } _params;
 
     const struct LogStructure *structure(uint16_t num) const;
@@ -433,6 +453,16 @@ private:
     #define LOGGER_MAX_BACKENDS 2
     uint8_t _next_backend;
     AP_Logger_Backend *backends[LOGGER_MAX_BACKENDS];
+
+#if HAL_LOGGER_RATE_LIMIT_ENABLED
+    AP_Logger_RateLimiter *_rate_limiter;
+    uint32_t _last_rate_stats_ms;
+    void Write_Rate_Stats();
+#endif
+    // return true if a non-critical message of this type should be written now
+    bool rate_limit_ok(uint8_t msg_type);
+    // note a message of this type dropped by a backend
+    void note_dropped(uint8_t msg_type);
     const AP_Int32 &_log_bitmask;
 
     enum class Backend_Type : uint8_t {
@@ -540,6 +570,13 @@ private:
     GCS_MAVLINK *_log_sending_link;
     HAL_Semaphore _log_send_sem;
 
+    // throughput of the current log download
+    struct {
+        uint32_t start_ms;
+        uint32_t bytes;
+        uint16_t requests;
+    } _log_send_stats;
+
     // last time arming failed, for backends
     uint32_t _last_arming_failure_ms;
 
@@ -557,6 +594,7 @@ private:
     void handle_log_send_listing(); // handle LISTING state
     void handle_log_sending(); // handle SENDING state
     bool handle_log_send_data(); // send data chunk to client
+    void handle_log_send_stats(); // report download throughput
 
     void get_log_info(uint16_t log_num, uint32_t &size, uint32_t &time_utc);
 
@@ -411,7 +411,12 @@ bool AP_Logger_Backend::WritePrioritisedBlock(const void *pBuffer, uint16_t size
     if (!WritesOK()) {
         return false;
     }
-    return _WritePrioritisedBlock(pBuffer, size, is_critical);
+    const uint32_t dropped = _dropped;
+    const bool ret = _WritePrioritisedBlock(pBuffer, size, is_critical);
+    if (_dropped != dropped) {
+        _front.note_dropped(((const uint8_t *)pBuffer)[2]);
+    }
+    return ret;
 }
 
 bool AP_Logger_Backend::ShouldLog(bool is_critical)
@@ -0,0 +1,361 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AP_Logger_Compress.h"
+
+#include <AP_Filesystem/AP_Filesystem.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_Math/crc.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+// a match is at least this long
+#define MIN_MATCH 4
+// the last match must start at least this far from the end of a block
+#define MF_LIMIT 12
+// and the last bytes of a block are always literals
+#define LAST_LITERALS 5
+
+#define HASH_SIZE (1U<<LOGGER_COMPRESS_HASH_BITS)
+
+static_assert(LOGGER_COMPRESS_BLOCK_MAX <= 0xFFFF, "offsets must fit in 16 bits");
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint16_t hash32(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - LOGGER_COMPRESS_HASH_BITS);
+}
+
+// write the extra bytes of a literal or match length above 15
+static inline uint8_t *write_length(uint8_t *op, uint32_t len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = len;
+    return op;
+}
+
+AP_Logger_Compress::~AP_Logger_Compress()
+{
+    free(_hashtable);
+}
+
+bool AP_Logger_Compress::init(void)
+{
+    if (_hashtable == nullptr) {
+        _hashtable = (uint16_t *)calloc(HASH_SIZE, sizeof(uint16_t));
+    }
+    return _hashtable != nullptr;
+}
+
+uint32_t AP_Logger_Compress::compress_block(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t dst_max)
+{
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *const iend = src + len;
+    uint8_t *op = dst;
+    uint8_t *const oend = dst + dst_max;
+
+    if (len > MF_LIMIT) {
+        const uint8_t *const mflimit = iend - MF_LIMIT;
+        const uint8_t *const matchlimit = iend - LAST_LITERALS;
+
+        // stale entries are harmless as every match is checked, but
+        // they must not point past the end of this block
+        memset(_hashtable, 0, HASH_SIZE * sizeof(uint16_t));
+
+        ip++;
+        while (ip < mflimit) {
+            const uint32_t seq = read32(ip);
+            const uint16_t h = hash32(seq);
+            const uint8_t *ref = src + _hashtable[h];
+            _hashtable[h] = ip - src;
+            if (read32(ref) != seq || ref >= ip) {
+                // skip faster through data which doesn't compress
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            // extend the match backwards over the pending literals
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t *mp = ip + MIN_MATCH;
+            const uint8_t *rp = ref + MIN_MATCH;
+            while (mp < matchlimit && *mp == *rp) {
+                mp++;
+                rp++;
+            }
+
+            const uint32_t lit_len = ip - anchor;
+            const uint32_t match_len = mp - ip - MIN_MATCH;
+            if (uint32_t(oend - op) < 1 + lit_len/255 + 1 + lit_len + 2 + match_len/255 + 1) {
+                return 0;
+            }
+
+            uint8_t *token = op++;
+            *token = MIN(lit_len, 15U) << 4;
+            if (lit_len >= 15) {
+                op = write_length(op, lit_len - 15);
+            }
+            memcpy(op, anchor, lit_len);
+            op += lit_len;
+
+            const uint16_t offset = ip - ref;
+            *op++ = offset & 0xFF;
+            *op++ = offset >> 8;
+            *token |= MIN(match_len, 15U);
+            if (match_len >= 15) {
+                op = write_length(op, match_len - 15);
+            }
+
+            ip = mp;
+            anchor = ip;
+            if (ip < mflimit) {
+                _hashtable[hash32(read32(ip-2))] = ip - 2 - src;
+            }
+        }
+    }
+
+    // the rest of the block is literals
+    const uint32_t lit_len = iend - anchor;
+    if (uint32_t(oend - op) < 1 + lit_len/255 + 1 + lit_len) {
+        return 0;
+    }
+    *op++ = MIN(lit_len, 15U) << 4;
+    if (lit_len >= 15) {
+        op = write_length(op, lit_len - 15);
+    }
+    memcpy(op, anchor, lit_len);
+    op += lit_len;
+
+    return op - dst;
+}
+
+int32_t AP_Logger_Compress::decompress_block(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t dst_max)
+{
+    const uint8_t *ip = src;
+    const uint8_t *const iend = src + len;
+    uint8_t *op = dst;
+    uint8_t *const oend = dst + dst_max;
+
+    while (ip < iend) {
+        const uint8_t token = *ip++;
+
+        uint32_t lit_len = token >> 4;
+        if (lit_len == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                b = *ip++;
+                lit_len += b;
+            } while (b == 255);
+        }
+        if (lit_len > uint32_t(iend - ip) || lit_len > uint32_t(oend - op)) {
+            return -1;
+        }
+        memcpy(op, ip, lit_len);
+        op += lit_len;
+        ip += lit_len;
+        if (ip == iend) {
+            // the last sequence has no match
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return -1;
+        }
+        const uint16_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - dst) {
+            return -1;
+        }
+        uint32_t match_len = token & 0x0F;
+        if (match_len == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                b = *ip++;
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += MIN_MATCH;
+        if (match_len > uint32_t(oend - op)) {
+            return -1;
+        }
+        // matches may overlap the bytes they produce
+        const uint8_t *ref = op - offset;
+        while (match_len--) {
+            *op++ = *ref++;
+        }
+    }
+    return op - dst;
+}
+
+uint32_t AP_Logger_Compress::compress_frame(const uint8_t *src, uint16_t raw_len, uint8_t *frame)
+{
+    FrameHeader hdr {};
+    hdr.magic1 = LOGGER_COMPRESS_MAGIC1;
+    hdr.magic2 = LOGGER_COMPRESS_MAGIC2;
+    hdr.raw_len = raw_len;
+
+    uint8_t *data = &frame[sizeof(hdr)];
+    // only keep the compressed block if it is smaller
+    uint32_t data_len = compress_block(src, raw_len, data, raw_len > 0 ? raw_len-1 : 0);
+    if (data_len == 0) {
+        hdr.flags = FRAME_FLAG_STORED;
+        memcpy(data, src, raw_len);
+        data_len = raw_len;
+    }
+    hdr.data_len = data_len;
+    hdr.crc = crc_crc32(0, data, data_len);
+    memcpy(frame, &hdr, sizeof(hdr));
+
+    return sizeof(hdr) + data_len;
+}
+
+void AP_Logger_Compress::trailer_frame(uint32_t raw_size, uint8_t frame[TRAILER_SIZE])
+{
+    FrameHeader hdr {};
+    hdr.magic1 = LOGGER_COMPRESS_MAGIC1;
+    hdr.magic2 = LOGGER_COMPRESS_MAGIC2;
+    hdr.flags = FRAME_FLAG_TRAILER;
+    hdr.data_len = sizeof(raw_size);
+    memcpy(&frame[sizeof(hdr)], &raw_size, sizeof(raw_size));
+    hdr.crc = crc_crc32(0, &frame[sizeof(hdr)], sizeof(raw_size));
+    memcpy(frame, &hdr, sizeof(hdr));
+}
+
+bool AP_Logger_Compress::header_valid(const FrameHeader &hdr)
+{
+    return hdr.magic1 == LOGGER_COMPRESS_MAGIC1 &&
+        hdr.magic2 == LOGGER_COMPRESS_MAGIC2 &&
+        hdr.raw_len <= LOGGER_COMPRESS_BLOCK_MAX &&
+        hdr.data_len <= hdr.raw_len;
+}
+
+bool AP_Logger_Compress::decode_frame(const FrameHeader &hdr, const uint8_t *data, uint8_t *out)
+{
+    if (crc_crc32(0, data, hdr.data_len) != hdr.crc) {
+        return false;
+    }
+    if (hdr.flags & FRAME_FLAG_STORED) {
+        if (hdr.data_len != hdr.raw_len) {
+            return false;
+        }
+        memcpy(out, data, hdr.raw_len);
+        return true;
+    }
+    return decompress_block(data, hdr.data_len, out, hdr.raw_len) == hdr.raw_len;
+}
+
+int32_t AP_Logger_Compress::read_frame(int fd, uint8_t *data, uint8_t *out)
+{
+    FrameHeader hdr;
+    const ssize_t n = AP::FS().read(fd, &hdr, sizeof(hdr));
+    if (n < 0) {
+        return -1;
+    }
+    if (n != sizeof(hdr) || !header_valid(hdr)) {
+        return 0;
+    }
+    const ssize_t ndata = AP::FS().read(fd, data, hdr.data_len);
+    if (ndata < 0) {
+        return -1;
+    }
+    if (ndata != hdr.data_len || !decode_frame(hdr, data, out)) {
+        return 0;
+    }
+    return hdr.raw_len;
+}
+
+bool AP_Logger_Compress::skip_frames(int fd, uint32_t raw_ofs, uint32_t &raw_pos)
+{
+    // seeking past the end of the file succeeds, so a torn frame is
+    // found by comparing against the file length
+    off_t pos = AP::FS().lseek(fd, 0, SEEK_CUR);
+    const off_t file_end = AP::FS().lseek(fd, 0, SEEK_END);
+    if (pos == (off_t)-1 || file_end == (off_t)-1 ||
+        AP::FS().lseek(fd, pos, SEEK_SET) == (off_t)-1) {
+        return false;
+    }
+    while (true) {
+        FrameHeader hdr;
+        const ssize_t n = AP::FS().read(fd, &hdr, sizeof(hdr));
+        if (n < 0) {
+            return false;
+        }
+        if (n != sizeof(hdr) || !header_valid(hdr) ||
+            pos + n + hdr.data_len > file_end ||
+            raw_pos + hdr.raw_len > raw_ofs) {
+            // back up to the start of this frame
+            return n == 0 || AP::FS().lseek(fd, -n, SEEK_CUR) != (off_t)-1;
+        }
+        if (AP::FS().lseek(fd, hdr.data_len, SEEK_CUR) == (off_t)-1) {
+            return false;
+        }
+        pos += n + hdr.data_len;
+        raw_pos += hdr.raw_len;
+    }
+}
+
+bool AP_Logger_Compress::is_compressed(int fd)
+{
+    uint8_t magic[2];
+    const bool ret = AP::FS().read(fd, magic, sizeof(magic)) == sizeof(magic) &&
+        magic[0] == LOGGER_COMPRESS_MAGIC1 &&
+        magic[1] == LOGGER_COMPRESS_MAGIC2;
+    AP::FS().lseek(fd, 0, SEEK_SET);
+    return ret;
+}
+
+uint32_t AP_Logger_Compress::raw_size(int fd)
+{
+    uint8_t trailer[TRAILER_SIZE];
+    FrameHeader hdr;
+    uint32_t raw_pos = 0;
+    if (AP::FS().lseek(fd, -int32_t(TRAILER_SIZE), SEEK_END) != (off_t)-1 &&
+        AP::FS().read(fd, trailer, sizeof(trailer)) == sizeof(trailer)) {
+        memcpy(&hdr, trailer, sizeof(hdr));
+        if (hdr.magic1 == LOGGER_COMPRESS_MAGIC1 &&
+            hdr.magic2 == LOGGER_COMPRESS_MAGIC2 &&
+            hdr.flags == FRAME_FLAG_TRAILER &&
+            hdr.data_len == sizeof(raw_pos) &&
+            crc_crc32(0, &trailer[sizeof(hdr)], sizeof(raw_pos)) == hdr.crc) {
+            memcpy(&raw_pos, &trailer[sizeof(hdr)], sizeof(raw_pos));
+            AP::FS().lseek(fd, 0, SEEK_SET);
+            return raw_pos;
+        }
+    }
+    // not closed cleanly
+    AP::FS().lseek(fd, 0, SEEK_SET);
+    skip_frames(fd, UINT32_MAX, raw_pos);
+    AP::FS().lseek(fd, 0, SEEK_SET);
+    return raw_pos;
+}
@@ -0,0 +1,151 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  block compression for log files
+
+  A compressed log is a sequence of frames, each a FrameHeader
+  followed by data_len bytes which decode to raw_len bytes of the
+  normal log stream. Blocks are compressed independently, so a log
+  can be read from any frame and a torn frame at the end of a log
+  from a power loss only loses that frame.
+
+  The frame data uses the LZ4 block format: sequences of a token, a
+  run of literals and a match with a 16 bit offset into the output
+  already produced. Frames which would not get smaller are stored.
+
+  Compressed logs start with LOGGER_COMPRESS_MAGIC1/2 where a normal
+  log starts with HEAD_BYTE1/2, so readers can tell them apart from
+  the first two bytes.
+
+  A log closed cleanly ends with a trailer frame holding the length
+  of the log stream, so it can be found without walking the frames.
+  The trailer is not a valid frame, so readers stop at it.
+ */
+#pragma once
+
+#include <AP_Common/AP_Common.h>
+#include <AP_HAL/AP_HAL_Boards.h>
+
+#include <stdint.h>
+
+#define LOGGER_COMPRESS_MAGIC1 0xA3
+#define LOGGER_COMPRESS_MAGIC2 0x4C
+
+// largest raw block in a frame. Readers need this much buffer
+#define LOGGER_COMPRESS_BLOCK_MAX 8192
+
+// the compressor hash table has 1<<LOGGER_COMPRESS_HASH_BITS entries
+#ifndef LOGGER_COMPRESS_HASH_BITS
+#define LOGGER_COMPRESS_HASH_BITS 12
+#endif
+
+class AP_Logger_Compress
+{
+public:
+    struct PACKED FrameHeader {
+        uint8_t magic1;
+        uint8_t magic2;
+        uint8_t flags;
+        uint8_t reserved;
+        uint16_t raw_len;
+        uint16_t data_len;
+        // crc32 of the frame data
+        uint32_t crc;
+    };
+
+    // frame data is the raw block, not compressed
+    static const uint8_t FRAME_FLAG_STORED = 0x01;
+    // frame data is the uint32_t length of the log stream
+    static const uint8_t FRAME_FLAG_TRAILER = 0x02;
+
+    // length of the trailer frame
+    static const uint8_t TRAILER_SIZE = sizeof(FrameHeader) + sizeof(uint32_t);
+
+    // largest frame for a raw block of raw_len bytes
+    static constexpr uint32_t max_frame_size(uint32_t raw_len) {
+        return sizeof(FrameHeader) + raw_len;
+    }
+
+    ~AP_Logger_Compress();
+
+    // allocate the compressor state, returns false when out of memory
+    bool init(void);
+
+    /*
+      compress raw_len bytes of src to a frame. frame must have room
+      for max_frame_size(raw_len) bytes. Returns the length of the frame
+     */
+    uint32_t compress_frame(const uint8_t *src, uint16_t raw_len, uint8_t *frame);
+
+    // fill frame with the trailer for a log stream of raw_size bytes
+    static void trailer_frame(uint32_t raw_size, uint8_t frame[TRAILER_SIZE]);
+
+    // check the header of a frame
+    static bool header_valid(const FrameHeader &hdr);
+
+    /*
+      decode the data of a frame to out, which must have room for
+      hdr.raw_len bytes. Returns false if the frame is corrupt
+     */
+    static bool decode_frame(const FrameHeader &hdr, const uint8_t *data, uint8_t *out);
+
+    /*
+      read and decode the next frame of a log from fd. data must have
+      room for LOGGER_COMPRESS_BLOCK_MAX bytes and out for
+      LOGGER_COMPRESS_BLOCK_MAX bytes. Returns the number of bytes
+      decoded, 0 at the end of the log, which includes a torn or
+      corrupt frame, or -1 on a read error
+     */
+    static int32_t read_frame(int fd, uint8_t *data, uint8_t *out);
+
+    /*
+      skip over frames of a log from fd until the one holding offset
+      raw_ofs of the log stream, starting from a frame boundary at
+      raw_pos. On return raw_pos is the offset of the next frame to
+      read. A frame with data missing from the end of the file ends
+      the log. Returns false on a read or seek error
+     */
+    static bool skip_frames(int fd, uint32_t raw_ofs, uint32_t &raw_pos);
+
+    /*
+      return true if the log in fd is compressed, leaving the file at
+      its start
+     */
+    static bool is_compressed(int fd);
+
+    /*
+      the length of the log stream in compressed log fd, from its
+      trailer, or by walking the frames of a log which was not closed
+     */
+    static uint32_t raw_size(int fd);
+
+    /*
+      compress a block in the LZ4 block format to dst, writing no more
+      than dst_max bytes. Returns the compressed length, or 0 if it
+      would not fit
+     */
+    uint32_t compress_block(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t dst_max);
+
+    /*
+      decompress a block in the LZ4 block format to dst, writing no
+      more than dst_max bytes. Returns the decompressed length, or -1
+      if the block is corrupt
+     */
+    static int32_t decompress_block(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t dst_max);
+
+private:
+    // offsets into the current block by hash of the 4 bytes there
+    uint16_t *_hashtable = nullptr;
+};
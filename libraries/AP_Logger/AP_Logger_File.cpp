@@ -33,6 +33,30 @@ extern const AP_HAL::HAL& hal;
 #define HAL_LOGGER_WRITE_CHUNK_SIZE 4096
 #endif
 
+// read-ahead for log download. Allocated only while a log is open
+// for reading
+#ifndef HAL_LOGGER_READ_AHEAD_SIZE
+#if HAL_MEM_CLASS >= HAL_MEM_CLASS_500
+#define HAL_LOGGER_READ_AHEAD_SIZE 16384
+#else
+#define HAL_LOGGER_READ_AHEAD_SIZE 4096
+#endif
+#endif
+
+#ifndef HAL_LOGGER_READ_CHUNK_SIZE
+#define HAL_LOGGER_READ_CHUNK_SIZE 4096
+#endif
+
+// data already sent which is kept in the read-ahead buffer, so that a
+// GCS retry of recent data doesn't need a seek
+#ifndef HAL_LOGGER_READ_REWIND_SIZE
+#define HAL_LOGGER_READ_REWIND_SIZE 1024
+#endif
+
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+static_assert(HAL_LOGGER_WRITE_CHUNK_SIZE <= LOGGER_COMPRESS_BLOCK_MAX, "write chunks must fit in a compressed frame");
+#endif
+
 #define MB_to_B 1000000
 #define B_to_MB 0.000001
 
@@ -51,6 +75,7 @@ AP_Logger_File::AP_Logger_File(AP_Logger &front,
     _log_directory(log_directory),
     _writebuf(0),
     _writebuf_chunk(HAL_LOGGER_WRITE_CHUNK_SIZE),
+    _readbuf(0),
     _perf_write(hal.util->perf_alloc(AP_HAL::Util::PC_ELAPSED, "DF_write")),
     _perf_fsync(hal.util->perf_alloc(AP_HAL::Util::PC_ELAPSED, "DF_fsync")),
     _perf_errors(hal.util->perf_alloc(AP_HAL::Util::PC_COUNT, "DF_errors")),
@@ -98,6 +123,20 @@ void AP_Logger_File::Init()
 
     hal.console->printf("AP_Logger_File: buffer size=%u\n", (unsigned)bufsize);
 
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    if (_front._params.file_compress) {
+        _compress = new AP_Logger_Compress();
+        _frame = (uint8_t *)malloc(AP_Logger_Compress::max_frame_size(_writebuf_chunk));
+        if (_compress == nullptr || !_compress->init() || _frame == nullptr) {
+            hal.console->printf("AP_Logger_File: out of memory for compression\n");
+            delete _compress;
+            _compress = nullptr;
+            free(_frame);
+            _frame = nullptr;
+        }
+    }
+#endif
+
     _initialised = true;
 
     const char* custom_dir = hal.util->get_custom_log_directory();
@@ -584,6 +623,66 @@ uint32_t AP_Logger_File::_get_log_size(const uint16_t log_num)
     return st.st_size;
 }
 
+/*
+  find the length of the log stream in a log. For a compressed log
+  this is larger than the file
+ */
+uint32_t AP_Logger_File::_get_log_data_size(const uint16_t log_num)
+{
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    char *fname = _log_file_name(log_num);
+    if (fname == nullptr) {
+        return 0;
+    }
+    if (_write_fd != -1 && write_fd_semaphore.take_nonblocking()) {
+        if (_write_filename != nullptr && strcmp(_write_filename, fname) == 0) {
+            // it is the file we are currently writing
+            const uint32_t ret = _compress != nullptr ? _write_raw_offset : _write_offset;
+            free(fname);
+            write_fd_semaphore.give();
+            return ret;
+        }
+        write_fd_semaphore.give();
+    }
+
+    // the size is cached per log so a log listing doesn't open every
+    // log each time. The cached size is good while the file length
+    // is unchanged
+    const uint32_t file_size = _get_log_size(log_num);
+    if (file_size == 0) {
+        free(fname);
+        return 0;
+    }
+    if (_data_size_cache == nullptr) {
+        _data_size_cache = (DataSizeCacheEntry *)calloc(MAX_LOG_FILES, sizeof(DataSizeCacheEntry));
+    }
+    DataSizeCacheEntry *entry = nullptr;
+    if (_data_size_cache != nullptr && log_num <= MAX_LOG_FILES) {
+        entry = &_data_size_cache[log_num-1];
+        if (entry->file_size == file_size) {
+            free(fname);
+            return entry->data_size;
+        }
+    }
+
+    EXPECT_DELAY_MS(3000);
+    const int fd = AP::FS().open(fname, O_RDONLY);
+    free(fname);
+    if (fd == -1) {
+        return file_size;
+    }
+    const uint32_t ret = AP_Logger_Compress::is_compressed(fd) ? AP_Logger_Compress::raw_size(fd) : file_size;
+    AP::FS().close(fd);
+    if (entry != nullptr) {
+        entry->file_size = file_size;
+        entry->data_size = ret;
+    }
+    return ret;
+#else
+    return _get_log_size(log_num);
+#endif
+}
+
 uint32_t AP_Logger_File::_get_log_time(const uint16_t log_num)
 {
     char *fname = _log_file_name(log_num);
@@ -627,7 +726,7 @@ void AP_Logger_File::get_log_boundaries(const uint16_t list_entry, uint32_t & st
     }
 
     start_page = 0;
-    end_page = _get_log_size(log_num) / LOGGER_PAGE_SIZE;
+    end_page = _get_log_data_size(log_num) / LOGGER_PAGE_SIZE;
 }
 
 /*
@@ -645,9 +744,10 @@ int16_t AP_Logger_File::get_log_data(const uint16_t list_entry, const uint16_t p
         return -1;
     }
 
+    WITH_SEMAPHORE(read_semaphore);
+
     if (_read_fd != -1 && log_num != _read_fd_log_num) {
-        AP::FS().close(_read_fd);
-        _read_fd = -1;
+        close_read_fd();
     }
     if (_read_fd == -1) {
         char *fname = _log_file_name(log_num);
@@ -669,25 +769,192 @@ int16_t AP_Logger_File::get_log_data(const uint16_t list_entry, const uint16_t p
         }
         free(fname);
         _read_offset = 0;
+        _read_eof = false;
+        _read_error = false;
         _read_fd_log_num = log_num;
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+        if (!open_read_compressed()) {
+            close_read_fd();
+            return -1;
+        }
+        if (!_read_compressed)
+#endif
+        {
+            // without a read-ahead buffer we read directly from the file
+            _readbuf.set_size(HAL_LOGGER_READ_AHEAD_SIZE);
+        }
     }
     uint32_t ofs = page * (uint32_t)LOGGER_PAGE_SIZE + offset;
 
-    if (ofs != _read_offset) {
+    // the file offset of the first byte in the read-ahead buffer
+    const uint32_t buf_ofs = _read_offset - _readbuf.available();
+
+    if (ofs >= buf_ofs && ofs <= _read_offset) {
+        // the GCS is asking for data we have buffered, or for the
+        // data following it. Keeping some of the data before it
+        // avoids a seek when the GCS retries or re-requests a range
+        if (ofs - buf_ofs > HAL_LOGGER_READ_REWIND_SIZE) {
+            _readbuf.advance(ofs - buf_ofs - HAL_LOGGER_READ_REWIND_SIZE);
+        }
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    } else if (_read_compressed) {
+        // frames can only be found by walking them from the start of
+        // the log, or from the end of the buffered data
+        if (ofs < buf_ofs) {
+            if (AP::FS().lseek(_read_fd, 0, SEEK_SET) == (off_t)-1) {
+                close_read_fd();
+                return -1;
+            }
+            _read_offset = 0;
+        }
+        _readbuf.clear();
+        _read_eof = false;
+        _read_error = false;
+        if (!AP_Logger_Compress::skip_frames(_read_fd, ofs, _read_offset) ||
+            !fill_read_buffer()) {
+            close_read_fd();
+            return -1;
+        }
+        // the first frame starts at or before ofs
+        _readbuf.advance(MIN(ofs - (_read_offset - _readbuf.available()), _readbuf.available()));
+#endif
+    } else {
         if (AP::FS().lseek(_read_fd, ofs, SEEK_SET) == (off_t)-1) {
-            AP::FS().close(_read_fd);
-            _read_fd = -1;
+            close_read_fd();
             return -1;
         }
+        _readbuf.clear();
         _read_offset = ofs;
+        _read_eof = false;
+        _read_error = false;
     }
-    int16_t ret = (int16_t)AP::FS().read(_read_fd, data, len);
-    if (ret > 0) {
-        _read_offset += ret;
+
+    if (_readbuf.get_size() == 0) {
+        int16_t ret = (int16_t)AP::FS().read(_read_fd, data, len);
+        if (ret > 0) {
+            _read_offset += ret;
+        }
+        return ret;
     }
-    return ret;
+
+    if (ofs == _read_offset) {
+        // the IO thread has not caught up, or failed to read. Once
+        // the data read before an error has been sent it is reported
+        if (_read_error || !fill_read_buffer()) {
+            close_read_fd();
+            return -1;
+        }
+    }
+    return (int16_t)read_buffered(ofs - (_read_offset - _readbuf.available()), data, len);
+}
+
+/*
+  copy data from the read-ahead buffer, starting skip bytes in,
+  without consuming it. Returns the number of bytes copied
+ */
+uint16_t AP_Logger_File::read_buffered(uint32_t skip, uint8_t *data, uint16_t len)
+{
+    ByteBuffer::IoVec vec[2];
+    const uint8_t n_vec = _readbuf.peekiovec(vec, skip + len);
+    uint16_t copied = 0;
+    for (uint8_t i = 0; i < n_vec; i++) {
+        if (skip >= vec[i].len) {
+            skip -= vec[i].len;
+            continue;
+        }
+        const uint32_t n = MIN(vec[i].len - skip, uint32_t(len - copied));
+        memcpy(&data[copied], &vec[i].data[skip], n);
+        copied += n;
+        skip = 0;
+    }
+    return copied;
+}
+
+/*
+  read the next chunk of the log being downloaded into the read-ahead
+  buffer. Returns false on a read error. Called with read_semaphore held
+ */
+bool AP_Logger_File::fill_read_buffer(void)
+{
+    if (_read_fd == -1 || _read_eof) {
+        return true;
+    }
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    if (_read_compressed) {
+        if (_readbuf.space() < LOGGER_COMPRESS_BLOCK_MAX) {
+            return true;
+        }
+        const int32_t nread = AP_Logger_Compress::read_frame(_read_fd, _read_frame_data, _read_frame_raw);
+        if (nread < 0) {
+            return false;
+        }
+        if (nread == 0) {
+            _read_eof = true;
+        }
+        _readbuf.write(_read_frame_raw, nread);
+        _read_offset += nread;
+        return true;
+    }
+#endif
+    // only fill the contiguous space, the next call will wrap
+    ByteBuffer::IoVec vec[2];
+    if (_readbuf.reserve(vec, MIN(_readbuf.space(), (uint32_t)HAL_LOGGER_READ_CHUNK_SIZE)) == 0) {
+        return true;
+    }
+    const ssize_t nread = AP::FS().read(_read_fd, vec[0].data, vec[0].len);
+    if (nread < 0) {
+        _readbuf.commit(0);
+        return false;
+    }
+    if (nread == 0) {
+        _read_eof = true;
+    }
+    _readbuf.commit(nread);
+    _read_offset += nread;
+    return true;
 }
 
+/*
+  close the log being downloaded and release the read-ahead buffer
+ */
+void AP_Logger_File::close_read_fd(void)
+{
+    WITH_SEMAPHORE(read_semaphore);
+    if (_read_fd != -1) {
+        AP::FS().close(_read_fd);
+        _read_fd = -1;
+    }
+    _readbuf.set_size(0);
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    _read_compressed = false;
+    free(_read_frame_data);
+    _read_frame_data = nullptr;
+    free(_read_frame_raw);
+    _read_frame_raw = nullptr;
+#endif
+}
+
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+/*
+  check if the log just opened for reading is compressed and allocate
+  the buffers to decode it. Returns false when out of memory
+ */
+bool AP_Logger_File::open_read_compressed(void)
+{
+    _read_compressed = AP_Logger_Compress::is_compressed(_read_fd);
+    if (!_read_compressed) {
+        return true;
+    }
+    // the buffer must always have room for a whole frame
+    if (!_readbuf.set_size(HAL_LOGGER_READ_AHEAD_SIZE + LOGGER_COMPRESS_BLOCK_MAX)) {
+        return false;
+    }
+    _read_frame_data = (uint8_t *)malloc(LOGGER_COMPRESS_BLOCK_MAX);
+    _read_frame_raw = (uint8_t *)malloc(LOGGER_COMPRESS_BLOCK_MAX);
+    return _read_frame_data != nullptr && _read_frame_raw != nullptr;
+}
+#endif
+
 /*
   find size and date of a log
  */
@@ -701,7 +968,7 @@ void AP_Logger_File::get_log_info(const uint16_t list_entry, uint32_t &size, uin
         return;
     }
 
-    size = _get_log_size(log_num);
+    size = _get_log_data_size(log_num);
     time_utc = _get_log_time(log_num);
 }
 
@@ -742,6 +1009,15 @@ void AP_Logger_File::stop_logging(void)
     if (_write_fd != -1) {
         int fd = _write_fd;
         _write_fd = -1;
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+        if (have_sem && _compress != nullptr && _frame_len == 0) {
+            // record the log stream length so the log size can be
+            // found without walking the frames
+            uint8_t trailer[AP_Logger_Compress::TRAILER_SIZE];
+            AP_Logger_Compress::trailer_frame(_write_raw_offset, trailer);
+            AP::FS().write(fd, trailer, sizeof(trailer));
+        }
+#endif
         AP::FS().close(fd);
     }
     if (have_sem) {
@@ -774,10 +1050,7 @@ void AP_Logger_File::start_new_log(void)
 
     start_new_log_reset_variables();
 
-    if (_read_fd != -1) {
-        AP::FS().close(_read_fd);
-        _read_fd = -1;
-    }
+    close_read_fd();
 
     if (disk_space_avail() < _free_space_min_avail && disk_space() > 0) {
         hal.console->printf("Out of space for logging\n");
@@ -817,6 +1090,11 @@ void AP_Logger_File::start_new_log(void)
     EXPECT_DELAY_MS(3000);
     _write_fd = AP::FS().open(_write_filename, O_WRONLY|O_CREAT|O_TRUNC);
     _cached_oldest_log = 0;
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    if (_data_size_cache != nullptr && log_num <= MAX_LOG_FILES) {
+        _data_size_cache[log_num-1].file_size = 0;
+    }
+#endif
 
     if (_write_fd == -1) {
         write_fd_semaphore.give();
@@ -833,6 +1111,10 @@ void AP_Logger_File::start_new_log(void)
     _open_error_ms = 0;
     _write_offset = 0;
     _writebuf.clear();
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    _frame_len = 0;
+    _write_raw_offset = 0;
+#endif
     write_fd_semaphore.give();
 
     // now update lastlog.txt with the new log number
@@ -866,7 +1148,7 @@ void AP_Logger_File::flush(void)
 #if APM_BUILD_TYPE(APM_BUILD_Replay) || APM_BUILD_TYPE(APM_BUILD_UNKNOWN)
 {
     uint32_t tnow = AP_HAL::millis();
-    while (_write_fd != -1 && _initialised && !recent_open_error() && _writebuf.available()) {
+    while (_write_fd != -1 && _initialised && !recent_open_error() && (_writebuf.available() || write_pending())) {
         // convince the IO timer that it really is OK to write out
         // less than _writebuf_chunk bytes:
         if (tnow > 2001) { // avoid resetting _last_write_time to 0
@@ -894,15 +1176,28 @@ void AP_Logger_File::io_timer(void)
 {
     uint32_t tnow = AP_HAL::millis();
     _io_timer_heartbeat = tnow;
+
+    if (_read_fd != -1 && read_semaphore.take_nonblocking()) {
+        // keep the log download read-ahead full
+        last_io_operation = "read";
+        if (_readbuf.get_size() != 0 && !_read_error && !fill_read_buffer()) {
+            // stop reading, the download gets the error once it has
+            // the data read before it
+            _read_error = true;
+        }
+        last_io_operation = "";
+        read_semaphore.give();
+    }
+
     if (_write_fd == -1 || !_initialised || recent_open_error()) {
         return;
     }
 
     uint32_t nbytes = _writebuf.available();
-    if (nbytes == 0) {
+    if (nbytes == 0 && !write_pending()) {
         return;
     }
-    if (nbytes < _writebuf_chunk && 
+    if (nbytes < _writebuf_chunk && !write_pending() &&
         tnow - _last_write_time < 2000UL) {
         // write in _writebuf_chunk-sized chunks, but always write at
         // least once per 2 seconds if data is available
@@ -949,6 +1244,25 @@ void AP_Logger_File::io_timer(void)
         write_fd_semaphore.give();
         return;
     }
+
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    if (_compress != nullptr) {
+        // compress the next chunk once the last frame is written
+        // out. This is done holding the semaphore so stop_logging()
+        // sees whole frames when it writes the trailer
+        if (_frame_len == 0) {
+            last_io_operation = "compress";
+            _frame_len = _compress->compress_frame(head, nbytes, _frame);
+            _frame_ofs = 0;
+            _writebuf.advance(nbytes);
+            _write_raw_offset += nbytes;
+            last_io_operation = "write";
+        }
+        head = &_frame[_frame_ofs];
+        nbytes = _frame_len - _frame_ofs;
+    }
+#endif
+
     ssize_t nwritten = AP::FS().write(_write_fd, head, nbytes);
     last_io_operation = "";
     if (nwritten <= 0) {
@@ -968,7 +1282,17 @@ void AP_Logger_File::io_timer(void)
         _last_write_failed = false;
         _last_write_ms = tnow;
         _write_offset += nwritten;
-        _writebuf.advance(nwritten);
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+        if (_compress != nullptr) {
+            _frame_ofs += nwritten;
+            if (_frame_ofs == _frame_len) {
+                _frame_len = 0;
+            }
+        } else
+#endif
+        {
+            _writebuf.advance(nwritten);
+        }
         /*
           the best strategy for minimizing corruption on microSD cards
           seems to be to write in 4k chunks and fsync the file on each
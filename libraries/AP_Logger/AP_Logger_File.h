@@ -12,6 +12,7 @@
 
 #include <AP_HAL/utility/RingBuffer.h>
 #include "AP_Logger_Backend.h"
+#include "AP_Logger_Compress.h"
 
 class AP_Logger_File : public AP_Logger_Backend
 {
@@ -71,7 +72,11 @@ private:
     
     int _read_fd;
     uint16_t _read_fd_log_num;
+    // file offset of the end of the data in _readbuf
     uint32_t _read_offset;
+    bool _read_eof;
+    // the IO thread failed to read the log being downloaded
+    bool _read_error;
     uint32_t _write_offset;
     volatile uint32_t _open_error_ms;
     const char *_log_directory;
@@ -100,12 +105,53 @@ private:
     const uint16_t _writebuf_chunk;
     uint32_t _last_write_time;
 
+    // read-ahead buffer for log download, filled from the IO thread
+    ByteBuffer _readbuf;
+    bool fill_read_buffer(void);
+    uint16_t read_buffered(uint32_t skip, uint8_t *data, uint16_t len);
+    void close_read_fd(void);
+
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    // compressor for logs being written, nullptr if not compressing
+    AP_Logger_Compress *_compress;
+    // the frame being written and how much of it has been written
+    uint8_t *_frame;
+    uint32_t _frame_len;
+    uint32_t _frame_ofs;
+    // length of the log stream written to the current log
+    uint32_t _write_raw_offset;
+
+    // frame buffers for downloading a compressed log
+    bool _read_compressed;
+    uint8_t *_read_frame_data;
+    uint8_t *_read_frame_raw;
+    bool open_read_compressed(void);
+
+    // length of the log stream of each log by log number, valid
+    // while the file is file_size long
+    struct DataSizeCacheEntry {
+        uint32_t file_size;
+        uint32_t data_size;
+    };
+    DataSizeCacheEntry *_data_size_cache;
+#endif
+
+    // true if a compressed frame is part way through being written
+    bool write_pending(void) const {
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+        return _frame_len != 0;
+#else
+        return false;
+#endif
+    }
+
     /* construct a file name given a log number. Caller must free. */
     char *_log_file_name(const uint16_t log_num) const;
     char *_log_file_name_long(const uint16_t log_num) const;
     char *_log_file_name_short(const uint16_t log_num) const;
     char *_lastlog_file_name() const;
     uint32_t _get_log_size(const uint16_t log_num);
+    uint32_t _get_log_data_size(const uint16_t log_num);
     uint32_t _get_log_time(const uint16_t log_num);
 
     void stop_logging(void) override;
@@ -125,7 +171,10 @@ private:
     // can open/close files without causing the backend to write to a
     // bad fd
     HAL_Semaphore write_fd_semaphore;
-    
+    // read_semaphore mediates access to read_fd and the read-ahead
+    // buffer between the frontend and the IO thread
+    HAL_Semaphore read_semaphore;
+
     // performance counters
     AP_HAL::Util::perf_counter_t  _perf_write;
     AP_HAL::Util::perf_counter_t  _perf_fsync;
@@ -138,7 +138,12 @@ void AP_Logger::handle_log_request_data(GCS_MAVLINK &link, const mavlink_message
 
         uint32_t end;
         get_log_boundaries(packet.id, _log_data_page, end);
+
+        _log_send_stats.start_ms = AP_HAL::millis();
+        _log_send_stats.bytes = 0;
+        _log_send_stats.requests = 0;
     }
+    _log_send_stats.requests++;
 
     _log_data_offset = packet.ofs;
     if (_log_data_offset >= _log_data_size) {
@@ -212,7 +217,7 @@ void AP_Logger::handle_log_sending()
 
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
     // assume USB speeds in SITL for the purposes of log download
-    const uint8_t num_sends = 40;
+    uint8_t num_sends = 250;
 #else
     uint8_t num_sends = 1;
     if (_log_sending_link->is_high_bandwidth() && hal.gpio->usb_connected()) {
@@ -227,6 +232,10 @@ void AP_Logger::handle_log_sending()
     }
 #endif
 
+    // don't try to send more than the link can take this time
+    const mavlink_channel_t chan = _log_sending_link->get_chan();
+    num_sends = MIN(uint32_t(num_sends), comm_get_txspace(chan) / PAYLOAD_SIZE(chan, LOG_DATA));
+
     for (uint8_t i=0; i<num_sends; i++) {
         if (transfer_activity != TransferActivity::SENDING) {
             // may have completed sending data
@@ -321,9 +330,34 @@ bool AP_Logger::handle_log_send_data()
 
     _log_data_offset += nbytes;
     _log_data_remaining -= nbytes;
+    _log_send_stats.bytes += nbytes;
+    if (nbytes < MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN) {
+        // reached the end of the log
+        handle_log_send_stats();
+    }
     if (nbytes < MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN || _log_data_remaining == 0) {
         transfer_activity = TransferActivity::IDLE;
         _log_sending_link = nullptr;
     }
     return true;
 }
+
+/**
+   report the throughput of a log download to the GCS
+ */
+void AP_Logger::handle_log_send_stats()
+{
+    // small logs are sent too quickly for a useful rate
+    if (_log_send_stats.bytes < 65536) {
+        return;
+    }
+    const uint32_t dt_ms = MAX(AP_HAL::millis() - _log_send_stats.start_ms, 1U);
+    _log_sending_link->send_text(MAV_SEVERITY_INFO, "Log %u: %u bytes in %.1fs (%uB/s, %u requests)",
+                                 unsigned(_log_num_data),
+                                 unsigned(_log_send_stats.bytes),
+                                 (double)(dt_ms * 0.001f),
+                                 unsigned((uint64_t(_log_send_stats.bytes) * 1000U) / dt_ms),
+                                 unsigned(_log_send_stats.requests));
+    // only report once per log
+    _log_send_stats.bytes = 0;
+}
@@ -0,0 +1,82 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AP_Logger_RateLimiter.h"
+
+#if HAL_LOGGER_RATE_LIMIT_ENABLED
+
+#include <AP_Math/AP_Math.h>
+#include <AP_Scheduler/AP_Scheduler.h>
+
+AP_Logger_RateLimiter::AP_Logger_RateLimiter(const AP_Float &rate_max, const AP_Float &disarmed_rate_max) :
+    _rate_max(rate_max),
+    _disarmed_rate_max(disarmed_rate_max)
+{
+}
+
+/*
+  convert a rate limit to a number of ticks between writes
+ */
+static uint16_t rate_to_interval(float rate_hz, uint16_t loop_rate_hz)
+{
+    if (rate_hz <= 0 || loop_rate_hz == 0) {
+        return 0;
+    }
+    return constrain_float(loop_rate_hz / rate_hz, 0, UINT16_MAX);
+}
+
+void AP_Logger_RateLimiter::update(uint16_t loop_rate_hz)
+{
+    _interval = rate_to_interval(_rate_max, loop_rate_hz);
+    _disarmed_interval = rate_to_interval(_disarmed_rate_max, loop_rate_hz);
+}
+
+bool AP_Logger_RateLimiter::should_log(uint8_t msg_type, bool armed)
+{
+    const uint16_t interval = (!armed && _disarmed_interval != 0) ? _disarmed_interval : _interval;
+    if (interval <= 1 || exempt.get(msg_type)) {
+        return true;
+    }
+    const uint16_t now = AP::scheduler().ticks();
+    if (now != last_tick[msg_type] && uint16_t(now - last_tick[msg_type]) < interval) {
+        if (decimated[msg_type] < UINT16_MAX) {
+            decimated[msg_type]++;
+        }
+        return false;
+    }
+    last_tick[msg_type] = now;
+    return true;
+}
+
+void AP_Logger_RateLimiter::note_dropped(uint8_t msg_type)
+{
+    if (dropped[msg_type] < UINT16_MAX) {
+        dropped[msg_type]++;
+    }
+}
+
+bool AP_Logger_RateLimiter::take_counts(uint8_t msg_type, uint16_t &_decimated, uint16_t &_dropped)
+{
+    _decimated = decimated[msg_type];
+    _dropped = dropped[msg_type];
+    if (_decimated == 0 && _dropped == 0) {
+        return false;
+    }
+    decimated[msg_type] = 0;
+    dropped[msg_type] = 0;
+    return true;
+}
+
+#endif // HAL_LOGGER_RATE_LIMIT_ENABLED
@@ -0,0 +1,80 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  per message type rate limiting for the AP_Logger front end
+
+  Each message type is limited to a maximum rate, measured in
+  scheduler ticks so that limits line up with the main loop. All
+  writes of a type in the tick in which it was last written are
+  allowed, so multi-instance messages (IMU, BARO, GPS, ...) and the
+  several writes a loop makes of a type are kept or decimated
+  together.
+
+  Critical and Replay messages are never limited, nor are the message
+  types marked exempt.
+ */
+#pragma once
+
+#include <AP_Common/Bitmask.h>
+#include <AP_HAL/AP_HAL_Boards.h>
+#include <AP_Param/AP_Param.h>
+
+#ifndef HAL_LOGGER_RATE_LIMIT_ENABLED
+#define HAL_LOGGER_RATE_LIMIT_ENABLED (HAL_MEM_CLASS >= HAL_MEM_CLASS_300)
+#endif
+
+#if HAL_LOGGER_RATE_LIMIT_ENABLED
+
+class AP_Logger_RateLimiter
+{
+public:
+    AP_Logger_RateLimiter(const AP_Float &rate_max, const AP_Float &disarmed_rate_max);
+
+    // messages of this type are never limited
+    void set_exempt(uint8_t msg_type) { exempt.set(msg_type); }
+
+    // return true if a message of this type should be written now
+    bool should_log(uint8_t msg_type, bool armed);
+
+    // note a message of this type dropped by a backend
+    void note_dropped(uint8_t msg_type);
+
+    /*
+      get and clear the counts of messages of a type which were
+      decimated or dropped. Returns false if there were none
+     */
+    bool take_counts(uint8_t msg_type, uint16_t &decimated, uint16_t &dropped);
+
+    // pick up changes to the limits and the loop rate
+    void update(uint16_t loop_rate_hz);
+
+private:
+    const AP_Float &_rate_max;
+    const AP_Float &_disarmed_rate_max;
+
+    // minimum scheduler ticks between writes of a type, 0 for no limit
+    uint16_t _interval;
+    uint16_t _disarmed_interval;
+
+    Bitmask<256> exempt;
+
+    // scheduler tick of the last write of each type
+    uint16_t last_tick[256];
+
+    uint16_t decimated[256];
+    uint16_t dropped[256];
+};
+
+#endif // HAL_LOGGER_RATE_LIMIT_ENABLED
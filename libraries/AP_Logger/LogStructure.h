@@ -191,6 +191,14 @@ struct PACKED log_DSF {
     uint32_t buf_space_avg;
 };
 
+struct PACKED log_Rate_Stats {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint8_t id;
+    uint16_t decimated;
+    uint16_t dropped;
+};
+
 struct PACKED log_Event {
     LOG_PACKET_HEADER;
     uint64_t time_us;
@@ -279,6 +287,36 @@ struct PACKED log_ISBD {
 };
 static_assert(sizeof(log_ISBD) < 256, "log_ISBD is over-size");
 
+// a block of continuously streamed IMU samples. Element 0 of each
+// axis is the sample divided by the axis scale, the rest are
+// differences from the previous element
+struct PACKED log_ISBS {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint8_t instance;
+    uint8_t sensor_type; // e.g. GYRO or ACCEL
+    uint16_t seqno;
+    uint64_t sample_us; // time of the first sample in the block
+    float sample_rate_hz;
+    float scale_x, scale_y, scale_z;
+    int16_t x[32];
+    int16_t y[32];
+    int16_t z[32];
+};
+static_assert(sizeof(log_ISBS) < 256, "log_ISBS is over-size");
+
+struct PACKED log_ISST {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint8_t instance;
+    uint8_t sensor_type;
+    uint16_t seqno;
+    uint32_t samples_logged;
+    uint32_t samples_dropped;
+    uint32_t samples_discarded;
+    uint8_t queued;
+};
+
 struct PACKED log_Vibe {
     LOG_PACKET_HEADER;
     uint64_t time_us;
@@ -1071,6 +1109,16 @@ struct PACKED log_PSC {
 #define ISBD_UNITS  "s--ooo"
 #define ISBD_MULTS  "F--???"
 
+#define ISBS_LABELS "TimeUS,I,T,N,SampleUS,smp_rate,SX,SY,SZ,x,y,z"
+#define ISBS_FMT    "QBBHQffffaaa"
+#define ISBS_UNITS  "s#--sz------"
+#define ISBS_MULTS  "F---F-------"
+
+#define ISST_LABELS "TimeUS,I,T,N,Smp,Drop,Part,QLen"
+#define ISST_FMT    "QBBHIIIB"
+#define ISST_UNITS  "s#------"
+#define ISST_MULTS  "F-------"
+
 #define PID_LABELS "TimeUS,Tar,Act,Err,P,I,D,FF,Dmod,Limit"
 #define PID_FMT    "QffffffffB"
 #define PID_UNITS  "s---------"
@@ -1278,6 +1326,13 @@ struct PACKED log_PSC {
 // @Field: FMx: Maximum free space in write buffer in last time period
 // @Field: FAv: Average free space in write buffer in last time period
 
+// @LoggerMessage: DSFT
+// @Description: Onboard logging per message type statistics, written for each message type with messages not logged in the last second
+// @Field: TimeUS: Time since system startup
+// @Field: Id: Message type ID
+// @Field: Dec: Number of messages not logged due to the LOG_RATEMAX and LOG_DARM_RATEMAX limits
+// @Field: Dp: Number of messages rejected by a backend for lack of space
+
 // @LoggerMessage: DSTL
 // @Description: Deepstall Landing data
 // @Field: TimeUS: Time since system startup
@@ -2006,6 +2061,10 @@ struct PACKED log_PSC {
       "ISBH",ISBH_FMT,ISBH_LABELS,ISBH_UNITS,ISBH_MULTS },  \
     { LOG_ISBD_MSG, sizeof(log_ISBD), \
       "ISBD",ISBD_FMT,ISBD_LABELS, ISBD_UNITS, ISBD_MULTS }, \
+    { LOG_ISBS_MSG, sizeof(log_ISBS), \
+      "ISBS",ISBS_FMT,ISBS_LABELS, ISBS_UNITS, ISBS_MULTS }, \
+    { LOG_ISST_MSG, sizeof(log_ISST), \
+      "ISST",ISST_FMT,ISST_LABELS, ISST_UNITS, ISST_MULTS }, \
     { LOG_ORGN_MSG, sizeof(log_ORGN), \
       "ORGN","QBLLe","TimeUS,Type,Lat,Lng,Alt", "s-DUm", "F-GGB" },   \
 LOG_STRUCTURE_FROM_DAL \
@@ -2042,7 +2101,9 @@ LOG_STRUCTURE_FROM_NAVEKF3 \
     { LOG_WINCH_MSG, sizeof(log_Winch), \
       "WINC", "QBBBBBfffHfb", "TimeUS,Heal,ThEnd,Mov,Clut,Mode,DLen,Len,DRate,Tens,Vcc,Temp", "s-----mmn?vO", "F-----000000" }, \
     { LOG_PSC_MSG, sizeof(log_PSC), \
-      "PSC", "Qffffffffffff", "TimeUS,TPX,TPY,PX,PY,TVX,TVY,VX,VY,TAX,TAY,AX,AY", "smmmmnnnnoooo", "F000000000000" }
+      "PSC", "Qffffffffffff", "TimeUS,TPX,TPY,PX,PY,TVX,TVY,VX,VY,TAX,TAY,AX,AY", "smmmmnnnnoooo", "F000000000000" }, \
+    { LOG_RATE_STATS_MSG, sizeof(log_Rate_Stats), \
+      "DSFT", "QBHH", "TimeUS,Id,Dec,Dp", "s---", "F---" }
 
 // @LoggerMessage: SBPH
 // @Description: Swift Health Data
@@ -2173,6 +2234,9 @@ enum LogMessages : uint8_t {
     LOG_SIMPLE_AVOID_MSG,
     LOG_WINCH_MSG,
     LOG_PSC_MSG,
+    LOG_RATE_STATS_MSG,
+    LOG_ISBS_MSG,
+    LOG_ISST_MSG,
 
     _LOG_LAST_MSG_
 };
@@ -0,0 +1,142 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Logger/AP_Logger_Compress.h>
+#include <AP_Math/AP_Math.h>
+
+#include <stdio.h>
+
+/*
+  compression of 4k blocks, the chunk size the File backend writes,
+  of a stream of IMU, EKF and batch sampler like messages. The bytes
+  processed give the CPU cost per MB and the label the compression
+  ratio
+ */
+#define BLOCK_SIZE 4096
+#define STREAM_SIZE (256*1024)
+
+static uint8_t stream[STREAM_SIZE];
+
+static void append(uint32_t &ofs, const void *data, uint32_t len)
+{
+    len = MIN(len, STREAM_SIZE - ofs);
+    memcpy(&stream[ofs], data, len);
+    ofs += len;
+}
+
+static void make_stream(void)
+{
+    uint32_t ofs = 0;
+    uint64_t time_us = 0;
+    uint32_t seed = 1;
+    while (ofs < STREAM_SIZE) {
+        time_us += 2500;
+        for (uint8_t instance = 0; instance < 3; instance++) {
+            // IMU: header, time, instance, gyro, accel, error counts,
+            // temperature, health and rates
+            struct PACKED {
+                uint8_t head1, head2, msgid;
+                uint64_t time_us;
+                uint8_t instance;
+                float gyro[3];
+                float accel[3];
+                uint32_t gyro_error, accel_error;
+                float temperature;
+                uint8_t gyro_health, accel_health;
+                uint16_t gyro_rate, accel_rate;
+            } imu {};
+            imu.head1 = 0xA3;
+            imu.head2 = 0x95;
+            imu.msgid = 130;
+            imu.time_us = time_us;
+            imu.instance = instance;
+            for (uint8_t i = 0; i < 3; i++) {
+                seed = seed * 1103515245U + 12345U;
+                // sensor noise in the low bits
+                imu.gyro[i] = 0.01f * sinf(time_us * 1e-6f) + ((seed >> 20) & 0xF) * 1e-4f;
+                imu.accel[i] = (i == 2 ? -9.81f : 0.1f) + ((seed >> 12) & 0xF) * 1e-3f;
+            }
+            imu.temperature = 45.5f;
+            imu.gyro_health = imu.accel_health = 1;
+            imu.gyro_rate = imu.accel_rate = 400;
+            append(ofs, &imu, sizeof(imu));
+        }
+        // EKF replay style message with slowly changing states
+        struct PACKED {
+            uint8_t head1, head2, msgid;
+            uint64_t time_us;
+            uint8_t core;
+            int16_t roll, pitch;
+            uint16_t yaw;
+            float vel[3];
+            float pos[3];
+            int16_t gyro_bias[3];
+        } xkf {};
+        xkf.head1 = 0xA3;
+        xkf.head2 = 0x95;
+        xkf.msgid = 160;
+        xkf.time_us = time_us;
+        xkf.roll = 12;
+        xkf.pitch = -5;
+        xkf.yaw = uint16_t(time_us / 100000U) % 36000U;
+        for (uint8_t i = 0; i < 3; i++) {
+            xkf.vel[i] = time_us * 1e-7f;
+            xkf.pos[i] = time_us * 1e-6f;
+            xkf.gyro_bias[i] = 3;
+        }
+        append(ofs, &xkf, sizeof(xkf));
+    }
+}
+
+static void BM_CompressFrame(benchmark::State& state)
+{
+    static AP_Logger_Compress compress;
+    static uint8_t frame[AP_Logger_Compress::max_frame_size(BLOCK_SIZE)];
+    make_stream();
+    compress.init();
+
+    uint64_t raw_bytes = 0;
+    uint64_t frame_bytes = 0;
+    uint32_t ofs = 0;
+    while (state.KeepRunning()) {
+        const uint32_t len = compress.compress_frame(&stream[ofs], BLOCK_SIZE, frame);
+        gbenchmark_escape(frame);
+        raw_bytes += BLOCK_SIZE;
+        frame_bytes += len;
+        ofs = (ofs + BLOCK_SIZE) % STREAM_SIZE;
+    }
+
+    char label[32];
+    snprintf(label, sizeof(label), "ratio %.2f", frame_bytes ? double(raw_bytes) / frame_bytes : 0.0);
+    state.SetLabel(label);
+    state.SetBytesProcessed(raw_bytes);
+}
+
+static void BM_DecodeFrame(benchmark::State& state)
+{
+    static AP_Logger_Compress compress;
+    static uint8_t frame[STREAM_SIZE / BLOCK_SIZE][AP_Logger_Compress::max_frame_size(BLOCK_SIZE)];
+    static uint8_t out[BLOCK_SIZE];
+    make_stream();
+    compress.init();
+    for (uint32_t i = 0; i < STREAM_SIZE / BLOCK_SIZE; i++) {
+        compress.compress_frame(&stream[i * BLOCK_SIZE], BLOCK_SIZE, frame[i]);
+    }
+
+    uint64_t raw_bytes = 0;
+    uint32_t i = 0;
+    while (state.KeepRunning()) {
+        AP_Logger_Compress::FrameHeader hdr;
+        memcpy(&hdr, frame[i], sizeof(hdr));
+        bool ok = AP_Logger_Compress::decode_frame(hdr, &frame[i][sizeof(hdr)], out);
+        gbenchmark_escape(&ok);
+        gbenchmark_escape(out);
+        raw_bytes += BLOCK_SIZE;
+        i = (i + 1) % (STREAM_SIZE / BLOCK_SIZE);
+    }
+    state.SetBytesProcessed(raw_bytes);
+}
+
+BENCHMARK(BM_CompressFrame);
+BENCHMARK(BM_DecodeFrame);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,224 @@
+#include <AP_gtest.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <AP_Filesystem/AP_Filesystem.h>
+#include <AP_Logger/AP_Logger_Compress.h>
+#include <AP_Math/AP_Math.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#define TEST_LOG "test_logger_compress.bin"
+#define CHUNK_SIZE 4096
+#define RAW_SIZE 100000U
+#define MAX_FRAMES (RAW_SIZE / CHUNK_SIZE + 1)
+
+/*
+  a compressed log is written from a log-like stream: runs of
+  messages with slowly changing fields and a few random bytes
+ */
+class LoggerCompress : public ::testing::Test {
+protected:
+    void SetUp() override {
+        raw = (uint8_t *)malloc(RAW_SIZE);
+        ASSERT_NE(raw, nullptr);
+        uint32_t seed = 1;
+        for (uint32_t i = 0; i < RAW_SIZE; i += 32) {
+            seed = seed * 1103515245U + 12345U;
+            const uint8_t msg[32] = { 0xA3, 0x95, 0x81, uint8_t(i), uint8_t(i>>8), uint8_t(i>>16),
+                                      0, 0, 0x10, 0x20, 0x30, 0x40, uint8_t(seed>>16), uint8_t(seed>>24) };
+            memcpy(&raw[i], msg, MIN(uint32_t(sizeof(msg)), RAW_SIZE - i));
+        }
+        ASSERT_TRUE(compress.init());
+    }
+
+    void TearDown() override {
+        free(raw);
+        AP::FS().unlink(TEST_LOG);
+    }
+
+    // write raw as a compressed log, returning the file offset of each frame
+    void write_log(bool trailer) {
+        uint8_t frame[AP_Logger_Compress::max_frame_size(CHUNK_SIZE)];
+        const int fd = AP::FS().open(TEST_LOG, O_WRONLY|O_CREAT|O_TRUNC);
+        ASSERT_NE(fd, -1);
+        nframes = 0;
+        uint32_t file_ofs = 0;
+        for (uint32_t ofs = 0; ofs < RAW_SIZE; ofs += CHUNK_SIZE) {
+            const uint16_t len = MIN(uint32_t(CHUNK_SIZE), RAW_SIZE - ofs);
+            const uint32_t frame_len = compress.compress_frame(&raw[ofs], len, frame);
+            ASSERT_LE(frame_len, AP_Logger_Compress::max_frame_size(len));
+            ASSERT_EQ(AP::FS().write(fd, frame, frame_len), int32_t(frame_len));
+            frame_ofs[nframes++] = file_ofs;
+            file_ofs += frame_len;
+        }
+        frame_ofs[nframes] = file_ofs;
+        if (trailer) {
+            uint8_t t[AP_Logger_Compress::TRAILER_SIZE];
+            AP_Logger_Compress::trailer_frame(RAW_SIZE, t);
+            ASSERT_EQ(AP::FS().write(fd, t, sizeof(t)), int32_t(sizeof(t)));
+        }
+        AP::FS().close(fd);
+    }
+
+    void truncate_log(uint32_t len) {
+        ASSERT_EQ(truncate(TEST_LOG, len), 0);
+    }
+
+    // decode the whole log, returning the number of bytes which
+    // matched the raw stream
+    uint32_t read_log(void) {
+        uint8_t data[LOGGER_COMPRESS_BLOCK_MAX];
+        uint8_t out[LOGGER_COMPRESS_BLOCK_MAX];
+        const int fd = AP::FS().open(TEST_LOG, O_RDONLY);
+        EXPECT_NE(fd, -1);
+        EXPECT_TRUE(AP_Logger_Compress::is_compressed(fd));
+        uint32_t ofs = 0;
+        int32_t n;
+        while ((n = AP_Logger_Compress::read_frame(fd, data, out)) > 0) {
+            if (ofs + n > RAW_SIZE || memcmp(out, &raw[ofs], n) != 0) {
+                break;
+            }
+            ofs += n;
+        }
+        EXPECT_EQ(n, 0);
+        AP::FS().close(fd);
+        return ofs;
+    }
+
+    uint32_t raw_size(void) {
+        const int fd = AP::FS().open(TEST_LOG, O_RDONLY);
+        EXPECT_NE(fd, -1);
+        const uint32_t ret = AP_Logger_Compress::raw_size(fd);
+        AP::FS().close(fd);
+        return ret;
+    }
+
+    AP_Logger_Compress compress;
+    uint8_t *raw;
+    uint32_t frame_ofs[MAX_FRAMES+1];
+    uint8_t nframes;
+};
+
+TEST_F(LoggerCompress, block_round_trip)
+{
+    uint8_t dst[CHUNK_SIZE];
+    uint8_t out[CHUNK_SIZE];
+
+    // compressible data round trips and gets smaller
+    const uint32_t len = compress.compress_block(raw, CHUNK_SIZE, dst, sizeof(dst));
+    ASSERT_GT(len, 0U);
+    EXPECT_LT(len, uint32_t(CHUNK_SIZE/2));
+    EXPECT_EQ(AP_Logger_Compress::decompress_block(dst, len, out, sizeof(out)), CHUNK_SIZE);
+    EXPECT_EQ(memcmp(out, raw, CHUNK_SIZE), 0);
+
+    // short blocks are all literals
+    EXPECT_EQ(AP_Logger_Compress::decompress_block(dst, compress.compress_block(raw, 7, dst, sizeof(dst)), out, sizeof(out)), 7);
+    EXPECT_EQ(memcmp(out, raw, 7), 0);
+
+    // a corrupt block is rejected rather than overrunning out
+    dst[0] = 0xFF;
+    EXPECT_EQ(AP_Logger_Compress::decompress_block(dst, 3, out, sizeof(out)), -1);
+}
+
+TEST_F(LoggerCompress, incompressible_frame_is_stored)
+{
+    uint8_t frame[AP_Logger_Compress::max_frame_size(CHUNK_SIZE)];
+    uint8_t noise[CHUNK_SIZE];
+    uint8_t out[CHUNK_SIZE];
+    uint32_t seed = 7;
+    for (uint16_t i = 0; i < sizeof(noise); i++) {
+        seed = seed * 1103515245U + 12345U;
+        noise[i] = seed >> 16;
+    }
+    const uint32_t frame_len = compress.compress_frame(noise, sizeof(noise), frame);
+    EXPECT_EQ(frame_len, AP_Logger_Compress::max_frame_size(sizeof(noise)));
+
+    AP_Logger_Compress::FrameHeader hdr;
+    memcpy(&hdr, frame, sizeof(hdr));
+    EXPECT_TRUE(AP_Logger_Compress::header_valid(hdr));
+    EXPECT_TRUE(hdr.flags & AP_Logger_Compress::FRAME_FLAG_STORED);
+    EXPECT_TRUE(AP_Logger_Compress::decode_frame(hdr, &frame[sizeof(hdr)], out));
+    EXPECT_EQ(memcmp(out, noise, sizeof(noise)), 0);
+}
+
+TEST_F(LoggerCompress, log_round_trip)
+{
+    write_log(true);
+    EXPECT_EQ(read_log(), RAW_SIZE);
+    EXPECT_EQ(raw_size(), RAW_SIZE);
+
+    // without the trailer the size is found by walking the frames
+    truncate_log(frame_ofs[nframes]);
+    EXPECT_EQ(read_log(), RAW_SIZE);
+    EXPECT_EQ(raw_size(), RAW_SIZE);
+}
+
+TEST_F(LoggerCompress, torn_tail)
+{
+    write_log(false);
+    const uint32_t last_frame_raw = RAW_SIZE - (nframes-1) * CHUNK_SIZE;
+
+    // cut into the data of the last frame, its header is still there
+    truncate_log(frame_ofs[nframes] - 10);
+    EXPECT_EQ(read_log(), RAW_SIZE - last_frame_raw);
+    EXPECT_EQ(raw_size(), RAW_SIZE - last_frame_raw);
+
+    // cut into the header of the last frame
+    truncate_log(frame_ofs[nframes-1] + 3);
+    EXPECT_EQ(read_log(), RAW_SIZE - last_frame_raw);
+    EXPECT_EQ(raw_size(), RAW_SIZE - last_frame_raw);
+}
+
+TEST_F(LoggerCompress, corrupt_frame)
+{
+    write_log(true);
+
+    // damage the data of the third frame
+    const int fd = AP::FS().open(TEST_LOG, O_RDWR);
+    ASSERT_NE(fd, -1);
+    uint8_t b;
+    const uint32_t ofs = frame_ofs[2] + sizeof(AP_Logger_Compress::FrameHeader) + 5;
+    ASSERT_EQ(AP::FS().lseek(fd, ofs, SEEK_SET), int32_t(ofs));
+    ASSERT_EQ(AP::FS().read(fd, &b, 1), 1);
+    b ^= 0xFF;
+    ASSERT_EQ(AP::FS().lseek(fd, ofs, SEEK_SET), int32_t(ofs));
+    ASSERT_EQ(AP::FS().write(fd, &b, 1), 1);
+    AP::FS().close(fd);
+
+    // the log ends before the bad frame
+    EXPECT_EQ(read_log(), 2U * CHUNK_SIZE);
+}
+
+TEST_F(LoggerCompress, skip_frames)
+{
+    uint8_t data[LOGGER_COMPRESS_BLOCK_MAX];
+    uint8_t out[LOGGER_COMPRESS_BLOCK_MAX];
+    write_log(true);
+
+    const int fd = AP::FS().open(TEST_LOG, O_RDONLY);
+    ASSERT_NE(fd, -1);
+
+    // stop at the frame holding the offset
+    uint32_t raw_pos = 0;
+    const uint32_t target = 5 * CHUNK_SIZE + 100;
+    ASSERT_TRUE(AP_Logger_Compress::skip_frames(fd, target, raw_pos));
+    EXPECT_EQ(raw_pos, 5U * CHUNK_SIZE);
+    EXPECT_EQ(AP::FS().lseek(fd, 0, SEEK_CUR), int32_t(frame_ofs[5]));
+    EXPECT_EQ(AP_Logger_Compress::read_frame(fd, data, out), CHUNK_SIZE);
+    EXPECT_EQ(memcmp(out, &raw[5 * CHUNK_SIZE], CHUNK_SIZE), 0);
+
+    // skipping past the end stops at the trailer
+    raw_pos = 0;
+    ASSERT_EQ(AP::FS().lseek(fd, 0, SEEK_SET), 0);
+    ASSERT_TRUE(AP_Logger_Compress::skip_frames(fd, UINT32_MAX, raw_pos));
+    EXPECT_EQ(raw_pos, RAW_SIZE);
+    EXPECT_EQ(AP_Logger_Compress::read_frame(fd, data, out), 0);
+
+    AP::FS().close(fd);
+}
+
+AP_GTEST_MAIN()
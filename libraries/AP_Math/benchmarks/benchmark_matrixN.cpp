@@ -0,0 +1,111 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AP_Math/matrixN.h>
+
+/*
+  the damped normal equations of the compass calibrator ellipsoid fit
+  and the accel calibrator, a 9x9 symmetric positive definite system
+ */
+static MatrixN<float,9> normal_matrix(void)
+{
+    MatrixN<float,9> JTJ;
+    for (uint8_t k = 0; k < 20; k++) {
+        VectorN<float,9> jacob;
+        for (uint8_t i = 0; i < 9; i++) {
+            jacob[i] = sinf(k * 9 + i);
+        }
+        MatrixN<float,9> outer;
+        outer.mult(jacob, jacob);
+        JTJ += outer;
+    }
+    for (uint8_t i = 0; i < 9; i++) {
+        JTJ(i,i) += 0.1f;
+    }
+    return JTJ;
+}
+
+static void BM_MatInverse9(benchmark::State& state)
+{
+    const MatrixN<float,9> JTJ = normal_matrix();
+    float m[81], inv[81];
+    for (uint8_t i = 0; i < 9; i++) {
+        for (uint8_t j = 0; j < 9; j++) {
+            m[i*9+j] = JTJ(i,j);
+        }
+    }
+
+    while (state.KeepRunning()) {
+        bool ok = inverse(m, inv, 9);
+        gbenchmark_escape(&ok);
+        gbenchmark_escape(inv);
+    }
+}
+
+static void BM_InverseSymmetric9(benchmark::State& state)
+{
+    const MatrixN<float,9> JTJ = normal_matrix();
+    MatrixN<float,9> inv;
+
+    while (state.KeepRunning()) {
+        bool ok = JTJ.inverse_symmetric(inv);
+        gbenchmark_escape(&ok);
+        gbenchmark_escape(&inv);
+    }
+}
+
+static void BM_SolveSymmetric9(benchmark::State& state)
+{
+    const MatrixN<float,9> JTJ = normal_matrix();
+    VectorN<float,9> JTFI, step;
+    for (uint8_t i = 0; i < 9; i++) {
+        JTFI[i] = i + 1;
+    }
+
+    while (state.KeepRunning()) {
+        bool ok = JTJ.solve_symmetric(JTFI, step);
+        gbenchmark_escape(&ok);
+        gbenchmark_escape(&step);
+    }
+}
+
+static void BM_Cholesky9(benchmark::State& state)
+{
+    const MatrixN<float,9> JTJ = normal_matrix();
+    MatrixN<float,9> L;
+
+    while (state.KeepRunning()) {
+        bool ok = JTJ.cholesky(L);
+        gbenchmark_escape(&ok);
+        gbenchmark_escape(&L);
+    }
+}
+
+static void BM_MatrixNMultiply9(benchmark::State& state)
+{
+    const MatrixN<float,9> JTJ = normal_matrix();
+
+    while (state.KeepRunning()) {
+        MatrixN<float,9> m = JTJ * JTJ;
+        gbenchmark_escape(&m);
+    }
+}
+
+static void BM_MatrixNTransposeMultiply9(benchmark::State& state)
+{
+    const MatrixN<float,9> JTJ = normal_matrix();
+
+    while (state.KeepRunning()) {
+        MatrixN<float,9> m = JTJ.transpose_mul(JTJ);
+        gbenchmark_escape(&m);
+    }
+}
+
+BENCHMARK(BM_MatInverse9);
+BENCHMARK(BM_InverseSymmetric9);
+BENCHMARK(BM_SolveSymmetric9);
+BENCHMARK(BM_Cholesky9);
+BENCHMARK(BM_MatrixNMultiply9);
+BENCHMARK(BM_MatrixNTransposeMultiply9);
+
+BENCHMARK_MAIN();
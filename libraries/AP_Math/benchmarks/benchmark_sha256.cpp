@@ -0,0 +1,78 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Math/sha256.h>
+
+#include <string.h>
+
+/*
+  SHA-256 throughput on 4k buffers, and the cost of signing a MAVLink2
+  packet with a 28 byte ATTITUDE sized payload, with the accelerated
+  block compression where the CPU has it and the portable one
+ */
+
+static void sha256_buffer(benchmark::State& state, bool portable_only)
+{
+    static uint8_t buf[4096];
+    uint8_t digest[SHA256::DIGEST_LEN];
+    SHA256::set_portable_only(portable_only);
+    while (state.KeepRunning()) {
+        SHA256::hash(buf, sizeof(buf), digest);
+        gbenchmark_escape(digest);
+    }
+    state.SetLabel(SHA256::implementation());
+    state.SetBytesProcessed(uint64_t(state.iterations()) * sizeof(buf));
+    SHA256::set_portable_only(false);
+}
+
+static void sha256_sign(benchmark::State& state, bool portable_only)
+{
+    uint8_t key[32] {};
+    uint8_t header[10] {};
+    uint8_t payload[28] {};
+    uint8_t crc[2] {};
+    uint8_t link_id_timestamp[7] {};
+    uint8_t signature[6];
+
+    SHA256::set_portable_only(portable_only);
+    SHA256 keyed;
+    keyed.update(key, sizeof(key));
+    while (state.KeepRunning()) {
+        SHA256 ctx = keyed;
+        ctx.update(header, sizeof(header));
+        ctx.update(payload, sizeof(payload));
+        ctx.update(crc, sizeof(crc));
+        ctx.update(link_id_timestamp, sizeof(link_id_timestamp));
+        ctx.final_48(signature);
+        gbenchmark_escape(signature);
+        link_id_timestamp[1]++;
+    }
+    state.SetLabel(SHA256::implementation());
+    SHA256::set_portable_only(false);
+}
+
+static void BM_SHA256Buffer(benchmark::State& state)
+{
+    sha256_buffer(state, false);
+}
+
+static void BM_SHA256BufferPortable(benchmark::State& state)
+{
+    sha256_buffer(state, true);
+}
+
+static void BM_MAVLinkSign(benchmark::State& state)
+{
+    sha256_sign(state, false);
+}
+
+static void BM_MAVLinkSignPortable(benchmark::State& state)
+{
+    sha256_sign(state, true);
+}
+
+BENCHMARK(BM_SHA256Buffer);
+BENCHMARK(BM_SHA256BufferPortable);
+BENCHMARK(BM_MAVLinkSign);
+BENCHMARK(BM_MAVLinkSignPortable);
+
+BENCHMARK_MAIN();
@@ -4,6 +4,7 @@
 
 #pragma GCC optimize("O2")
 
+#include "AP_Math.h"
 #include "matrixN.h"
 
 
@@ -54,7 +55,228 @@ void MatrixN<T,N>::force_symmetry(void)
     }
 }
 
-template void MatrixN<float,4>::mult(const VectorN<float,4> &A, const VectorN<float,4> &B);
-template MatrixN<float,4> &MatrixN<float,4>::operator -=(const MatrixN<float,4> &B);
-template MatrixN<float,4> &MatrixN<float,4>::operator +=(const MatrixN<float,4> &B);
-template void MatrixN<float,4>::force_symmetry(void);
+// set to the identity matrix
+template <typename T, uint8_t N>
+void MatrixN<T,N>::identity(void)
+{
+    memset(v, 0, sizeof(v));
+    for (uint8_t i = 0; i < N; i++) {
+        v[i][i] = 1;
+    }
+}
+
+// multiply by B
+template <typename T, uint8_t N>
+MatrixN<T,N> MatrixN<T,N>::operator *(const MatrixN<T,N> &B) const
+{
+    MatrixN<T,N> ret;
+    for (uint8_t i = 0; i < N; i++) {
+        for (uint8_t k = 0; k < N; k++) {
+            const T a = v[i][k];
+            for (uint8_t j = 0; j < N; j++) {
+                ret.v[i][j] += a * B.v[k][j];
+            }
+        }
+    }
+    return ret;
+}
+
+// multiply by a vector
+template <typename T, uint8_t N>
+VectorN<T,N> MatrixN<T,N>::operator *(const VectorN<T,N> &b) const
+{
+    VectorN<T,N> ret;
+    for (uint8_t i = 0; i < N; i++) {
+        T sum = 0;
+        for (uint8_t j = 0; j < N; j++) {
+            sum += v[i][j] * b[j];
+        }
+        ret[i] = sum;
+    }
+    return ret;
+}
+
+// multiply the transpose by B
+template <typename T, uint8_t N>
+MatrixN<T,N> MatrixN<T,N>::transpose_mul(const MatrixN<T,N> &B) const
+{
+    MatrixN<T,N> ret;
+    for (uint8_t k = 0; k < N; k++) {
+        for (uint8_t i = 0; i < N; i++) {
+            const T a = v[k][i];
+            for (uint8_t j = 0; j < N; j++) {
+                ret.v[i][j] += a * B.v[k][j];
+            }
+        }
+    }
+    return ret;
+}
+
+// multiply the transpose by a vector
+template <typename T, uint8_t N>
+VectorN<T,N> MatrixN<T,N>::transpose_mul(const VectorN<T,N> &b) const
+{
+    VectorN<T,N> ret;
+    for (uint8_t k = 0; k < N; k++) {
+        for (uint8_t i = 0; i < N; i++) {
+            ret[i] += v[k][i] * b[k];
+        }
+    }
+    return ret;
+}
+
+/*
+  a pivot is treated as zero when it is lost in the rounding error of
+  the sum that produced it. The threshold is relative to the terms of
+  that sum, so it does not depend on how the parameters are scaled
+ */
+template <typename T, uint8_t N>
+static bool pivot_negligible(T pivot, T scale)
+{
+    return !(fabsf(pivot) > N * FLT_EPSILON * scale);
+}
+
+/*
+  Cholesky-Banachiewicz decomposition, only the lower triangle of the
+  matrix is used
+ */
+template <typename T, uint8_t N>
+bool MatrixN<T,N>::cholesky(MatrixN<T,N> &L) const
+{
+    L = MatrixN<T,N>();
+    for (uint8_t i = 0; i < N; i++) {
+        for (uint8_t j = 0; j <= i; j++) {
+            T sum = v[i][j];
+            for (uint8_t k = 0; k < j; k++) {
+                sum -= L.v[i][k] * L.v[j][k];
+            }
+            if (i == j) {
+                if (!(sum > 0) || pivot_negligible<T,N>(sum, v[i][i])) {
+                    return false;
+                }
+                L.v[i][i] = sqrtf(sum);
+            } else {
+                L.v[i][j] = sum / L.v[j][j];
+            }
+        }
+    }
+    return true;
+}
+
+/*
+  LDL^T decomposition, which avoids the square roots of Cholesky and
+  also works for symmetric indefinite matrices as long as no pivot is
+  negligible. Only the lower triangle of the matrix is used
+ */
+template <typename T, uint8_t N>
+bool MatrixN<T,N>::ldlt(MatrixN<T,N> &L, VectorN<T,N> &D) const
+{
+    L.identity();
+    for (uint8_t j = 0; j < N; j++) {
+        T d = v[j][j];
+        T scale = fabsf(d);
+        for (uint8_t k = 0; k < j; k++) {
+            const T t = L.v[j][k] * L.v[j][k] * D[k];
+            d -= t;
+            scale += fabsf(t);
+        }
+        if (pivot_negligible<T,N>(d, scale) || isinf(d)) {
+            return false;
+        }
+        D[j] = d;
+        for (uint8_t i = j+1; i < N; i++) {
+            T sum = v[i][j];
+            for (uint8_t k = 0; k < j; k++) {
+                sum -= L.v[i][k] * L.v[j][k] * D[k];
+            }
+            L.v[i][j] = sum / d;
+        }
+    }
+    return true;
+}
+
+// solve L*D*L^T*x = b by forward and back substitution
+template <typename T, uint8_t N>
+void MatrixN<T,N>::ldlt_solve(const MatrixN<T,N> &L, const VectorN<T,N> &D, const VectorN<T,N> &b, VectorN<T,N> &x)
+{
+    for (uint8_t i = 0; i < N; i++) {
+        T sum = b[i];
+        for (uint8_t k = 0; k < i; k++) {
+            sum -= L.v[i][k] * x[k];
+        }
+        x[i] = sum;
+    }
+    for (uint8_t i = 0; i < N; i++) {
+        x[i] /= D[i];
+    }
+    for (int8_t i = N-1; i >= 0; i--) {
+        T sum = x[i];
+        for (uint8_t k = i+1; k < N; k++) {
+            sum -= L.v[k][i] * x[k];
+        }
+        x[i] = sum;
+    }
+}
+
+// solve A*x = b for a symmetric matrix
+template <typename T, uint8_t N>
+bool MatrixN<T,N>::solve_symmetric(const VectorN<T,N> &b, VectorN<T,N> &x) const
+{
+    MatrixN<T,N> L;
+    VectorN<T,N> D;
+    if (!ldlt(L, D)) {
+        return false;
+    }
+    ldlt_solve(L, D, b, x);
+    for (uint8_t i = 0; i < N; i++) {
+        if (isnan(x[i]) || isinf(x[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// inverse of a symmetric matrix, solving for one column at a time
+template <typename T, uint8_t N>
+bool MatrixN<T,N>::inverse_symmetric(MatrixN<T,N> &inv) const
+{
+    MatrixN<T,N> L;
+    VectorN<T,N> D;
+    if (!ldlt(L, D)) {
+        return false;
+    }
+    for (uint8_t j = 0; j < N; j++) {
+        VectorN<T,N> e;
+        VectorN<T,N> x;
+        e[j] = 1;
+        ldlt_solve(L, D, e, x);
+        // the result is symmetric, keep the lower triangle
+        for (uint8_t i = j; i < N; i++) {
+            if (isnan(x[i]) || isinf(x[i])) {
+                return false;
+            }
+            inv.v[i][j] = x[i];
+            inv.v[j][i] = x[i];
+        }
+    }
+    return true;
+}
+
+#define MATRIXN_INSTANTIATE(T, N) \
+template void MatrixN<T,N>::mult(const VectorN<T,N> &A, const VectorN<T,N> &B); \
+template MatrixN<T,N> &MatrixN<T,N>::operator -=(const MatrixN<T,N> &B); \
+template MatrixN<T,N> &MatrixN<T,N>::operator +=(const MatrixN<T,N> &B); \
+template void MatrixN<T,N>::force_symmetry(void); \
+template void MatrixN<T,N>::identity(void); \
+template MatrixN<T,N> MatrixN<T,N>::operator *(const MatrixN<T,N> &B) const; \
+template VectorN<T,N> MatrixN<T,N>::operator *(const VectorN<T,N> &b) const; \
+template MatrixN<T,N> MatrixN<T,N>::transpose_mul(const MatrixN<T,N> &B) const; \
+template VectorN<T,N> MatrixN<T,N>::transpose_mul(const VectorN<T,N> &b) const; \
+template bool MatrixN<T,N>::cholesky(MatrixN<T,N> &L) const; \
+template bool MatrixN<T,N>::ldlt(MatrixN<T,N> &L, VectorN<T,N> &D) const; \
+template bool MatrixN<T,N>::solve_symmetric(const VectorN<T,N> &b, VectorN<T,N> &x) const; \
+template bool MatrixN<T,N>::inverse_symmetric(MatrixN<T,N> &inv) const;
+
+// sizes used by the compass (4 and 9 parameter) and accel calibrators
+MATRIXN_INSTANTIATE(float, 4)
+MATRIXN_INSTANTIATE(float, 9)
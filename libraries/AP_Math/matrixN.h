@@ -6,6 +6,7 @@
 
 #include "math.h"
 #include <stdint.h>
+#include <AP_Common/AP_Common.h>
 #include "vectorN.h"
 
 template <typename T, uint8_t N>
@@ -43,6 +44,42 @@ public:
     // Matrix symmetry routine
     void force_symmetry(void);
 
+    // element access
+    T &operator()(uint8_t i, uint8_t j) { return v[i][j]; }
+    const T &operator()(uint8_t i, uint8_t j) const { return v[i][j]; }
+
+    // set to the identity matrix
+    void identity(void);
+
+    // multiply by B
+    MatrixN<T,N> operator *(const MatrixN<T,N> &B) const;
+
+    // multiply by a vector
+    VectorN<T,N> operator *(const VectorN<T,N> &b) const;
+
+    // multiply the transpose by B, without forming the transpose
+    MatrixN<T,N> transpose_mul(const MatrixN<T,N> &B) const;
+    VectorN<T,N> transpose_mul(const VectorN<T,N> &b) const;
+
+    // Cholesky decomposition of a symmetric positive definite
+    // matrix, A = L*L^T. Returns false if not positive definite to
+    // working precision
+    bool cholesky(MatrixN<T,N> &L) const WARN_IF_UNUSED;
+
+    // LDL^T decomposition of a symmetric matrix, A = L*D*L^T with
+    // L unit lower triangular. Returns false if a pivot is negligible
+    // compared to the diagonal element it came from
+    bool ldlt(MatrixN<T,N> &L, VectorN<T,N> &D) const WARN_IF_UNUSED;
+
+    // solve A*x = b for a symmetric matrix using LDL^T
+    bool solve_symmetric(const VectorN<T,N> &b, VectorN<T,N> &x) const WARN_IF_UNUSED;
+
+    // inverse of a symmetric matrix using LDL^T
+    bool inverse_symmetric(MatrixN<T,N> &inv) const WARN_IF_UNUSED;
+
 private:
+    // solve L*D*L^T*x = b given the LDL^T decomposition
+    static void ldlt_solve(const MatrixN<T,N> &L, const VectorN<T,N> &D, const VectorN<T,N> &b, VectorN<T,N> &x);
+
     T v[N][N];
 };
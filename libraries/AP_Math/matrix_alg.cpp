@@ -63,173 +63,81 @@ static inline void swap(float &a, float &b)
 }
 
 /*
- *    calculates pivot matrix such that all the larger elements in the row are on diagonal
- *
- *    @param     A,           input matrix matrix
- *    @param     pivot
- *    @param     n,           dimenstion of square matrix
- *    @returns                false = matrix is Singular or non positive definite, true = matrix inversion successful
+ *    matrix inverse code for any square matrix using Gauss-Jordan
+ *    elimination with partial pivoting, in place in inv so no
+ *    temporary matrices are allocated. The row swaps are undone as
+ *    column swaps at the end
+ *    ref: https://en.wikipedia.org/wiki/Gaussian_elimination#Finding_the_inverse_of_a_matrix
+ *    @param     A,           input nxn matrix
+ *    @param     inv,         Output inverted nxn matrix, may be the same as A
+ *    @param     n,           dimension of square matrix
+ *    @returns                false = matrix is Singular, true = matrix inversion successful
  */
-
-static void mat_pivot(float* A, float* pivot, uint8_t n)
+static bool mat_inverse(float* A, float* inv, uint8_t n)
 {
-    for(uint8_t i = 0;i<n;i++){
-        for(uint8_t j=0;j<n;j++) {
-            pivot[i*n+j] = static_cast<float>(i==j);
-        }
+    uint8_t perm[UINT8_MAX];
+
+    if (inv != A) {
+        memcpy(inv, A, n*n*sizeof(float));
     }
 
-    for(uint8_t i = 0;i < n; i++) {
-        uint8_t max_j = i;
-        for(uint8_t j=i;j<n;j++){
-            if(fabsf(A[j*n + i]) > fabsf(A[max_j*n + i])) {
-                max_j = j;
+    for (uint8_t k = 0; k < n; k++) {
+        // pick the largest pivot in the column
+        uint8_t p = k;
+        for (uint8_t i = k+1; i < n; i++) {
+            if (fabsf(inv[i*n + k]) > fabsf(inv[p*n + k])) {
+                p = i;
             }
         }
-
-        if(max_j != i) {
-            for(uint8_t k = 0; k < n; k++) {
-                swap(pivot[i*n + k], pivot[max_j*n + k]);
-            }
+        // like the LU code this replaced, a singular matrix is found by
+        // the NaN/inf check at the end. Only a pivot too small to take
+        // the reciprocal of, which would trap in SITL, stops early
+        if (!(fabsf(inv[p*n + k]) >= FLT_MIN)) {
+            return false;
         }
-    }
-}
-
-/*
- *    calculates matrix inverse of Lower trangular matrix using forward substitution
- *
- *    @param     L,           lower triangular matrix
- *    @param     out,         Output inverted lower triangular matrix
- *    @param     n,           dimension of matrix
- */
-
-static void mat_forward_sub(float *L, float *out, uint8_t n)
-{
-    // Forward substitution solve LY = I
-    for(int i = 0; i < n; i++) {
-        out[i*n + i] = 1/L[i*n + i];
-        for (int j = i+1; j < n; j++) {
-            for (int k = i; k < j; k++) {
-                out[j*n + i] -= L[j*n + k] * out[k*n + i];
+        perm[k] = p;
+        if (p != k) {
+            for (uint8_t j = 0; j < n; j++) {
+                swap(inv[k*n + j], inv[p*n + j]);
             }
-            out[j*n + i] /= L[j*n + j];
         }
-    }
-}
 
-/*
- *    calculates matrix inverse of Upper trangular matrix using backward substitution
- *
- *    @param     U,           upper triangular matrix
- *    @param     out,         Output inverted upper triangular matrix
- *    @param     n,           dimension of matrix
- */
+        // scale the pivot row, the pivot element becomes its inverse
+        const float pivot_inv = 1.0f / inv[k*n + k];
+        inv[k*n + k] = 1.0f;
+        for (uint8_t j = 0; j < n; j++) {
+            inv[k*n + j] *= pivot_inv;
+        }
 
-static void mat_back_sub(float *U, float *out, uint8_t n)
-{
-    // Backward Substitution solve UY = I
-    for(int i = n-1; i >= 0; i--) {
-        out[i*n + i] = 1/U[i*n + i];
-        for (int j = i - 1; j >= 0; j--) {
-            for (int k = i; k > j; k--) {
-                out[j*n + i] -= U[j*n + k] * out[k*n + i];
+        // eliminate the column from the other rows
+        for (uint8_t i = 0; i < n; i++) {
+            if (i == k) {
+                continue;
+            }
+            const float f = inv[i*n + k];
+            inv[i*n + k] = 0.0f;
+            for (uint8_t j = 0; j < n; j++) {
+                inv[i*n + j] -= f * inv[k*n + j];
             }
-            out[j*n + i] /= U[j*n + j];
         }
     }
-}
 
-/*
- *    Decomposes square matrix into Lower and Upper triangular matrices such that
- *    A*P = L*U, where P is the pivot matrix
- *    ref: http://rosettacode.org/wiki/LU_decomposition
- *    @param     U,           upper triangular matrix
- *    @param     out,         Output inverted upper triangular matrix
- *    @param     n,           dimension of matrix
- */
-
-static void mat_LU_decompose(float* A, float* L, float* U, float *P, uint8_t n)
-{
-    memset(L,0,n*n*sizeof(float));
-    memset(U,0,n*n*sizeof(float));
-    memset(P,0,n*n*sizeof(float));
-    mat_pivot(A,P,n);
-
-    float *APrime = mat_mul(P,A,n);
-    for(uint8_t i = 0; i < n; i++) {
-        L[i*n + i] = 1;
-    }
-    for(uint8_t i = 0; i < n; i++) {
-        for(uint8_t j = 0; j < n; j++) {
-            if(j <= i) {    
-                U[j*n + i] = APrime[j*n + i];
-                for(uint8_t k = 0; k < j; k++) {
-                    U[j*n + i] -= L[j*n + k] * U[k*n + i]; 
-                }
-            }
-            if(j >= i) {
-                L[j*n + i] = APrime[j*n + i];
-                for(uint8_t k = 0; k < i; k++) {
-                    L[j*n + i] -= L[j*n + k] * U[k*n + i]; 
-                }
-                L[j*n + i] /= U[i*n + i];
+    // undo the row swaps
+    for (int16_t k = n-1; k >= 0; k--) {
+        if (perm[k] != k) {
+            for (uint8_t i = 0; i < n; i++) {
+                swap(inv[i*n + k], inv[i*n + perm[k]]);
             }
         }
     }
-    delete[] APrime;
-}
-
-/*
- *    matrix inverse code for any square matrix using LU decomposition
- *    inv = inv(U)*inv(L)*P, where L and U are triagular matrices and P the pivot matrix
- *    ref: http://www.cl.cam.ac.uk/teaching/1314/NumMethods/supporting/mcmaster-kiruba-ludecomp.pdf
- *    @param     m,           input 4x4 matrix
- *    @param     inv,      Output inverted 4x4 matrix
- *    @param     n,           dimension of square matrix
- *    @returns                false = matrix is Singular, true = matrix inversion successful
- */
-static bool mat_inverse(float* A, float* inv, uint8_t n)
-{
-    float *L, *U, *P;
-    bool ret = true;
-    L = new float[n*n];
-    U = new float[n*n];
-    P = new float[n*n];
-    mat_LU_decompose(A,L,U,P,n);
-
-    float *L_inv = new float[n*n];
-    float *U_inv = new float[n*n];
-
-    memset(L_inv,0,n*n*sizeof(float));
-    mat_forward_sub(L,L_inv,n);
-
-    memset(U_inv,0,n*n*sizeof(float));
-    mat_back_sub(U,U_inv,n);
-
-    // decomposed matrices no longer required
-    delete[] L;
-    delete[] U;
-
-    float *inv_unpivoted = mat_mul(U_inv,L_inv,n);
-    float *inv_pivoted = mat_mul(inv_unpivoted, P, n);
 
     //check sanity of results
-    for(uint8_t i = 0; i < n; i++) {
-        for(uint8_t j = 0; j < n; j++) {
-            if(isnan(inv_pivoted[i*n+j]) || isinf(inv_pivoted[i*n+j])){
-                ret = false;
-            }
+    for(uint16_t i = 0; i < n*n; i++) {
+        if(isnan(inv[i]) || isinf(inv[i])){
+            return false;
         }
     }
-    memcpy(inv,inv_pivoted,n*n*sizeof(float));
-
-    //free memory
-    delete[] inv_pivoted;
-    delete[] inv_unpivoted;
-    delete[] P;
-    delete[] U_inv;
-    delete[] L_inv;
-    return ret;
+    return true;
 }
 
 /*
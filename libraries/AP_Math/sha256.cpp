@@ -0,0 +1,333 @@
+/*
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+  SHA-256 with portable, x86 SHA extension and ARMv8 crypto extension
+  block compression
+ */
+
+#include "sha256.h"
+
+#include <string.h>
+#include <AP_HAL/utility/sparse-endian.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define SHA256_ARMV8 1
+#include <arm_neon.h>
+#endif
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t ror32(uint32_t x, uint8_t n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+/*
+  portable block compression
+ */
+static void compress_portable(uint32_t state[8], const uint8_t *blocks, size_t nblocks)
+{
+    while (nblocks--) {
+        uint32_t W[16];
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (uint8_t i=0; i<64; i++) {
+            uint32_t w;
+            if (i < 16) {
+                w = be32toh_ptr(&blocks[i*4]);
+            } else {
+                const uint32_t w15 = W[(i-15) & 15];
+                const uint32_t w2 = W[(i-2) & 15];
+                const uint32_t s0 = ror32(w15, 7) ^ ror32(w15, 18) ^ (w15 >> 3);
+                const uint32_t s1 = ror32(w2, 17) ^ ror32(w2, 19) ^ (w2 >> 10);
+                w = W[i & 15] + s0 + W[(i-7) & 15] + s1;
+            }
+            W[i & 15] = w;
+
+            const uint32_t S1 = ror32(e, 6) ^ ror32(e, 11) ^ ror32(e, 25);
+            const uint32_t ch = (e & f) ^ (~e & g);
+            const uint32_t t1 = h + S1 + ch + K[i] + w;
+            const uint32_t S0 = ror32(a, 2) ^ ror32(a, 13) ^ ror32(a, 22);
+            const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            const uint32_t t2 = S0 + maj;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+        blocks += SHA256::BLOCK_LEN;
+    }
+}
+
+#if SHA256_X86
+/*
+  block compression with the x86 SHA extensions. The state is held
+  as ABEF and CDGH, the order the instructions work in
+ */
+__attribute__((target("sha,sse4.1,ssse3")))
+static void compress_x86(uint32_t state[8], const uint8_t *blocks, size_t nblocks)
+{
+    const __m128i BSWAP = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_loadu_si128((const __m128i *)&state[0]);
+    __m128i state1 = _mm_loadu_si128((const __m128i *)&state[4]);
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);              // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);        // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);     // CDGH
+
+    while (nblocks--) {
+        const __m128i abef_save = state0;
+        const __m128i cdgh_save = state1;
+        __m128i m[4];
+
+        for (uint8_t i=0; i<16; i++) {
+            if (i < 4) {
+                m[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&blocks[i*16]), BSWAP);
+            } else {
+                __m128i w = _mm_sha256msg1_epu32(m[i & 3], m[(i-3) & 3]);
+                w = _mm_add_epi32(w, _mm_alignr_epi8(m[(i-1) & 3], m[(i-2) & 3], 4));
+                m[i & 3] = _mm_sha256msg2_epu32(w, m[(i-1) & 3]);
+            }
+            __m128i wk = _mm_add_epi32(m[i & 3], _mm_loadu_si128((const __m128i *)&K[i*4]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+            wk = _mm_shuffle_epi32(wk, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, wk);
+        }
+
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+        blocks += SHA256::BLOCK_LEN;
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);           // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);        // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);     // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);        // HGFE
+    _mm_storeu_si128((__m128i *)&state[0], state0);
+    _mm_storeu_si128((__m128i *)&state[4], state1);
+}
+
+static bool have_x86_sha(void)
+{
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) ||
+        !(ecx & bit_SSE4_1) || !(ecx & bit_SSSE3)) {
+        return false;
+    }
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (ebx & (1U<<29)) != 0;
+}
+#endif // SHA256_X86
+
+#if SHA256_ARMV8
+/*
+  block compression with the ARMv8 crypto extensions
+ */
+static void compress_armv8(uint32_t state[8], const uint8_t *blocks, size_t nblocks)
+{
+    uint32x4_t state0 = vld1q_u32(&state[0]);
+    uint32x4_t state1 = vld1q_u32(&state[4]);
+
+    while (nblocks--) {
+        const uint32x4_t abcd_save = state0;
+        const uint32x4_t efgh_save = state1;
+        uint32x4_t m[4];
+
+        for (uint8_t i=0; i<16; i++) {
+            if (i < 4) {
+                m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&blocks[i*16])));
+            } else {
+                m[i & 3] = vsha256su1q_u32(vsha256su0q_u32(m[i & 3], m[(i-3) & 3]),
+                                           m[(i-2) & 3], m[(i-1) & 3]);
+            }
+            const uint32x4_t wk = vaddq_u32(m[i & 3], vld1q_u32(&K[i*4]));
+            const uint32x4_t abcd = state0;
+            state0 = vsha256hq_u32(state0, state1, wk);
+            state1 = vsha256h2q_u32(state1, abcd, wk);
+        }
+
+        state0 = vaddq_u32(state0, abcd_save);
+        state1 = vaddq_u32(state1, efgh_save);
+        blocks += SHA256::BLOCK_LEN;
+    }
+
+    vst1q_u32(&state[0], state0);
+    vst1q_u32(&state[4], state1);
+}
+#endif // SHA256_ARMV8
+
+SHA256::compress_fn_t SHA256::compress_fn;
+
+SHA256::compress_fn_t SHA256::select_compress(void)
+{
+#if SHA256_X86
+    if (have_x86_sha()) {
+        return compress_x86;
+    }
+#endif
+#if SHA256_ARMV8
+    return compress_armv8;
+#else
+    return compress_portable;
+#endif
+}
+
+void SHA256::compress(uint32_t _state[8], const uint8_t *blocks, size_t nblocks)
+{
+    // selecting more than once in a race is harmless
+    if (compress_fn == nullptr) {
+        compress_fn = select_compress();
+    }
+    compress_fn(_state, blocks, nblocks);
+}
+
+const char *SHA256::implementation(void)
+{
+    if (compress_fn == nullptr) {
+        compress_fn = select_compress();
+    }
+#if SHA256_X86
+    if (compress_fn == compress_x86) {
+        return "x86-sha";
+    }
+#endif
+#if SHA256_ARMV8
+    if (compress_fn == compress_armv8) {
+        return "armv8-crypto";
+    }
+#endif
+    return "portable";
+}
+
+void SHA256::set_portable_only(bool portable_only)
+{
+    compress_fn = portable_only ? compress_portable : select_compress();
+}
+
+void SHA256::reset(void)
+{
+    state[0] = 0x6a09e667;
+    state[1] = 0xbb67ae85;
+    state[2] = 0x3c6ef372;
+    state[3] = 0xa54ff53a;
+    state[4] = 0x510e527f;
+    state[5] = 0x9b05688c;
+    state[6] = 0x1f83d9ab;
+    state[7] = 0x5be0cd19;
+    count = 0;
+}
+
+void SHA256::update(const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint8_t used = count % BLOCK_LEN;
+    count += len;
+
+    if (used != 0) {
+        const size_t n = len < size_t(BLOCK_LEN - used) ? len : size_t(BLOCK_LEN - used);
+        memcpy(&buf[used], p, n);
+        p += n;
+        len -= n;
+        used += n;
+        if (used < BLOCK_LEN) {
+            return;
+        }
+        compress(state, buf, 1);
+    }
+
+    // whole blocks straight from the caller's buffer
+    const size_t nblocks = len / BLOCK_LEN;
+    if (nblocks > 0) {
+        compress(state, p, nblocks);
+        p += nblocks * BLOCK_LEN;
+        len -= nblocks * BLOCK_LEN;
+    }
+
+    memcpy(buf, p, len);
+}
+
+/*
+  pad the last block with the length in bits
+ */
+void SHA256::finish(void)
+{
+    const uint64_t bits = count * 8;
+    uint8_t used = count % BLOCK_LEN;
+    buf[used++] = 0x80;
+    if (used > BLOCK_LEN - 8) {
+        memset(&buf[used], 0, BLOCK_LEN - used);
+        compress(state, buf, 1);
+        used = 0;
+    }
+    memset(&buf[used], 0, BLOCK_LEN - 8 - used);
+    put_be32_ptr(&buf[BLOCK_LEN-8], uint32_t(bits >> 32));
+    put_be32_ptr(&buf[BLOCK_LEN-4], uint32_t(bits));
+    compress(state, buf, 1);
+}
+
+void SHA256::final(uint8_t digest[DIGEST_LEN])
+{
+    finish();
+    for (uint8_t i=0; i<8; i++) {
+        put_be32_ptr(&digest[i*4], state[i]);
+    }
+}
+
+void SHA256::final_48(uint8_t digest[6])
+{
+    finish();
+    put_be32_ptr(&digest[0], state[0]);
+    digest[4] = state[1] >> 24;
+    digest[5] = state[1] >> 16;
+}
+
+void SHA256::hash(const void *data, size_t len, uint8_t digest[DIGEST_LEN])
+{
+    SHA256 ctx;
+    ctx.update(data, len);
+    ctx.final(digest);
+}
@@ -0,0 +1,72 @@
+/*
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+  SHA-256 (FIPS 180-4), as used for MAVLink2 packet signing
+
+  The block compression uses the SHA extensions of x86 CPUs which
+  have them, found at runtime, or the ARMv8 crypto extensions when
+  the build targets them. Everything else uses portable code.
+
+  A context may be copied, so a context which has absorbed a common
+  prefix such as a key can be reused as the start of many hashes.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+class SHA256
+{
+public:
+    static const uint8_t DIGEST_LEN = 32;
+    static const uint8_t BLOCK_LEN = 64;
+
+    SHA256() { reset(); }
+
+    // start a new hash
+    void reset(void);
+
+    // add data to the hash
+    void update(const void *data, size_t len);
+
+    // finish the hash. The context must be reset before reuse
+    void final(uint8_t digest[DIGEST_LEN]);
+
+    // finish the hash, giving the first 48 bits of the digest as
+    // used for MAVLink2 signatures
+    void final_48(uint8_t digest[6]);
+
+    // hash a buffer in one go
+    static void hash(const void *data, size_t len, uint8_t digest[DIGEST_LEN]);
+
+    // name of the block compression in use
+    static const char *implementation(void);
+
+    // use the portable block compression even where the CPU has
+    // SHA instructions, for testing and benchmarking
+    static void set_portable_only(bool portable_only);
+
+private:
+    uint32_t state[8];
+    uint64_t count;
+    uint8_t buf[BLOCK_LEN];
+
+    void finish(void);
+
+    typedef void (*compress_fn_t)(uint32_t state[8], const uint8_t *blocks, size_t nblocks);
+    static compress_fn_t compress_fn;
+    static compress_fn_t select_compress(void);
+    static void compress(uint32_t state[8], const uint8_t *blocks, size_t nblocks);
+};
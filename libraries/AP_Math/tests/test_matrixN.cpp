@@ -0,0 +1,207 @@
+#include <AP_gtest.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AP_Math/matrixN.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+/*
+  a 9x9 symmetric positive definite matrix like the damped normal
+  equations of the compass and accel calibrators
+ */
+static MatrixN<float,9> normal_matrix(void)
+{
+    MatrixN<float,9> JTJ;
+    for (uint8_t k = 0; k < 20; k++) {
+        VectorN<float,9> jacob;
+        for (uint8_t i = 0; i < 9; i++) {
+            jacob[i] = sinf(k * 9 + i);
+        }
+        MatrixN<float,9> outer;
+        outer.mult(jacob, jacob);
+        JTJ += outer;
+    }
+    for (uint8_t i = 0; i < 9; i++) {
+        JTJ(i,i) += 0.1f;
+    }
+    return JTJ;
+}
+
+template <uint8_t N>
+static void expect_identity(const MatrixN<float,N> &m, float accuracy)
+{
+    for (uint8_t i = 0; i < N; i++) {
+        for (uint8_t j = 0; j < N; j++) {
+            EXPECT_NEAR(i == j ? 1.0f : 0.0f, m(i,j), accuracy);
+        }
+    }
+}
+
+TEST(MatrixAlgTest, InverseKnown)
+{
+    // I - S, with S the upper shift, has all ones on and above the
+    // diagonal as its inverse
+    float m[25] {};
+    float inv[25];
+    for (uint8_t i = 0; i < 5; i++) {
+        m[i*5+i] = 1;
+        if (i < 4) {
+            m[i*5+i+1] = -1;
+        }
+    }
+    EXPECT_TRUE(inverse(m, inv, 5));
+    for (uint8_t i = 0; i < 5; i++) {
+        for (uint8_t j = 0; j < 5; j++) {
+            EXPECT_FLOAT_EQ(j >= i ? 1.0f : 0.0f, inv[i*5+j]);
+        }
+    }
+
+    // a scaled permutation has a zero diagonal, so needs pivoting
+    const float scale[5] = { 2, -4, 0.5f, 8, 1e-8f };
+    memset(m, 0, sizeof(m));
+    for (uint8_t i = 0; i < 5; i++) {
+        m[i*5 + (i+2)%5] = scale[i];
+    }
+    // in place
+    EXPECT_TRUE(inverse(m, m, 5));
+    for (uint8_t i = 0; i < 5; i++) {
+        for (uint8_t j = 0; j < 5; j++) {
+            const float expected = (i == (j+2)%5) ? 1 / scale[j] : 0;
+            EXPECT_FLOAT_EQ(expected, m[i*5+j]);
+        }
+    }
+}
+
+TEST(MatrixAlgTest, InverseNormalMatrix)
+{
+    const MatrixN<float,9> A = normal_matrix();
+    float m[81], inv[81];
+    for (uint8_t i = 0; i < 9; i++) {
+        for (uint8_t j = 0; j < 9; j++) {
+            m[i*9+j] = A(i,j);
+        }
+    }
+    EXPECT_TRUE(inverse(m, inv, 9));
+    MatrixN<float,9> I;
+    for (uint8_t i = 0; i < 9; i++) {
+        for (uint8_t j = 0; j < 9; j++) {
+            for (uint8_t k = 0; k < 9; k++) {
+                I(i,j) += m[i*9+k] * inv[k*9+j];
+            }
+        }
+    }
+    expect_identity(I, 1.0e-3f);
+}
+
+TEST(MatrixAlgTest, InverseSingular)
+{
+    float m[25] {};
+    float inv[25];
+    EXPECT_FALSE(inverse(m, inv, 5));
+
+    // two equal rows
+    for (uint8_t i = 0; i < 5; i++) {
+        for (uint8_t j = 0; j < 5; j++) {
+            m[i*5+j] = i == 3 ? j + 1 : (i + 1) * (j + 2) % 7;
+        }
+    }
+    for (uint8_t j = 0; j < 5; j++) {
+        m[1*5+j] = m[3*5+j];
+    }
+    EXPECT_FALSE(inverse(m, inv, 5));
+}
+
+TEST(MatrixNTest, Cholesky)
+{
+    const MatrixN<float,9> A = normal_matrix();
+    MatrixN<float,9> L;
+    EXPECT_TRUE(A.cholesky(L));
+
+    // L*L^T
+    MatrixN<float,9> LLT;
+    for (uint8_t i = 0; i < 9; i++) {
+        for (uint8_t j = 0; j < 9; j++) {
+            for (uint8_t k = 0; k < 9; k++) {
+                LLT(i,j) += L(i,k) * L(j,k);
+            }
+            EXPECT_NEAR(A(i,j), LLT(i,j), 1.0e-4f * A(i,i));
+        }
+    }
+}
+
+TEST(MatrixNTest, SolveSymmetric)
+{
+    const MatrixN<float,9> A = normal_matrix();
+    VectorN<float,9> x_true;
+    for (uint8_t i = 0; i < 9; i++) {
+        x_true[i] = i - 4.5f;
+    }
+    const VectorN<float,9> b = A * x_true;
+
+    VectorN<float,9> x;
+    EXPECT_TRUE(A.solve_symmetric(b, x));
+    for (uint8_t i = 0; i < 9; i++) {
+        EXPECT_NEAR(x_true[i], x[i], 1.0e-2f);
+    }
+
+    MatrixN<float,9> inv;
+    EXPECT_TRUE(A.inverse_symmetric(inv));
+    expect_identity(A * inv, 1.0e-3f);
+}
+
+TEST(MatrixNTest, SolveSymmetricScaled)
+{
+    // the pivot test is relative, so scaling the parameters, as the
+    // calibrators' offsets and diagonals are, must not matter
+    const float scale[4] = { 1e-4f, 1, 300, 1e-3f };
+    MatrixN<float,4> A;
+    for (uint8_t i = 0; i < 4; i++) {
+        for (uint8_t j = 0; j < 4; j++) {
+            A(i,j) = (i == j ? 4.0f : 1.0f) * scale[i] * scale[j];
+        }
+    }
+    VectorN<float,4> b, x;
+    for (uint8_t i = 0; i < 4; i++) {
+        b[i] = 7 * scale[i];
+    }
+    EXPECT_TRUE(A.solve_symmetric(b, x));
+    for (uint8_t i = 0; i < 4; i++) {
+        EXPECT_NEAR(1.0f, x[i] * scale[i], 1.0e-4f);
+    }
+
+    MatrixN<float,4> L;
+    EXPECT_TRUE(A.cholesky(L));
+}
+
+TEST(MatrixNTest, SolveSymmetricSingular)
+{
+    VectorN<float,9> b, x;
+    for (uint8_t i = 0; i < 9; i++) {
+        b[i] = 1;
+    }
+    MatrixN<float,9> L;
+    VectorN<float,9> D;
+    MatrixN<float,9> inv;
+
+    MatrixN<float,9> zero;
+    EXPECT_FALSE(zero.solve_symmetric(b, x));
+    EXPECT_FALSE(zero.cholesky(L));
+
+    // rank 3, so the later pivots are only rounding error
+    MatrixN<float,9> A;
+    for (uint8_t k = 0; k < 3; k++) {
+        VectorN<float,9> u;
+        for (uint8_t i = 0; i < 9; i++) {
+            u[i] = cosf(k * 9 + i) * 1000;
+        }
+        MatrixN<float,9> outer;
+        outer.mult(u, u);
+        A += outer;
+    }
+    EXPECT_FALSE(A.ldlt(L, D));
+    EXPECT_FALSE(A.solve_symmetric(b, x));
+    EXPECT_FALSE(A.inverse_symmetric(inv));
+    EXPECT_FALSE(A.cholesky(L));
+}
+
+AP_GTEST_MAIN()
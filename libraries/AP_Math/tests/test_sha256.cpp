@@ -0,0 +1,105 @@
+#include <AP_gtest.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AP_Math/sha256.h>
+
+#include <string.h>
+
+/*
+  known answer tests from FIPS 180-4 and NIST, run with both the
+  accelerated block compression, where the CPU has one, and the
+  portable one
+ */
+
+static void check_digest(const uint8_t *digest, const uint8_t *expected, uint8_t len)
+{
+    for (uint8_t i=0; i<len; i++) {
+        EXPECT_EQ(expected[i], digest[i]) << "byte " << unsigned(i);
+    }
+}
+
+static void known_answers(void)
+{
+    const struct {
+        const char *msg;
+        uint8_t digest[SHA256::DIGEST_LEN];
+    } vectors[] = {
+        { "",
+          { 0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24,
+            0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c, 0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55 } },
+        { "abc",
+          { 0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+            0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad } },
+        { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+          { 0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+            0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1 } },
+    };
+    for (const auto &v : vectors) {
+        uint8_t digest[SHA256::DIGEST_LEN];
+        SHA256::hash(v.msg, strlen(v.msg), digest);
+        check_digest(digest, v.digest, sizeof(digest));
+    }
+
+    // one million 'a', fed in uneven pieces to cross block boundaries
+    static const uint8_t million_a[SHA256::DIGEST_LEN] = {
+        0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92, 0x81, 0xa1, 0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67,
+        0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97, 0x20, 0x0e, 0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0 };
+    uint8_t chunk[200];
+    memset(chunk, 'a', sizeof(chunk));
+    SHA256 ctx;
+    uint32_t total = 0;
+    for (uint32_t i=0; total < 1000000; i++) {
+        const uint32_t n = MIN(1 + (i * 37) % sizeof(chunk), 1000000 - total);
+        ctx.update(chunk, n);
+        total += n;
+    }
+    uint8_t digest[SHA256::DIGEST_LEN];
+    ctx.final(digest);
+    check_digest(digest, million_a, sizeof(digest));
+}
+
+TEST(SHA256Test, KnownAnswers)
+{
+    known_answers();
+}
+
+TEST(SHA256Test, KnownAnswersPortable)
+{
+    SHA256::set_portable_only(true);
+    known_answers();
+    SHA256::set_portable_only(false);
+}
+
+/*
+  a MAVLink2 signature: the first 48 bits of the hash of the secret
+  key, header, payload, crc, link id and timestamp, starting from a
+  copy of a context which has absorbed the key
+ */
+TEST(SHA256Test, MAVLinkSignature)
+{
+    uint8_t key[32];
+    for (uint8_t i=0; i<sizeof(key); i++) {
+        key[i] = i;
+    }
+    const uint8_t header[] = { 0xFD, 9, 0x01, 0, 42, 1, 1, 0, 0, 0 };
+    const uint8_t payload[] = { 0, 0, 0, 0, 2, 3, 81, 4, 3 };
+    const uint8_t crc[] = { 0x12, 0x34 };
+    const uint8_t link_id_timestamp[] = { 1, 0x10, 0x32, 0x54, 0x76, 0x98, 0xBA };
+    const uint8_t expected[6] = { 0xcd, 0x7b, 0x21, 0x69, 0x97, 0xde };
+
+    SHA256 keyed;
+    keyed.update(key, sizeof(key));
+
+    for (uint8_t i=0; i<2; i++) {
+        SHA256 ctx = keyed;
+        ctx.update(header, sizeof(header));
+        ctx.update(payload, sizeof(payload));
+        ctx.update(crc, sizeof(crc));
+        ctx.update(link_id_timestamp, sizeof(link_id_timestamp));
+        uint8_t signature[6];
+        ctx.final_48(signature);
+        check_digest(signature, expected, sizeof(signature));
+    }
+}
+
+AP_GTEST_MAIN()
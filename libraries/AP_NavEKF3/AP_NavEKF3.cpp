@@ -690,6 +690,15 @@ const AP_Param::GroupInfo NavEKF3::var_info2[] = {
     // @User: Advanced
     AP_GROUPINFO("DRAG_MCOEF", 5, NavEKF3, _momentumDragCoef, 0.0f),
 
+#if HAL_NAVEKF3_PARALLEL_CORES
+    // @Param: LANE_THREADS
+    // @DisplayName: Run EKF lanes on worker threads
+    // @Description: When enabled each EKF lane after the first is updated on its own thread, in parallel with the first lane. The lanes produce the same results as when they are run one after the other. Only useful on multi-core Linux boards and SITL
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO("LANE_THREADS", 6, NavEKF3, _laneThreads, 0),
+#endif
+
     AP_GROUPEND
 };
 
@@ -860,17 +869,16 @@ void NavEKF3::UpdateFilter(void)
 
     imuSampleTime_us = AP::dal().micros64();
 
+#if HAL_NAVEKF3_PARALLEL_CORES
+    if (use_workers()) {
+        lanesInParallel = true;
+        workers.update();
+        lanesInParallel = false;
+        publishCommonOrigin();
+    } else
+#endif
     for (uint8_t i=0; i<num_cores; i++) {
-        // if we have not overrun by more than 3 IMU frames, and we
-        // have already used more than 1/3 of the CPU budget for this
-        // loop then suppress the prediction step. This allows
-        // multiple EKF instances to cooperate on scheduling
-        bool allow_state_prediction = true;
-        if (core[i].getFramesSincePredict() < (_framesPerPrediction+3) &&
-            AP::dal().ekf_low_time_remaining(AP_DAL::EKFType::EKF3, i)) {
-            allow_state_prediction = false;
-        }
-        core[i].UpdateFilter(allow_state_prediction);
+        UpdateCoreFilter(i);
     }
 
     // If the current core selected has a bad error score or is unhealthy, switch to a healthy core with the lowest fault score
@@ -953,6 +961,64 @@ void NavEKF3::UpdateFilter(void)
     sources.align_inactive_sources();
 }
 
+/*
+  run the update of one core. Called for each core in turn, or from the
+  worker threads when the cores are run in parallel
+ */
+void NavEKF3::UpdateCoreFilter(uint8_t i)
+{
+    // if we have not overrun by more than 3 IMU frames, and we
+    // have already used more than 1/3 of the CPU budget for this
+    // loop then suppress the prediction step. This allows
+    // multiple EKF instances to cooperate on scheduling
+    bool allow_state_prediction = true;
+    if (core[i].getFramesSincePredict() < (_framesPerPrediction+3) &&
+        AP::dal().ekf_low_time_remaining(AP_DAL::EKFType::EKF3, i)) {
+        allow_state_prediction = false;
+    }
+    core[i].UpdateFilter(allow_state_prediction);
+}
+
+#if HAL_NAVEKF3_PARALLEL_CORES
+/*
+  the cores only share the frontend origin until they all have one of
+  their own, so until then they are run one after the other
+ */
+bool NavEKF3::use_workers(void)
+{
+    if (_laneThreads == 0 || num_cores < 2) {
+        return false;
+    }
+    for (uint8_t i=0; i<num_cores; i++) {
+        if (!core[i].origin_valid()) {
+            return false;
+        }
+    }
+    if (!workers.running() &&
+        !workers.init(FUNCTOR_BIND_MEMBER(&NavEKF3::UpdateCoreFilter, void, uint8_t), num_cores)) {
+        return false;
+    }
+    return true;
+}
+
+/*
+  a core which set its origin while the cores were running in parallel
+  leaves it for the frontend to share once they have all finished, as
+  the other cores may be reading the common origin. Later cores win,
+  as they would when run one after the other
+ */
+void NavEKF3::publishCommonOrigin(void)
+{
+    for (uint8_t i=0; i<num_cores; i++) {
+        Location loc;
+        if (core[i].takeCommonOrigin(loc)) {
+            common_EKF_origin = loc;
+            common_origin_valid = true;
+        }
+    }
+}
+#endif // HAL_NAVEKF3_PARALLEL_CORES
+
 /*
   check if switching lanes will reduce the normalised
   innovations. This is called when the vehicle code is about to
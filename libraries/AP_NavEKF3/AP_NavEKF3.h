@@ -25,6 +25,7 @@
 #include <GCS_MAVLink/GCS_MAVLink.h>
 #include <AP_NavEKF/AP_Nav_Common.h>
 #include <AP_NavEKF/AP_NavEKF_Source.h>
+#include "AP_NavEKF3_Workers.h"
 
 class NavEKF3_core;
 
@@ -462,6 +463,23 @@ private:
     AP_Float _ballisticCoef_x;      // ballistic coefficient measured for flow in X body frame directions
     AP_Float _ballisticCoef_y;      // ballistic coefficient measured for flow in Y body frame directions
     AP_Float _momentumDragCoef;     // lift rotor momentum drag coefficient
+#if HAL_NAVEKF3_PARALLEL_CORES
+    AP_Int8 _laneThreads;           // run the cores on worker threads when set
+
+    NavEKF3_Workers workers;
+
+    // true while the cores are being run on the worker threads
+    bool lanesInParallel;
+
+    // true if the cores can be run on the worker threads for this frame
+    bool use_workers(void);
+
+    // share an origin set by a core while the cores ran in parallel
+    void publishCommonOrigin(void);
+#endif
+
+    // run the update of one core, including its prediction decision
+    void UpdateCoreFilter(uint8_t i);
 
 // Possible values for _flowUse
 #define FLOW_USE_NONE    0
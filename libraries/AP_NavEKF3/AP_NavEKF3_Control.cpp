@@ -580,10 +580,27 @@ void NavEKF3_core::setOrigin(const Location &loc)
     GCS_SEND_TEXT(MAV_SEVERITY_INFO, "EKF3 IMU%u origin set",(unsigned)imu_index);
 
     // put origin in frontend as well to ensure it stays in sync between lanes
+#if HAL_NAVEKF3_PARALLEL_CORES
+    if (frontend->lanesInParallel) {
+        // other lanes may be reading it, the frontend copies it once they are done
+        commonOriginPending = true;
+        return;
+    }
+#endif
     frontend->common_EKF_origin = EKF_origin;
     frontend->common_origin_valid = true;
 }
 
+bool NavEKF3_core::takeCommonOrigin(Location &loc)
+{
+    if (!commonOriginPending) {
+        return false;
+    }
+    commonOriginPending = false;
+    loc = EKF_origin;
+    return true;
+}
+
 // record a yaw reset event
 void NavEKF3_core::recordYawReset()
 {
@@ -0,0 +1,112 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "AP_NavEKF3_Workers.h"
+
+#if HAL_NAVEKF3_PARALLEL_CORES
+
+#include <AP_HAL/AP_HAL.h>
+
+extern const AP_HAL::HAL& hal;
+
+// the thread library keeps a pointer to the name
+static const char *worker_names[NAVEKF3_MAX_WORKERS] = {
+    "EKF3 lane 1",
+    "EKF3 lane 2",
+};
+
+NavEKF3_Workers::NavEKF3_Workers() :
+    _update_core(nullptr),
+    _num_cores(0),
+    _num_registered(0),
+    _init_done(false),
+    _running(false),
+    _generation(0),
+    _pending(0)
+{
+    pthread_mutex_init(&_mutex, nullptr);
+    pthread_cond_init(&_start_cond, nullptr);
+    pthread_cond_init(&_done_cond, nullptr);
+}
+
+bool NavEKF3_Workers::init(update_fn_t update_core, uint8_t num_cores)
+{
+    if (_init_done) {
+        // threads are only ever started once
+        return _running;
+    }
+    _init_done = true;
+    if (num_cores < 2 || num_cores > NAVEKF3_MAX_WORKERS+1) {
+        return false;
+    }
+    _update_core = update_core;
+    _num_cores = num_cores;
+
+    for (uint8_t i=0; i<num_cores-1; i++) {
+        if (!hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&NavEKF3_Workers::worker_thread, void),
+                                          worker_names[i], 32*1024, AP_HAL::Scheduler::PRIORITY_MAIN, 0)) {
+            // any workers already started will wait forever, which is harmless
+            return false;
+        }
+    }
+    _running = true;
+    return true;
+}
+
+void NavEKF3_Workers::update(void)
+{
+    pthread_mutex_lock(&_mutex);
+    _pending = _num_cores - 1;
+    _generation++;
+    pthread_cond_broadcast(&_start_cond);
+    pthread_mutex_unlock(&_mutex);
+
+    _update_core(0);
+
+    // barrier, the frontend must not look at any core until all are done
+    pthread_mutex_lock(&_mutex);
+    while (_pending != 0) {
+        pthread_cond_wait(&_done_cond, &_mutex);
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+void NavEKF3_Workers::worker_thread(void)
+{
+    // workers claim core indexes in the order they start, and
+    // generation 0 is never run so a late starter can't miss a frame
+    pthread_mutex_lock(&_mutex);
+    const uint8_t index = ++_num_registered;
+    uint32_t generation = 0;
+    pthread_mutex_unlock(&_mutex);
+
+    while (true) {
+        pthread_mutex_lock(&_mutex);
+        while (_generation == generation) {
+            pthread_cond_wait(&_start_cond, &_mutex);
+        }
+        generation = _generation;
+        pthread_mutex_unlock(&_mutex);
+
+        _update_core(index);
+
+        pthread_mutex_lock(&_mutex);
+        if (--_pending == 0) {
+            pthread_cond_signal(&_done_cond);
+        }
+        pthread_mutex_unlock(&_mutex);
+    }
+}
+
+#endif // HAL_NAVEKF3_PARALLEL_CORES
@@ -0,0 +1,87 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL_Boards.h>
+#include <AP_NavEKF/AP_NavEKF_core_common.h>
+#include <AP_HAL/utility/functor.h>
+
+/*
+  allow the EKF3 cores to be run on worker threads, see
+  EK3_LANE_THREADS. The EKF3 scratch variables are then per thread, so
+  this is off unless asked for
+ */
+#ifndef HAL_NAVEKF3_PARALLEL_CORES
+#define HAL_NAVEKF3_PARALLEL_CORES 0
+#endif
+
+#if HAL_NAVEKF3_PARALLEL_CORES && CONFIG_HAL_BOARD != HAL_BOARD_SITL && CONFIG_HAL_BOARD != HAL_BOARD_LINUX
+#error "HAL_NAVEKF3_PARALLEL_CORES is only supported on SITL and Linux"
+#endif
+
+#if HAL_NAVEKF3_PARALLEL_CORES
+
+#include <pthread.h>
+
+#define NAVEKF3_MAX_WORKERS 2 // one less than MAX_EKF_CORES, core 0 runs on the caller
+
+/*
+  run the update of the EKF3 cores on worker threads.
+
+  Core 0 is run on the calling thread and the other cores each have a
+  thread of their own. update() does not return until every core has
+  finished, so the frontend only looks at the cores once they are all
+  done
+ */
+class NavEKF3_Workers {
+public:
+    FUNCTOR_TYPEDEF(update_fn_t, void, uint8_t);
+
+    NavEKF3_Workers();
+
+    /* Do not allow copies */
+    NavEKF3_Workers(const NavEKF3_Workers &other) = delete;
+    NavEKF3_Workers &operator=(const NavEKF3_Workers&) = delete;
+
+    // start the worker threads for the given number of cores, which
+    // are updated by calling update_core with the core index. Returns
+    // false if the threads could not be created
+    bool init(update_fn_t update_core, uint8_t num_cores);
+
+    // true once all worker threads have been started
+    bool running(void) const { return _running; }
+
+    // update all cores
+    void update(void);
+
+private:
+    void worker_thread(void);
+
+    update_fn_t _update_core;
+    uint8_t _num_cores;
+    uint8_t _num_registered;
+    bool _init_done;
+    bool _running;
+
+    pthread_mutex_t _mutex;
+    pthread_cond_t _start_cond;
+    pthread_cond_t _done_cond;
+
+    // incremented each time the workers are asked to run
+    uint32_t _generation;
+    uint8_t _pending;
+};
+
+#endif // HAL_NAVEKF3_PARALLEL_CORES
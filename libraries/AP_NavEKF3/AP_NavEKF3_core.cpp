@@ -7,6 +7,26 @@
 #include <AP_Logger/AP_Logger.h>
 #include <AP_DAL/AP_DAL.h>
 
+#if HAL_NAVEKF3_PARALLEL_CORES
+thread_local NavEKF3_core::Matrix24 NavEKF3_core::KH;
+thread_local NavEKF3_core::Matrix24 NavEKF3_core::KHP;
+thread_local NavEKF3_core::Matrix24 NavEKF3_core::nextP;
+thread_local NavEKF3_core::Vector28 NavEKF3_core::Kfusion;
+
+/*
+  fill the per thread scratch variables, for detecting re-use of variables between loops in SITL
+ */
+void NavEKF3_core::fill_scratch_variables(void)
+{
+#if CONFIG_HAL_BOARD == HAL_BOARD_SITL
+    fill_nanf(&KH[0][0], sizeof(KH)/sizeof(float));
+    fill_nanf(&KHP[0][0], sizeof(KHP)/sizeof(float));
+    fill_nanf(&nextP[0][0], sizeof(nextP)/sizeof(float));
+    fill_nanf(&Kfusion[0], sizeof(Kfusion)/sizeof(float));
+#endif
+}
+#endif // HAL_NAVEKF3_PARALLEL_CORES
+
 // constructor
 NavEKF3_core::NavEKF3_core(NavEKF3 *_frontend) :
     frontend(_frontend),
@@ -272,6 +292,7 @@ void NavEKF3_core::InitialiseVariables()
     yawResetAngle = 0.0f;
     lastYawReset_ms = 0;
     tiltErrorVariance = sq(M_2PI);
+    commonOriginPending = false;
     tiltAlignComplete = false;
     yawAlignComplete = false;
     have_table_earth_field = false;
@@ -1723,6 +1744,73 @@ void NavEKF3_core::ForceSymmetry()
     }
 }
 
+/*
+  calculate P*H' and the Kalman gain for a scalar observation. Only the
+  non-zero jacobian elements are visited and the gains for inhibited
+  states are zeroed before they can reach the state or covariance update
+ */
+void NavEKF3_core::sparseKalmanGain(const sparse_obs_elements &obs, ftype varInnov, Vector24 &PHT)
+{
+    const ftype SK = 1.0f / varInnov;
+    for (uint8_t i=0; i<=stateIndexLim; i++) {
+        ftype res = 0;
+        for (uint8_t k=0; k<obs.n; k++) {
+            res += P[i][obs.idx[k]] * obs.H[k];
+        }
+        PHT[i] = res;
+        Kfusion[i] = SK * res;
+    }
+    for (uint8_t i=stateIndexLim+1; i<=23; i++) {
+        Kfusion[i] = 0.0f;
+    }
+
+    if (inhibitDelAngBiasStates) {
+        // zero indexes 10 to 12 = 3*4 bytes
+        memset(&Kfusion[10], 0, 12);
+    }
+    if (inhibitDelVelBiasStates) {
+        // zero indexes 13 to 15 = 3*4 bytes
+        memset(&Kfusion[13], 0, 12);
+    }
+    if (inhibitMagStates) {
+        // zero indexes 16 to 21 = 6*4 bytes
+        memset(&Kfusion[16], 0, 24);
+    }
+    if (inhibitWindStates) {
+        // zero indexes 22 to 23 = 2*4 bytes
+        memset(&Kfusion[22], 0, 8);
+    }
+}
+
+// returns false if applying the current Kalman gain would drive any variances negative
+bool NavEKF3_core::sparseCovarianceHealthy(const Vector24 &PHT) const
+{
+    for (uint8_t i=0; i<=stateIndexLim; i++) {
+        if (Kfusion[i] * PHT[i] > P[i][i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+  correct the covariance P = (I - K*H)*P for a scalar observation. As P
+  is symmetric H*P is the transpose of P*H', so K*H*P is the rank-1
+  product K*PHT'. Only the lower triangle is calculated and the
+  average of the two halves is written to both, which gives the same
+  result as a full update followed by ForceSymmetry()
+ */
+void NavEKF3_core::sparseCovarianceUpdate(const Vector24 &PHT)
+{
+    for (uint8_t i=0; i<=stateIndexLim; i++) {
+        for (uint8_t j=0; j<=i; j++) {
+            const ftype temp = 0.5f*(P[i][j] + P[j][i] - Kfusion[i]*PHT[j] - Kfusion[j]*PHT[i]);
+            P[i][j] = temp;
+            P[j][i] = temp;
+        }
+    }
+}
+
 // constrain variances (diagonal terms) in the state covariance matrix to  prevent ill-conditioning
 // if states are inactive, zero the corresponding off-diagonals
 void NavEKF3_core::ConstrainVariances()
@@ -2016,9 +2104,13 @@ void NavEKF3_core::verifyTiltErrorVariance()
     }
 
     tiltErrorVarianceAlt = MIN(tiltErrorVarianceAlt, sq(radians(30.0f)));
+    // shared by the cores so only one of them logs each time. They may
+    // be run on separate threads, so only the core that moves the time
+    // on logs
     static uint32_t lastLogTime_ms = 0;
-    if (imuSampleTime_ms - lastLogTime_ms > 500) {
-        lastLogTime_ms = imuSampleTime_ms;
+    uint32_t lastLog_ms = __atomic_load_n(&lastLogTime_ms, __ATOMIC_RELAXED);
+    if (imuSampleTime_ms - lastLog_ms > 500 &&
+        __atomic_compare_exchange_n(&lastLogTime_ms, &lastLog_ms, imuSampleTime_ms, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
         const struct log_XKTV msg {
             LOG_PACKET_HEADER_INIT(LOG_XKTV_MSG),
             time_us      : dal.micros64(),
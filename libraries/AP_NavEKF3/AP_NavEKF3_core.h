@@ -35,6 +35,7 @@
 #include <AP_DAL/AP_DAL.h>
 
 #include "AP_NavEKF/EKFGSF_yaw.h"
+#include "AP_NavEKF3_Workers.h"
 
 // GPS pre-flight check bit locations
 #define MASK_GPS_NSATS      (1<<0)
@@ -415,6 +416,16 @@ public:
         return yawAlignComplete;
     }
 
+    // return true if this core has an origin of its own
+    bool origin_valid(void) const {
+        return validOrigin;
+    }
+
+    // return true, and the origin, if this core set its origin while
+    // the cores were running in parallel and it has not yet been
+    // shared with the other cores
+    bool takeCommonOrigin(Location &loc);
+
     void Log_Write(uint64_t time_us);
 
 private:
@@ -480,6 +491,18 @@ private:
     typedef uint32_t Vector_u32_50[50];
 #endif
 
+#if HAL_NAVEKF3_PARALLEL_CORES
+    // the cores may be updated in parallel, so EKF3 has per thread
+    // copies of the common scratch variables, hiding the shared ones
+    static thread_local Matrix24 KH;
+    static thread_local Matrix24 KHP;
+    static thread_local Matrix24 nextP;
+    static thread_local Vector28 Kfusion;
+
+    // fill the per thread scratch variables with NaN on SITL
+    void fill_scratch_variables(void);
+#endif
+
     // the states are available in two forms, either as a Vector24, or
     // broken down as individual elements. Both are equivalent (same
     // memory)
@@ -598,6 +621,13 @@ private:
         Vector2f accelXY;       // measured specific force along the X and Y body axes (m/sec**2)
     };
 
+    // non-zero elements of a scalar observation jacobian
+    struct sparse_obs_elements {
+        uint8_t n;              // number of non-zero elements
+        uint8_t idx[9];         // state index of each element
+        ftype   H[9];           // jacobian value of each element
+    };
+
     // bias estimates for the IMUs that are enabled but not being used
     // by this core.
     struct {
@@ -675,6 +705,16 @@ private:
     // fuse synthetic sideslip measurement of zero
     void FuseSideslip();
 
+    // calculate P*H' and the Kalman gain for a scalar observation with a sparse jacobian
+    // gains for inhibited states are zeroed, PHT is calculated for all states up to stateIndexLim
+    void sparseKalmanGain(const sparse_obs_elements &obs, ftype varInnov, Vector24 &PHT);
+
+    // returns false if the covariance update for the current Kalman gain would make any variances negative
+    bool sparseCovarianceHealthy(const Vector24 &PHT) const;
+
+    // apply the symmetric covariance update P = P - K*H*P for a scalar observation
+    void sparseCovarianceUpdate(const Vector24 &PHT);
+
     // zero specified range of rows in the state covariance matrix
     void zeroRows(Matrix24 &covMat, uint8_t first, uint8_t last);
 
@@ -1126,6 +1166,7 @@ private:
     uint32_t firstInitTime_ms;      // First time the initialise function was called (msec)
     uint32_t lastInitFailReport_ms; // Last time the buffer initialisation failure report was sent (msec)
     float tiltErrorVariance;        // variance of the angular uncertainty measured perpendicular to the vertical (rad^2)
+    bool commonOriginPending;       // true when EKF_origin is waiting to be copied to the frontend
 
     // variables used to calculate a vertical velocity that is kinematically consistent with the vertical position
     struct {
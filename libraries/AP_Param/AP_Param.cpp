@@ -1193,6 +1193,12 @@ void AP_Param::save(bool force_save)
  */
 void AP_Param::save_io_handler(void)
 {
+    if (save_queue.available() == 0) {
+        return;
+    }
+    // commit the whole queue at once, instead of flushing each
+    // parameter as it is written
+    StorageTransaction transaction;
     struct param_save p;
     while (save_queue.pop(p)) {
         p.param->save_sync(p.force_save);
@@ -109,6 +109,15 @@ const AP_Param::GroupInfo AP_Scripting::var_info[] = {
     // @User: Advanced
     AP_GROUPINFO("DIR_DISABLE", 9, AP_Scripting, _dir_disable, 0),
 
+    // @Param: BUDGET_US
+    // @DisplayName: Scripting default time budget
+    // @Description: The CPU time a script may use each time it is run before it is counted as an overrun. Normal and low priority scripts with a budget that overrun have their next run delayed by the excess, and have a small random delay added so that scripts with the same period drift apart. Scripts can change their own budget with script.set_budget(). 0 disables the check
+    // @Units: us
+    // @Range: 0 100000
+    // @Increment: 100
+    // @User: Advanced
+    AP_GROUPINFO("BUDGET_US", 10, AP_Scripting, _script_budget_us, 0),
+
     AP_GROUPEND
 };
 
@@ -194,19 +203,27 @@ void AP_Scripting::repl_stop(void) {
 }
 
 void AP_Scripting::thread(void) {
-    lua_scripts *lua = new lua_scripts(_script_vm_exec_count, _script_heap_size, _debug_level, terminal);
+    lua_scripts *lua = new lua_scripts(_script_vm_exec_count, _script_heap_size, _debug_level, _script_budget_us, terminal);
     if (lua == nullptr || !lua->heap_allocated()) {
         gcs().send_text(MAV_SEVERITY_CRITICAL, "Unable to allocate scripting memory");
         delete lua;
         _init_failed = true;
         return;
     }
+    _lua = lua;
     lua->run();
 
     // only reachable if the lua backend has died for any reason
     gcs().send_text(MAV_SEVERITY_CRITICAL, "Scripting has stopped");
 }
 
+void AP_Scripting::profile_info(ExpandingString &str) {
+    if (_lua == nullptr) {
+        return;
+    }
+    _lua->profile_info(str);
+}
+
 AP_Scripting *AP_Scripting::_singleton = nullptr;
 
 namespace AP {
@@ -21,6 +21,9 @@
 #include <GCS_MAVLink/GCS.h>
 #include <AP_Filesystem/AP_Filesystem.h>
 
+class lua_scripts;
+class ExpandingString;
+
 class AP_Scripting
 {
 public:
@@ -56,6 +59,9 @@ public:
     };
     uint16_t get_disabled_dir() { return uint16_t(_dir_disable.get());}
 
+    // per script profiling information for @SYS/scripts.txt
+    void profile_info(ExpandingString &str);
+
 private:
 
     bool repl_start(void);
@@ -70,9 +76,12 @@ private:
     AP_Int32 _script_heap_size;
     AP_Int8 _debug_level;
     AP_Int16 _dir_disable;
+    AP_Int32 _script_budget_us;
 
     bool _init_failed;  // true if memory allocation failed
 
+    lua_scripts *_lua;
+
     static AP_Scripting *_singleton;
 
 };
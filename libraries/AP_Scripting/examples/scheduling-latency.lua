@@ -0,0 +1,44 @@
+-- Measures how late a high priority control loop is run by the scripting
+-- scheduler. Run it alongside scheduling-load.lua, and with and without the
+-- set_priority call, to compare the worst case latency reported
+
+local PERIOD_MS = 10
+local REPORT_MS = 10000
+
+script.set_priority(script.PRIORITY_HIGH)
+script.set_budget(500)
+
+local expected_us = nil
+local worst_late_us = 0
+local total_late_us = 0
+local runs = 0
+local last_report_ms = millis()
+
+function update()
+  local now_us = micros()
+  if expected_us then
+    -- runs are scheduled in milliseconds, so can be slightly early
+    local late_us = 0
+    if now_us > expected_us then
+      late_us = (now_us - expected_us):tofloat()
+    end
+    if late_us > worst_late_us then
+      worst_late_us = late_us
+    end
+    total_late_us = total_late_us + late_us
+    runs = runs + 1
+  end
+  expected_us = now_us + PERIOD_MS * 1000
+
+  if (millis() - last_report_ms):tofloat() >= REPORT_MS and runs > 0 then
+    gcs:send_text(6, string.format("latency: mean %.0fus worst %.0fus over %d runs", total_late_us / runs, worst_late_us, runs))
+    worst_late_us = 0
+    total_late_us = 0
+    runs = 0
+    last_report_ms = millis()
+  end
+
+  return update, PERIOD_MS
+end
+
+return update()
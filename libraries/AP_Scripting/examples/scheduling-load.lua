@@ -0,0 +1,19 @@
+-- Background load for scheduling-latency.lua. Each run burns a few
+-- milliseconds of CPU time building and sorting a table, copy this script
+-- under several names to add more load
+
+script.set_priority(script.PRIORITY_LOW)
+script.set_budget(5000)
+
+local SIZE = 400
+
+function update()
+  local values = {}
+  for i = 1, SIZE do
+    values[i] = math.random()
+  end
+  table.sort(values)
+  return update, 20
+end
+
+return update()
@@ -962,12 +962,14 @@ void emit_dependencies(FILE *f) {
 void emit_userdata_allocators(void) {
   struct userdata * node = parsed_userdata;
   while (node) {
+    // registry reference to the metatable, filled in by load_generated_bindings
+    fprintf(source, "static int %s_meta_ref = LUA_NOREF;\n\n", node->sanatized_name);
     fprintf(source, "int new_%s(lua_State *L) {\n", node->sanatized_name);
     fprintf(source, "    luaL_checkstack(L, 2, \"Out of stack\");\n"); // ensure we have sufficent stack to push the return
     fprintf(source, "    void *ud = lua_newuserdata(L, sizeof(%s));\n", node->name);
     fprintf(source, "    memset(ud, 0, sizeof(%s));\n", node->name);
     fprintf(source, "    new (ud) %s();\n", node->name);
-    fprintf(source, "    luaL_getmetatable(L, \"%s\");\n", node->name);
+    fprintf(source, "    lua_rawgeti(L, LUA_REGISTRYINDEX, %s_meta_ref);\n", node->sanatized_name);
     fprintf(source, "    lua_setmetatable(L, -2);\n");
     fprintf(source, "    return 1;\n");
     fprintf(source, "}\n\n");
@@ -978,11 +980,12 @@ void emit_userdata_allocators(void) {
 void emit_ap_object_allocators(void) {
   struct userdata * node = parsed_ap_objects;
   while (node) {
+    fprintf(source, "static int %s_meta_ref = LUA_NOREF;\n\n", node->sanatized_name);
     fprintf(source, "int new_%s(lua_State *L) {\n", node->sanatized_name);
     fprintf(source, "    luaL_checkstack(L, 2, \"Out of stack\");\n"); // ensure we have sufficent stack to push the return
     fprintf(source, "    void *ud = lua_newuserdata(L, sizeof(%s *));\n", node->name);
     fprintf(source, "    memset(ud, 0, sizeof(%s *));\n", node->name); // FIXME: memset is a ridiculously large hammer here
-    fprintf(source, "    luaL_getmetatable(L, \"%s\");\n", node->name);
+    fprintf(source, "    lua_rawgeti(L, LUA_REGISTRYINDEX, %s_meta_ref);\n", node->sanatized_name);
     fprintf(source, "    lua_setmetatable(L, -2);\n");
     fprintf(source, "    return 1;\n");
     fprintf(source, "}\n\n");
@@ -994,7 +997,7 @@ void emit_userdata_checkers(void) {
   struct userdata * node = parsed_userdata;
   while (node) {
     fprintf(source, "%s * check_%s(lua_State *L, int arg) {\n", node->name, node->sanatized_name);
-    fprintf(source, "    void *data = luaL_checkudata(L, arg, \"%s\");\n", node->name);
+    fprintf(source, "    void *data = binding_checkudata(L, arg, %s_meta_ref, \"%s\");\n", node->sanatized_name, node->name);
     fprintf(source, "    return (%s *)data;\n", node->name);
     fprintf(source, "}\n\n");
     node = node->next;
@@ -1005,7 +1008,7 @@ void emit_ap_object_checkers(void) {
   struct userdata * node = parsed_ap_objects;
   while (node) {
     fprintf(source, "%s ** check_%s(lua_State *L, int arg) {\n", node->name, node->sanatized_name);
-    fprintf(source, "    void *data = luaL_checkudata(L, arg, \"%s\");\n", node->name);
+    fprintf(source, "    void *data = binding_checkudata(L, arg, %s_meta_ref, \"%s\");\n", node->sanatized_name, node->name);
     fprintf(source, "    return (%s **)data;\n", node->name);
     fprintf(source, "}\n\n");
     node = node->next;
@@ -1356,7 +1359,7 @@ int emit_references(const struct argument *arg, const char * tab) {
         case TYPE_USERDATA:
           // userdatas must allocate a new container to return
           fprintf(source, "%snew_%s(L);\n", tab, arg->type.data.ud.sanatized_name);
-          fprintf(source, "%s*check_%s(L, -1) = data_%d;\n", tab, arg->type.data.ud.sanatized_name, arg_index);
+          fprintf(source, "%s*static_cast<%s *>(lua_touserdata(L, -1)) = data_%d;\n", tab, arg->type.data.ud.name, arg_index);
           break;
         case TYPE_NONE:
           error(ERROR_INTERNAL, "Attempted to emit a nullable or reference  argument of type none");
@@ -1615,14 +1618,14 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
     case TYPE_USERDATA:
       // userdatas must allocate a new container to return
       fprintf(source, "    new_%s(L);\n", method->return_type.data.ud.sanatized_name);
-      fprintf(source, "    *check_%s(L, -1) = data;\n", method->return_type.data.ud.sanatized_name);
+      fprintf(source, "    *static_cast<%s *>(lua_touserdata(L, -1)) = data;\n", method->return_type.data.ud.name);
       break;
     case TYPE_AP_OBJECT:
       fprintf(source, "    if (data == NULL) {\n");
       fprintf(source, "        lua_pushnil(L);\n");
       fprintf(source, "    } else {\n");
       fprintf(source, "        new_%s(L);\n", method->return_type.data.ud.sanatized_name);
-      fprintf(source, "        *check_%s(L, -1) = data;\n", method->return_type.data.ud.sanatized_name);
+      fprintf(source, "        *static_cast<%s **>(lua_touserdata(L, -1)) = data;\n", method->return_type.data.ud.name);
       fprintf(source, "    }\n");
       break;
     case TYPE_NONE:
@@ -1694,7 +1697,7 @@ void emit_operators(struct userdata *data) {
     fprintf(source, "    %s *ud2 = check_%s(L, 2);\n", data->name, data->sanatized_name);
     // create a container for the result
     fprintf(source, "    new_%s(L);\n", data->sanatized_name);
-    fprintf(source, "    *check_%s(L, -1) = *ud %c *ud2;;\n", data->sanatized_name, op_sym);
+    fprintf(source, "    *static_cast<%s *>(lua_touserdata(L, -1)) = *ud %c *ud2;\n", data->name, op_sym);
     // return the first pointer
     fprintf(source, "    return 1;\n");
     fprintf(source, "}\n\n");
@@ -1787,10 +1790,15 @@ void emit_enums(struct userdata * data) {
 void emit_metas(struct userdata * data, char * meta_name) {
   fprintf(source, "const struct userdata_meta %s_fun[] = {\n", meta_name);
   while (data) {
+    // singletons are only ever looked up by name when the sandbox is built
+    char ref[128] = "NULL";
+    if (data->ud_type != UD_SINGLETON) {
+      snprintf(ref, sizeof(ref), "&%s_meta_ref", data->sanatized_name);
+    }
     if (data->enums) {
-      fprintf(source, "    {\"%s\", %s_meta, %s_enums},\n", data->alias ? data->alias : data->name, data->name, data->sanatized_name);
+      fprintf(source, "    {\"%s\", %s_meta, %s_enums, %s},\n", data->alias ? data->alias : data->name, data->name, data->sanatized_name, ref);
     } else {
-      fprintf(source, "    {\"%s\", %s_meta, NULL},\n", data->alias ? data->alias : data->name, data->sanatized_name);
+      fprintf(source, "    {\"%s\", %s_meta, NULL, %s},\n", data->alias ? data->alias : data->name, data->sanatized_name, ref);
     }
     data = data->next;
   }
@@ -1811,6 +1819,7 @@ void emit_loaders(void) {
   fprintf(source, "    const char *name;\n");
   fprintf(source, "    const luaL_Reg *reg;\n");
   fprintf(source, "    const struct userdata_enum *enums;\n");
+  fprintf(source, "    int *ref;\n");
   fprintf(source, "};\n\n");
   emit_metas(parsed_userdata, "userdata");
   emit_metas(parsed_singletons, "singleton");
@@ -1825,7 +1834,7 @@ void emit_loaders(void) {
   fprintf(source, "        lua_pushstring(L, \"__index\");\n");
   fprintf(source, "        lua_pushvalue(L, -2);\n");
   fprintf(source, "        lua_settable(L, -3);\n");
-  fprintf(source, "        lua_pop(L, 1);\n");
+  fprintf(source, "        *userdata_fun[i].ref = luaL_ref(L, LUA_REGISTRYINDEX);\n");
   fprintf(source, "    }\n");
   fprintf(source, "\n");
 
@@ -1836,7 +1845,7 @@ void emit_loaders(void) {
   fprintf(source, "        lua_pushstring(L, \"__index\");\n");
   fprintf(source, "        lua_pushvalue(L, -2);\n");
   fprintf(source, "        lua_settable(L, -3);\n");
-  fprintf(source, "        lua_pop(L, 1);\n");
+  fprintf(source, "        *ap_object_fun[i].ref = luaL_ref(L, LUA_REGISTRYINDEX);\n");
   fprintf(source, "    }\n");
   fprintf(source, "\n");
 
@@ -1918,6 +1927,23 @@ void emit_sandbox(void) {
   fprintf(source, "}\n");
 }
 
+void emit_checkudata_helper(void) {
+  // compare against the metatable references cached at load time, and only
+  // fall back to the by name lookup to generate the error message
+  fprintf(source, "static void *binding_checkudata(lua_State *L, int arg, int ref, const char *name) {\n");
+  fprintf(source, "    void *data = lua_touserdata(L, arg);\n");
+  fprintf(source, "    if ((data != nullptr) && lua_getmetatable(L, arg)) {\n");
+  fprintf(source, "        lua_rawgeti(L, LUA_REGISTRYINDEX, ref);\n");
+  fprintf(source, "        const bool match = lua_rawequal(L, -1, -2);\n");
+  fprintf(source, "        lua_pop(L, 2);\n");
+  fprintf(source, "        if (match) {\n");
+  fprintf(source, "            return data;\n");
+  fprintf(source, "        }\n");
+  fprintf(source, "    }\n");
+  fprintf(source, "    return luaL_checkudata(L, arg, name);\n");
+  fprintf(source, "}\n\n");
+}
+
 void emit_argcheck_helper(void) {
   // tagging this with NOINLINE can save a large amount of flash
   // but until we need it we will allow the compilier to choose to inline this for us
@@ -2025,6 +2051,8 @@ int main(int argc, char **argv) {
 
   emit_argcheck_helper();
 
+  emit_checkudata_helper();
+
   emit_userdata_allocators();
 
   emit_userdata_checkers();
@@ -4,6 +4,7 @@
 #include <AP_Logger/AP_Logger.h>
 
 #include "lua_bindings.h"
+#include "lua_scripts.h"
 
 #include "lua_boxed_numerics.h"
 #include <AP_Scripting/lua_generated_bindings.h>
@@ -250,11 +251,51 @@ const luaL_Reg AP_Logger_functions[] = {
     {NULL, NULL}
 };
 
+static int lua_script_set_priority(lua_State *L) {
+    check_arguments(L, 1, "set_priority");
+
+    const lua_Integer priority = luaL_checkinteger(L, 1);
+    luaL_argcheck(L, ((priority >= (lua_Integer)lua_scripts::Priority::LOW) && (priority <= (lua_Integer)lua_scripts::Priority::HIGH)), 1, "priority out of range");
+
+    if (!lua_scripts::set_priority((lua_scripts::Priority)priority)) {
+        return luaL_error(L, "set_priority must be called from a running script");
+    }
+    return 0;
+}
+
+static int lua_script_set_budget(lua_State *L) {
+    check_arguments(L, 1, "set_budget");
+
+    const lua_Integer budget_us = luaL_checkinteger(L, 1);
+    luaL_argcheck(L, budget_us >= 0, 1, "budget out of range");
+
+    if (!lua_scripts::set_budget_us((uint32_t)budget_us)) {
+        return luaL_error(L, "set_budget must be called from a running script");
+    }
+    return 0;
+}
+
+const luaL_Reg script_functions[] = {
+    {"set_priority", lua_script_set_priority},
+    {"set_budget", lua_script_set_budget},
+    {NULL, NULL}
+};
+
 void load_lua_bindings(lua_State *L) {
     lua_pushstring(L, "logger");
     luaL_newlib(L, AP_Logger_functions);
     lua_settable(L, -3);
 
+    lua_pushstring(L, "script");
+    luaL_newlib(L, script_functions);
+    lua_pushinteger(L, (lua_Integer)lua_scripts::Priority::LOW);
+    lua_setfield(L, -2, "PRIORITY_LOW");
+    lua_pushinteger(L, (lua_Integer)lua_scripts::Priority::NORMAL);
+    lua_setfield(L, -2, "PRIORITY_NORMAL");
+    lua_pushinteger(L, (lua_Integer)lua_scripts::Priority::HIGH);
+    lua_setfield(L, -2, "PRIORITY_HIGH");
+    lua_settable(L, -3);
+
     luaL_setfuncs(L, global_functions, 0);
 }
 
@@ -17,22 +17,41 @@
 #include <AP_HAL/AP_HAL.h>
 #include <GCS_MAVLink/GCS.h>
 #include "AP_Scripting.h"
+#include <AP_Math/AP_Math.h>
 
 #include <AP_Scripting/lua_generated_bindings.h>
 
 extern const AP_HAL::HAL& hal;
 
 bool lua_scripts::overtime;
+uint32_t lua_scripts::_hook_executed;
+uint32_t lua_scripts::_hook_limit;
+uint32_t lua_scripts::_hook_steps;
 jmp_buf lua_scripts::panic_jmp;
+lua_scripts::script_info *lua_scripts::_running;
+lua_scripts::pool_block *lua_scripts::_pool[SCRIPTING_POOL_CLASSES];
+uint8_t lua_scripts::_pool_count[SCRIPTING_POOL_CLASSES];
+lua_scripts::pool_stats lua_scripts::_pool_stats;
 
-lua_scripts::lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, const AP_Int8 &debug_level, struct AP_Scripting::terminal_s &_terminal)
+lua_scripts::lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, const AP_Int8 &debug_level, const AP_Int32 &budget_us, struct AP_Scripting::terminal_s &_terminal)
     : _vm_steps(vm_steps),
       _debug_level(debug_level),
+      _budget_us(budget_us),
      terminal(_terminal) {
     _heap = hal.util->allocate_heap_memory(heap_size);
 }
 
 void lua_scripts::hook(lua_State *L, lua_Debug *ar) {
+    if (!overtime) {
+        _hook_executed += _hook_steps;
+        if (_hook_executed < _hook_limit) {
+            // still within the allowance, only count the instructions
+            _hook_steps = MIN(_hook_limit - _hook_executed, (uint32_t)SCRIPTING_VM_HOOK_STEPS);
+            lua_sethook(L, hook, LUA_MASKCOUNT, _hook_steps);
+            return;
+        }
+    }
+
     lua_scripts::overtime = true;
 
     // we need to aggressively bail out as we are over time
@@ -82,8 +101,10 @@ lua_scripts::script_info *lua_scripts::load_script(lua_State *L, char *filename)
         return nullptr;
     }
 
+    memset(new_script, 0, sizeof(script_info));
     new_script->name = filename;
-    new_script->next = nullptr;
+    new_script->priority = Priority::NORMAL;
+    new_script->budget_us = MAX(_budget_us, 0);
 
     create_sandbox(L);
     lua_setupvalue(L, -2, 1);
@@ -164,12 +185,60 @@ void lua_scripts::load_all_scripts_in_dir(lua_State *L, const char *dirname) {
 void lua_scripts::reset_loop_overtime(lua_State *L) {
     overtime = false;
     // reset the hook to clear the counter
-    const int32_t vm_steps = MAX(_vm_steps, 1000);
-    lua_sethook(L, hook, LUA_MASKCOUNT, vm_steps);
+    _hook_executed = 0;
+    _hook_limit = MAX(_vm_steps, 1000);
+    _hook_steps = MIN(_hook_limit, (uint32_t)SCRIPTING_VM_HOOK_STEPS);
+    lua_sethook(L, hook, LUA_MASKCOUNT, _hook_steps);
 }
 
-void lua_scripts::run_next_script(lua_State *L) {
+/*
+  scripts that are due are run highest priority first, and in order of
+  their scheduled time within a priority. A due script is held back if
+  its expected runtime would make it overlap the next run of a higher
+  priority script, unless it has already been held for too long
+ */
+lua_scripts::script_info *lua_scripts::select_next_script(uint64_t now_ms, uint32_t &wait_ms) const {
     if (scripts == nullptr) {
+        wait_ms = 1000;
+        return nullptr;
+    }
+
+    if (now_ms < scripts->next_run_ms) {
+        // nothing is due yet
+        wait_ms = scripts->next_run_ms - now_ms;
+        return nullptr;
+    }
+
+    script_info *best = nullptr;
+    for (script_info *script = scripts; script != nullptr && script->next_run_ms <= now_ms; script = script->next) {
+        if (best == nullptr || script->priority > best->priority) {
+            best = script;
+        }
+    }
+
+    if (best->priority == Priority::HIGH ||
+        (now_ms - best->next_run_ms) >= SCRIPTING_MAX_HOLDOFF_MS) {
+        return best;
+    }
+
+    // find the next run of any script that would preempt this one
+    for (script_info *script = best->next; script != nullptr; script = script->next) {
+        if (script->priority <= best->priority) {
+            continue;
+        }
+        if ((now_ms * 1000ULL) + best->runtime_est_us > (script->next_run_ms * 1000ULL)) {
+            wait_ms = MAX(script->next_run_ms - now_ms, 1U);
+            return nullptr;
+        }
+        // the list is sorted, later scripts can only be due later
+        break;
+    }
+
+    return best;
+}
+
+void lua_scripts::run_next_script(lua_State *L, script_info *script) {
+    if (script == nullptr) {
 #if defined(AP_SCRIPTING_CHECKS) && AP_SCRIPTING_CHECKS >= 1
         AP_HAL::panic("Lua: Attempted to run a script without any scripts queued");
 #endif // defined(AP_SCRIPTING_CHECKS) && AP_SCRIPTING_CHECKS >= 1
@@ -178,8 +247,11 @@ void lua_scripts::run_next_script(lua_State *L) {
 
     uint64_t start_time_ms = AP_HAL::millis64();
     // strip the selected script out of the list
-    script_info *script = scripts;
-    scripts = script->next;
+    {
+        WITH_SEMAPHORE(_list_sem);
+        dequeue_script(script);
+        _running = script;
+    }
 
     // reset the hook to clear the counter
     reset_loop_overtime(L);
@@ -190,7 +262,35 @@ void lua_scripts::run_next_script(lua_State *L) {
     // pop the function to the top of the stack
     lua_rawgeti(L, LUA_REGISTRYINDEX, script->lua_ref);
 
-    if(lua_pcall(L, 0, LUA_MULTRET, 0)) {
+    const uint64_t start_time_us = AP_HAL::micros64();
+
+    const int call_result = lua_pcall(L, 0, LUA_MULTRET, 0);
+
+    const uint32_t runtime_us = AP_HAL::micros64() - start_time_us;
+    script->profile.runtime_us = runtime_us;
+    script->profile.runtime_max_us = MAX(script->profile.runtime_max_us, runtime_us);
+    script->profile.runtime_total_us += runtime_us;
+    script->runtime_est_us = MAX(runtime_us, script->runtime_est_us - (script->runtime_est_us / 8));
+    uint32_t overrun_us = 0;
+    if (script->budget_us != 0 && runtime_us > script->budget_us) {
+        overrun_us = runtime_us - script->budget_us;
+        script->profile.overruns++;
+        if (_debug_level > 0) {
+            gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: %s overran budget by %u us", script->name, (unsigned)overrun_us);
+        }
+    }
+
+    // instructions since the last hook call are not counted
+    script->profile.vm_instructions = overtime ? _hook_limit : _hook_executed;
+    script->profile.vm_instructions_total += script->profile.vm_instructions;
+    script->profile.run_count++;
+    {
+        // profile_info() reads it from another thread
+        WITH_SEMAPHORE(_list_sem);
+        _running = nullptr;
+    }
+
+    if (call_result) {
         if (overtime) {
             // script has consumed an excessive amount of CPU time
             gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: %s exceeded time limit", script->name);
@@ -226,7 +326,18 @@ void lua_scripts::run_next_script(lua_State *L) {
                    }
 
                    // types match the expectations, go ahead and reschedule
-                   script->next_run_ms = start_time_ms + (uint64_t)luaL_checknumber(L, -1);
+                   const uint64_t delay_ms = (uint64_t)luaL_checknumber(L, -1);
+                   script->next_run_ms = start_time_ms + delay_ms;
+                   if (script->priority != Priority::HIGH && script->budget_us != 0) {
+                       // spread budgeted scripts with the same period
+                       // apart, and push back those that overran by the
+                       // excess
+                       const uint32_t jitter_max_ms = MIN(delay_ms / 10, (uint64_t)SCRIPTING_JITTER_MAX_MS);
+                       if (jitter_max_ms > 0) {
+                           script->next_run_ms += get_random16() % (jitter_max_ms + 1);
+                       }
+                       script->next_run_ms += overrun_us / 1000;
+                   }
                    lua_pop(L, 1);
                    int old_ref = script->lua_ref;
                    script->lua_ref = luaL_ref(L, LUA_REGISTRYINDEX);
@@ -251,7 +362,24 @@ void lua_scripts::remove_script(lua_State *L, script_info *script) {
         return;
     }
 
+    if (L != nullptr) {
+        // state could be null if we are force killing all scripts
+        luaL_unref(L, LUA_REGISTRYINDEX, script->lua_ref);
+    }
+
+    WITH_SEMAPHORE(_list_sem);
+
     // ensure that the script isn't in the loaded list for any reason
+    dequeue_script(script);
+
+    if (_running == script) {
+        _running = nullptr;
+    }
+    hal.util->heap_realloc(_heap, script->name, 0);
+    hal.util->heap_realloc(_heap, script, 0);
+}
+
+void lua_scripts::dequeue_script(script_info *script) {
     if (scripts == nullptr) {
         // nothing to do, already not in the list
     } else if (scripts == script) {
@@ -264,13 +392,7 @@ void lua_scripts::remove_script(lua_State *L, script_info *script) {
             }
         }
     }
-
-    if (L != nullptr) {
-        // state could be null if we are force killing all scripts
-        luaL_unref(L, LUA_REGISTRYINDEX, script->lua_ref);
-    }
-    hal.util->heap_realloc(_heap, script->name, 0);
-    hal.util->heap_realloc(_heap, script, 0);
+    script->next = nullptr;
 }
 
 void lua_scripts::reschedule_script(script_info *script) {
@@ -281,6 +403,8 @@ void lua_scripts::reschedule_script(script_info *script) {
        return;
     }
 
+    WITH_SEMAPHORE(_list_sem);
+
     script->next = nullptr;
     if (scripts == nullptr) {
         scripts = script;
@@ -309,10 +433,166 @@ void lua_scripts::reschedule_script(script_info *script) {
 }
 
 void *lua_scripts::_heap;
+size_t lua_scripts::_heap_used;
+
+/*
+  return the pool class for a block of the given size, or
+  SCRIPTING_POOL_CLASSES if the block is not pooled
+ */
+uint8_t lua_scripts::pool_class(size_t size) {
+    if (size == 0 || size > SCRIPTING_POOL_GRANULE * SCRIPTING_POOL_CLASSES) {
+        return SCRIPTING_POOL_CLASSES;
+    }
+    return (size - 1) / SCRIPTING_POOL_GRANULE;
+}
+
+void *lua_scripts::pool_take(uint8_t pool_class, size_t size) {
+    if (pool_class < SCRIPTING_POOL_CLASSES) {
+        pool_block *block = _pool[pool_class];
+        if (block != nullptr) {
+            _pool[pool_class] = block->next;
+            _pool_count[pool_class]--;
+            _pool_stats.hits++;
+            return block;
+        }
+        _pool_stats.misses++;
+        // allocate the whole class so the block can be reused by any size in it
+        size = (pool_class + 1) * SCRIPTING_POOL_GRANULE;
+    }
+    void *ret = hal.util->heap_realloc(_heap, nullptr, size);
+    if (ret == nullptr) {
+        // the pools may be holding enough memory to satisfy this
+        pool_flush();
+        ret = hal.util->heap_realloc(_heap, nullptr, size);
+    }
+    return ret;
+}
+
+void lua_scripts::pool_give(uint8_t pool_class, void *ptr) {
+    if (pool_class >= SCRIPTING_POOL_CLASSES || _pool_count[pool_class] >= SCRIPTING_POOL_MAX_BLOCKS) {
+        hal.util->heap_realloc(_heap, ptr, 0);
+        return;
+    }
+    pool_block *block = (pool_block *)ptr;
+    block->next = _pool[pool_class];
+    _pool[pool_class] = block;
+    _pool_count[pool_class]++;
+}
+
+void lua_scripts::pool_flush(void) {
+    for (uint8_t i = 0; i < SCRIPTING_POOL_CLASSES; i++) {
+        while (_pool[i] != nullptr) {
+            pool_block *block = _pool[i];
+            _pool[i] = block->next;
+            hal.util->heap_realloc(_heap, block, 0);
+        }
+        _pool_count[i] = 0;
+    }
+    _pool_stats.flushes++;
+}
 
 void *lua_scripts::alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
-    (void)ud; (void)osize;  /* not used */
-    return hal.util->heap_realloc(_heap, ptr, nsize);
+    (void)ud;  /* not used */
+
+    // for new objects Lua passes the object type in osize
+    const size_t old_size = (ptr == nullptr) ? 0 : osize;
+
+    _heap_used = _heap_used + nsize - old_size;
+
+    if (_running != nullptr && nsize > old_size) {
+        if (ptr == nullptr) {
+            _running->profile.alloc_count++;
+        }
+        _running->profile.alloc_bytes += nsize - old_size;
+        _running->profile.heap_high_water = MAX(_running->profile.heap_high_water, _heap_used);
+    }
+
+    const uint8_t old_class = pool_class(old_size);
+    const uint8_t new_class = pool_class(nsize);
+
+    if (old_class == SCRIPTING_POOL_CLASSES && new_class == SCRIPTING_POOL_CLASSES) {
+        // neither block is pooled, let the heap handle it
+        void *ret = hal.util->heap_realloc(_heap, ptr, nsize);
+        if (ret == nullptr && nsize != 0) {
+            pool_flush();
+            ret = hal.util->heap_realloc(_heap, ptr, nsize);
+        }
+        return ret;
+    }
+
+    if (old_class == new_class) {
+        // the existing block already covers the whole class
+        return ptr;
+    }
+
+    void *ret = nullptr;
+    if (nsize != 0) {
+        ret = pool_take(new_class, nsize);
+        if (ret == nullptr) {
+            // Lua assumes shrinking can't fail, and the old block is
+            // larger than the class it will be returned to
+            return (nsize <= old_size) ? ptr : nullptr;
+        }
+        if (ptr != nullptr) {
+            memcpy(ret, ptr, MIN(old_size, nsize));
+        }
+    }
+    if (ptr != nullptr) {
+        pool_give(old_class, ptr);
+    }
+    return ret;
+}
+
+bool lua_scripts::set_priority(Priority priority) {
+    if (_running == nullptr) {
+        return false;
+    }
+    _running->priority = priority;
+    return true;
+}
+
+bool lua_scripts::set_budget_us(uint32_t budget_us) {
+    if (_running == nullptr) {
+        return false;
+    }
+    _running->budget_us = budget_us;
+    return true;
+}
+
+void lua_scripts::profile_info(ExpandingString &str) {
+    str.printf("Pool hits=%u misses=%u flushes=%u\n",
+               (unsigned)_pool_stats.hits,
+               (unsigned)_pool_stats.misses,
+               (unsigned)_pool_stats.flushes);
+
+    WITH_SEMAPHORE(_list_sem);
+
+    // the running script has been taken out of the list
+    if (_running != nullptr) {
+        print_script_info(str, *_running, true);
+    }
+    for (script_info *script = scripts; script != nullptr; script = script->next) {
+        print_script_info(str, *script, false);
+    }
+}
+
+void lua_scripts::print_script_info(ExpandingString &str, const script_info &script, bool running) {
+    str.printf("%-24.24s prio=%u runs=%u insn=%u insn_total=%llu allocs=%u alloc_bytes=%u heap_hw=%u "
+               "time=%u time_max=%u time_total=%llu budget=%u overruns=%u%s\n",
+               script.name,
+               (unsigned)script.priority,
+               (unsigned)script.profile.run_count,
+               (unsigned)script.profile.vm_instructions,
+               (unsigned long long)script.profile.vm_instructions_total,
+               (unsigned)script.profile.alloc_count,
+               (unsigned)script.profile.alloc_bytes,
+               (unsigned)script.profile.heap_high_water,
+               (unsigned)script.profile.runtime_us,
+               (unsigned)script.profile.runtime_max_us,
+               (unsigned long long)script.profile.runtime_total_us,
+               (unsigned)script.budget_us,
+               (unsigned)script.profile.overruns,
+               running ? " running" : "");
 }
 
 void lua_scripts::repl_cleanup (void) {
@@ -348,7 +628,11 @@ void lua_scripts::run(void) {
         for (script_info *script = scripts; script != nullptr; script = scripts) {
             remove_script(nullptr, script);
         }
-        scripts = nullptr;
+        {
+            WITH_SEMAPHORE(_list_sem);
+            scripts = nullptr;
+            _running = nullptr;
+        }
         overtime = false;
         // end any open REPL sessions
         repl_cleanup();
@@ -409,19 +693,21 @@ void lua_scripts::run(void) {
 #endif // defined(AP_SCRIPTING_CHECKS) && AP_SCRIPTING_CHECKS >= 1
 
             // compute delay time
-            uint64_t now_ms = AP_HAL::millis64();
-            if (now_ms < scripts->next_run_ms) {
-                hal.scheduler->delay(scripts->next_run_ms - now_ms);
+            uint32_t wait_ms = 0;
+            script_info *next = select_next_script(AP_HAL::millis64(), wait_ms);
+            if (next == nullptr) {
+                hal.scheduler->delay(wait_ms);
+                continue;
             }
 
             if (_debug_level > 1) {
-                gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: Running %s", scripts->name);
+                gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: Running %s", next->name);
             }
 
             const int startMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
             const uint32_t loadEnd = AP_HAL::micros();
 
-            run_next_script(L);
+            run_next_script(L, next);
 
             const uint32_t runEnd = AP_HAL::micros();
             const int endMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
@@ -15,6 +15,8 @@
 #pragma once
 
 #include <AP_Common/AP_Common.h>
+#include <AP_Common/ExpandingString.h>
+#include <AP_HAL/Semaphores.h>
 #include <AP_Param/AP_Param.h>
 #include <setjmp.h>
 
@@ -38,6 +40,41 @@
   #endif //HAL_OS_FATFS_IO
 #endif // SCRIPTING_DIRECTORY
 
+// small Lua heap blocks are pooled in classes of this many bytes
+#ifndef SCRIPTING_POOL_GRANULE
+  #define SCRIPTING_POOL_GRANULE 16
+#endif // SCRIPTING_POOL_GRANULE
+
+// number of pooled size classes, the default covers the userdata for
+// Vector2f, Vector3f and Location on both 32 and 64 bit targets
+#ifndef SCRIPTING_POOL_CLASSES
+  #define SCRIPTING_POOL_CLASSES 4
+#endif // SCRIPTING_POOL_CLASSES
+
+// maximum number of free blocks held in each class
+#ifndef SCRIPTING_POOL_MAX_BLOCKS
+  #define SCRIPTING_POOL_MAX_BLOCKS 32
+#endif // SCRIPTING_POOL_MAX_BLOCKS
+
+// the VM hook counts instructions in steps of this many, so the
+// per script profile is only this precise
+#ifndef SCRIPTING_VM_HOOK_STEPS
+  #define SCRIPTING_VM_HOOK_STEPS 250
+#endif // SCRIPTING_VM_HOOK_STEPS
+
+// maximum random delay added when rescheduling normal and low priority
+// scripts that have a budget, so that scripts with the same period drift
+// apart
+#ifndef SCRIPTING_JITTER_MAX_MS
+  #define SCRIPTING_JITTER_MAX_MS 5
+#endif // SCRIPTING_JITTER_MAX_MS
+
+// longest time a due script can be held back to keep a higher
+// priority script on time
+#ifndef SCRIPTING_MAX_HOLDOFF_MS
+  #define SCRIPTING_MAX_HOLDOFF_MS 100
+#endif // SCRIPTING_MAX_HOLDOFF_MS
+
 #ifndef REPL_IN
   #define REPL_IN REPL_DIRECTORY "/in"
 #endif // REPL_IN
@@ -49,7 +86,7 @@
 class lua_scripts
 {
 public:
-    lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, const AP_Int8 &debug_level, struct AP_Scripting::terminal_s &_terminal);
+    lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, const AP_Int8 &debug_level, const AP_Int32 &budget_us, struct AP_Scripting::terminal_s &_terminal);
 
     /* Do not allow copies */
     lua_scripts(const lua_scripts &other) = delete;
@@ -62,6 +99,21 @@ public:
     void run(void);
 
     static bool overtime; // script exceeded it's execution slot, and we are bailing out
+
+    // report per script profiling information
+    void profile_info(ExpandingString &str);
+
+    enum class Priority : uint8_t {
+        LOW    = 0,
+        NORMAL = 1,
+        HIGH   = 2,
+    };
+
+    // change the scheduling of the script that is currently running,
+    // returns false if called outside of a script
+    static bool set_priority(Priority priority);
+    static bool set_budget_us(uint32_t budget_us);
+
 private:
 
     void create_sandbox(lua_State *L);
@@ -72,6 +124,21 @@ private:
        int lua_ref;          // reference to the loaded script object
        uint64_t next_run_ms; // time (in milliseconds) the script should next be run at
        char *name;           // filename for the script // FIXME: This information should be available from Lua
+       uint32_t budget_us;   // CPU time a single run may take before it is counted as an overrun, 0 for no limit
+       uint32_t runtime_est_us; // slowly decaying worst case runtime, used to avoid delaying higher priority scripts
+       Priority priority;
+       struct {
+           uint32_t run_count;       // number of times the script has been run
+           uint32_t vm_instructions; // VM instructions executed by the last run
+           uint64_t vm_instructions_total;
+           uint32_t alloc_count;     // heap allocations made while the script was running
+           uint32_t alloc_bytes;
+           uint32_t runtime_us;      // duration of the last run
+           uint32_t runtime_max_us;
+           uint64_t runtime_total_us;
+           uint32_t overruns;        // runs that exceeded budget_us
+           uint32_t heap_high_water; // largest Lua heap usage seen while the script was running
+       } profile;
        script_info *next;
     } script_info;
 
@@ -81,10 +148,17 @@ private:
 
     void load_all_scripts_in_dir(lua_State *L, const char *dirname);
 
-    void run_next_script(lua_State *L);
+    // select the script that should be run next, returns nullptr and
+    // sets wait_ms if nothing should be run yet
+    script_info *select_next_script(uint64_t now_ms, uint32_t &wait_ms) const;
+
+    void run_next_script(lua_State *L, script_info *script);
 
     void remove_script(lua_State *L, script_info *script);
 
+    // take the script out of the scheduled list, the list semaphore must be held
+    void dequeue_script(script_info *script);
+
     // reschedule the script for execution. It is assumed the script is not in the list already
     void reschedule_script(script_info *script);
 
@@ -104,9 +178,21 @@ private:
 
     script_info *scripts; // linked list of scripts to be run, sorted by next run time (soonest first)
 
-    // hook will be run when CPU time for a script is exceeded
+    // script currently being run, allocations are charged to it
+    static script_info *_running;
+
+    // protects the scripts list against profile_info()
+    HAL_Semaphore _list_sem;
+
+    void print_script_info(ExpandingString &str, const script_info &script, bool running);
+
+    // hook will be run every SCRIPTING_VM_HOOK_STEPS instructions to count
+    // them, and raises an error once the script has run out of CPU time.
     // it must be static to be passed to the C API
     static void hook(lua_State *L, lua_Debug *ar);
+    static uint32_t _hook_executed; // instructions run by the current script
+    static uint32_t _hook_limit;    // instructions the script may run
+    static uint32_t _hook_steps;    // instructions until the next hook call
 
     // lua panic handler, will jump back to the start of run
     static int atpanic(lua_State *L);
@@ -116,8 +202,29 @@ private:
 
     const AP_Int32 & _vm_steps;
     const AP_Int8 & _debug_level;
+    const AP_Int32 & _budget_us;
 
     static void *alloc(void *ud, void *ptr, size_t osize, size_t nsize);
 
     static void *_heap;
+    static size_t _heap_used; // bytes currently allocated to Lua
+
+    // free lists of small heap blocks. Short lived userdata such as
+    // Vector3f and Location are created and collected at a high rate,
+    // so they are recycled here rather than going back to the heap
+    struct pool_block {
+        pool_block *next;
+    };
+    static pool_block *_pool[SCRIPTING_POOL_CLASSES];
+    static uint8_t _pool_count[SCRIPTING_POOL_CLASSES];
+    static struct pool_stats {
+        uint32_t hits;
+        uint32_t misses;
+        uint32_t flushes;
+    } _pool_stats;
+
+    static uint8_t pool_class(size_t size);
+    static void *pool_take(uint8_t pool_class, size_t size);
+    static void pool_give(uint8_t pool_class, void *ptr);
+    static void pool_flush(void);
 };
@@ -30,8 +30,8 @@ const AP_Param::GroupInfo AP_SmartRTL::var_info[] = {
 
     // @Param: POINTS
     // @DisplayName: SmartRTL maximum number of points on path
-    // @Description: SmartRTL maximum number of points on path. Set to 0 to disable SmartRTL.  100 points consumes about 3k of memory.
-    // @Range: 0 500
+    // @Description: SmartRTL maximum number of points on path. Set to 0 to disable SmartRTL. Each point uses about 30 bytes of memory, so 5000 points use about 150kB.
+    // @Range: 0 5000
     // @User: Advanced
     // @RebootRequired: True
     AP_GROUPINFO("POINTS", 1, AP_SmartRTL, _points_max, SMARTRTL_POINTS_DEFAULT),
@@ -55,7 +55,10 @@ const AP_Param::GroupInfo AP_SmartRTL::var_info[] = {
 *    points when their line segments get close. This algorithm will never
 *    compare two consecutive line segments. Obviously the segments (p1,p2) and
 *    (p2,p3) will get very close (they touch), but there would be nothing to
-*    trim between them.
+*    trim between them.  The segments already on the path are kept in a spatial
+*    hash of horizontal cells, so each new segment is only compared with the
+*    segments passing through the cells around it.  This keeps pruning close to
+*    linear in the number of points.
 *
 *    2. Simplification uses the Ramer-Douglas-Peucker algorithm. See Wikipedia
 *    for a more complete description.
@@ -108,16 +111,34 @@ void AP_SmartRTL::init()
     _simplify.stack_max = _points_max * SMARTRTL_SIMPLIFY_STACK_LEN_MULT;
     _simplify.stack = (simplify_start_finish_t*)calloc(_simplify.stack_max, sizeof(simplify_start_finish_t));
 
+    // one bucket for every two points, rounded up to a power of two
+    uint16_t num_buckets = 16;
+    while (num_buckets < _points_max / 2) {
+        num_buckets <<= 1;
+    }
+    _prune.buckets_mask = num_buckets - 1;
+    _prune.buckets = (uint16_t*)calloc(num_buckets, sizeof(uint16_t));
+
+    _prune.entries_max = _points_max * SMARTRTL_PRUNING_HASH_ENTRIES_MULT;
+    _prune.entries = (prune_hash_entry_t*)calloc(_prune.entries_max, sizeof(prune_hash_entry_t));
+
     // check if memory allocation failed
-    if (_path == nullptr || _prune.loops == nullptr || _simplify.stack == nullptr) {
+    if (_path == nullptr || _prune.loops == nullptr || _simplify.stack == nullptr ||
+        _prune.buckets == nullptr || _prune.entries == nullptr) {
         log_action(SRTL_DEACTIVATED_INIT_FAILED);
         gcs().send_text(MAV_SEVERITY_WARNING, "SmartRTL deactivated: init failed");
         free(_path);
         free(_prune.loops);
         free(_simplify.stack);
+        free(_prune.buckets);
+        free(_prune.entries);
+        _path = nullptr;
         return;
     }
 
+    // start with an empty pruning hash
+    reset_pruning();
+
     _path_points_max = _points_max;
 
     // when running the example sketch, we want the cleanup tasks to run when we tell them to, not in the background (so that they can be timed.)
@@ -394,6 +415,8 @@ void AP_SmartRTL::routine_cleanup(uint16_t path_points_count, uint16_t path_poin
     }
     if (_prune.path_points_completed > path_points_completed_limit) {
         _prune.path_points_completed = path_points_completed_limit;
+        // drop segments whose end point has been popped from the pruning hash
+        prune_hash_truncate(path_points_completed_limit > 0 ? path_points_completed_limit - 1 : 0);
     }
 
     // calculate the number of points we could simplify
@@ -525,7 +548,8 @@ void AP_SmartRTL::detect_simplifications()
 /**
 *   This method runs for the allotted time, and detects loops in a path. Any detected loops are added to _prune.loops,
 *   this function does not alter the path in memory. It works by comparing the line segment between any two sequential points
-*   to the line segment between any other two sequential points. If they get close enough, anything between them could be pruned.
+*   to the line segment between any earlier two sequential points. If they get close enough, anything between them could be pruned.
+*   Only earlier segments which the pruning hash places near the new segment are compared.
 *
 *   reset_pruning should have been called at least once before this function is called to setup the indexes (_prune.i, etc)
 */
@@ -537,39 +561,175 @@ void AP_SmartRTL::detect_loops()
         return;
     }
 
+    // the cells must be wide enough that segments within SMARTRTL_PRUNING_DELTA of each
+    // other are in neighbouring cells.  _ACCURACY may have been raised since the hash was built
+    if (_prune.cell_size < 2.0f * SMARTRTL_PRUNING_DELTA) {
+        _prune.cell_size = SMARTRTL_PRUNING_CELL_SIZE;
+        prune_hash_truncate(0);
+    }
+
     // capture start time
     const uint32_t start_time_us = AP_HAL::micros();
 
     // run for defined amount of time
     while (AP_HAL::micros() - start_time_us < SMARTRTL_PRUNING_LOOP_TIME_US) {
 
-        // advance inner loop
-        _prune.j++;
-        if (_prune.j > _prune.i - 2) {
-            // set inner loop back to first point
-            _prune.j = 1;
-            // reduce outer loop
-            _prune.i--;
-            // complete when outer loop has run out of new points to check
-            if (_prune.i < 4 || _prune.i < _prune.path_points_completed) {
-                _prune.complete = true;
-                _prune.path_points_completed = _prune.path_points_count;
-                return;
+        // complete when outer loop has run out of new points to check
+        if (_prune.i < 4 || _prune.i < _prune.path_points_completed) {
+            _prune.complete = true;
+            _prune.path_points_completed = _prune.path_points_count;
+            return;
+        }
+
+        // the hash must hold every segment up to the one before the segment being checked.
+        // it may hold later segments too, these are skipped by find_loop
+        if (_prune.segments_hashed + 2 < _prune.i) {
+            if (!prune_hash_add(_prune.segments_hashed + 1)) {
+                // out of entries so rebuild the hash with larger cells
+                _prune.cell_size *= 2.0f;
+                prune_hash_truncate(0);
             }
+            continue;
         }
 
-        // find the closest distance between two line segments and the mid-point
-        dist_point dp = segment_segment_dist(_path[_prune.i], _path[_prune.i-1], _path[_prune.j-1], _path[_prune.j]);
-        if (dp.distance < SMARTRTL_PRUNING_DELTA) {
+        uint16_t loop_start;
+        Vector3f midpoint;
+        if (find_loop(_prune.i, loop_start, midpoint)) {
             // if there is a loop here, add to loop array
-            if (!add_loop(_prune.j, _prune.i-1, dp.midpoint)) {
+            if (!add_loop(loop_start, _prune.i-1, midpoint)) {
                 // if the buffer is full, stop trying to prune
                 _prune.complete = true;
+                return;
+            }
+        }
+
+        // move to the previous segment
+        _prune.i--;
+    }
+}
+
+// find the earliest segment which comes close enough to segment i (from point i-1 to point i) to form a loop
+//  returns true if a loop was found, with the loop's start index and the midpoint which should replace it
+bool AP_SmartRTL::find_loop(uint16_t i, uint16_t &loop_start, Vector3f &midpoint) const
+{
+    const Vector3f &p1 = _path[i];
+    const Vector3f &p2 = _path[i-1];
+    const float delta = SMARTRTL_PRUNING_DELTA;
+    const Vector3f bounds_min(MIN(p1.x, p2.x) - delta, MIN(p1.y, p2.y) - delta, MIN(p1.z, p2.z) - delta);
+    const Vector3f bounds_max(MAX(p1.x, p2.x) + delta, MAX(p1.y, p2.y) + delta, MAX(p1.z, p2.z) + delta);
+
+    // step along the segment at most half a cell at a time.  Any earlier segment passing within
+    // delta of this one was added to a cell next to one of the cells these steps land in
+    const Vector2f line(p1.x - p2.x, p1.y - p2.y);
+    const uint32_t steps = MAX(ceilf(line.length() / (_prune.cell_size * 0.5f)), 1.0f);
+
+    uint16_t best_j = i - 1;
+    int32_t last_cell_x = INT32_MAX, last_cell_y = INT32_MAX;
+    for (uint32_t s = 0; s <= steps; s++) {
+        const float t = float(s) / steps;
+        const int32_t cell_x = floorf((p2.x + line.x * t) / _prune.cell_size);
+        const int32_t cell_y = floorf((p2.y + line.y * t) / _prune.cell_size);
+        if (cell_x == last_cell_x && cell_y == last_cell_y) {
+            continue;
+        }
+        last_cell_x = cell_x;
+        last_cell_y = cell_y;
+
+        for (int8_t dx = -1; dx <= 1; dx++) {
+            for (int8_t dy = -1; dy <= 1; dy++) {
+                uint16_t e = _prune.buckets[prune_hash_bucket(cell_x + dx, cell_y + dy)];
+                for (; e != SMARTRTL_PRUNING_HASH_NONE; e = _prune.entries[e].next) {
+                    // only the earliest segment is of interest as it gives the longest loop
+                    const uint16_t j = _prune.entries[e].segment;
+                    if (j >= best_j) {
+                        continue;
+                    }
+                    // quickly discard segments which are not near this one
+                    const Vector3f &p3 = _path[j-1];
+                    const Vector3f &p4 = _path[j];
+                    if (MAX(p3.x, p4.x) < bounds_min.x || MIN(p3.x, p4.x) > bounds_max.x ||
+                        MAX(p3.y, p4.y) < bounds_min.y || MIN(p3.y, p4.y) > bounds_max.y ||
+                        MAX(p3.z, p4.z) < bounds_min.z || MIN(p3.z, p4.z) > bounds_max.z) {
+                        continue;
+                    }
+                    // find the closest distance between two line segments and the mid-point
+                    const dist_point dp = segment_segment_dist(p1, p2, p3, p4);
+                    if (dp.distance < delta) {
+                        best_j = j;
+                        midpoint = dp.midpoint;
+                    }
+                }
             }
-            // set inner loop forward to trigger outer loop move to next segment
-            _prune.j = _prune.i;
         }
     }
+
+    if (best_j >= i - 1) {
+        return false;
+    }
+    loop_start = best_j;
+    return true;
+}
+
+// add the segment ending at point i to the pruning hash, returns false if the hash is full
+bool AP_SmartRTL::prune_hash_add(uint16_t i)
+{
+    const Vector3f &p1 = _path[i-1];
+    const Vector3f &p2 = _path[i];
+    const Vector2f line(p2.x - p1.x, p2.y - p1.y);
+    const uint32_t steps = MAX(ceilf(line.length() / (_prune.cell_size * 0.5f)), 1.0f);
+    if (steps >= _prune.entries_max) {
+        return false;
+    }
+
+    // add an entry for each cell the steps along the segment land in.  A straight line
+    // never returns to a cell, so only consecutive steps can share one
+    int32_t last_cell_x = INT32_MAX, last_cell_y = INT32_MAX;
+    for (uint32_t s = 0; s <= steps; s++) {
+        const float t = float(s) / steps;
+        const int32_t cell_x = floorf((p1.x + line.x * t) / _prune.cell_size);
+        const int32_t cell_y = floorf((p1.y + line.y * t) / _prune.cell_size);
+        if (cell_x == last_cell_x && cell_y == last_cell_y) {
+            continue;
+        }
+        last_cell_x = cell_x;
+        last_cell_y = cell_y;
+
+        if (_prune.entries_count >= _prune.entries_max) {
+            // undo this segment's entries
+            prune_hash_truncate(i - 1);
+            return false;
+        }
+        const uint16_t bucket = prune_hash_bucket(cell_x, cell_y);
+        _prune.entries[_prune.entries_count] = prune_hash_entry_t {i, _prune.buckets[bucket]};
+        _prune.buckets[bucket] = _prune.entries_count++;
+    }
+    _prune.segments_hashed = i;
+    return true;
+}
+
+// remove all segments after the segment ending at point i from the pruning hash
+void AP_SmartRTL::prune_hash_truncate(uint16_t i)
+{
+    // entries were added in path order so the segments to remove are at the end
+    const uint16_t entries_count = _prune.entries_count;
+    while (_prune.entries_count > 0 && _prune.entries[_prune.entries_count-1].segment > i) {
+        _prune.entries_count--;
+    }
+    // and at the head of each bucket
+    if (_prune.entries_count != entries_count) {
+        for (uint16_t b = 0; b <= _prune.buckets_mask; b++) {
+            while (_prune.buckets[b] != SMARTRTL_PRUNING_HASH_NONE && _prune.buckets[b] >= _prune.entries_count) {
+                _prune.buckets[b] = _prune.entries[_prune.buckets[b]].next;
+            }
+        }
+    }
+    _prune.segments_hashed = MIN(_prune.segments_hashed, i);
+}
+
+// return the pruning hash bucket for a cell
+uint16_t AP_SmartRTL::prune_hash_bucket(int32_t cell_x, int32_t cell_y) const
+{
+    return ((uint32_t(cell_x) * 73856093U) ^ (uint32_t(cell_y) * 19349663U)) & _prune.buckets_mask;
 }
 
 // restart simplify if new points have been added to path
@@ -613,16 +773,23 @@ void AP_SmartRTL::restart_pruning(uint16_t path_points_count)
 {
     _prune.complete = false;
     _prune.i = (path_points_count > 0) ? path_points_count - 1 : 0;
-    _prune.j = 0;
     _prune.path_points_count = path_points_count;
 }
 
 // reset pruning algorithm so that it will re-check all points in the path
 void AP_SmartRTL::reset_pruning()
 {
+    _prune.path_points_completed = 0;
     restart_pruning(0);
     _prune.loops_count = 0; // clear the loops that we've recorded
-    _prune.path_points_completed = 0;
+    _prune.cell_size = SMARTRTL_PRUNING_CELL_SIZE;
+    _prune.entries_count = 0;
+    _prune.segments_hashed = 0;
+    if (_prune.buckets != nullptr) {
+        for (uint16_t b = 0; b <= _prune.buckets_mask; b++) {
+            _prune.buckets[b] = SMARTRTL_PRUNING_HASH_NONE;
+        }
+    }
 }
 
 // remove all simplify-able points from the path
@@ -632,9 +799,14 @@ void AP_SmartRTL::remove_points_by_simplify_bitmask()
     if (!_path_sem.take_nonblocking()) {
         return;
     }
-    uint16_t dest = 1;
+    // skip to the first point to be removed, only the newly simplified points can have been
+    uint16_t first_removed = 1;
+    while (first_removed < _path_points_count && _simplify.bitmask.get(first_removed)) {
+        first_removed++;
+    }
+    uint16_t dest = first_removed;
     uint16_t removed = 0;
-    for (uint16_t src = 1; src < _path_points_count; src++) {
+    for (uint16_t src = first_removed; src < _path_points_count; src++) {
         if (!_simplify.bitmask.get(src)) {
             log_action(SRTL_POINT_SIMPLIFY, _path[src]);
             removed++;
@@ -656,6 +828,9 @@ void AP_SmartRTL::remove_points_by_simplify_bitmask()
 
     _path_sem.give();
 
+    // segments from the first removed point onwards have moved
+    prune_hash_truncate(first_removed - 1);
+
     // flag point removal is complete
     _simplify.bitmask.setall();
     _simplify.removal_required = false;
@@ -676,47 +851,70 @@ bool AP_SmartRTL::remove_points_by_loops(uint16_t num_points_to_remove)
         return false;
     }
 
+    // take loops from the end of the array until enough points will be removed
+    uint16_t first = _prune.loops_count;
     uint16_t removed_points = 0;
-    uint16_t i = _prune.loops_count;
-    while ((i > 0) && (removed_points < num_points_to_remove)) {
-        i--;
-        prune_loop_t loop = _prune.loops[i];
-
-        // midpoint goes into start_index (this is the end point of the first segment)
-        _path[loop.start_index] = loop.midpoint;
-
-        // shift points after the end of the loop down by the number of points in the loop
-        uint16_t loop_num_points_to_remove = loop.end_index - loop.start_index;
-        for (uint16_t dest = loop.start_index + 1; dest < _path_points_count - loop_num_points_to_remove; dest++) {
-            log_action(SRTL_POINT_PRUNE, _path[dest]);
-            _path[dest] = _path[dest + loop_num_points_to_remove];
-        }
+    while ((first > 0) && (removed_points < num_points_to_remove)) {
+        first--;
+        removed_points += _prune.loops[first].end_index - _prune.loops[first].start_index;
+    }
 
-        if (_path_points_count > loop_num_points_to_remove) {
-            _path_points_count -= loop_num_points_to_remove;
-            removed_points += loop_num_points_to_remove;
-        } else {
-            // this is an error that should never happen so deactivate
-            deactivate(SRTL_DEACTIVATED_PROGRAM_ERROR, "program error");
-            _path_sem.give();
-            // we return true so thorough_cleanup does not get stuck
-            return true;
-        }
+    if (removed_points >= _path_points_count) {
+        // this is an error that should never happen so deactivate
+        deactivate(SRTL_DEACTIVATED_PROGRAM_ERROR, "program error");
+        _path_sem.give();
+        // we return true so thorough_cleanup does not get stuck
+        return true;
+    }
 
-        // fix the indices of any existing prune loops
-        // we do not check for overlapping loops because add_loops should have caught them
-        for (uint16_t loop_cnt = 0; loop_cnt < i; loop_cnt++) {
-            if (_prune.loops[loop_cnt].start_index >= loop.end_index) {
-                _prune.loops[loop_cnt].start_index -= loop_num_points_to_remove;
-            }
-            if (_prune.loops[loop_cnt].end_index >= loop.end_index) {
-                _prune.loops[loop_cnt].end_index -= loop_num_points_to_remove;
-            }
+    // sort the loops being removed by start index so the path can be closed up in a single pass
+    // add_loop ensures no two loops overlap
+    for (uint16_t i = first + 1; i < _prune.loops_count; i++) {
+        const prune_loop_t loop = _prune.loops[i];
+        uint16_t j = i;
+        while (j > first && _prune.loops[j-1].start_index > loop.start_index) {
+            _prune.loops[j] = _prune.loops[j-1];
+            j--;
         }
+        _prune.loops[j] = loop;
+    }
 
-        // remove last prune loop from array
-        _prune.loops_count--;
+    // midpoint goes into each loop's start_index (this is the end point of the first segment)
+    // and the points after it up to the loop's end_index are removed
+    uint16_t dest = _prune.loops[first].start_index;
+    uint16_t src = dest;
+    for (uint16_t i = first; i < _prune.loops_count; i++) {
+        const prune_loop_t &loop = _prune.loops[i];
+        while (src < loop.start_index) {
+            _path[dest++] = _path[src++];
+        }
+        _path[dest++] = loop.midpoint;
+        for (src = loop.start_index + 1; src <= loop.end_index; src++) {
+            log_action(SRTL_POINT_PRUNE, _path[src]);
+        }
+    }
+    while (src < _path_points_count) {
+        _path[dest++] = _path[src++];
     }
+    _path_points_count -= removed_points;
+
+    // fix the indices of the remaining prune loops
+    // we do not check for overlapping loops because add_loops should have caught them
+    for (uint16_t loop_cnt = 0; loop_cnt < first; loop_cnt++) {
+        prune_loop_t &remaining = _prune.loops[loop_cnt];
+        uint16_t shift = 0;
+        for (uint16_t i = first; i < _prune.loops_count && _prune.loops[i].end_index <= remaining.start_index; i++) {
+            shift += _prune.loops[i].end_index - _prune.loops[i].start_index;
+        }
+        remaining.start_index -= shift;
+        remaining.end_index -= shift;
+    }
+
+    // segments from the first loop onwards have moved
+    prune_hash_truncate(_prune.loops[first].start_index - 1);
+
+    // remove the pruned loops from array
+    _prune.loops_count = first;
 
     _path_sem.give();
     return true;
@@ -6,8 +6,14 @@
 
 // definitions and macros
 #define SMARTRTL_ACCURACY_DEFAULT        2.0f   // default _ACCURACY parameter value.  Points will be no closer than this distance (in meters) together.
-#define SMARTRTL_POINTS_DEFAULT          300    // default _POINTS parameter value.  High numbers improve path pruning but use more memory and CPU for cleanup. Memory used will be 20bytes * this number.
-#define SMARTRTL_POINTS_MAX              500    // the absolute maximum number of points this library can support.
+#define SMARTRTL_POINTS_DEFAULT          300    // default _POINTS parameter value.  High numbers improve path pruning but use more memory and CPU for cleanup. Memory used will be 30bytes * this number.
+#ifndef SMARTRTL_POINTS_MAX
+#if HAL_MEM_CLASS >= HAL_MEM_CLASS_300
+#define SMARTRTL_POINTS_MAX              5000   // the absolute maximum number of points this library can support.
+#else
+#define SMARTRTL_POINTS_MAX              500
+#endif
+#endif
 #define SMARTRTL_TIMEOUT                 15000  // the time in milliseconds with no points saved to the path (for whatever reason), before SmartRTL is disabled for the flight
 #define SMARTRTL_CLEANUP_POINT_TRIGGER   50     // simplification will trigger when this many points are added to the path
 #define SMARTRTL_CLEANUP_START_MARGIN    10     // routine cleanup algorithms begin when the path array has only this many empty slots remaining
@@ -20,6 +26,9 @@
 #define SMARTRTL_PRUNING_DELTA (_accuracy * 0.99)   // How many meters apart must two points be, such that we can assume that there is no obstacle between them.  must be smaller than _ACCURACY parameter
 #define SMARTRTL_PRUNING_LOOP_BUFFER_LEN_MULT 0.25f // pruning loop buffer size as compared to maximum number of points
 #define SMARTRTL_PRUNING_LOOP_TIME_US    200    // maximum time (in microseconds) that the loop finding algorithm will run before returning
+#define SMARTRTL_PRUNING_CELL_SIZE (_accuracy * 2.0f)   // starting width in meters of the pruning hash cells.  must be at least twice SMARTRTL_PRUNING_DELTA
+#define SMARTRTL_PRUNING_HASH_ENTRIES_MULT 2    // pruning hash entries as compared to maximum number of points
+#define SMARTRTL_PRUNING_HASH_NONE       UINT16_MAX // marks the end of a pruning hash bucket
 
 class AP_SmartRTL {
 
@@ -140,6 +149,19 @@ private:
     // returns false if it failed to remove points (because it could not take semaphore)
     bool remove_points_by_loops(uint16_t num_points_to_remove);
 
+    // find the earliest segment which comes close enough to segment i (from point i-1 to point i) to form a loop
+    //  returns true if a loop was found, with the loop's start index and the midpoint which should replace it
+    bool find_loop(uint16_t i, uint16_t &loop_start, Vector3f &midpoint) const;
+
+    // add the segment ending at point i to the pruning hash, returns false if the hash is full
+    bool prune_hash_add(uint16_t i);
+
+    // remove all segments after the segment ending at point i from the pruning hash
+    void prune_hash_truncate(uint16_t i);
+
+    // return the pruning hash bucket for a cell
+    uint16_t prune_hash_bucket(int32_t cell_x, int32_t cell_y) const;
+
     // add loop to loops array
     //  returns true if loop added successfully, false on failure (because loop array is full)
     //  checks if loop overlaps with an existing loop, keeps only the longer loop
@@ -207,15 +229,30 @@ private:
         Vector3f midpoint;      // midpoint which should replace the first point when the loop is removed
         float length_squared;   // length squared (in meters) of the loop (used so we can remove the longest loops)
     } prune_loop_t;
+    // entry in the pruning hash, placing a path segment in a cell
+    typedef struct {
+        uint16_t segment;   // index of the point at the end of the segment
+        uint16_t next;      // next entry in the same bucket, or SMARTRTL_PRUNING_HASH_NONE
+    } prune_hash_entry_t;
     struct {
         bool complete;
         uint16_t path_points_count;  // copy of _path_points_count taken when the prune algorithm started
         uint16_t path_points_completed; // number of points in that path that have already been checked for loops and should be ignored
-        uint16_t i;     // loop search's outer loop index
-        uint16_t j;     // loop search's inner loop index
+        uint16_t i;     // loop search's next segment to check (the index of the point at its end)
         prune_loop_t* loops;// the result of the pruning algorithm
         uint16_t loops_max; // maximum number of elements in the _prunable_loops array
         uint16_t loops_count;   // number of elements in the _prunable_loops array
+
+        // spatial hash of the segments already on the path, so each new segment is only
+        // compared with the segments which pass near it.  Segments are hashed by the horizontal
+        // cells they cross, and only the segments ending at points 1 to segments_hashed are held
+        float cell_size;            // width in meters of the square cells
+        uint16_t* buckets;          // newest entry in each bucket, or SMARTRTL_PRUNING_HASH_NONE
+        uint16_t buckets_mask;      // number of buckets minus one, the number of buckets is a power of two
+        prune_hash_entry_t* entries;// entries in the order they were added
+        uint16_t entries_max;       // maximum number of elements in the entries array
+        uint16_t entries_count;     // number of elements in the entries array
+        uint16_t segments_hashed;   // index of the point at the end of the last segment in the hash
     } _prune;
 
     // returns true if the two loops overlap (used within add_loop to determine which loops to keep or throw away)
@@ -27,11 +27,16 @@ static DummyVehicle vehicle;
 
 AP_AHRS_NavEKF &ahrs(vehicle.ahrs);
 AP_SmartRTL smart_rtl{true};
+AP_SmartRTL smart_rtl_long{true};
 AP_BoardConfig board_config;
 
+// number of points on the long path, which is the most SRTL_POINTS allows
+#define LONG_PATH_POINTS SMARTRTL_POINTS_MAX
+
 void setup();
 void loop();
 void reset();
+void long_path_test();
 void check_path(const std::vector<Vector3f> &correct_path, const char* test_name, uint32_t time_us);
 
 void setup()
@@ -39,6 +44,8 @@ void setup()
     hal.console->printf("SmartRTL test\n");
     board_config.init();
     smart_rtl.init();
+    AP_Param::set_object_value(&smart_rtl_long, AP_SmartRTL::var_info, "POINTS", LONG_PATH_POINTS);
+    smart_rtl_long.init();
 }
 
 void loop()
@@ -76,6 +83,9 @@ void loop()
     run_time = AP_HAL::micros() - reference_time;
     check_path(test_path_complete, "simplify and pruning", run_time);
 
+    // test simplification and pruning of a full length path
+    long_path_test();
+
     // delay before next display
     hal.scheduler->delay(5e3); // 5 seconds
 }
@@ -89,6 +99,41 @@ void reset()
     }
 }
 
+/*
+  fill smart_rtl_long with a zig-zagging outward spiral which never comes
+  back on itself, so neither simplification nor pruning can remove any
+  points and every segment has to be checked. Then fly a circle at the
+  end, which pruning should remove
+ */
+void long_path_test()
+{
+    smart_rtl_long.set_home(true, Vector3f{0.0f, 0.0f, 0.0f});
+    float angle = 0;
+    for (uint16_t i = 0; i < LONG_PATH_POINTS - 20; i++) {
+        const float radius = 20 + 20 * angle / M_2PI + (i % 2) * 5;
+        angle += 3 / radius;
+        smart_rtl_long.update(true, Vector3f{radius * cosf(angle), radius * sinf(angle), 0.0f});
+    }
+    const Vector3f end = smart_rtl_long.get_point(smart_rtl_long.get_num_points()-1);
+    for (uint8_t i = 1; i <= 10; i++) {
+        const float circle_angle = M_2PI * i / 10;
+        smart_rtl_long.update(true, end + Vector3f{5 * sinf(circle_angle), 5 - 5 * cosf(circle_angle), 0.0f});
+    }
+    const uint16_t points_before = smart_rtl_long.get_num_points();
+
+    const uint32_t reference_time = AP_HAL::micros();
+    while (!smart_rtl_long.request_thorough_cleanup(AP_SmartRTL::THOROUGH_CLEAN_ALL)) {
+        smart_rtl_long.run_background_cleanup();
+    }
+    const uint32_t run_time = AP_HAL::micros() - reference_time;
+
+    // only the circle should have been removed
+    const uint16_t points_after = smart_rtl_long.get_num_points();
+    const bool success = points_after < points_before && points_after >= points_before - 10;
+    hal.console->printf("long path: %s time:%u us\n", success ? "success" : "fail", (unsigned)run_time);
+    hal.console->printf("   %u points cleaned up to %u\n", (unsigned)points_before, (unsigned)points_after);
+}
+
 // compare the vector array passed in with the path held in the smart_rtl object
 void check_path(const std::vector<Vector3f>& correct_path, const char* test_name, uint32_t time_us)
 {
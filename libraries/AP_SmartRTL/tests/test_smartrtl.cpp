@@ -0,0 +1,136 @@
+#include <AP_gtest.h>
+
+#include <AP_SmartRTL/AP_SmartRTL.h>
+
+#include "../examples/SmartRTL_test/SmartRTL_test.h"
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  each test gets its own SmartRTL in example mode, so the cleanup only
+  runs when run_background_cleanup() is called here
+ */
+class SmartRTLTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        srtl = new AP_SmartRTL(true);
+    }
+
+    void TearDown() override {
+        delete srtl;
+    }
+
+    void init(uint16_t points) {
+        ASSERT_TRUE(AP_Param::set_object_value(srtl, AP_SmartRTL::var_info, "POINTS", points));
+        srtl->init();
+    }
+
+    // clear the path and add the points to it
+    void load_path(const std::vector<Vector3f> &points) {
+        srtl->set_home(true, Vector3f{0.0f, 0.0f, 0.0f});
+        ASSERT_TRUE(srtl->is_active());
+        for (const Vector3f &v : points) {
+            srtl->update(true, v);
+        }
+    }
+
+    // run a thorough cleanup to completion
+    void thorough_cleanup(AP_SmartRTL::ThoroughCleanupType clean_type) {
+        // requests are told apart by their time in ms, so each must be
+        // made in a later ms than the last one completed
+        const uint32_t last_ms = AP_HAL::millis();
+        while (AP_HAL::millis() == last_ms) {
+        }
+        while (!srtl->request_thorough_cleanup(clean_type)) {
+            srtl->run_background_cleanup();
+        }
+    }
+
+    void expect_path(const std::vector<Vector3f> &points) {
+        ASSERT_EQ(srtl->get_num_points(), points.size());
+        for (uint16_t i = 0; i < points.size(); i++) {
+            EXPECT_EQ(srtl->get_point(i), points[i]) << "point " << i;
+        }
+    }
+
+    AP_SmartRTL *srtl;
+};
+
+TEST_F(SmartRTLTest, example_path)
+{
+    init(SMARTRTL_POINTS_DEFAULT);
+
+    load_path(test_path_before);
+    expect_path(test_path_after_adding);
+
+    thorough_cleanup(AP_SmartRTL::THOROUGH_CLEAN_SIMPLIFY_ONLY);
+    expect_path(test_path_after_simplifying);
+
+    load_path(test_path_before);
+    thorough_cleanup(AP_SmartRTL::THOROUGH_CLEAN_ALL);
+    expect_path(test_path_complete);
+}
+
+/*
+  an outward spiral which never comes back on itself, so a long path
+  where pruning has to check every segment and finds nothing
+ */
+TEST_F(SmartRTLTest, long_path_without_loops)
+{
+    const uint16_t points = 5000;
+    init(points);
+
+    std::vector<Vector3f> path;
+    float angle = 0;
+    for (uint16_t i = 0; i < points - 1; i++) {
+        const float radius = 20 + 20 * angle / M_2PI + (i % 2) * 5;
+        angle += 3 / radius;
+        path.push_back(Vector3f{radius * cosf(angle), radius * sinf(angle), 0.0f});
+    }
+    load_path(path);
+    ASSERT_EQ(srtl->get_num_points(), points);
+
+    path.insert(path.begin(), Vector3f{0.0f, 0.0f, 0.0f});
+    thorough_cleanup(AP_SmartRTL::THOROUGH_CLEAN_ALL);
+    expect_path(path);
+}
+
+/*
+  a long path along the x axis with a circle flown every 30m, each of
+  which comes back to where it started and so is pruned
+ */
+TEST_F(SmartRTLTest, long_path_with_loops)
+{
+    const uint16_t sections = 150;
+    init(5000);
+
+    std::vector<Vector3f> path;
+    for (uint16_t s = 0; s < sections; s++) {
+        const float x = s * 30;
+        for (uint8_t i = 1; i <= 10; i++) {
+            path.push_back(Vector3f{x + i * 3, 0.0f, 0.0f});
+        }
+        for (uint8_t i = 1; i < 17; i++) {
+            const float angle = M_2PI * i / 17;
+            path.push_back(Vector3f{x + 30 + 8 * sinf(angle), 8 - 8 * cosf(angle), 0.0f});
+        }
+    }
+    load_path(path);
+    ASSERT_EQ(srtl->get_num_points(), path.size() + 1);
+
+    thorough_cleanup(AP_SmartRTL::THOROUGH_CLEAN_ALL);
+
+    // every circle is gone, leaving a path along the axis which never
+    // turns back by more than the accuracy
+    EXPECT_LT(srtl->get_num_points(), sections * 4);
+    EXPECT_GT(srtl->get_point(srtl->get_num_points()-1).x, (sections - 1) * 30);
+    for (uint16_t i = 0; i < srtl->get_num_points(); i++) {
+        const Vector3f &p = srtl->get_point(i);
+        EXPECT_LT(fabsf(p.y), SMARTRTL_ACCURACY_DEFAULT) << "point " << i;
+        if (i > 0) {
+            EXPECT_GT(p.x, srtl->get_point(i-1).x - SMARTRTL_ACCURACY_DEFAULT) << "point " << i;
+        }
+    }
+}
+
+AP_GTEST_MAIN()
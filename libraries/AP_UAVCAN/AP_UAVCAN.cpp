@@ -425,6 +425,8 @@ void AP_UAVCAN::loop(void)
 
         const int error = _node->spin(uavcan::MonotonicDuration::fromMSec(1));
 
+        esc_status_publish();
+
         if (error < 0) {
             hal.scheduler->delay_microseconds(100);
             continue;
@@ -860,24 +862,51 @@ void AP_UAVCAN::handle_ESC_status(AP_UAVCAN* ap_uavcan, uint8_t node_id, const E
                                  cb.msg->rpm,
                                  cb.msg->power_rating_pct);
 
-    WITH_SEMAPHORE(_telem_sem);
-
     if (!is_esc_data_index_valid(esc_index)) {
         return;
     }
 
-    esc_data &esc = _escs_data[esc_index];
-    esc.available = true;
+    // handlers run on this driver's thread, so the pending data
+    // needs no lock until it is published
+    esc_data &esc = ap_uavcan->_esc_status_pending[esc_index];
     esc.temp = (cb.msg->temperature - C_TO_KELVIN);
     esc.voltage = cb.msg->voltage*100;
     esc.current = cb.msg->current*100;
     esc.rpm = cb.msg->rpm;
     esc.count++;
+    ap_uavcan->_esc_status_pending_mask |= 1U << esc_index;
+}
 
+/*
+  publish the ESC status received during the last spin
+ */
+void AP_UAVCAN::esc_status_publish()
+{
+    if (_esc_status_pending_mask == 0) {
+        return;
+    }
+
+    WITH_SEMAPHORE(_telem_sem);
+
+    for (uint8_t i = 0; i < UAVCAN_SRV_NUMBER; i++) {
+        if ((_esc_status_pending_mask & (1U << i)) == 0) {
+            continue;
+        }
+        esc_data &pending = _esc_status_pending[i];
+        esc_data &esc = _escs_data[i];
+        esc.available = true;
+        esc.temp = pending.temp;
+        esc.voltage = pending.voltage;
+        esc.current = pending.current;
+        esc.rpm = pending.rpm;
+        esc.count += pending.count;
+        pending.count = 0;
+    }
+    _esc_status_pending_mask = 0;
 }
 
 bool AP_UAVCAN::is_esc_data_index_valid(const uint8_t index) {
-    if (index > UAVCAN_SRV_NUMBER) {
+    if (index >= UAVCAN_SRV_NUMBER) {
         // printf("UAVCAN: invalid esc index: %d. max index allowed: %d\n\r", index, UAVCAN_SRV_NUMBER);
         return false;
     }
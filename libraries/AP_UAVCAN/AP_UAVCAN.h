@@ -24,6 +24,7 @@
 #include "AP_UAVCAN_DNA_Server.h"
 #include "AP_UAVCAN_IfaceMgr.h"
 #include "AP_UAVCAN_Clock.h"
+#include "AP_UAVCAN_DispatchTable.h"
 #include <AP_CANManager/AP_CANDriver.h>
 #include <AP_HAL/Semaphores.h>
 #include <AP_Param/AP_Param.h>
@@ -238,6 +239,13 @@ private:
 
     static esc_data _escs_data[UAVCAN_SRV_NUMBER];
 
+    // ESC status received by this driver since the last publish,
+    // copied to _escs_data under a single semaphore acquisition
+    esc_data _esc_status_pending[UAVCAN_SRV_NUMBER];
+    uint32_t _esc_status_pending_mask;
+    static_assert(UAVCAN_SRV_NUMBER <= 32, "pending mask too small");
+    void esc_status_publish();
+
     
     // safety status send state
     uint32_t _last_safety_state_ms;
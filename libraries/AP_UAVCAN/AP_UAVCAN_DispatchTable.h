@@ -0,0 +1,155 @@
+/*
+ * This file is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  Lookup from the source of a UAVCAN message to the backend handling
+  it, for the sensor drivers' message handlers.
+
+  A source is the CAN driver index, node ID and sensor ID of a
+  message. Sources a driver has seen are added, so the handlers only
+  go through detection for sources they have not seen before. The backend of an entry is nullptr while the source is
+  waiting to be probed or when there was no free slot for it.
+
+  The table is open addressed with linear probing. Sources without a
+  backend only save a scan of the detected modules, so when the table
+  is 3/4 full they are evicted, one slot after another, to make room for new
+  sources, and a source that was evicted is simply detected again.
+  Sources with a backend are only removed by remove(). Callers protect
+  the table with their registry semaphore.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifndef AP_UAVCAN_DISPATCH_TABLE_SIZE
+#define AP_UAVCAN_DISPATCH_TABLE_SIZE 64
+#endif
+
+template <typename T, uint16_t SIZE = AP_UAVCAN_DISPATCH_TABLE_SIZE>
+class AP_UAVCAN_DispatchTable {
+public:
+    static_assert(SIZE >= 4 && (SIZE & (SIZE - 1)) == 0, "SIZE must be a power of 2");
+
+    // node IDs are 7 bit, bit 7 is always set so that zero marks an empty entry
+    static uint32_t make_key(uint8_t driver_index, uint8_t node_id, uint8_t sensor_id = 0)
+    {
+        return (uint32_t(driver_index) << 16) | (uint32_t(node_id | 0x80U) << 8) | sensor_id;
+    }
+
+    // find a source, returns false if it has not been seen
+    bool find(uint32_t key, T *&backend) const
+    {
+        const int16_t i = slot(key);
+        if (i < 0 || _entries[i].key != key) {
+            return false;
+        }
+        backend = _entries[i].backend;
+        return true;
+    }
+
+    // add a source or change its backend, returns false if there is no room
+    bool set(uint32_t key, T *backend)
+    {
+        int16_t i = slot(key);
+        if (i >= 0 && _entries[i].key == key) {
+            _entries[i].backend = backend;
+            return true;
+        }
+        if (_count >= MAX_COUNT) {
+            if (!evict()) {
+                return false;
+            }
+            // the eviction may have moved the free slot for the key
+            i = slot(key);
+        }
+        if (i < 0) {
+            return false;
+        }
+        _entries[i].key = key;
+        _entries[i].backend = backend;
+        _count++;
+        return true;
+    }
+
+    // forget a source
+    void remove(uint32_t key)
+    {
+        const int16_t i = slot(key);
+        if (i >= 0 && _entries[i].key == key) {
+            remove_slot(i);
+        }
+    }
+
+    // number of sources in the table
+    uint16_t count(void) const { return _count; }
+
+private:
+    static const uint16_t MAX_COUNT = SIZE - SIZE / 4;
+
+    static uint16_t index(uint32_t key)
+    {
+        // fibonacci hashing, the top bits are the best mixed
+        return uint16_t((key * 2654435769U) >> 16) & (SIZE - 1);
+    }
+
+    // the slot holding key, or the empty slot it would go in, or -1
+    int16_t slot(uint32_t key) const
+    {
+        uint16_t i = index(key);
+        for (uint16_t n = 0; n < SIZE; n++) {
+            if (_entries[i].key == key || _entries[i].key == 0) {
+                return i;
+            }
+            i = (i + 1) & (SIZE - 1);
+        }
+        return -1;
+    }
+
+    // remove the next source without a backend after the last one evicted
+    bool evict(void)
+    {
+        for (uint16_t n = 0; n < SIZE; n++) {
+            _evict_next = (_evict_next + 1) & (SIZE - 1);
+            if (_entries[_evict_next].key != 0 && _entries[_evict_next].backend == nullptr) {
+                remove_slot(_evict_next);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // empty a slot, shifting back the entries after it so that no
+    // probe sequence is broken by the gap
+    void remove_slot(uint16_t gap)
+    {
+        for (uint16_t i = (gap + 1) & (SIZE - 1); _entries[i].key != 0; i = (i + 1) & (SIZE - 1)) {
+            const uint16_t home = index(_entries[i].key);
+            // move the entry back if the gap is between its home and it
+            if (((i - home) & (SIZE - 1)) >= ((i - gap) & (SIZE - 1))) {
+                _entries[gap] = _entries[i];
+                gap = i;
+            }
+        }
+        _entries[gap].key = 0;
+        _entries[gap].backend = nullptr;
+        _count--;
+    }
+
+    struct {
+        uint32_t key;
+        T *backend;
+    } _entries[SIZE] {};
+    uint16_t _count = 0;
+    uint16_t _evict_next = 0;
+};
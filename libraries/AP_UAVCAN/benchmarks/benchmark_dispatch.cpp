@@ -0,0 +1,124 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_UAVCAN/AP_UAVCAN_DispatchTable.h>
+
+/*
+  backend lookup for a simulated bus of 32 nodes all sending a message
+  type of which only the first few have a backend, as happens with
+  several CAN GPS or compass nodes on a bus
+ */
+#define BUS_NODES 32
+#define BUS_BACKENDS 3
+
+struct Backend {
+    uint32_t messages;
+};
+
+static Backend backends[BUS_BACKENDS];
+
+// the detected modules scan used by the sensor drivers before the dispatch table
+static struct DetectedModules {
+    bool detected;
+    uint8_t node_id;
+    Backend *driver;
+} detected_modules[BUS_BACKENDS];
+
+static Backend *scan_backend(uint8_t node_id)
+{
+    for (uint8_t i = 0; i < BUS_BACKENDS; i++) {
+        if (detected_modules[i].driver != nullptr && detected_modules[i].node_id == node_id) {
+            return detected_modules[i].driver;
+        }
+    }
+    bool already_detected = false;
+    for (uint8_t i = 0; i < BUS_BACKENDS; i++) {
+        if (detected_modules[i].detected && detected_modules[i].node_id == node_id) {
+            already_detected = true;
+            break;
+        }
+    }
+    if (!already_detected) {
+        for (uint8_t i = 0; i < BUS_BACKENDS; i++) {
+            if (!detected_modules[i].detected) {
+                detected_modules[i].detected = true;
+                detected_modules[i].node_id = node_id;
+                break;
+            }
+        }
+    }
+    return nullptr;
+}
+
+static void BM_DispatchScan(benchmark::State& state)
+{
+    for (uint8_t i = 0; i < BUS_BACKENDS; i++) {
+        detected_modules[i].detected = true;
+        detected_modules[i].node_id = i + 1;
+        detected_modules[i].driver = &backends[i];
+    }
+
+    uint8_t node_id = 1;
+    while (state.KeepRunning()) {
+        Backend *backend = scan_backend(node_id);
+        if (backend != nullptr) {
+            backend->messages++;
+        }
+        gbenchmark_escape(backend);
+        node_id = node_id % BUS_NODES + 1;
+    }
+}
+
+static void BM_DispatchTable(benchmark::State& state)
+{
+    static AP_UAVCAN_DispatchTable<Backend> table;
+    for (uint8_t node_id = 1; node_id <= BUS_NODES; node_id++) {
+        Backend *backend = node_id <= BUS_BACKENDS ? &backends[node_id - 1] : nullptr;
+        table.set(table.make_key(0, node_id), backend);
+    }
+
+    uint8_t node_id = 1;
+    while (state.KeepRunning()) {
+        Backend *backend = nullptr;
+        if (table.find(table.make_key(0, node_id), backend) && backend != nullptr) {
+            backend->messages++;
+        }
+        gbenchmark_escape(backend);
+        node_id = node_id % BUS_NODES + 1;
+    }
+}
+
+/*
+  as above, but with every node sending four sensor IDs, so there are
+  more sources than the table holds and the ones without a backend
+  keep getting evicted and added again
+ */
+static void BM_DispatchTableChurn(benchmark::State& state)
+{
+    static AP_UAVCAN_DispatchTable<Backend> table;
+    for (uint8_t i = 0; i < BUS_BACKENDS; i++) {
+        table.set(table.make_key(0, i + 1), &backends[i]);
+    }
+
+    uint8_t node_id = 1;
+    uint8_t sensor_id = 0;
+    while (state.KeepRunning()) {
+        const uint32_t key = table.make_key(0, node_id, sensor_id);
+        Backend *backend = nullptr;
+        if (!table.find(key, backend)) {
+            table.set(key, nullptr);
+        } else if (backend != nullptr) {
+            backend->messages++;
+        }
+        gbenchmark_escape(backend);
+        node_id = node_id % BUS_NODES + 1;
+        if (node_id == 1) {
+            sensor_id = (sensor_id + 1) % 4;
+        }
+    }
+}
+
+BENCHMARK(BM_DispatchScan);
+BENCHMARK(BM_DispatchTable);
+BENCHMARK(BM_DispatchTableChurn);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,99 @@
+#include <AP_gtest.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_UAVCAN/AP_UAVCAN_DispatchTable.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+struct Backend {
+    uint8_t id;
+};
+
+static Backend backends[4];
+
+TEST(AP_UAVCAN_DispatchTable, find_set_remove)
+{
+    AP_UAVCAN_DispatchTable<Backend, 8> table;
+    Backend *backend = nullptr;
+
+    const uint32_t key = table.make_key(0, 10);
+    EXPECT_FALSE(table.find(key, backend));
+    EXPECT_TRUE(table.set(key, nullptr));
+    EXPECT_TRUE(table.find(key, backend));
+    EXPECT_EQ(nullptr, backend);
+    EXPECT_TRUE(table.set(key, &backends[0]));
+    EXPECT_TRUE(table.find(key, backend));
+    EXPECT_EQ(&backends[0], backend);
+    EXPECT_EQ(1U, table.count());
+
+    // node 0 and sensor 0 still make a valid key
+    EXPECT_NE(0U, table.make_key(0, 0, 0));
+
+    table.remove(key);
+    EXPECT_FALSE(table.find(key, backend));
+    EXPECT_EQ(0U, table.count());
+}
+
+TEST(AP_UAVCAN_DispatchTable, remove_keeps_probe_chain)
+{
+    AP_UAVCAN_DispatchTable<Backend, 8> table;
+    Backend *backend;
+
+    // fill to capacity so the probe chains wrap and overlap
+    for (uint8_t node = 1; node <= 6; node++) {
+        EXPECT_TRUE(table.set(table.make_key(1, node), &backends[node % 4]));
+    }
+    for (uint8_t removed = 1; removed <= 6; removed++) {
+        table.remove(table.make_key(1, removed));
+        for (uint8_t node = removed + 1; node <= 6; node++) {
+            backend = nullptr;
+            EXPECT_TRUE(table.find(table.make_key(1, node), backend));
+            EXPECT_EQ(&backends[node % 4], backend);
+        }
+    }
+    EXPECT_EQ(0U, table.count());
+}
+
+TEST(AP_UAVCAN_DispatchTable, evicts_sources_without_backend)
+{
+    AP_UAVCAN_DispatchTable<Backend, 8> table;
+    Backend *backend;
+
+    EXPECT_TRUE(table.set(table.make_key(0, 1), &backends[0]));
+    EXPECT_TRUE(table.set(table.make_key(0, 2), &backends[1]));
+
+    // many more silent nodes than the table holds
+    for (uint8_t node = 3; node < 100; node++) {
+        const uint32_t key = table.make_key(0, node);
+        EXPECT_TRUE(table.set(key, nullptr));
+        EXPECT_TRUE(table.find(key, backend));
+        EXPECT_LE(table.count(), 6U);
+    }
+
+    backend = nullptr;
+    EXPECT_TRUE(table.find(table.make_key(0, 1), backend));
+    EXPECT_EQ(&backends[0], backend);
+    backend = nullptr;
+    EXPECT_TRUE(table.find(table.make_key(0, 2), backend));
+    EXPECT_EQ(&backends[1], backend);
+}
+
+TEST(AP_UAVCAN_DispatchTable, full_of_backends)
+{
+    AP_UAVCAN_DispatchTable<Backend, 4> table;
+    Backend *backend;
+
+    for (uint8_t node = 1; node <= 3; node++) {
+        EXPECT_TRUE(table.set(table.make_key(0, node), &backends[node]));
+    }
+    // nothing can be evicted, the caller falls back to the scan
+    EXPECT_FALSE(table.set(table.make_key(0, 4), nullptr));
+    EXPECT_FALSE(table.find(table.make_key(0, 4), backend));
+    // an existing source can still change backend
+    EXPECT_TRUE(table.set(table.make_key(0, 3), nullptr));
+    EXPECT_TRUE(table.set(table.make_key(0, 4), nullptr));
+    EXPECT_FALSE(table.find(table.make_key(0, 3), backend));
+    EXPECT_TRUE(table.find(table.make_key(0, 4), backend));
+}
+
+AP_GTEST_MAIN()
@@ -321,6 +321,12 @@ public:
     // return current packet overhead for a channel
     static uint8_t packet_overhead_chan(mavlink_channel_t chan);
 
+    // throughput of the current or last FTP session
+    static void ftp_stats(class ExpandingString &str);
+
+    // learned routes and per-channel forwarding statistics
+    static void routing_stats(class ExpandingString &str) { routing.get_stats(str); }
+
     // alternative protocol function handler
     FUNCTOR_TYPEDEF(protocol_handler_fn_t, bool, uint8_t, AP_HAL::UARTDriver *);
 
@@ -762,6 +768,28 @@ private:
         int16_t current_session;
         uint32_t last_send_ms;
         uint8_t need_banner_send_mask;
+
+        // burst reads are served from two large blocks of the file,
+        // the next one being read while the link drains the replies
+        struct {
+            uint8_t *data;
+            uint32_t offset;
+            uint16_t length;
+        } blocks[2];
+        uint32_t read_offset; // last offset served from the blocks
+        uint16_t burst_packets;
+
+        // throughput of the current or last session
+        struct {
+            uint32_t start_ms;
+            uint32_t last_ms;
+            uint32_t bytes;
+            uint32_t bursts;
+            uint32_t block_reads;
+            uint32_t prefetches;
+            uint32_t read_us;
+            uint32_t stall_ms;
+        } stats;
     };
     static struct ftp_state ftp;
 
@@ -774,6 +802,11 @@ private:
     void send_ftp_replies(void);
     void ftp_worker(void);
     void ftp_push_replies(pending_ftp &reply);
+    void ftp_burst_read(pending_ftp &request, pending_ftp &reply);
+    static bool ftp_read_block(uint8_t idx, uint32_t offset);
+    static ssize_t ftp_block_read(uint32_t offset, uint8_t *data, uint16_t len);
+    static bool ftp_prefetch(void);
+    static void ftp_invalidate_blocks(void);
 
     void send_distance_sensor(const class AP_RangeFinder_Backend *sensor, const uint8_t instance) const;
 
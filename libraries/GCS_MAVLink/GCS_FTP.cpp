@@ -21,6 +21,7 @@
 #include <AP_Filesystem/AP_Filesystem.h>
 #include <AP_HAL/utility/sparse-endian.h>
 #include <AP_BoardConfig/AP_BoardConfig.h>
+#include <AP_Common/ExpandingString.h>
 
 extern const AP_HAL::HAL& hal;
 
@@ -29,6 +30,20 @@ struct GCS_MAVLINK::ftp_state GCS_MAVLINK::ftp;
 // timeout for session inactivity
 #define FTP_SESSION_TIMEOUT 3000
 
+// size of the blocks burst reads are served from
+#ifndef FTP_READ_BLOCK_SIZE
+#if HAL_MEM_CLASS >= HAL_MEM_CLASS_500
+#define FTP_READ_BLOCK_SIZE 8192
+#else
+#define FTP_READ_BLOCK_SIZE 2048
+#endif
+#endif
+
+// a burst is sized to take about FTP_BURST_PERIOD_MS on the link
+#define FTP_BURST_PERIOD_MS 1000
+#define FTP_BURST_PACKETS_MIN 100
+#define FTP_BURST_PACKETS_MAX 1000
+
 bool GCS_MAVLINK::ftp_init(void) {
 
     // check if ftp is disabled for memory savings
@@ -50,6 +65,12 @@ bool GCS_MAVLINK::ftp_init(void) {
     if (ftp.replies == nullptr) {
         goto failed;
     }
+    for (uint8_t i = 0; i < ARRAY_SIZE(ftp.blocks); i++) {
+        ftp.blocks[i].data = new uint8_t[FTP_READ_BLOCK_SIZE];
+        if (ftp.blocks[i].data == nullptr) {
+            goto failed;
+        }
+    }
 
     if (!hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&GCS_MAVLINK::ftp_worker, void),
                                       "FTP", 3072, AP_HAL::Scheduler::PRIORITY_IO, 0)) {
@@ -63,6 +84,10 @@ failed:
     ftp.requests = nullptr;
     delete ftp.replies;
     ftp.replies = nullptr;
+    for (uint8_t i = 0; i < ARRAY_SIZE(ftp.blocks); i++) {
+        delete[] ftp.blocks[i].data;
+        ftp.blocks[i].data = nullptr;
+    }
 
     return false;
 }
@@ -108,7 +133,8 @@ void GCS_MAVLINK::send_ftp_replies(void)
         return;
     }
 
-    for (uint8_t i = 0; i < 20; i++) {
+    // send as many replies as the link has room for
+    for (uint16_t i = 0; ; i++) {
         if (!HAVE_PAYLOAD_SPACE(chan, FILE_TRANSFER_PROTOCOL)) {
             return;
         }
@@ -167,8 +193,200 @@ void GCS_MAVLINK::ftp_error(struct pending_ftp &response, FTP_ERROR error) {
 void GCS_MAVLINK::ftp_push_replies(pending_ftp &reply)
 {
     while (!ftp.replies->push(reply)) { // we must fit the response, keep shoving it in
-        hal.scheduler->delay(2);
+        // read ahead while the link catches up
+        if (!ftp_prefetch()) {
+            hal.scheduler->delay(2);
+            ftp.stats.stall_ms += 2;
+        }
+    }
+}
+
+/*
+  forget the blocks of the previously open file
+ */
+void GCS_MAVLINK::ftp_invalidate_blocks(void)
+{
+    for (uint8_t i = 0; i < ARRAY_SIZE(ftp.blocks); i++) {
+        ftp.blocks[i].offset = 0;
+        ftp.blocks[i].length = 0;
+    }
+    ftp.read_offset = 0;
+}
+
+/*
+  read the block of the open file at offset into one of the block
+  buffers. A length of zero marks the block as empty
+ */
+bool GCS_MAVLINK::ftp_read_block(uint8_t idx, uint32_t offset)
+{
+    auto &block = ftp.blocks[idx];
+    block.length = 0;
+    const uint32_t start_us = AP_HAL::micros();
+    if (AP::FS().lseek(ftp.fd, offset, SEEK_SET) == -1) {
+        return false;
+    }
+    const ssize_t read_bytes = AP::FS().read(ftp.fd, block.data, FTP_READ_BLOCK_SIZE);
+    if (read_bytes == -1) {
+        return false;
+    }
+    block.offset = offset;
+    block.length = read_bytes;
+    ftp.stats.block_reads++;
+    ftp.stats.read_us += AP_HAL::micros() - start_us;
+    return true;
+}
+
+/*
+  fill data from the open file using the blocks, loading blocks as
+  needed. Returns the number of bytes read, which is short at the end
+  of the file, or -1 on error
+ */
+ssize_t GCS_MAVLINK::ftp_block_read(uint32_t offset, uint8_t *data, uint16_t len)
+{
+    uint16_t copied = 0;
+    while (copied < len) {
+        const uint32_t ofs = offset + copied;
+        int8_t idx = -1;
+        for (uint8_t i = 0; i < ARRAY_SIZE(ftp.blocks); i++) {
+            if (ofs >= ftp.blocks[i].offset && ofs < ftp.blocks[i].offset + ftp.blocks[i].length) {
+                idx = i;
+                break;
+            }
+        }
+        if (idx == -1) {
+            // replace an empty block, or the one furthest back in the file
+            if (ftp.blocks[0].length == 0) {
+                idx = 0;
+            } else if (ftp.blocks[1].length == 0) {
+                idx = 1;
+            } else {
+                idx = ftp.blocks[0].offset < ftp.blocks[1].offset ? 0 : 1;
+            }
+            if (!ftp_read_block(idx, ofs - (ofs % FTP_READ_BLOCK_SIZE))) {
+                return -1;
+            }
+            if (ofs >= ftp.blocks[idx].offset + ftp.blocks[idx].length) {
+                // end of file
+                break;
+            }
+        }
+        const auto &block = ftp.blocks[idx];
+        const uint16_t n = MIN(uint32_t(len - copied), block.offset + block.length - ofs);
+        memcpy(&data[copied], &block.data[ofs - block.offset], n);
+        copied += n;
+        ftp.read_offset = ofs;
+    }
+    return copied;
+}
+
+/*
+  read the block after the one burst reads are being served from, if
+  it isn't already loaded. Returns true if a block was read
+ */
+bool GCS_MAVLINK::ftp_prefetch(void)
+{
+    if (ftp.fd == -1 || ftp.mode != FTP_FILE_MODE::Read) {
+        return false;
+    }
+    uint8_t current = 0;
+    if (ftp.blocks[1].length != 0 &&
+        (ftp.blocks[0].length == 0 || ftp.blocks[1].offset > ftp.blocks[0].offset)) {
+        current = 1;
+    }
+    const auto &block = ftp.blocks[current];
+    if (block.length != FTP_READ_BLOCK_SIZE ||
+        ftp.read_offset < block.offset ||
+        ftp.read_offset >= block.offset + block.length) {
+        // nothing being read, we are at the end of the file, or the
+        // next block is already loaded
+        return false;
+    }
+    if (!ftp_read_block(1 - current, block.offset + FTP_READ_BLOCK_SIZE)) {
+        return false;
     }
+    ftp.stats.prefetches++;
+    return true;
+}
+
+/*
+  send a burst of replies from the open file starting at the request offset
+ */
+void GCS_MAVLINK::ftp_burst_read(pending_ftp &request, pending_ftp &reply)
+{
+    const uint16_t max_read = (request.size == 0?sizeof(reply.data):request.size);
+    const uint16_t transfer_size = ftp.burst_packets;
+    const uint32_t burst_start_ms = AP_HAL::millis();
+    ftp.stats.bursts++;
+
+    uint16_t i;
+    for (i = 0; (i < transfer_size); i++) {
+        // fill the buffer
+        const ssize_t read_bytes = ftp_block_read(request.offset + i * max_read, reply.data, max_read);
+        if (read_bytes == -1) {
+            ftp_error(reply, FTP_ERROR::FailErrno);
+            break;
+        }
+
+        if (read_bytes != sizeof(reply.data)) {
+            // don't send any old data
+            memset(reply.data + read_bytes, 0, sizeof(reply.data) - read_bytes);
+        }
+
+        if (read_bytes == 0) {
+            ftp_error(reply, FTP_ERROR::EndOfFile);
+            break;
+        }
+
+        reply.opcode = FTP_OP::Ack;
+        reply.offset = request.offset + i * max_read;
+        reply.burst_complete = (i == (transfer_size - 1));
+        reply.size = (uint8_t)read_bytes;
+
+        ftp_push_replies(reply);
+        ftp.stats.bytes += read_bytes;
+
+        if (read_bytes < max_read) {
+            // ensure the NACK which we send next is at the right offset
+            reply.offset += read_bytes;
+        }
+
+        // prep the reply to be used again
+        reply.seq_number++;
+    }
+
+    ftp.stats.last_ms = AP_HAL::millis();
+    if (i == transfer_size) {
+        // the reply queue fills at the rate the link drains it, so
+        // size the next burst from how long this one took
+        const uint32_t dt_ms = MAX(ftp.stats.last_ms - burst_start_ms, 1U);
+        ftp.burst_packets = constrain_int32(uint32_t(transfer_size) * FTP_BURST_PERIOD_MS / dt_ms,
+                                            FTP_BURST_PACKETS_MIN, FTP_BURST_PACKETS_MAX);
+    }
+}
+
+void GCS_MAVLINK::ftp_stats(ExpandingString &str)
+{
+    const uint32_t dt_ms = ftp.stats.last_ms - ftp.stats.start_ms;
+    const float rate_kbps = dt_ms > 0 ? ftp.stats.bytes / float(dt_ms) : 0;
+    const uint32_t read_us_avg = ftp.stats.block_reads > 0 ? ftp.stats.read_us / ftp.stats.block_reads : 0;
+    str.printf("bytes:         %u\n"
+               "time_ms:       %u\n"
+               "rate_kBps:     %.1f\n"
+               "bursts:        %u\n"
+               "burst_packets: %u\n"
+               "block_reads:   %u\n"
+               "prefetches:    %u\n"
+               "read_us_avg:   %u\n"
+               "stall_ms:      %u\n",
+               unsigned(ftp.stats.bytes),
+               unsigned(dt_ms),
+               (double)rate_kbps,
+               unsigned(ftp.stats.bursts),
+               unsigned(ftp.burst_packets),
+               unsigned(ftp.stats.block_reads),
+               unsigned(ftp.stats.prefetches),
+               unsigned(read_us_avg),
+               unsigned(ftp.stats.stall_ms));
 }
 
 void GCS_MAVLINK::ftp_worker(void) {
@@ -289,6 +507,11 @@ void GCS_MAVLINK::ftp_worker(void) {
                         }
                         ftp.mode = FTP_FILE_MODE::Read;
                         ftp.current_session = request.session;
+                        ftp_invalidate_blocks();
+                        ftp.burst_packets = FTP_BURST_PACKETS_MIN;
+                        memset(&ftp.stats, 0, sizeof(ftp.stats));
+                        ftp.stats.start_ms = now;
+                        ftp.stats.last_ms = now;
 
                         reply.opcode = FTP_OP::Ack;
                         reply.size = sizeof(uint32_t);
@@ -484,7 +707,6 @@ void GCS_MAVLINK::ftp_worker(void) {
                     }
                 case FTP_OP::BurstReadFile:
                     {
-                        const uint16_t max_read = (request.size == 0?sizeof(reply.data):request.size);
                         // must actually be working on a file
                         if (ftp.fd == -1) {
                             ftp_error(reply, FTP_ERROR::FileNotFound);
@@ -497,46 +719,7 @@ void GCS_MAVLINK::ftp_worker(void) {
                             break;
                         }
 
-                        // seek to requested offset
-                        if (AP::FS().lseek(ftp.fd, request.offset, SEEK_SET) == -1) {
-                            ftp_error(reply, FTP_ERROR::FailErrno);
-                            break;
-                        }
-
-                        const uint32_t transfer_size = 100;
-                        for (uint32_t i = 0; (i < transfer_size); i++) {
-                            // fill the buffer
-                            const ssize_t read_bytes = AP::FS().read(ftp.fd, reply.data, max_read);
-                            if (read_bytes == -1) {
-                                ftp_error(reply, FTP_ERROR::FailErrno);
-                                break;
-                            }
-
-                            if (read_bytes != sizeof(reply.data)) {
-                                // don't send any old data
-                                memset(reply.data + read_bytes, 0, sizeof(reply.data) - read_bytes);
-                            }
-
-                            if (read_bytes == 0) {
-                                ftp_error(reply, FTP_ERROR::EndOfFile);
-                                break;
-                            }
-
-                            reply.opcode = FTP_OP::Ack;
-                            reply.offset = request.offset + i * max_read;
-                            reply.burst_complete = (i == (transfer_size - 1));
-                            reply.size = (uint8_t)read_bytes;
-
-                            ftp_push_replies(reply);
-
-                            if (read_bytes < max_read) {
-                                // ensure the NACK which we send next is at the right offset
-                                reply.offset += read_bytes;
-                            }
-
-                            // prep the reply to be used again
-                            reply.seq_number++;
-                        }
+                        ftp_burst_read(request, reply);
 
                         if (reply.opcode != FTP_OP::Nack) {
                             // prevent a duplicate packet send for
@@ -40,6 +40,22 @@
 
 #include "include/mavlink/v2.0/mavlink_types.h"
 
+/*
+  MAVLink2 packet signing and signature checking are done in
+  GCS_Signing.cpp with the SHA-256 from AP_Math, which uses the CPU's
+  SHA instructions where it has them
+ */
+#define MAVLINK_NO_SIGN_PACKET
+#define MAVLINK_NO_SIGNATURE_CHECK
+uint8_t mavlink_sign_packet(mavlink_signing_t *signing,
+                            uint8_t signature[MAVLINK_SIGNATURE_BLOCK_LEN],
+                            const uint8_t *header, uint8_t header_len,
+                            const uint8_t *packet, uint8_t packet_len,
+                            const uint8_t crc[2]);
+bool mavlink_signature_check(mavlink_signing_t *signing,
+                             mavlink_signing_streams_t *signing_streams,
+                             const mavlink_message_t *msg);
+
 /// MAVLink stream used for uartA
 extern AP_HAL::UARTDriver	*mavlink_comm_port[MAVLINK_COMM_NUM_BUFFERS];
 extern bool gcs_alternative_active[MAVLINK_COMM_NUM_BUFFERS];
@@ -16,6 +16,7 @@
  */
 
 #include "GCS.h"
+#include <AP_Math/sha256.h>
 
 extern const AP_HAL::HAL& hal;
 
@@ -264,3 +265,131 @@ uint8_t GCS_MAVLINK::packet_overhead_chan(mavlink_channel_t chan)
     return MAVLINK_NUM_NON_PAYLOAD_BYTES + reserved_space;
 }
 
+/*
+  create the signature block for a packet. This replaces the
+  implementation in the generated MAVLink headers so the hash uses
+  the accelerated SHA-256.
+
+  The 32 byte secret key is only half a SHA-256 block, so there is no
+  keyed midstate to precompute. The first block compression always
+  covers the key, header and start of the payload
+ */
+uint8_t mavlink_sign_packet(mavlink_signing_t *signing,
+                            uint8_t signature[MAVLINK_SIGNATURE_BLOCK_LEN],
+                            const uint8_t *header, uint8_t header_len,
+                            const uint8_t *packet, uint8_t packet_len,
+                            const uint8_t crc[2])
+{
+    if (signing == nullptr || !(signing->flags & MAVLINK_SIGNING_FLAG_SIGN_OUTGOING)) {
+        return 0;
+    }
+
+    // link ID and 48 bit little endian timestamp
+    signature[0] = signing->link_id;
+    const uint64_t timestamp = signing->timestamp++;
+    memcpy(&signature[1], &timestamp, 6);
+
+    SHA256 ctx;
+    ctx.update(signing->secret_key, sizeof(signing->secret_key));
+    ctx.update(header, header_len);
+    ctx.update(packet, packet_len);
+    ctx.update(crc, 2);
+    ctx.update(signature, 7);
+    ctx.final_48(&signature[7]);
+
+    return MAVLINK_SIGNATURE_BLOCK_LEN;
+}
+
+/*
+  check the signature block of a packet, replacing the implementation
+  in the generated MAVLink headers.
+
+  The stream is found and its timestamp checked before the hash, so
+  replayed and stale packets are rejected without hashing them. The
+  streams and our timestamp are only changed once the signature is
+  known to be good, so forged packets leave no trace beyond
+  last_status, and nothing here needs a lock
+ */
+bool mavlink_signature_check(mavlink_signing_t *signing,
+                             mavlink_signing_streams_t *signing_streams,
+                             const mavlink_message_t *msg)
+{
+    if (signing == nullptr) {
+        return true;
+    }
+    if (signing_streams == nullptr) {
+        signing->last_status = MAVLINK_SIGNING_STATUS_NO_STREAMS;
+        return false;
+    }
+
+    const uint8_t *psig = msg->signature;
+    const uint8_t link_id = psig[0];
+    uint64_t timestamp = 0;
+    memcpy(&timestamp, &psig[1], 6);
+
+    uint16_t i;
+    for (i=0; i<signing_streams->num_signing_streams; i++) {
+        if (msg->sysid == signing_streams->stream[i].sysid &&
+            msg->compid == signing_streams->stream[i].compid &&
+            link_id == signing_streams->stream[i].link_id) {
+            break;
+        }
+    }
+    if (i == signing_streams->num_signing_streams) {
+        if (i >= MAVLINK_MAX_SIGNING_STREAMS) {
+            // over max number of streams
+            signing->last_status = MAVLINK_SIGNING_STATUS_TOO_MANY_STREAMS;
+            return false;
+        }
+        // new stream. Only accept if timestamp is not more than 1 minute old
+        if (timestamp + 6000*1000UL < signing->timestamp) {
+            signing->last_status = MAVLINK_SIGNING_STATUS_OLD_TIMESTAMP;
+            return false;
+        }
+    } else {
+        uint64_t last_timestamp = 0;
+        memcpy(&last_timestamp, signing_streams->stream[i].timestamp_bytes, 6);
+        if (timestamp <= last_timestamp) {
+            // repeating old timestamp
+            signing->last_status = MAVLINK_SIGNING_STATUS_REPLAY;
+            return false;
+        }
+    }
+
+    SHA256 ctx;
+    ctx.update(signing->secret_key, sizeof(signing->secret_key));
+    ctx.update(&msg->magic, MAVLINK_NUM_HEADER_BYTES);
+    ctx.update(_MAV_PAYLOAD(msg), msg->len);
+    ctx.update(msg->ck, 2);
+    ctx.update(psig, 7);
+    uint8_t signature[6];
+    ctx.final_48(signature);
+
+    // compare in constant time
+    uint8_t diff = 0;
+    for (uint8_t j=0; j<sizeof(signature); j++) {
+        diff |= signature[j] ^ psig[7+j];
+    }
+    if (diff != 0) {
+        signing->last_status = MAVLINK_SIGNING_STATUS_BAD_SIGNATURE;
+        return false;
+    }
+
+    if (i == signing_streams->num_signing_streams) {
+        // add new stream
+        signing_streams->stream[i].sysid = msg->sysid;
+        signing_streams->stream[i].compid = msg->compid;
+        signing_streams->stream[i].link_id = link_id;
+        signing_streams->num_signing_streams++;
+    }
+
+    // remember last timestamp
+    memcpy(signing_streams->stream[i].timestamp_bytes, &psig[1], 6);
+
+    // our next timestamp must be at least this timestamp
+    if (timestamp > signing->timestamp) {
+        signing->timestamp = timestamp;
+    }
+    signing->last_status = MAVLINK_SIGNING_STATUS_OK;
+    return true;
+}
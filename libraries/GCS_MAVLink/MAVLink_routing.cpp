@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include <AP_HAL/AP_HAL.h>
 #include <AP_Common/AP_Common.h>
+#include <AP_Common/ExpandingString.h>
 #include "GCS.h"
 #include "MAVLink_routing.h"
 
@@ -26,6 +27,9 @@ extern const AP_HAL::HAL& hal;
 
 #define ROUTING_DEBUG 0
 
+static_assert(MAVLINK_MAX_ROUTES < 256, "route_hash holds route index plus one in a uint8_t");
+static_assert(MAVLINK_COMM_NUM_BUFFERS <= 8, "channel masks are uint8_t");
+
 // constructor
 MAVLink_routing::MAVLink_routing(void) : num_routes(0) {}
 
@@ -139,42 +143,44 @@ bool MAVLink_routing::check_and_forward(mavlink_channel_t in_channel, const mavl
         return true;
     }
 
-    // forward on any channels matching the targets
-    bool forwarded = false;
-    bool sent_to_chan[MAVLINK_COMM_NUM_BUFFERS];
-    memset(sent_to_chan, 0, sizeof(sent_to_chan));
-    for (uint8_t i=0; i<num_routes; i++) {
-
-        // Skip if channel is private and the target system or component IDs do not match
-        if ((GCS_MAVLINK::is_private(routes[i].channel)) &&
-            (target_system != routes[i].sysid ||
-             target_component != routes[i].compid)) {
-            continue;
+    // work out the channels matching the targets
+    const uint8_t private_mask = GCS_MAVLINK::private_channel_mask();
+    uint8_t mask = 0;
+    if (broadcast_system) {
+        for (uint8_t i=0; i<num_routes; i++) {
+            mask |= routes[i].chan_mask;
         }
+        mask &= ~private_mask;
+    } else {
+        if (broadcast_component || !match_system) {
+            // any component of the target system will do
+            mask = sysid_chan_mask[target_system] & ~private_mask;
+        }
+        if (target_component != -1) {
+            // private channels only get packets addressed exactly to
+            // a route on them
+            const struct route *r = find_route(target_system, target_component);
+            if (r != nullptr) {
+                mask |= r->chan_mask;
+            }
+        }
+    }
+    mask &= ~(1U<<(in_channel-MAVLINK_COMM_0));
 
-        if (broadcast_system || (target_system == routes[i].sysid &&
-                                 (broadcast_component || 
-                                  target_component == routes[i].compid ||
-                                  !match_system))) {
-
-            if (in_channel != routes[i].channel && !sent_to_chan[routes[i].channel]) {
-                
-                if (comm_get_txspace(routes[i].channel) >= ((uint16_t)msg.len) +
-                    GCS_MAVLINK::packet_overhead_chan(routes[i].channel)) {
+    const bool forwarded = (mask != 0);
+    if (forwarded) {
 #if ROUTING_DEBUG
-                    ::printf("fwd msg %u from chan %u on chan %u sysid=%d compid=%d\n",
-                             msg.msgid,
-                             (unsigned)in_channel,
-                             (unsigned)routes[i].channel,
-                             (int)target_system,
-                             (int)target_component);
+        ::printf("fwd msg %u from chan %u on chans 0x%02x sysid=%d compid=%d\n",
+                 msg.msgid,
+                 (unsigned)in_channel,
+                 (unsigned)mask,
+                 (int)target_system,
+                 (int)target_component);
 #endif
-                    _mavlink_resend_uart(routes[i].channel, &msg);
-                }
-                sent_to_chan[routes[i].channel] = true;
-                forwarded = true;
-            }
-        }
+        // encode once and send the same bytes on every channel
+        uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+        const uint16_t len = mavlink_msg_to_send_buffer(frame, &msg);
+        forward_frame(frame, len, mask);
     }
 
     if ((!forwarded && match_system) ||
@@ -201,43 +207,37 @@ void MAVLink_routing::send_to_components(uint32_t msgid, const char *pkt, uint8_
 
 void MAVLink_routing::send_to_components(const char *pkt, const mavlink_msg_entry_t *entry, const uint8_t pkt_len)
 {
-    bool sent_to_chan[MAVLINK_COMM_NUM_BUFFERS] {};
+#if CONFIG_HAL_BOARD == HAL_BOARD_SITL
+    if (entry->max_msg_len > pkt_len) {
+        AP_HAL::panic("Passed packet message length (%u > %u)",
+                      entry->max_msg_len, pkt_len);
+    }
+#endif
 
-    // check learned routes
-    for (uint8_t i=0; i<num_routes; i++) {
-        if (routes[i].sysid != mavlink_system.sysid) {
-            // our system ID hasn't been seen on this link
-            continue;
-        }
-        if (sent_to_chan[routes[i].channel]) {
-            // we've already send it on this link
+    // channels our system ID has been seen on
+    const uint8_t mask = sysid_chan_mask[mavlink_system.sysid];
+
+    for (uint8_t i=0; i<MAVLINK_COMM_NUM_BUFFERS; i++) {
+        if (!(mask & (1U<<i))) {
             continue;
         }
-        if (comm_get_txspace(routes[i].channel) <
-            ((uint16_t)entry->max_msg_len) + GCS_MAVLINK::packet_overhead_chan(routes[i].channel)) {
+        const mavlink_channel_t channel = (mavlink_channel_t)(MAVLINK_COMM_0 + i);
+        if (comm_get_txspace(channel) <
+            ((uint16_t)entry->max_msg_len) + GCS_MAVLINK::packet_overhead_chan(channel)) {
             // it doesn't fit on this channel
             continue;
         }
 #if ROUTING_DEBUG
-        ::printf("send msg %u on chan %u sysid=%u compid=%u\n",
+        ::printf("send msg %u on chan %u\n",
                  entry->msgid,
-                 (unsigned)routes[i].channel,
-                 (unsigned)routes[i].sysid,
-                 (unsigned)routes[i].compid);
-#endif
-#if CONFIG_HAL_BOARD == HAL_BOARD_SITL
-        if (entry->max_msg_len > pkt_len) {
-            AP_HAL::panic("Passed packet message length (%u > %u)",
-                          entry->max_msg_len, pkt_len);
-        }
+                 (unsigned)channel);
 #endif
-        _mav_finalize_message_chan_send(routes[i].channel,
+        _mav_finalize_message_chan_send(channel,
                                         entry->msgid,
                                         pkt,
                                         entry->min_msg_len,
                                         MIN(entry->max_msg_len, pkt_len),
                                         entry->crc_extra);
-        sent_to_chan[routes[i].channel] = true;
     }
 }
 
@@ -261,12 +261,40 @@ bool MAVLink_routing::find_by_mavtype(uint8_t mavtype, uint8_t &sysid, uint8_t &
     return false;
 }
 
+/*
+  hash a sysid/compid to its first slot in route_hash
+*/
+static inline uint16_t route_hash_slot(uint8_t sysid, uint8_t compid, uint16_t size)
+{
+    const uint32_t key = (uint32_t(sysid)<<8) | compid;
+    return ((key * 2654435761U) >> 16) & (size-1);
+}
+
+/*
+  find the route for a sysid/compid
+*/
+struct MAVLink_routing::route *MAVLink_routing::find_route(uint8_t sysid, uint8_t compid)
+{
+    uint16_t slot = route_hash_slot(sysid, compid, ROUTE_HASH_SIZE);
+    for (uint16_t n=0; n<ROUTE_HASH_SIZE; n++) {
+        const uint8_t idx = route_hash[slot];
+        if (idx == 0) {
+            return nullptr;
+        }
+        struct route &r = routes[idx-1];
+        if (r.sysid == sysid && r.compid == compid) {
+            return &r;
+        }
+        slot = (slot + 1) & (ROUTE_HASH_SIZE-1);
+    }
+    return nullptr;
+}
+
 /*
   see if the message is for a new route and learn it
 */
 void MAVLink_routing::learn_route(mavlink_channel_t in_channel, const mavlink_message_t &msg)
 {
-    uint8_t i;
     if (msg.sysid == 0) {
         // don't learn routes to the broadcast system
         return;
@@ -283,24 +311,22 @@ void MAVLink_routing::learn_route(mavlink_channel_t in_channel, const mavlink_me
         // should also process them locally.
         return;
     }
-    for (i=0; i<num_routes; i++) {
-        if (routes[i].sysid == msg.sysid &&
-            routes[i].compid == msg.compid &&
-            routes[i].channel == in_channel) {
-            if (routes[i].mavtype == 0 && msg.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
-                routes[i].mavtype = mavlink_msg_heartbeat_get_type(&msg);
-            }
-            break;
+    const uint8_t chan_bit = 1U<<(in_channel-MAVLINK_COMM_0);
+    struct route *r = find_route(msg.sysid, msg.compid);
+    if (r == nullptr) {
+        if (num_routes >= MAVLINK_MAX_ROUTES) {
+            // table is full
+            return;
         }
-    }
-    if (i == num_routes && i<MAVLINK_MAX_ROUTES) {
-        routes[i].sysid = msg.sysid;
-        routes[i].compid = msg.compid;
-        routes[i].channel = in_channel;
-        if (msg.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
-            routes[i].mavtype = mavlink_msg_heartbeat_get_type(&msg);
+        r = &routes[num_routes++];
+        r->sysid = msg.sysid;
+        r->compid = msg.compid;
+        r->channel = in_channel;
+        uint16_t slot = route_hash_slot(msg.sysid, msg.compid, ROUTE_HASH_SIZE);
+        while (route_hash[slot] != 0) {
+            slot = (slot + 1) & (ROUTE_HASH_SIZE-1);
         }
-        num_routes++;
+        route_hash[slot] = num_routes;
 #if ROUTING_DEBUG
         ::printf("learned route %u %u via %u\n",
                  (unsigned)msg.sysid,
@@ -308,9 +334,13 @@ void MAVLink_routing::learn_route(mavlink_channel_t in_channel, const mavlink_me
                  (unsigned)in_channel);
 #endif
     }
+    r->chan_mask |= chan_bit;
+    sysid_chan_mask[msg.sysid] |= chan_bit;
+    if (r->mavtype == 0 && msg.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
+        r->mavtype = mavlink_msg_heartbeat_get_type(&msg);
+    }
 }
 
-
 /*
   special handling for heartbeat messages. To ensure routing
   propagation heartbeat messages need to be forwarded on all channels
@@ -328,10 +358,9 @@ void MAVLink_routing::handle_heartbeat(mavlink_channel_t in_channel, const mavli
     mask &= ~no_route_mask;
     
     // mask out channels that are known sources for this sysid/compid
-    for (uint8_t i=0; i<num_routes; i++) {
-        if (routes[i].sysid == msg.sysid && routes[i].compid == msg.compid) {
-            mask &= ~(1U<<((unsigned)(routes[i].channel-MAVLINK_COMM_0)));
-        }
+    const struct route *r = find_route(msg.sysid, msg.compid);
+    if (r != nullptr) {
+        mask &= ~r->chan_mask;
     }
 
     if (mask == 0) {
@@ -339,23 +368,18 @@ void MAVLink_routing::handle_heartbeat(mavlink_channel_t in_channel, const mavli
         return;
     }
 
-    // send on the remaining channels
-    for (uint8_t i=0; i<MAVLINK_COMM_NUM_BUFFERS; i++) {
-        if (mask & (1U<<i)) {
-            mavlink_channel_t channel = (mavlink_channel_t)(MAVLINK_COMM_0 + i);
-            if (comm_get_txspace(channel) >= ((uint16_t)msg.len) +
-                GCS_MAVLINK::packet_overhead_chan(channel)) {
 #if ROUTING_DEBUG
-                ::printf("fwd HB from chan %u on chan %u from sysid=%u compid=%u\n",
-                         (unsigned)in_channel,
-                         (unsigned)channel,
-                         (unsigned)msg.sysid,
-                         (unsigned)msg.compid);
+    ::printf("fwd HB from chan %u on chans 0x%02x from sysid=%u compid=%u\n",
+             (unsigned)in_channel,
+             (unsigned)mask,
+             (unsigned)msg.sysid,
+             (unsigned)msg.compid);
 #endif
-                _mavlink_resend_uart(channel, &msg);
-            }
-        }
-    }
+
+    // send on the remaining channels
+    uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+    const uint16_t len = mavlink_msg_to_send_buffer(frame, &msg);
+    forward_frame(frame, len, mask);
 }
 
 
@@ -378,3 +402,135 @@ void MAVLink_routing::get_targets(const mavlink_message_t &msg, int16_t &sysid,
     }
 }
 
+
+/*
+  length of the encoded frame starting with hdr, which must hold at
+  least the first 3 bytes
+*/
+static uint16_t frame_length(const uint8_t *hdr)
+{
+    if (hdr[0] == MAVLINK_STX_MAVLINK1) {
+        return hdr[1] + MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 + MAVLINK_NUM_CHECKSUM_BYTES;
+    }
+    uint16_t len = hdr[1] + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+    if (hdr[2] & MAVLINK_IFLAG_SIGNED) {
+        len += MAVLINK_SIGNATURE_BLOCK_LEN;
+    }
+    return len;
+}
+
+/*
+  write a whole frame to a channel. The channel lock keeps other
+  senders from interleaving with it
+*/
+void MAVLink_routing::write_frame(mavlink_channel_t chan, const uint8_t *frame, uint16_t len)
+{
+    comm_send_lock(chan);
+    while (len > 0) {
+        const uint8_t n = MIN(len, 255U);
+        comm_send_buffer(chan, frame, n);
+        frame += n;
+        len -= n;
+    }
+    comm_send_unlock(chan);
+}
+
+/*
+  forward an encoded frame on the channels in mask
+*/
+void MAVLink_routing::forward_frame(const uint8_t *frame, uint16_t len, uint8_t mask)
+{
+    for (uint8_t i=0; i<MAVLINK_COMM_NUM_BUFFERS; i++) {
+        if (!(mask & (1U<<i))) {
+            continue;
+        }
+        const mavlink_channel_t channel = (mavlink_channel_t)(MAVLINK_COMM_0 + i);
+
+        // frames must go out in order, so anything already queued
+        // goes first
+        send_queued(channel);
+        ByteBuffer *q = queue[i];
+        if ((q == nullptr || q->is_empty()) &&
+            comm_get_txspace(channel) >= len) {
+            write_frame(channel, frame, len);
+            stats[i].forwarded++;
+            continue;
+        }
+
+#if MAVLINK_ROUTING_QUEUE_SIZE > 0
+        if (q == nullptr) {
+            q = new ByteBuffer(MAVLINK_ROUTING_QUEUE_SIZE);
+            if (q != nullptr && q->get_size() == 0) {
+                delete q;
+                q = nullptr;
+            }
+            queue[i] = q;
+        }
+#endif
+        if (q == nullptr || q->space() < len) {
+            stats[i].dropped++;
+            continue;
+        }
+        q->write(frame, len);
+        stats[i].queued++;
+        stats[i].queue_max = MAX(stats[i].queue_max, uint16_t(q->available()));
+    }
+}
+
+/*
+  send as many queued forwarded frames on a channel as will fit
+*/
+void MAVLink_routing::send_queued(mavlink_channel_t chan)
+{
+    ByteBuffer *q = queue[chan-MAVLINK_COMM_0];
+    if (q == nullptr) {
+        return;
+    }
+    uint8_t hdr[3];
+    while (q->peekbytes(hdr, sizeof(hdr)) == sizeof(hdr)) {
+        const uint16_t len = frame_length(hdr);
+        if (comm_get_txspace(chan) < len) {
+            break;
+        }
+        uint32_t n;
+        const uint8_t *p = q->readptr(n);
+        if (n >= len) {
+            write_frame(chan, p, len);
+        } else {
+            // the frame wraps around the end of the queue
+            uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+            q->peekbytes(frame, len);
+            write_frame(chan, frame, len);
+        }
+        q->advance(len);
+        stats[chan-MAVLINK_COMM_0].forwarded++;
+    }
+}
+
+/*
+  routing statistics for @SYS/routing.txt
+*/
+void MAVLink_routing::get_stats(ExpandingString &str)
+{
+    str.printf("routes: %u/%u\n", unsigned(num_routes), unsigned(MAVLINK_MAX_ROUTES));
+    for (uint8_t i=0; i<num_routes; i++) {
+        str.printf("  %3u/%-3u type=%-3u chans=0x%02x\n",
+                   unsigned(routes[i].sysid),
+                   unsigned(routes[i].compid),
+                   unsigned(routes[i].mavtype),
+                   unsigned(routes[i].chan_mask));
+    }
+    for (uint8_t i=0; i<MAVLINK_COMM_NUM_BUFFERS; i++) {
+        if (stats[i].forwarded == 0 && stats[i].dropped == 0) {
+            continue;
+        }
+        const ByteBuffer *q = queue[i];
+        str.printf("chan%u: fwd=%u queued=%u dropped=%u qlen=%u qmax=%u\n",
+                   unsigned(i),
+                   unsigned(stats[i].forwarded),
+                   unsigned(stats[i].queued),
+                   unsigned(stats[i].dropped),
+                   unsigned(q != nullptr ? q->available() : 0),
+                   unsigned(stats[i].queue_max));
+    }
+}
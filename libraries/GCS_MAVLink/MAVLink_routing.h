@@ -3,12 +3,39 @@
 #pragma once
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/utility/RingBuffer.h>
 #include <AP_Common/AP_Common.h>
 #include "GCS_MAVLink.h"
 
-// 20 routes should be enough for now. This may need to increase as
-// we make more extensive use of MAVLink forwarding
+/*
+  the number of sysid/compid combinations we can learn routes
+  for. Each route may be reachable over several channels
+ */
+#ifndef MAVLINK_MAX_ROUTES
+#if HAL_MEM_CLASS >= HAL_MEM_CLASS_500
+#define MAVLINK_MAX_ROUTES 64
+#else
 #define MAVLINK_MAX_ROUTES 20
+#endif
+#endif
+
+/*
+  size of the per-channel queue of forwarded frames waiting for
+  transmit space, 0 to drop frames which don't fit immediately
+ */
+#ifndef MAVLINK_ROUTING_QUEUE_SIZE
+#if HAL_MEM_CLASS >= HAL_MEM_CLASS_300
+#define MAVLINK_ROUTING_QUEUE_SIZE 2048
+#else
+#define MAVLINK_ROUTING_QUEUE_SIZE 0
+#endif
+#endif
+
+// smallest power of two at least twice the number of routes
+static constexpr uint16_t mavlink_route_hash_size(uint16_t routes, uint16_t size=1)
+{
+    return size >= 2*routes ? size : mavlink_route_hash_size(routes, size*2);
+}
 
 /*
   object to handle MAVLink packet routing
@@ -44,20 +71,43 @@ public:
      */
     bool find_by_mavtype(uint8_t mavtype, uint8_t &sysid, uint8_t &compid, mavlink_channel_t &channel);
 
+    // send as many queued forwarded frames on a channel as will fit
+    void send_queued(mavlink_channel_t chan);
+
+    // routing statistics for @SYS/routing.txt
+    void get_stats(class ExpandingString &str);
+
 private:
-    // a simple linear routing table. We don't expect to have a lot of
-    // routes, so a scalable structure isn't worthwhile yet.
+    // routes in the order they were learned, so find_by_mavtype()
+    // returns the first match
     uint8_t num_routes;
     struct route {
         uint8_t sysid;
         uint8_t compid;
+        // channel the route was first learned on
         mavlink_channel_t channel;
         uint8_t mavtype;
+        // all channels the route has been seen on
+        uint8_t chan_mask;
     } routes[MAVLINK_MAX_ROUTES];
-    
+
+    /*
+      open addressed hash of sysid/compid to index in routes[] plus
+      one, 0 for an empty slot. Routes are never removed, so linear
+      probing needs no tombstones
+     */
+    static const uint16_t ROUTE_HASH_SIZE = mavlink_route_hash_size(MAVLINK_MAX_ROUTES);
+    uint8_t route_hash[ROUTE_HASH_SIZE];
+
+    // channels each sysid has been seen on, over all its compids
+    uint8_t sysid_chan_mask[256];
+
     // a channel mask to block routing as required
     uint8_t no_route_mask;
-    
+
+    // find a route, returns nullptr if it is not known
+    struct route *find_route(uint8_t sysid, uint8_t compid);
+
     // learn new routes
     void learn_route(mavlink_channel_t in_channel, const mavlink_message_t &msg);
 
@@ -68,4 +118,24 @@ private:
     void handle_heartbeat(mavlink_channel_t in_channel, const mavlink_message_t &msg);
 
     void send_to_components(const char *pkt, const mavlink_msg_entry_t *entry, uint8_t pkt_len);
+
+    /*
+      forward an encoded frame on the channels in mask. Frames go
+      straight out if nothing is queued and there is room, otherwise
+      they are queued behind earlier frames or dropped
+     */
+    void forward_frame(const uint8_t *frame, uint16_t len, uint8_t mask);
+
+    // write a whole frame to a channel
+    void write_frame(mavlink_channel_t chan, const uint8_t *frame, uint16_t len);
+
+    // frames waiting for transmit space, allocated on first use
+    ByteBuffer *queue[MAVLINK_COMM_NUM_BUFFERS];
+
+    struct {
+        uint32_t forwarded;
+        uint32_t queued;
+        uint32_t dropped;
+        uint16_t queue_max;
+    } stats[MAVLINK_COMM_NUM_BUFFERS];
 };
@@ -0,0 +1,343 @@
+#include <AP_gtest.h>
+
+#include <AP_Common/ExpandingString.h>
+#include <GCS_MAVLink/GCS.h>
+#include <GCS_MAVLink/GCS_Dummy.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+const AP_Param::GroupInfo GCS_MAVLINK_Parameters::var_info[] = {
+    AP_GROUPEND
+};
+
+/*
+  a channel which keeps what is written to it, as long as it fits in
+  the transmit space the test gives it
+ */
+class StubUART : public AP_HAL::UARTDriver {
+public:
+    void begin(uint32_t baud) override {}
+    void begin(uint32_t baud, uint16_t rxSpace, uint16_t txSpace) override {}
+    void end() override {}
+    void flush() override {}
+    bool is_initialized() override { return true; }
+    void set_blocking_writes(bool blocking) override {}
+    bool tx_pending() override { return false; }
+
+    uint32_t available() override { return 0; }
+    int16_t read() override { return -1; }
+    bool discard_input() override { return true; }
+
+    uint32_t txspace() override { return space; }
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override {
+        size = MIN(size, size_t(MIN(space, sizeof(buf) - len)));
+        memcpy(&buf[len], buffer, size);
+        len += size;
+        space -= size;
+        return size;
+    }
+
+    void reset(uint32_t _space) {
+        space = _space;
+        len = 0;
+    }
+
+    uint32_t space;
+    uint8_t buf[4096];
+    uint32_t len;
+};
+
+/*
+  GCS with a stub UART on every channel
+ */
+class GCS_Routing_Test : public GCS_Dummy {
+public:
+    void setup_stub_channels(StubUART *uarts) {
+        while (_num_gcs < MAVLINK_COMM_NUM_BUFFERS) {
+            _chan[_num_gcs] = new_gcs_mavlink_backend(chan_parameters[_num_gcs], uarts[_num_gcs]);
+            mavlink_comm_port[_num_gcs] = &uarts[_num_gcs];
+            _num_gcs++;
+        }
+    }
+};
+
+static GCS_Routing_Test _gcs;
+static StubUART uarts[MAVLINK_COMM_NUM_BUFFERS];
+
+#define OUR_SYSID 1
+#define OUR_COMPID 1
+#define GCS_SYSID 255
+#define GCS_COMPID 190
+#define GCS_CHAN MAVLINK_COMM_0
+#define PRIVATE_CHAN MAVLINK_COMM_3
+
+/*
+  each test gets an empty route table. The GCS is on GCS_CHAN and
+  PRIVATE_CHAN is a private channel
+ */
+class MAVLinkRouting : public ::testing::Test {
+protected:
+    void SetUp() override {
+        _gcs.setup_stub_channels(uarts);
+        GCS_MAVLINK::set_channel_private(PRIVATE_CHAN);
+        mavlink_system.sysid = OUR_SYSID;
+        mavlink_system.compid = OUR_COMPID;
+        // routes are never removed, so a new table is needed per test
+        routing = new MAVLink_routing();
+        ASSERT_NE(routing, nullptr);
+        reset_uarts();
+    }
+
+    void TearDown() override {
+        delete routing;
+    }
+
+    void reset_uarts(uint32_t space=1024) {
+        for (StubUART &u : uarts) {
+            u.reset(space);
+        }
+    }
+
+    static mavlink_message_t heartbeat(uint8_t sysid, uint8_t compid, uint8_t type) {
+        mavlink_heartbeat_t hb {};
+        hb.type = type;
+        mavlink_message_t msg;
+        mavlink_msg_heartbeat_encode(sysid, compid, &msg, &hb);
+        return msg;
+    }
+
+    static mavlink_message_t command(uint8_t target_system, uint8_t target_component, float param1=0) {
+        mavlink_command_long_t cmd {};
+        cmd.command = MAV_CMD_REQUEST_MESSAGE;
+        cmd.param1 = param1;
+        cmd.target_system = target_system;
+        cmd.target_component = target_component;
+        mavlink_message_t msg;
+        mavlink_msg_command_long_encode(GCS_SYSID, GCS_COMPID, &msg, &cmd);
+        return msg;
+    }
+
+    // bitmask of the channels which have had something written
+    uint8_t written_mask(void) const {
+        uint8_t mask = 0;
+        for (uint8_t i=0; i<MAVLINK_COMM_NUM_BUFFERS; i++) {
+            if (uarts[i].len != 0) {
+                mask |= 1U<<i;
+            }
+        }
+        return mask;
+    }
+
+    // true if the channel has had exactly the encoded frames of msgs
+    // written to it
+    bool channel_holds(mavlink_channel_t chan, const mavlink_message_t *msgs, uint8_t count) const {
+        const StubUART &u = uarts[chan];
+        uint32_t ofs = 0;
+        for (uint8_t i=0; i<count; i++) {
+            uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+            const uint16_t len = mavlink_msg_to_send_buffer(frame, &msgs[i]);
+            if (ofs + len > u.len || memcmp(&u.buf[ofs], frame, len) != 0) {
+                return false;
+            }
+            ofs += len;
+        }
+        return ofs == u.len;
+    }
+
+    MAVLink_routing *routing;
+};
+
+TEST_F(MAVLinkRouting, targeted_to_component)
+{
+    // components of our own system on several channels, plus one of
+    // another system
+    routing->check_and_forward(GCS_CHAN, heartbeat(GCS_SYSID, GCS_COMPID, MAV_TYPE_GCS));
+    routing->check_and_forward(MAVLINK_COMM_1, heartbeat(OUR_SYSID, MAV_COMP_ID_CAMERA, MAV_TYPE_CAMERA));
+    routing->check_and_forward(MAVLINK_COMM_2, heartbeat(OUR_SYSID, MAV_COMP_ID_GIMBAL, MAV_TYPE_GIMBAL));
+    routing->check_and_forward(MAVLINK_COMM_2, heartbeat(5, 1, MAV_TYPE_QUADROTOR));
+    // heartbeats are not forwarded to inactive channels
+    EXPECT_EQ(written_mask(), 0);
+
+    // a command for a known component only goes to its channel, and
+    // is not for us
+    mavlink_message_t msg = command(OUR_SYSID, MAV_COMP_ID_CAMERA);
+    EXPECT_FALSE(routing->check_and_forward(GCS_CHAN, msg));
+    EXPECT_EQ(written_mask(), 1U<<MAVLINK_COMM_1);
+    EXPECT_TRUE(channel_holds(MAVLINK_COMM_1, &msg, 1));
+
+    // unknown components of our system are us
+    reset_uarts();
+    EXPECT_TRUE(routing->check_and_forward(GCS_CHAN, command(OUR_SYSID, MAV_COMP_ID_ONBOARD_COMPUTER)));
+    EXPECT_EQ(written_mask(), 0);
+
+    // so is our own component
+    EXPECT_TRUE(routing->check_and_forward(GCS_CHAN, command(OUR_SYSID, OUR_COMPID)));
+    EXPECT_EQ(written_mask(), 0);
+
+    // any component of another system goes where the system was seen
+    msg = command(5, 99);
+    EXPECT_FALSE(routing->check_and_forward(GCS_CHAN, msg));
+    EXPECT_EQ(written_mask(), 1U<<MAVLINK_COMM_2);
+    EXPECT_TRUE(channel_holds(MAVLINK_COMM_2, &msg, 1));
+
+    // nothing goes back where it came from
+    reset_uarts();
+    EXPECT_FALSE(routing->check_and_forward(MAVLINK_COMM_2, command(5, 1)));
+    EXPECT_EQ(written_mask(), 0);
+}
+
+TEST_F(MAVLinkRouting, broadcast)
+{
+    routing->check_and_forward(GCS_CHAN, heartbeat(GCS_SYSID, GCS_COMPID, MAV_TYPE_GCS));
+    routing->check_and_forward(MAVLINK_COMM_1, heartbeat(OUR_SYSID, MAV_COMP_ID_CAMERA, MAV_TYPE_CAMERA));
+    routing->check_and_forward(MAVLINK_COMM_2, heartbeat(5, 1, MAV_TYPE_QUADROTOR));
+
+    // goes to every channel with a route except the incoming one, and
+    // is processed locally
+    const mavlink_message_t msg = command(0, 0);
+    EXPECT_TRUE(routing->check_and_forward(GCS_CHAN, msg));
+    EXPECT_EQ(written_mask(), (1U<<MAVLINK_COMM_1) | (1U<<MAVLINK_COMM_2));
+    EXPECT_TRUE(channel_holds(MAVLINK_COMM_1, &msg, 1));
+    EXPECT_TRUE(channel_holds(MAVLINK_COMM_2, &msg, 1));
+
+    // all components of a system
+    reset_uarts();
+    EXPECT_TRUE(routing->check_and_forward(GCS_CHAN, command(OUR_SYSID, 0)));
+    EXPECT_EQ(written_mask(), 1U<<MAVLINK_COMM_1);
+}
+
+TEST_F(MAVLinkRouting, private_channel)
+{
+    routing->check_and_forward(GCS_CHAN, heartbeat(GCS_SYSID, GCS_COMPID, MAV_TYPE_GCS));
+
+    // nothing is learned or forwarded from a private channel
+    EXPECT_TRUE(routing->check_and_forward(PRIVATE_CHAN, heartbeat(OUR_SYSID, MAV_COMP_ID_CAMERA, MAV_TYPE_CAMERA)));
+    EXPECT_TRUE(routing->check_and_forward(PRIVATE_CHAN, command(0, 0)));
+    EXPECT_EQ(written_mask(), 0);
+    uint8_t sysid, compid;
+    mavlink_channel_t chan;
+    EXPECT_FALSE(routing->find_by_mavtype(MAV_TYPE_CAMERA, sysid, compid, chan));
+
+    // and broadcasts don't go to it
+    routing->check_and_forward(MAVLINK_COMM_1, heartbeat(5, 1, MAV_TYPE_QUADROTOR));
+    EXPECT_TRUE(routing->check_and_forward(GCS_CHAN, command(0, 0)));
+    EXPECT_EQ(written_mask(), 1U<<MAVLINK_COMM_1);
+}
+
+/*
+  fill the route table with keys which share most of their bits, and
+  check every lookup against a linear search of what was learned
+ */
+TEST_F(MAVLinkRouting, route_table)
+{
+    const mavlink_channel_t chans[] { MAVLINK_COMM_1, MAVLINK_COMM_2, MAVLINK_COMM_4 };
+    struct {
+        uint8_t sysid;
+        uint8_t compid;
+        mavlink_channel_t chan;
+    } learned[MAVLINK_MAX_ROUTES];
+    uint16_t nlearned = 0;
+
+    routing->check_and_forward(GCS_CHAN, heartbeat(GCS_SYSID, GCS_COMPID, MAV_TYPE_GCS));
+    learned[nlearned++] = { GCS_SYSID, GCS_COMPID, GCS_CHAN };
+    for (uint16_t i=0; nlearned<MAVLINK_MAX_ROUTES; i++) {
+        const uint8_t sysid = (i & 1) ? OUR_SYSID : 2 + (i & 6);
+        const uint8_t compid = 2 + (i >> 1) * 4;
+        const mavlink_channel_t chan = chans[i % ARRAY_SIZE(chans)];
+        routing->check_and_forward(chan, heartbeat(sysid, compid, 100 + nlearned));
+        learned[nlearned++] = { sysid, compid, chan };
+    }
+
+    // the table is full, so this one is not learned
+    routing->check_and_forward(MAVLINK_COMM_5, heartbeat(OUR_SYSID, 255, 99));
+
+    ExpandingString *str = new ExpandingString();
+    routing->get_stats(*str);
+    char expected[32];
+    snprintf(expected, sizeof(expected), "routes: %u/%u\n", unsigned(MAVLINK_MAX_ROUTES), unsigned(MAVLINK_MAX_ROUTES));
+    EXPECT_EQ(strncmp(str->get_string(), expected, strlen(expected)), 0);
+    delete str;
+
+    // routes are found by type in the order they were learned
+    for (uint16_t i=0; i<nlearned; i++) {
+        uint8_t sysid, compid;
+        mavlink_channel_t chan;
+        const uint8_t type = i == 0 ? uint8_t(MAV_TYPE_GCS) : uint8_t(100 + i);
+        ASSERT_TRUE(routing->find_by_mavtype(type, sysid, compid, chan));
+        EXPECT_EQ(sysid, learned[i].sysid);
+        EXPECT_EQ(compid, learned[i].compid);
+        EXPECT_EQ(chan, learned[i].chan);
+    }
+    uint8_t sysid, compid;
+    mavlink_channel_t chan;
+    EXPECT_FALSE(routing->find_by_mavtype(99, sysid, compid, chan));
+
+    // commands to components of our own system are routed by
+    // sysid/compid alone, so each goes to exactly the channels the
+    // reference has for it
+    for (uint16_t compid=0; compid<256; compid++) {
+        if (compid == 0 || compid == OUR_COMPID) {
+            continue;
+        }
+        uint8_t expected_mask = 0;
+        for (uint16_t i=0; i<nlearned; i++) {
+            if (learned[i].sysid == OUR_SYSID && learned[i].compid == compid) {
+                expected_mask |= 1U<<learned[i].chan;
+            }
+        }
+        reset_uarts();
+        const bool local = routing->check_and_forward(GCS_CHAN, command(OUR_SYSID, compid));
+        EXPECT_EQ(written_mask(), expected_mask) << "compid " << compid;
+        EXPECT_EQ(local, expected_mask == 0) << "compid " << compid;
+    }
+}
+
+#if MAVLINK_ROUTING_QUEUE_SIZE > 0
+TEST_F(MAVLinkRouting, queued_frames)
+{
+    routing->check_and_forward(GCS_CHAN, heartbeat(GCS_SYSID, GCS_COMPID, MAV_TYPE_GCS));
+    routing->check_and_forward(MAVLINK_COMM_1, heartbeat(OUR_SYSID, MAV_COMP_ID_CAMERA, MAV_TYPE_CAMERA));
+
+    // no room on the channel, so frames are queued in order
+    mavlink_message_t msgs[4];
+    uarts[MAVLINK_COMM_1].reset(0);
+    for (uint8_t i=0; i<ARRAY_SIZE(msgs); i++) {
+        msgs[i] = command(OUR_SYSID, MAV_COMP_ID_CAMERA, i);
+        EXPECT_FALSE(routing->check_and_forward(GCS_CHAN, msgs[i]));
+    }
+    EXPECT_EQ(written_mask(), 0);
+
+    // room for two and a half frames sends two
+    uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+    const uint16_t len = mavlink_msg_to_send_buffer(frame, &msgs[0]);
+    uarts[MAVLINK_COMM_1].reset(2*len + len/2);
+    routing->send_queued(MAVLINK_COMM_1);
+    EXPECT_TRUE(channel_holds(MAVLINK_COMM_1, msgs, 2));
+
+    // a new frame goes out behind the ones still queued
+    uarts[MAVLINK_COMM_1].reset(1024);
+    msgs[0] = msgs[2];
+    msgs[1] = msgs[3];
+    msgs[2] = command(OUR_SYSID, MAV_COMP_ID_CAMERA, 4);
+    EXPECT_FALSE(routing->check_and_forward(GCS_CHAN, msgs[2]));
+    EXPECT_TRUE(channel_holds(MAVLINK_COMM_1, msgs, 3));
+
+    // once the queue is full frames are dropped whole
+    uarts[MAVLINK_COMM_1].reset(0);
+    const uint16_t fits = (MAVLINK_ROUTING_QUEUE_SIZE-1) / len;
+    for (uint16_t i=0; i<fits+5; i++) {
+        EXPECT_FALSE(routing->check_and_forward(GCS_CHAN, command(OUR_SYSID, MAV_COMP_ID_CAMERA, i)));
+    }
+    uarts[MAVLINK_COMM_1].reset(sizeof(uarts[MAVLINK_COMM_1].buf));
+    routing->send_queued(MAVLINK_COMM_1);
+    EXPECT_EQ(uarts[MAVLINK_COMM_1].len, uint32_t(fits*len));
+
+    ExpandingString *str = new ExpandingString();
+    routing->get_stats(*str);
+    EXPECT_NE(strstr(str->get_string(), "dropped=5 "), nullptr);
+    delete str;
+}
+#endif
+
+AP_GTEST_MAIN()
@@ -0,0 +1,176 @@
+#include <AP_gtest.h>
+
+#include <AP_Math/sha256.h>
+#include <GCS_MAVLink/GCS_MAVLink.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  frames are signed on one channel and parsed on another, as by a GCS
+  and a vehicle sharing a key, so they go through mavlink_sign_packet()
+  and mavlink_signature_check() from GCS_Signing.cpp
+ */
+#define TX_CHAN MAVLINK_COMM_1
+#define RX_CHAN MAVLINK_COMM_2
+#define LINK_ID 3
+// in 10us units since 2015, as the signing timestamp is
+#define TIMESTAMP 200000000000ULL
+
+class MAVLinkSigning : public ::testing::Test {
+protected:
+    void SetUp() override {
+        memset(&tx_signing, 0, sizeof(tx_signing));
+        for (uint8_t i=0; i<sizeof(tx_signing.secret_key); i++) {
+            tx_signing.secret_key[i] = i * 7 + 3;
+        }
+        tx_signing.flags = MAVLINK_SIGNING_FLAG_SIGN_OUTGOING;
+        tx_signing.link_id = LINK_ID;
+        tx_signing.timestamp = TIMESTAMP;
+
+        memset(&rx_signing, 0, sizeof(rx_signing));
+        memcpy(rx_signing.secret_key, tx_signing.secret_key, sizeof(rx_signing.secret_key));
+        rx_signing.timestamp = TIMESTAMP - 100;
+        rx_signing.last_status = MAVLINK_SIGNING_STATUS_NONE;
+        memset(&streams, 0, sizeof(streams));
+
+        mavlink_status_t *tx = mavlink_get_channel_status(TX_CHAN);
+        tx->signing = &tx_signing;
+        tx->flags &= ~MAVLINK_STATUS_FLAG_OUT_MAVLINK1;
+
+        mavlink_status_t *rx = mavlink_get_channel_status(RX_CHAN);
+        mavlink_reset_channel_status(RX_CHAN);
+        rx->signing = &rx_signing;
+        rx->signing_streams = &streams;
+    }
+
+    void TearDown() override {
+        mavlink_get_channel_status(TX_CHAN)->signing = nullptr;
+        mavlink_status_t *rx = mavlink_get_channel_status(RX_CHAN);
+        rx->signing = nullptr;
+        rx->signing_streams = nullptr;
+    }
+
+    // a signed heartbeat from sysid/compid, returning its length
+    uint16_t signed_frame(uint8_t frame[MAVLINK_MAX_PACKET_LEN], uint8_t sysid=255, uint8_t compid=190) {
+        mavlink_message_t msg;
+        mavlink_msg_heartbeat_pack_chan(sysid, compid, TX_CHAN, &msg,
+                                        MAV_TYPE_GCS, MAV_AUTOPILOT_INVALID, 0, 0, MAV_STATE_ACTIVE);
+        return mavlink_msg_to_send_buffer(frame, &msg);
+    }
+
+    // feed a frame to the receive channel, returning the framing
+    // result of its last byte
+    uint8_t parse(const uint8_t *frame, uint16_t len) {
+        mavlink_message_t msg;
+        mavlink_status_t status;
+        uint8_t ret = MAVLINK_FRAMING_INCOMPLETE;
+        for (uint16_t i=0; i<len; i++) {
+            ret = mavlink_frame_char(RX_CHAN, frame[i], &msg, &status);
+        }
+        return ret;
+    }
+
+    mavlink_signing_t tx_signing;
+    mavlink_signing_t rx_signing;
+    mavlink_signing_streams_t streams;
+};
+
+TEST_F(MAVLinkSigning, sign_and_check)
+{
+    uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+    const uint16_t len = signed_frame(frame);
+
+    // a signed MAVLink2 frame, with the signature block at the end
+    ASSERT_EQ(frame[0], MAVLINK_STX);
+    ASSERT_TRUE(frame[2] & MAVLINK_IFLAG_SIGNED);
+    ASSERT_EQ(len, MAVLINK_NUM_NON_PAYLOAD_BYTES + frame[1] + MAVLINK_SIGNATURE_BLOCK_LEN);
+    const uint8_t *sig = &frame[len - MAVLINK_SIGNATURE_BLOCK_LEN];
+    EXPECT_EQ(sig[0], LINK_ID);
+    uint64_t timestamp = 0;
+    memcpy(&timestamp, &sig[1], 6);
+    EXPECT_EQ(timestamp, TIMESTAMP);
+    EXPECT_EQ(tx_signing.timestamp, TIMESTAMP + 1);
+
+    // the signature is the first 48 bits of the SHA-256 of the key
+    // and everything in the frame before it
+    uint8_t buf[sizeof(tx_signing.secret_key) + MAVLINK_MAX_PACKET_LEN];
+    memcpy(buf, tx_signing.secret_key, sizeof(tx_signing.secret_key));
+    memcpy(&buf[sizeof(tx_signing.secret_key)], frame, len - 6);
+    uint8_t digest[SHA256::DIGEST_LEN];
+    SHA256::hash(buf, sizeof(tx_signing.secret_key) + len - 6, digest);
+    EXPECT_EQ(memcmp(&sig[7], digest, 6), 0);
+
+    // and is accepted by the receiver, which learns the stream
+    EXPECT_EQ(parse(frame, len), MAVLINK_FRAMING_OK);
+    EXPECT_EQ(rx_signing.last_status, MAVLINK_SIGNING_STATUS_OK);
+    EXPECT_EQ(streams.num_signing_streams, 1);
+    EXPECT_EQ(streams.stream[0].sysid, 255);
+    EXPECT_EQ(streams.stream[0].compid, 190);
+    EXPECT_EQ(streams.stream[0].link_id, LINK_ID);
+    EXPECT_EQ(rx_signing.timestamp, TIMESTAMP);
+
+    // later frames on the same stream are accepted too
+    EXPECT_EQ(parse(frame, signed_frame(frame)), MAVLINK_FRAMING_OK);
+    EXPECT_EQ(rx_signing.last_status, MAVLINK_SIGNING_STATUS_OK);
+    EXPECT_EQ(streams.num_signing_streams, 1);
+}
+
+TEST_F(MAVLinkSigning, replay)
+{
+    uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+    const uint16_t len = signed_frame(frame);
+    EXPECT_EQ(parse(frame, len), MAVLINK_FRAMING_OK);
+    EXPECT_EQ(parse(frame, len), MAVLINK_FRAMING_BAD_SIGNATURE);
+    EXPECT_EQ(rx_signing.last_status, MAVLINK_SIGNING_STATUS_REPLAY);
+}
+
+TEST_F(MAVLinkSigning, bad_signature)
+{
+    uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+    uint8_t forged[MAVLINK_MAX_PACKET_LEN];
+    const uint16_t len = signed_frame(frame);
+    memcpy(forged, frame, len);
+    forged[len-1] ^= 0x01;
+
+    // a forged signature is rejected and changes nothing
+    EXPECT_EQ(parse(forged, len), MAVLINK_FRAMING_BAD_SIGNATURE);
+    EXPECT_EQ(rx_signing.last_status, MAVLINK_SIGNING_STATUS_BAD_SIGNATURE);
+    EXPECT_EQ(streams.num_signing_streams, 0);
+    EXPECT_EQ(rx_signing.timestamp, TIMESTAMP - 100);
+
+    // so the real frame with the same timestamp is still accepted
+    EXPECT_EQ(parse(frame, len), MAVLINK_FRAMING_OK);
+    EXPECT_EQ(rx_signing.last_status, MAVLINK_SIGNING_STATUS_OK);
+
+    // a frame signed with another key is rejected too
+    tx_signing.secret_key[0] ^= 0x80;
+    EXPECT_EQ(parse(frame, signed_frame(frame)), MAVLINK_FRAMING_BAD_SIGNATURE);
+    EXPECT_EQ(rx_signing.last_status, MAVLINK_SIGNING_STATUS_BAD_SIGNATURE);
+}
+
+TEST_F(MAVLinkSigning, new_streams)
+{
+    uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+
+    // a new stream more than a minute behind us is rejected
+    rx_signing.timestamp = TIMESTAMP + 6000*1000UL + 1;
+    EXPECT_EQ(parse(frame, signed_frame(frame)), MAVLINK_FRAMING_BAD_SIGNATURE);
+    EXPECT_EQ(rx_signing.last_status, MAVLINK_SIGNING_STATUS_OLD_TIMESTAMP);
+    rx_signing.timestamp = TIMESTAMP;
+
+    // as is one more than we have room for
+    streams.num_signing_streams = MAVLINK_MAX_SIGNING_STREAMS;
+    for (uint8_t i=0; i<MAVLINK_MAX_SIGNING_STREAMS; i++) {
+        streams.stream[i].sysid = i + 1;
+        streams.stream[i].compid = 1;
+    }
+    EXPECT_EQ(parse(frame, signed_frame(frame)), MAVLINK_FRAMING_BAD_SIGNATURE);
+    EXPECT_EQ(rx_signing.last_status, MAVLINK_SIGNING_STATUS_TOO_MANY_STREAMS);
+
+    // and there must be streams to check against
+    mavlink_get_channel_status(RX_CHAN)->signing_streams = nullptr;
+    EXPECT_EQ(parse(frame, signed_frame(frame)), MAVLINK_FRAMING_BAD_SIGNATURE);
+    EXPECT_EQ(rx_signing.last_status, MAVLINK_SIGNING_STATUS_NO_STREAMS);
+}
+
+AP_GTEST_MAIN()
@@ -79,13 +79,13 @@ void ADSB::update(void)
         return;
     } else if (_sitl->adsb_plane_count <= 0) {
         return;
-    } else if (_sitl->adsb_plane_count >= num_vehicles_MAX) {
+    } else if (_sitl->adsb_plane_count > num_vehicles_MAX) {
         _sitl->adsb_plane_count.set_and_save(0);
         num_vehicles = 0;
         return;
     } else if (num_vehicles != _sitl->adsb_plane_count) {
         num_vehicles = _sitl->adsb_plane_count;
-        for (uint8_t i=0; i<num_vehicles_MAX; i++) {
+        for (uint16_t i=0; i<num_vehicles_MAX; i++) {
             vehicles[i].initialised = false;
         }
     }
@@ -96,7 +96,7 @@ void ADSB::update(void)
     float delta_t = (now_us - last_update_us) * 1.0e-6f;
     last_update_us = now_us;
 
-    for (uint8_t i=0; i<num_vehicles; i++) {
+    for (uint16_t i=0; i<num_vehicles; i++) {
         vehicles[i].update(delta_t);
     }
     
@@ -188,7 +188,7 @@ void ADSB::send_report(void)
      */
     uint32_t now_us = AP_HAL::micros();
     if (now_us - last_report_us >= reporting_period_ms*1000UL) {
-        for (uint8_t i=0; i<num_vehicles; i++) {
+        for (uint16_t i=0; i<num_vehicles; i++) {
             ADSB_Vehicle &vehicle = vehicles[i];
             Location loc = home;
 
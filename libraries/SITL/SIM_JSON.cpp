@@ -21,12 +21,17 @@
 #include <stdio.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include <AP_HAL/AP_HAL.h>
 #include <AP_Logger/AP_Logger.h>
 #include <AP_HAL/utility/replace.h>
 
 #define UDP_TIMEOUT_MS 100
+#define SHM_TIMEOUT_MS 1000
 
 extern const AP_HAL::HAL& hal;
 
@@ -62,7 +67,15 @@ JSON::JSON(const char *frame_str) :
 
     const char *colon = strchr(frame_str, ':');
     if (colon) {
-        target_ip = colon+1;
+        if (strncmp(colon+1, "shm", 3) == 0) {
+            // json:shm or json:shm:/name selects the shared memory transport
+            use_shm = true;
+            if (colon[4] == ':' && colon[5] != 0) {
+                shm_name = &colon[5];
+            }
+        } else {
+            target_ip = colon+1;
+        }
     }
 
     for (uint8_t i=0; i<ARRAY_SIZE(sim_defaults); i++) {
@@ -82,6 +95,14 @@ JSON::JSON(const char *frame_str) :
 */
 void JSON::set_interface_ports(const char* address, const int port_in, const int port_out)
 {
+    if (use_shm) {
+        if (!shm_open_region()) {
+            AP_HAL::panic("JSON: unable to create shared memory %s", shm_name);
+        }
+        printf("JSON control interface set to shared memory %s\n", shm_name);
+        return;
+    }
+
     sock.set_blocking(false);
     sock.reuseaddress();
 
@@ -98,6 +119,11 @@ void JSON::set_interface_ports(const char* address, const int port_in, const int
 */
 void JSON::output_servos(const struct sitl_input &input)
 {
+    if (use_shm) {
+        output_servos_shm(input);
+        return;
+    }
+
     servo_packet pkt;
     pkt.frame_rate = rate_hz;
     pkt.frame_count = frame_counter;
@@ -199,11 +225,141 @@ uint16_t JSON::parse_sensors(const char *json)
     return received_bitmask;
 }
 
+// the model whose shared memory region is removed at exit
+JSON *JSON::shm_owner;
+
+JSON::~JSON()
+{
+    shm_close_region();
+}
+
 /*
-    Receive new sensor data from simulator
-    This is a blocking function
+    SITL leaves with exit() without deleting the model, so the region
+    is also removed from an atexit() handler
 */
-void JSON::recv_fdm(const struct sitl_input &input)
+void JSON::shm_atexit(void)
+{
+    if (shm_owner != nullptr) {
+        shm_owner->shm_close_region();
+    }
+}
+
+/*
+    Create or attach to the shared memory region used in place of the
+    UDP socket. SITL owns the region and (re)initialises its header
+*/
+bool JSON::shm_open_region(void)
+{
+    const int fd = ::shm_open(shm_name, O_RDWR | O_CREAT, 0600);
+    if (fd == -1) {
+        printf("JSON: shm_open(%s) failed: %s\n", shm_name, strerror(errno));
+        return false;
+    }
+    if (ftruncate(fd, sizeof(JSON_SHM_Region)) != 0) {
+        printf("JSON: ftruncate(%s) failed: %s\n", shm_name, strerror(errno));
+        close(fd);
+        return false;
+    }
+    void *p = mmap(nullptr, sizeof(JSON_SHM_Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        printf("JSON: mmap(%s) failed: %s\n", shm_name, strerror(errno));
+        return false;
+    }
+    shm = (JSON_SHM_Region *)p;
+    memset(shm, 0, sizeof(*shm));
+    shm->version = JSON_SHM_VERSION;
+    // magic is written last so the physics backend never sees a half initialised region
+    json_shm_store(&shm->magic, JSON_SHM_MAGIC);
+
+    if (shm_owner == nullptr) {
+        shm_owner = this;
+        atexit(shm_atexit);
+    }
+    return true;
+}
+
+/*
+    Unmap and remove the shared memory region. A physics backend that
+    still has it mapped keeps its mapping
+*/
+void JSON::shm_close_region(void)
+{
+    if (shm == nullptr) {
+        return;
+    }
+    munmap(shm, sizeof(JSON_SHM_Region));
+    shm = nullptr;
+    ::shm_unlink(shm_name);
+    if (shm_owner == this) {
+        shm_owner = nullptr;
+    }
+}
+
+/*
+    Publish servos into the shared memory slot
+*/
+void JSON::output_servos_shm(const struct sitl_input &input)
+{
+    JSON_SHM_Servos &s = shm->servos;
+    json_shm_write_begin(&s.seq);
+    s.frame_rate = rate_hz;
+    s.frame_count = frame_counter;
+    for (uint8_t i=0; i<ARRAY_SIZE(s.pwm); i++) {
+        s.pwm[i] = input.servos[i];
+    }
+    json_shm_write_end(&s.seq);
+}
+
+/*
+    Wait for the physics backend to answer the current servo frame
+    over shared memory and copy it into state. There is no text to
+    parse, so the returned bitmask is built from the fields word.
+    Returns zero if no answer came within SHM_TIMEOUT_MS, so that a
+    stopped physics backend doesn't stop SITL from exiting. The servos
+    are sent again on the next update
+*/
+uint16_t JSON::recv_fdm_shm(const struct sitl_input &input)
+{
+    JSON_SHM_FDM fdm;
+    const uint32_t start_ms = AP_HAL::millis();
+    while (true) {
+        const uint32_t head = json_shm_load(&shm->fdm_head);
+        if (head != 0) {
+            const JSON_SHM_FDM &slot = shm->fdm[(head-1) % JSON_SHM_RING_SIZE];
+            if (json_shm_read(&slot.seq, &slot, &fdm, sizeof(fdm)) &&
+                fdm.frame_count == frame_counter) {
+                break;
+            }
+        }
+        if (AP_HAL::millis() - start_ms > SHM_TIMEOUT_MS) {
+            // the physics backend may have been stopped or restarted
+            printf("No JSON sensor frame in shared memory, resending servos\n");
+            return 0;
+        }
+        sched_yield();
+    }
+
+    state.timestamp_s = fdm.timestamp_s;
+    state.imu.gyro = Vector3f(fdm.gyro[0], fdm.gyro[1], fdm.gyro[2]);
+    state.imu.accel_body = Vector3f(fdm.accel_body[0], fdm.accel_body[1], fdm.accel_body[2]);
+    state.position = Vector3f(fdm.position[0], fdm.position[1], fdm.position[2]);
+    state.velocity = Vector3f(fdm.velocity[0], fdm.velocity[1], fdm.velocity[2]);
+    state.attitude = Vector3f(fdm.attitude[0], fdm.attitude[1], fdm.attitude[2]);
+    state.quaternion = Quaternion(fdm.quaternion[0], fdm.quaternion[1], fdm.quaternion[2], fdm.quaternion[3]);
+    memcpy(state.rng, fdm.rng, sizeof(state.rng));
+    state.wind_vane_apparent.direction = fdm.wind_vane_direction;
+    state.wind_vane_apparent.speed = fdm.wind_vane_speed;
+
+    const uint16_t optional = EULER_ATT | QUAT_ATT | RNG_1 | RNG_2 | RNG_3 | RNG_4 | RNG_5 | RNG_6 | WIND_DIR | WIND_SPD;
+    return TIMESTAMP | GYRO | ACCEL_BODY | POSITION | VELOCITY | (fdm.fields & optional);
+}
+
+/*
+    Receive one JSON text frame over UDP and parse it into state
+    Returns the bitmask of received fields, zero if none is ready
+*/
+uint16_t JSON::recv_fdm_udp(const struct sitl_input &input)
 {
     // Receive sensor packet
     ssize_t ret = sock.recv(&sensor_buffer[sensor_buffer_len], sizeof(sensor_buffer)-sensor_buffer_len, UDP_TIMEOUT_MS);
@@ -228,18 +384,35 @@ void JSON::recv_fdm(const struct sitl_input &input)
 
     const uint8_t *p2 = (const uint8_t *)memrchr(sensor_buffer, 0, sensor_buffer_len);
     if (p2 == nullptr || p2 == sensor_buffer) {
-        return;
+        return 0;
     }
 
     const uint8_t *p1 = (const uint8_t *)memrchr(sensor_buffer, 0, p2 - sensor_buffer);
     if (p1 == nullptr) {
-        return;
+        return 0;
     }
 
     const uint16_t received_bitmask = parse_sensors((const char *)(p1+1));
     if (received_bitmask == 0) {
         // did not receve one of the mandatory fields
         printf("Did not contain all mandatory fields\n");
+        return 0;
+    }
+
+    memmove(sensor_buffer, p2, sensor_buffer_len - (p2 - sensor_buffer));
+    sensor_buffer_len = sensor_buffer_len - (p2 - sensor_buffer);
+
+    return received_bitmask;
+}
+
+/*
+    Receive new sensor data from simulator
+    This is a blocking function
+*/
+void JSON::recv_fdm(const struct sitl_input &input)
+{
+    const uint16_t received_bitmask = use_shm ? recv_fdm_shm(input) : recv_fdm_udp(input);
+    if (received_bitmask == 0) {
         return;
     }
 
@@ -267,9 +440,6 @@ void JSON::recv_fdm(const struct sitl_input &input)
     }
     last_received_bitmask = received_bitmask;
 
-    memmove(sensor_buffer, p2, sensor_buffer_len - (p2 - sensor_buffer));
-    sensor_buffer_len = sensor_buffer_len - (p2 - sensor_buffer);
-
     accel_body = state.imu.accel_body;
     gyro = state.imu.gyro;
     velocity_ef = state.velocity;
@@ -16,12 +16,14 @@
 
 #include <AP_HAL/utility/Socket.h>
 #include "SIM_Aircraft.h"
+#include "SIM_JSON_SHM.h"
 
 namespace SITL {
 
 class JSON : public Aircraft {
 public:
     JSON(const char *frame_str);
+    ~JSON();
 
     /* update model by one time step */
     void update(const struct sitl_input &input) override;
@@ -51,11 +53,24 @@ private:
 
     SocketAPM sock;
 
+    // shared memory transport, selected with json:shm[:name]
+    bool use_shm;
+    const char *shm_name = JSON_SHM_DEFAULT_NAME;
+    struct JSON_SHM_Region *shm;
+
     uint32_t frame_counter;
     double last_timestamp_s;
 
     void output_servos(const struct sitl_input &input);
     void recv_fdm(const struct sitl_input &input);
+    uint16_t recv_fdm_udp(const struct sitl_input &input);
+
+    bool shm_open_region(void);
+    void shm_close_region(void);
+    static void shm_atexit(void);
+    static JSON *shm_owner;
+    void output_servos_shm(const struct sitl_input &input);
+    uint16_t recv_fdm_shm(const struct sitl_input &input);
 
     uint16_t parse_sensors(const char *json);
 
@@ -0,0 +1,116 @@
+/*
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+  Shared memory transport for the JSON SITL backend.
+
+  This header is deliberately standalone (it only needs stdint.h and stdbool.h) so
+  that external physics engines can include it directly. The region is
+  created by SITL with shm_open() and mapped by the physics backend.
+
+  Both directions use a sequence lock: the writer bumps seq to an odd
+  value, writes the payload and then bumps seq to the next even
+  value. A reader copies the payload and retries if seq was odd or
+  changed while it was copying. SITL is the only writer of the servo
+  slot, the physics backend is the only writer of the FDM ring.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define JSON_SHM_MAGIC      0x314D534AU // "JSM1"
+#define JSON_SHM_VERSION    1
+#define JSON_SHM_RING_SIZE  8
+#define JSON_SHM_DEFAULT_NAME "/ardupilot_json"
+
+// bits in JSON_SHM_FDM::fields, matching the JSON key bitmask
+#define JSON_SHM_FIELD_ATTITUDE    (1U<<4)
+#define JSON_SHM_FIELD_QUATERNION  (1U<<5)
+#define JSON_SHM_FIELD_RNG(i)      (1U<<(7+(i)))
+#define JSON_SHM_FIELD_WIND_DIR    (1U<<13)
+#define JSON_SHM_FIELD_WIND_SPD    (1U<<14)
+
+struct JSON_SHM_Servos {
+    uint32_t seq;
+    uint16_t frame_rate;
+    uint16_t pad;
+    uint32_t frame_count;
+    uint16_t pwm[16];
+};
+
+struct JSON_SHM_FDM {
+    uint32_t seq;
+    uint32_t frame_count;   // frame_count of the servo frame this responds to
+    uint32_t fields;        // JSON_SHM_FIELD_* optional fields present
+    uint32_t pad;
+    double timestamp_s;     // physics time
+    float gyro[3];          // rad/s, body frame
+    float accel_body[3];    // m/s^2, body frame
+    float position[3];      // m, NED from origin
+    float velocity[3];      // m/s, NED
+    float attitude[3];      // roll, pitch, yaw in radians
+    float quaternion[4];
+    float rng[6];           // m
+    float wind_vane_direction; // radians, 0 = head to wind
+    float wind_vane_speed;  // m/s
+};
+
+struct JSON_SHM_Region {
+    uint32_t magic;
+    uint32_t version;
+    struct JSON_SHM_Servos servos;
+    // count of FDM frames published. The physics backend writes
+    // fdm[fdm_head % JSON_SHM_RING_SIZE] and then increments it, so the
+    // newest frame is fdm[(fdm_head-1) % JSON_SHM_RING_SIZE]
+    uint32_t fdm_head;
+    uint32_t pad;
+    struct JSON_SHM_FDM fdm[JSON_SHM_RING_SIZE];
+};
+
+static inline uint32_t json_shm_load(const uint32_t *v)
+{
+    return __atomic_load_n(v, __ATOMIC_ACQUIRE);
+}
+
+static inline void json_shm_store(uint32_t *v, uint32_t value)
+{
+    __atomic_store_n(v, value, __ATOMIC_RELEASE);
+}
+
+/*
+  copy a seqlocked payload out of shared memory. Returns false if the
+  writer was active or changed it during the copy
+ */
+static inline bool json_shm_read(const uint32_t *seq, const void *src, void *dst, uint32_t len)
+{
+    const uint32_t seq1 = json_shm_load(seq);
+    if (seq1 & 1U) {
+        return false;
+    }
+    __builtin_memcpy(dst, src, len);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return json_shm_load(seq) == seq1;
+}
+
+static inline void json_shm_write_begin(uint32_t *seq)
+{
+    json_shm_store(seq, json_shm_load(seq) + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void json_shm_write_end(uint32_t *seq)
+{
+    json_shm_store(seq, json_shm_load(seq) + 1);
+}
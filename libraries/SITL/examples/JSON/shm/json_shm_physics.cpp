@@ -0,0 +1,164 @@
+/*
+  minimal reference physics backend for the JSON SITL shared memory
+  transport
+
+  This is a vertical-only "hover rig": attitude is held level and the
+  average of the first four servo outputs is treated as collective
+  thrust. It exists to exercise and benchmark the transport, not to
+  fly anything interesting.
+
+  build:
+    g++ -O2 -Wall -I../../../.. json_shm_physics.cpp -o json_shm_physics -lrt
+
+  run SITL with --model json:shm (or json:shm:/name) and then start:
+    ./json_shm_physics [--name /name] [--rate 1000]
+ */
+
+#include <SITL/SIM_JSON_SHM.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+static const float GRAVITY_MSS = 9.80665f;
+// thrust to weight ratio at full throttle
+static const float THRUST_TO_WEIGHT = 2.0f;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+static JSON_SHM_Region *attach(const char *name)
+{
+    // SITL creates the region, wait for it to appear
+    while (true) {
+        const int fd = shm_open(name, O_RDWR, 0);
+        if (fd != -1) {
+            void *p = mmap(nullptr, sizeof(JSON_SHM_Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED) {
+                printf("mmap(%s) failed: %s\n", name, strerror(errno));
+                return nullptr;
+            }
+            JSON_SHM_Region *r = (JSON_SHM_Region *)p;
+            if (json_shm_load(&r->magic) == JSON_SHM_MAGIC) {
+                if (r->version != JSON_SHM_VERSION) {
+                    printf("%s: version %u, expected %u\n", name, (unsigned)r->version, JSON_SHM_VERSION);
+                    return nullptr;
+                }
+                return r;
+            }
+            munmap(p, sizeof(JSON_SHM_Region));
+        }
+        usleep(100000);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = JSON_SHM_DEFAULT_NAME;
+    float rate_hz = 1000;
+
+    for (int i=1; i<argc; i++) {
+        if (strcmp(argv[i], "--name") == 0 && i+1 < argc) {
+            name = argv[++i];
+        } else if (strcmp(argv[i], "--rate") == 0 && i+1 < argc) {
+            rate_hz = atof(argv[++i]);
+        } else {
+            printf("Usage: %s [--name /shm_name] [--rate hz]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("Waiting for SITL on %s\n", name);
+    JSON_SHM_Region *shm = attach(name);
+    if (shm == nullptr) {
+        return 1;
+    }
+    printf("Attached to %s\n", name);
+
+    double timestamp_s = 0;
+    float pos_d = 0;
+    float vel_d = 0;
+    uint32_t last_frame_count = UINT32_MAX;
+    uint32_t frames = 0;
+    double last_report_s = now_s();
+
+    while (true) {
+        JSON_SHM_Servos servos;
+        if (!json_shm_read(&shm->servos.seq, &shm->servos, &servos, sizeof(servos)) ||
+            servos.frame_count == last_frame_count) {
+            sched_yield();
+            continue;
+        }
+        if (servos.frame_count < last_frame_count && last_frame_count != UINT32_MAX) {
+            // SITL restarted, reset the vehicle
+            printf("SITL restart detected\n");
+            timestamp_s = 0;
+            pos_d = 0;
+            vel_d = 0;
+        }
+        last_frame_count = servos.frame_count;
+
+        const float dt = 1.0f / rate_hz;
+        float throttle = 0;
+        for (uint8_t i=0; i<4; i++) {
+            throttle += (servos.pwm[i] - 1000) * 0.001f;
+        }
+        throttle = fminf(fmaxf(throttle * 0.25f, 0), 1);
+
+        // specific force along body Z, up is negative
+        float accel_z = -throttle * THRUST_TO_WEIGHT * GRAVITY_MSS;
+        vel_d += (accel_z + GRAVITY_MSS) * dt;
+        pos_d += vel_d * dt;
+        if (pos_d > 0) {
+            // on the ground
+            pos_d = 0;
+            vel_d = 0;
+            accel_z = -GRAVITY_MSS;
+        }
+        timestamp_s += dt;
+
+        const uint32_t head = shm->fdm_head;
+        JSON_SHM_FDM &fdm = shm->fdm[head % JSON_SHM_RING_SIZE];
+        json_shm_write_begin(&fdm.seq);
+        fdm.frame_count = servos.frame_count;
+        fdm.fields = JSON_SHM_FIELD_QUATERNION;
+        fdm.timestamp_s = timestamp_s;
+        memset(fdm.gyro, 0, sizeof(fdm.gyro));
+        fdm.accel_body[0] = 0;
+        fdm.accel_body[1] = 0;
+        fdm.accel_body[2] = accel_z;
+        fdm.position[0] = 0;
+        fdm.position[1] = 0;
+        fdm.position[2] = pos_d;
+        fdm.velocity[0] = 0;
+        fdm.velocity[1] = 0;
+        fdm.velocity[2] = vel_d;
+        fdm.quaternion[0] = 1;
+        fdm.quaternion[1] = 0;
+        fdm.quaternion[2] = 0;
+        fdm.quaternion[3] = 0;
+        json_shm_write_end(&fdm.seq);
+        json_shm_store(&shm->fdm_head, head+1);
+
+        frames++;
+        const double t = now_s();
+        if (t - last_report_s >= 5) {
+            printf("%.0f frames/s, sim time %.1fs, alt %.2fm\n", frames / (t - last_report_s), timestamp_s, -pos_d);
+            frames = 0;
+            last_report_s = t;
+        }
+    }
+    return 0;
+}
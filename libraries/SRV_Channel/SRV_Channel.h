@@ -258,6 +258,10 @@ private:
     AP_Int8 reversed;
     AP_Int16 function;
 
+    // the function the SRV_Channels masks were last built with, so
+    // a change to SERVOn_FUNCTION can be noticed
+    int16_t mask_function;
+
     // a pending output value as PWM
     uint16_t output_pwm;
 
@@ -440,6 +444,9 @@ public:
     // refresh aux servo to function mapping
     static void update_aux_servo_function(void);
 
+    // refresh the mapping if any SERVOn_FUNCTION has changed since
+    static void check_aux_servo_function(void);
+
     // set default channel for an auxiliary function
     static bool set_aux_channel_default(SRV_Channel::Aux_servo_function_t function, uint8_t channel);
 
@@ -564,7 +571,10 @@ private:
     static uint16_t override_counter[NUM_SERVO_CHANNELS];
 
     static struct srv_function {
-        // mask of what channels this applies to
+        // mask of what channels this applies to. This is the channel
+        // list used by all the per-function calls, rebuilt from the
+        // SERVOn_FUNCTION parameters by update_aux_servo_function()
+        // whenever check_aux_servo_function() sees one change
         SRV_Channel::servo_mask_t channel_mask;
 
         // scaled output for this function
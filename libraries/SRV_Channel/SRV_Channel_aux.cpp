@@ -177,6 +177,11 @@ void SRV_Channels::update_aux_servo_function(void)
 
     // set auxiliary ranges
     for (uint8_t i = 0; i < NUM_SERVO_CHANNELS; i++) {
+        if (initialised && channels[i].mask_function != channels[i].function.get()) {
+            // a channel which changed function needs its pwm recalculated
+            SRV_Channel::have_pwm_mask &= ~(1U<<i);
+        }
+        channels[i].mask_function = channels[i].function.get();
         if ((uint8_t)channels[i].function.get() < SRV_Channel::k_nr_aux_servo_functions) {
             channels[i].aux_servo_function_setup();
             function_mask.set((uint8_t)channels[i].function.get());
@@ -186,6 +191,25 @@ void SRV_Channels::update_aux_servo_function(void)
     initialised = true;
 }
 
+/*
+  rebuild the function masks if a SERVOn_FUNCTION parameter has been
+  changed, by the GCS, scripting or a parameter load, since they were
+  last built. This is one compare per channel, so is cheap enough to
+  run every loop
+ */
+void SRV_Channels::check_aux_servo_function(void)
+{
+    if (!initialised) {
+        return;
+    }
+    for (uint8_t i = 0; i < NUM_SERVO_CHANNELS; i++) {
+        if (channels[i].function.get() != channels[i].mask_function) {
+            update_aux_servo_function();
+            return;
+        }
+    }
+}
+
 /// Should be called after the the servo functions have been initialized
 void SRV_Channels::enable_aux_servos()
 {
@@ -257,14 +281,10 @@ void SRV_Channels::enable_by_mask(uint16_t mask)
  */
 void SRV_Channels::set_output_pwm(SRV_Channel::Aux_servo_function_t function, uint16_t value)
 {
-    if (!function_assigned(function)) {
-        return;
-    }
-    for (uint8_t i = 0; i < NUM_SERVO_CHANNELS; i++) {
-        if (channels[i].function.get() == function) {
-            channels[i].set_output_pwm(value);
-            channels[i].output_ch();
-        }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        SRV_Channel &c = channels[__builtin_ctz(mask)];
+        c.set_output_pwm(value);
+        c.output_ch();
     }
 }
 
@@ -276,20 +296,16 @@ void SRV_Channels::set_output_pwm(SRV_Channel::Aux_servo_function_t function, ui
 void
 SRV_Channels::set_output_pwm_trimmed(SRV_Channel::Aux_servo_function_t function, int16_t value)
 {
-    if (!function_assigned(function)) {
-        return;
-    }
-    for (uint8_t i = 0; i < NUM_SERVO_CHANNELS; i++) {
-        if (channels[i].function.get() == function) {
-            int16_t value2;
-            if (channels[i].get_reversed()) {
-                value2 = 1500 - value + channels[i].get_trim();
-            } else {
-                value2 = value - 1500 + channels[i].get_trim();
-            }
-            channels[i].set_output_pwm(constrain_int16(value2,channels[i].get_output_min(),channels[i].get_output_max()));
-            channels[i].output_ch();
-          }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        SRV_Channel &c = channels[__builtin_ctz(mask)];
+        int16_t value2;
+        if (c.get_reversed()) {
+            value2 = 1500 - value + c.get_trim();
+        } else {
+            value2 = value - 1500 + c.get_trim();
+        }
+        c.set_output_pwm(constrain_int16(value2,c.get_output_min(),c.get_output_max()));
+        c.output_ch();
     }
 }
 
@@ -300,13 +316,9 @@ SRV_Channels::set_output_pwm_trimmed(SRV_Channel::Aux_servo_function_t function,
 void
 SRV_Channels::set_trim_to_servo_out_for(SRV_Channel::Aux_servo_function_t function)
 {
-    if (!function_assigned(function)) {
-        return;
-    }
-    for (uint8_t i = 0; i < NUM_SERVO_CHANNELS; i++) {
-        if (channels[i].function.get() == function) {
-            channels[i].servo_trim.set_and_save_ifchanged(channels[i].get_output_pwm());
-        }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        SRV_Channel &c = channels[__builtin_ctz(mask)];
+        c.servo_trim.set_and_save_ifchanged(c.get_output_pwm());
     }
 }
 
@@ -316,19 +328,15 @@ SRV_Channels::set_trim_to_servo_out_for(SRV_Channel::Aux_servo_function_t functi
 void
 SRV_Channels::copy_radio_in_out(SRV_Channel::Aux_servo_function_t function, bool do_input_output)
 {
-    if (!function_assigned(function)) {
-        return;
-    }
-    for (uint8_t i = 0; i < NUM_SERVO_CHANNELS; i++) {
-        if (channels[i].function.get() == function) {
-            RC_Channel *c = rc().channel(channels[i].ch_num);
-            if (c == nullptr) {
-                continue;
-            }
-            channels[i].set_output_pwm(c->get_radio_in());
-            if (do_input_output) {
-                channels[i].output_ch();
-            }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        SRV_Channel &srv = channels[__builtin_ctz(mask)];
+        RC_Channel *c = rc().channel(srv.ch_num);
+        if (c == nullptr) {
+            continue;
+        }
+        srv.set_output_pwm(c->get_radio_in());
+        if (do_input_output) {
+            srv.output_ch();
         }
     }
 }
@@ -357,14 +365,9 @@ SRV_Channels::copy_radio_in_out_mask(uint16_t mask)
 void
 SRV_Channels::set_failsafe_pwm(SRV_Channel::Aux_servo_function_t function, uint16_t pwm)
 {
-    if (!function_assigned(function)) {
-        return;
-    }
-    for (uint8_t i = 0; i < NUM_SERVO_CHANNELS; i++) {
-        const SRV_Channel &c = channels[i];
-        if (c.function.get() == function) {
-            hal.rcout->set_failsafe_pwm(1U<<c.ch_num, pwm);
-        }
+    const uint16_t mask = get_output_channel_mask(function);
+    if (mask != 0) {
+        hal.rcout->set_failsafe_pwm(mask, pwm);
     }
 }
 
@@ -374,15 +377,10 @@ SRV_Channels::set_failsafe_pwm(SRV_Channel::Aux_servo_function_t function, uint1
 void
 SRV_Channels::set_failsafe_limit(SRV_Channel::Aux_servo_function_t function, SRV_Channel::Limit limit)
 {
-    if (!function_assigned(function)) {
-        return;
-    }
-    for (uint8_t i = 0; i < NUM_SERVO_CHANNELS; i++) {
-        const SRV_Channel &c = channels[i];
-        if (c.function.get() == function) {
-            uint16_t pwm = c.get_limit_pwm(limit);
-            hal.rcout->set_failsafe_pwm(1U<<c.ch_num, pwm);
-        }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        const SRV_Channel &c = channels[__builtin_ctz(mask)];
+        uint16_t pwm = c.get_limit_pwm(limit);
+        hal.rcout->set_failsafe_pwm(1U<<c.ch_num, pwm);
     }
 }
 
@@ -392,15 +390,10 @@ SRV_Channels::set_failsafe_limit(SRV_Channel::Aux_servo_function_t function, SRV
 void
 SRV_Channels::set_safety_limit(SRV_Channel::Aux_servo_function_t function, SRV_Channel::Limit limit)
 {
-    if (!function_assigned(function)) {
-        return;
-    }
-    for (uint8_t i = 0; i < NUM_SERVO_CHANNELS; i++) {
-        const SRV_Channel &c = channels[i];
-        if (c.function.get() == function) {
-            uint16_t pwm = c.get_limit_pwm(limit);
-            hal.rcout->set_safety_pwm(1U<<c.ch_num, pwm);
-        }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        const SRV_Channel &c = channels[__builtin_ctz(mask)];
+        uint16_t pwm = c.get_limit_pwm(limit);
+        hal.rcout->set_safety_pwm(1U<<c.ch_num, pwm);
     }
 }
 
@@ -410,21 +403,16 @@ SRV_Channels::set_safety_limit(SRV_Channel::Aux_servo_function_t function, SRV_C
 void
 SRV_Channels::set_output_limit(SRV_Channel::Aux_servo_function_t function, SRV_Channel::Limit limit)
 {
-    if (!function_assigned(function)) {
-        return;
-    }
-    for (uint8_t i = 0; i < NUM_SERVO_CHANNELS; i++) {
-        SRV_Channel &c = channels[i];
-        if (c.function.get() == function) {
-            uint16_t pwm = c.get_limit_pwm(limit);
-            c.set_output_pwm(pwm);
-            if (c.function.get() == SRV_Channel::k_manual) {
-                RC_Channel *cin = rc().channel(c.ch_num);
-                if (cin != nullptr) {
-                    // in order for output_ch() to work for k_manual we
-                    // also have to override radio_in
-                    cin->set_radio_in(pwm);
-                }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        SRV_Channel &c = channels[__builtin_ctz(mask)];
+        uint16_t pwm = c.get_limit_pwm(limit);
+        c.set_output_pwm(pwm);
+        if (function == SRV_Channel::k_manual) {
+            RC_Channel *cin = rc().channel(c.ch_num);
+            if (cin != nullptr) {
+                // in order for output_ch() to work for k_manual we
+                // also have to override radio_in
+                cin->set_radio_in(pwm);
             }
         }
     }
@@ -455,13 +443,11 @@ SRV_Channels::move_servo(SRV_Channel::Aux_servo_function_t function,
     }
     float v = float(value - angle_min) / float(angle_max - angle_min);
     v = constrain_float(v, 0.0f, 1.0f);
-    for (uint8_t i = 0; i < NUM_SERVO_CHANNELS; i++) {
-        SRV_Channel &c = channels[i];
-        if (c.function.get() == function) {
-            float v2 = c.get_reversed()? (1-v) : v;
-            uint16_t pwm = c.servo_min + v2 * (c.servo_max - c.servo_min);
-            c.set_output_pwm(pwm);
-        }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        SRV_Channel &c = channels[__builtin_ctz(mask)];
+        float v2 = c.get_reversed()? (1-v) : v;
+        uint16_t pwm = c.servo_min + v2 * (c.servo_max - c.servo_min);
+        c.set_output_pwm(pwm);
     }
 }
 
@@ -488,8 +474,10 @@ bool SRV_Channels::set_aux_channel_default(SRV_Channel::Aux_servo_function_t fun
     }
     channels[channel].type_setup = false;
     channels[channel].function.set(function);
+    channels[channel].mask_function = function;
     channels[channel].aux_servo_function_setup();
     function_mask.set((uint8_t)function);
+    functions[SRV_Channel::k_none].channel_mask &= ~(1U<<channel);
     functions[function].channel_mask |= 1U<<channel;
     return true;
 }
@@ -497,19 +485,12 @@ bool SRV_Channels::set_aux_channel_default(SRV_Channel::Aux_servo_function_t fun
 // find first channel that a function is assigned to
 bool SRV_Channels::find_channel(SRV_Channel::Aux_servo_function_t function, uint8_t &chan)
 {
-    if (!initialised) {
-        update_aux_servo_function();
-    }
-    if (!function_assigned(function)) {
+    const uint16_t mask = get_output_channel_mask(function);
+    if (mask == 0) {
         return false;
     }
-    for (uint8_t i=0; i<NUM_SERVO_CHANNELS; i++) {
-        if (channels[i].function == function) {
-            chan = channels[i].ch_num;
-            return true;
-        }
-    }
-    return false;
+    chan = __builtin_ctz(mask);
+    return true;
 }
 
 /*
@@ -561,20 +542,17 @@ uint16_t SRV_Channels::get_output_channel_mask(SRV_Channel::Aux_servo_function_t
 // set the trim for a function channel to given pwm
 void SRV_Channels::set_trim_to_pwm_for(SRV_Channel::Aux_servo_function_t function, int16_t pwm)
 {
-    for (uint8_t i=0; i<NUM_SERVO_CHANNELS; i++) {
-        if (channels[i].function == function) {
-            channels[i].servo_trim.set(pwm);
-        }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        channels[__builtin_ctz(mask)].servo_trim.set(pwm);
     }
 }
 
 // set the trim for a function channel to min output
 void SRV_Channels::set_trim_to_min_for(SRV_Channel::Aux_servo_function_t function)
 {
-    for (uint8_t i=0; i<NUM_SERVO_CHANNELS; i++) {
-        if (channels[i].function == function) {
-            channels[i].servo_trim.set(channels[i].get_reversed()?channels[i].servo_max:channels[i].servo_min);
-        }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        SRV_Channel &c = channels[__builtin_ctz(mask)];
+        c.servo_trim.set(c.get_reversed()?c.servo_max:c.servo_min);
     }
 }
 
@@ -584,10 +562,20 @@ void SRV_Channels::set_trim_to_min_for(SRV_Channel::Aux_servo_function_t functio
 void SRV_Channels::set_default_function(uint8_t chan, SRV_Channel::Aux_servo_function_t function)
 {
     if (chan < NUM_SERVO_CHANNELS) {
-        int8_t old = channels[chan].function;
+        const int16_t old = channels[chan].function;
         channels[chan].function.set_default((uint8_t)function);
-        if (old != channels[chan].function && channels[chan].function == function) {
+        if (old != channels[chan].function && channels[chan].function == function &&
+            function < SRV_Channel::k_nr_aux_servo_functions) {
+            // keep the channel masks in step with the new function
+            if (old >= 0 && old < SRV_Channel::k_nr_aux_servo_functions) {
+                functions[old].channel_mask &= ~(1U<<chan);
+                if (functions[old].channel_mask == 0) {
+                    function_mask.clear(old);
+                }
+            }
             function_mask.set((uint8_t)function);
+            functions[function].channel_mask |= 1U<<chan;
+            channels[chan].mask_function = function;
         }
     }
 }
@@ -609,11 +597,9 @@ void SRV_Channels::adjust_trim(SRV_Channel::Aux_servo_function_t function, float
     if (is_zero(v)) {
         return;
     }
-    for (uint8_t i=0; i<NUM_SERVO_CHANNELS; i++) {
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        const uint8_t i = __builtin_ctz(mask);
         SRV_Channel &c = channels[i];
-        if (function != (SRV_Channel::Aux_servo_function_t)(c.function.get())) {
-            continue;
-        }
         float change = c.reversed?-v:v;
         uint16_t new_trim = c.servo_trim;
         if (c.servo_max <= c.servo_min) {
@@ -648,10 +634,9 @@ bool SRV_Channels::get_output_pwm(SRV_Channel::Aux_servo_function_t function, ui
 // set output pwm to trim for the given function
 void SRV_Channels::set_output_to_trim(SRV_Channel::Aux_servo_function_t function)
 {
-    for (uint8_t i=0; i<NUM_SERVO_CHANNELS; i++) {
-        if (channels[i].function == function) {
-            channels[i].set_output_pwm(channels[i].servo_trim);
-        }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        SRV_Channel &c = channels[__builtin_ctz(mask)];
+        c.set_output_pwm(c.servo_trim);
     }
 }
 
@@ -672,14 +657,8 @@ float SRV_Channels::get_output_norm(SRV_Channel::Aux_servo_function_t function)
 // set normalised output (-1 to 1 with 0 at mid point of servo_min/servo_max) for the given function
 void SRV_Channels::set_output_norm(SRV_Channel::Aux_servo_function_t function, float value)
 {
-    if (!function_assigned(function)) {
-        return;
-    }
-    for (uint8_t i=0; i<NUM_SERVO_CHANNELS; i++) {
-        SRV_Channel &c = channels[i];
-        if (c.function == function) {
-            c.set_output_norm(value);
-        }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        channels[__builtin_ctz(mask)].set_output_norm(value);
     }
 }
 
@@ -693,65 +672,56 @@ void SRV_Channels::limit_slew_rate(SRV_Channel::Aux_servo_function_t function, f
         // nothing to do
         return;
     }
-    for (uint8_t i=0; i<NUM_SERVO_CHANNELS; i++) {
-        SRV_Channel &c = channels[i];
-        if (c.function == function) {
-            c.calc_pwm(functions[function].output_scaled);
-            uint16_t last_pwm = hal.rcout->read_last_sent(c.ch_num);
-            if (last_pwm == c.get_output_pwm()) {
-                continue;
-            }
-            uint16_t max_change = (c.get_output_max() - c.get_output_min()) * slew_rate * dt * 0.01f;
-            if (max_change == 0 || dt > 1) {
-                // always allow some change. If dt > 1 then assume we
-                // are just starting out, and only allow a small
-                // change for this loop
-                max_change = 1;
-            }
-            c.set_output_pwm(constrain_int16(c.get_output_pwm(), last_pwm-max_change, last_pwm+max_change));
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        SRV_Channel &c = channels[__builtin_ctz(mask)];
+        c.calc_pwm(functions[function].output_scaled);
+        uint16_t last_pwm = hal.rcout->read_last_sent(c.ch_num);
+        if (last_pwm == c.get_output_pwm()) {
+            continue;
+        }
+        uint16_t max_change = (c.get_output_max() - c.get_output_min()) * slew_rate * dt * 0.01f;
+        if (max_change == 0 || dt > 1) {
+            // always allow some change. If dt > 1 then assume we
+            // are just starting out, and only allow a small
+            // change for this loop
+            max_change = 1;
         }
+        c.set_output_pwm(constrain_int16(c.get_output_pwm(), last_pwm-max_change, last_pwm+max_change));
     }
 }
 
 // call set_angle() on matching channels
 void SRV_Channels::set_angle(SRV_Channel::Aux_servo_function_t function, uint16_t angle)
 {
-    for (uint8_t i=0; i<NUM_SERVO_CHANNELS; i++) {
-        if (channels[i].function == function) {
-            channels[i].set_angle(angle);
-        }
-    }    
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        channels[__builtin_ctz(mask)].set_angle(angle);
+    }
 }
 
 // call set_range() on matching channels
 void SRV_Channels::set_range(SRV_Channel::Aux_servo_function_t function, uint16_t range)
 {
-    for (uint8_t i=0; i<NUM_SERVO_CHANNELS; i++) {
-        if (channels[i].function == function) {
-            channels[i].set_range(range);
-        }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        channels[__builtin_ctz(mask)].set_range(range);
     }
 }
 
 // set MIN parameter for a function
 void SRV_Channels::set_output_min_max(SRV_Channel::Aux_servo_function_t function, uint16_t min_pwm, uint16_t max_pwm)
 {
-    for (uint8_t i=0; i<NUM_SERVO_CHANNELS; i++) {
-        if (channels[i].function == function) {
-            channels[i].set_output_min(min_pwm);
-            channels[i].set_output_max(max_pwm);
-        }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        SRV_Channel &c = channels[__builtin_ctz(mask)];
+        c.set_output_min(min_pwm);
+        c.set_output_max(max_pwm);
     }
 }
 
 // constrain to output min/max for function
 void SRV_Channels::constrain_pwm(SRV_Channel::Aux_servo_function_t function)
 {
-    for (uint8_t i=0; i<NUM_SERVO_CHANNELS; i++) {
-        SRV_Channel &c = channels[i];
-        if (c.function == function) {
-            c.set_output_pwm(constrain_int16(c.output_pwm, c.servo_min, c.servo_max));
-        }
+    for (uint16_t mask = get_output_channel_mask(function); mask != 0; mask &= mask-1) {
+        SRV_Channel &c = channels[__builtin_ctz(mask)];
+        c.set_output_pwm(constrain_int16(c.output_pwm, c.servo_min, c.servo_max));
     }
 }
 
@@ -772,13 +742,7 @@ void SRV_Channels::upgrade_parameters(void)
 // set RC output frequency on a function output
 void SRV_Channels::set_rc_frequency(SRV_Channel::Aux_servo_function_t function, uint16_t frequency_hz)
 {
-    uint16_t mask = 0;
-    for (uint8_t i=0; i<NUM_SERVO_CHANNELS; i++) {
-        SRV_Channel &c = channels[i];
-        if (c.function == function) {
-            mask |= (1U<<c.ch_num);
-        }
-    }
+    const uint16_t mask = get_output_channel_mask(function);
     if (mask != 0) {
         hal.rcout->set_freq(mask, frequency_hz);
     }
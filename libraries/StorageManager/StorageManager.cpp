@@ -275,3 +275,19 @@ void StorageAccess::write_uint32(uint16_t loc, uint32_t value) const
 {
     write_block(loc, &value, sizeof(value));
 }
+
+/*
+  start a storage transaction
+ */
+StorageTransaction::StorageTransaction(void)
+{
+    hal.storage->begin_transaction();
+}
+
+/*
+  end a storage transaction, letting the backend flush
+ */
+StorageTransaction::~StorageTransaction(void)
+{
+    hal.storage->end_transaction();
+}
@@ -102,3 +102,18 @@ private:
     const StorageManager::StorageType type;
     uint16_t total_size;
 };
+
+/*
+  A StorageTransaction holds back flushing of storage to the backing
+  store for its lifetime, so a group of related writes (such as a
+  parameter header and its value) is committed together
+ */
+class StorageTransaction {
+public:
+    StorageTransaction(void);
+    ~StorageTransaction(void);
+
+    /* Do not allow copies */
+    StorageTransaction(const StorageTransaction &other) = delete;
+    StorageTransaction &operator=(const StorageTransaction&) = delete;
+};